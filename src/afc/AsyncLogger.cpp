@@ -0,0 +1,288 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "AsyncLogger.hpp"
+#include "math_utils.h"
+#include "number.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+// POSIX API.
+#include <sys/uio.h>
+#include <unistd.h>
+
+using afc::logger::AsyncLogger;
+using afc::logger::OverflowPolicy;
+using std::memory_order_acquire;
+using std::memory_order_relaxed;
+using std::memory_order_release;
+using std::memory_order_seq_cst;
+
+namespace
+{
+	// The number of records written at once. IOV_MAX is at least 1024 on all supported platforms.
+	constexpr std::size_t maxBatchSize = 512;
+
+	// Writes all the data from the vectors given, which are modified in the process.
+	bool writeFully(const int fd, ::iovec *iov, std::size_t iovCount) noexcept
+	{
+		while (iovCount != 0) {
+			const ::ssize_t written = ::writev(fd, iov, static_cast<int>(iovCount));
+			if (unlikely(written < 0)) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return false;
+			}
+
+			// Skipping the vectors that are written completely.
+			std::size_t rest = static_cast<std::size_t>(written);
+			while (iovCount != 0 && rest >= iov->iov_len) {
+				rest -= iov->iov_len;
+				++iov;
+				--iovCount;
+			}
+			if (iovCount != 0) {
+				iov->iov_base = static_cast<char *>(iov->iov_base) + rest;
+				iov->iov_len -= rest;
+			}
+		}
+		return true;
+	}
+
+	char *writeTextDropNotice(const std::uint64_t dropped, char * const dest) noexcept
+	{
+		static const char prefix[] = "afc::logger: ";
+		static const char suffix[] = " records dropped\n";
+		char *p = std::copy_n(prefix, sizeof(prefix) - 1, dest);
+		p = afc::printNumber<10>(dropped, p);
+		return std::copy_n(suffix, sizeof(suffix) - 1, p);
+	}
+}
+
+AsyncLogger::AsyncLogger(const int fd, const std::size_t capacity, const OverflowPolicy overflowPolicy)
+	: m_fd(fd), m_overflowPolicy(overflowPolicy),
+	  m_slotCount(afc::math::ceilPow2(std::max<std::size_t>(2, (capacity + slotSize - 1) / slotSize))),
+	  m_slots(new Slot[m_slotCount]), m_data(new char[m_slotCount * slotSize]),
+	  m_tail(0), m_written(0), m_dropped(0), m_dropNoticeWriter(writeTextDropNotice),
+	  m_writerSleeping(false), m_flushWaiters(0), m_stopped(false)
+{
+	for (std::size_t i = 0; i < m_slotCount; ++i) {
+		m_slots[i].seq.store(i, memory_order_relaxed);
+	}
+	// Started after the ring is initialised.
+	m_writer = std::thread(&AsyncLogger::run, this);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+	{ std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopped = true;
+	}
+	m_writerWakeup.notify_one();
+	m_writer.join();
+}
+
+bool AsyncLogger::push(const char * const record, const std::size_t n)
+{
+	if (unlikely(n == 0)) {
+		return true;
+	}
+
+	const std::size_t count = (n + slotSize - 1) / slotSize;
+	/* A record that does not fit into the end of the ring is placed at its beginning, so the slots
+	 * at the end are skipped. Records up to the half of the ring are guaranteed to fit then.
+	 */
+	if (unlikely(count > m_slotCount / 2 || n > std::numeric_limits<std::uint32_t>::max())) {
+		if (m_overflowPolicy == OverflowPolicy::block) {
+			writeDirectly(record, n);
+			return true;
+		}
+		m_dropped.fetch_add(1, memory_order_relaxed);
+		return false;
+	}
+
+	std::uint64_t pos;
+	if (unlikely(!claim(count, pos))) {
+		m_dropped.fetch_add(1, memory_order_relaxed);
+		return false;
+	}
+	std::memcpy(m_data.get() + (pos & (m_slotCount - 1)) * slotSize, record, n);
+	publish(pos, count, n);
+	wakeWriter();
+	return true;
+}
+
+bool AsyncLogger::claim(const std::size_t count, std::uint64_t &pos)
+{
+	const std::uint64_t mask = m_slotCount - 1;
+	std::uint64_t tail = m_tail.load(memory_order_relaxed);
+	for (;;) {
+		const std::size_t index = static_cast<std::size_t>(tail & mask);
+		const std::size_t padding = index + count > m_slotCount ? m_slotCount - index : 0;
+		const std::uint64_t last = tail + padding + count - 1;
+
+		/* The writer frees slots in order, so all the slots claimed are free if the last one is.
+		 * If another producer has claimed the slot then the tail has moved, and the CAS fails.
+		 */
+		const std::uint64_t seq = m_slots[last & mask].seq.load(memory_order_acquire);
+		if (seq == last) {
+			if (m_tail.compare_exchange_weak(tail, last + 1, memory_order_relaxed)) {
+				if (padding != 0) {
+					publish(tail, padding, 0);
+				}
+				pos = tail + padding;
+				return true;
+			}
+		} else if (seq < last) {
+			// The slot is not written yet since the previous round, unless the tail is outdated.
+			const std::uint64_t currentTail = m_tail.load(memory_order_relaxed);
+			if (currentTail == tail) {
+				if (m_overflowPolicy != OverflowPolicy::block) {
+					return false;
+				}
+				std::this_thread::yield();
+			}
+			tail = currentTail;
+		} else {
+			tail = m_tail.load(memory_order_relaxed);
+		}
+	}
+}
+
+inline void AsyncLogger::publish(const std::uint64_t pos, const std::size_t count, const std::size_t size) noexcept
+{
+	Slot &slot = m_slots[pos & (m_slotCount - 1)];
+	slot.size = static_cast<std::uint32_t>(size);
+	slot.count = static_cast<std::uint32_t>(count);
+	slot.seq.store(pos + 1, memory_order_release);
+}
+
+inline void AsyncLogger::wakeWriter()
+{
+	// Pairs with the fence in run(): either the writer sees the record or this thread sees the writer sleeping.
+	std::atomic_thread_fence(memory_order_seq_cst);
+	if (m_writerSleeping.load(memory_order_relaxed)) {
+		{ std::lock_guard<std::mutex> lock(m_mutex); }
+		m_writerWakeup.notify_one();
+	}
+}
+
+void AsyncLogger::writeDirectly(const char * const record, const std::size_t n)
+{
+	// The records pushed before by this thread go first.
+	flush();
+
+	std::lock_guard<std::mutex> lock(m_directWriteMutex);
+	::iovec iov = {const_cast<char *>(record), n};
+	if (unlikely(!writeFully(m_fd, &iov, 1))) {
+		m_dropped.fetch_add(1, memory_order_relaxed);
+	}
+}
+
+void AsyncLogger::flush()
+{
+	const std::uint64_t target = m_tail.load(memory_order_acquire);
+
+	m_flushWaiters.fetch_add(1, memory_order_seq_cst);
+	{ std::unique_lock<std::mutex> lock(m_mutex);
+		while (m_written.load(memory_order_seq_cst) < target) {
+			m_flushed.wait(lock);
+		}
+	}
+	m_flushWaiters.fetch_sub(1, memory_order_relaxed);
+}
+
+void AsyncLogger::run()
+{
+	const std::uint64_t mask = m_slotCount - 1;
+	/* The first vector is reserved for the notice on the records dropped. The notice follows
+	 * the records of the first batch instead, so that the header of a stream stays first.
+	 */
+	::iovec iov[maxBatchSize + 2];
+	char notice[maxDropNoticeSize];
+	std::uint64_t reportedDropped = 0;
+	std::uint64_t head = 0;
+
+	for (;;) {
+		std::size_t iovCount = 1;
+		std::size_t recordCount = 0;
+		std::uint64_t end = head;
+		while (recordCount < maxBatchSize) {
+			const Slot &slot = m_slots[end & mask];
+			if (slot.seq.load(memory_order_acquire) != end + 1) {
+				break;
+			}
+			if (slot.size != 0) {
+				iov[iovCount].iov_base = m_data.get() + (end & mask) * slotSize;
+				iov[iovCount].iov_len = slot.size;
+				++iovCount;
+				++recordCount;
+			}
+			end += slot.count;
+		}
+
+		if (end == head) {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_writerSleeping.store(true, memory_order_relaxed);
+			std::atomic_thread_fence(memory_order_seq_cst);
+			while (m_slots[head & mask].seq.load(memory_order_acquire) != head + 1) {
+				// All records pushed are written; those being pushed wake the writer up.
+				if (m_stopped && m_tail.load(memory_order_acquire) == head) {
+					return;
+				}
+				m_writerWakeup.wait(lock);
+			}
+			m_writerSleeping.store(false, memory_order_relaxed);
+			continue;
+		}
+
+		std::size_t firstIov = 1;
+		if (m_overflowPolicy == OverflowPolicy::count) {
+			const std::uint64_t dropped = m_dropped.load(memory_order_relaxed);
+			if (dropped != reportedDropped) {
+				const DropNoticeWriter writeNotice = m_dropNoticeWriter.load(memory_order_relaxed);
+				char * const p = writeNotice(dropped - reportedDropped, notice);
+				std::size_t noticeIov;
+				if (head == 0) {
+					noticeIov = iovCount++;
+				} else {
+					noticeIov = firstIov = 0;
+				}
+				iov[noticeIov].iov_base = notice;
+				iov[noticeIov].iov_len = std::size_t(p - notice);
+				reportedDropped = dropped;
+			}
+		}
+
+		if (unlikely(!writeFully(m_fd, iov + firstIov, iovCount - firstIov))) {
+			m_dropped.fetch_add(recordCount, memory_order_relaxed);
+		}
+
+		for (std::uint64_t pos = head; pos < end; ++pos) {
+			m_slots[pos & mask].seq.store(pos + m_slotCount, memory_order_release);
+		}
+		head = end;
+
+		m_written.store(head, memory_order_seq_cst);
+		if (m_flushWaiters.load(memory_order_seq_cst) != 0) {
+			{ std::lock_guard<std::mutex> lock(m_mutex); }
+			m_flushed.notify_all();
+		}
+	}
+}
@@ -0,0 +1,167 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_ASYNCLOGGER_HPP_
+#define AFC_ASYNCLOGGER_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "builtin.hpp"
+#include "logger.hpp"
+
+namespace afc
+{
+	namespace logger
+	{
+		// What a producer does with a record that does not fit into the queue of an AsyncLogger.
+		enum class OverflowPolicy
+		{
+			// Waits until the writer thread frees enough space.
+			block,
+			// Discards the record.
+			drop,
+			// Discards the record; the number of records discarded is logged when the queue has space again.
+			count
+		};
+
+		/* Writes log records to a file descriptor in a background thread.
+		 *
+		 * Producers format records into per-thread buffers and copy complete records into
+		 * a lock-free multi-producer single-consumer ring. The writer thread writes all
+		 * records that are ready with a single writev(2) call, so neither stdio locks nor
+		 * system calls are on the producers' path.
+		 *
+		 * Records are written in the order they are pushed, and each record is written
+		 * as a whole. The destructor writes all records pushed before it is called.
+		 */
+		class AsyncLogger
+		{
+		public:
+			// The size of a unit of the ring. Each record occupies one or more contiguous slots.
+			static constexpr std::size_t slotSize = 64;
+			// The maximal size of a notice on the records dropped.
+			static constexpr std::size_t maxDropNoticeSize = 64;
+
+			/* Writes a notice that the number of records given are dropped to dest and returns
+			 * the end of the notice. It is called by the writer thread.
+			 */
+			typedef char *(*DropNoticeWriter)(std::uint64_t dropped, char *dest);
+
+			/* fd is not closed by AsyncLogger. capacity is the size of the ring in octets;
+			 * it is rounded up to a power of two number of slots.
+			 */
+			explicit AsyncLogger(int fd, std::size_t capacity = 1024 * 1024,
+					OverflowPolicy overflowPolicy = OverflowPolicy::block);
+			AsyncLogger(const AsyncLogger &) = delete;
+			AsyncLogger &operator=(const AsyncLogger &) = delete;
+			~AsyncLogger();
+
+			// Logs the arguments followed by '\n' as a single record.
+			template<typename... Args>
+			bool log(const Args &...args);
+
+			// Logs a record formatted at compile time, followed by '\n'.
+			template<char... format, typename... Args>
+			bool logFmt(Format<format...> fmt, const Args &...args);
+
+			/* Queues a complete record, including its line terminator if needed.
+			 *
+			 * Returns false if the record is discarded due to overflow. Records larger than
+			 * the ring are written by the caller itself after the ring is flushed if
+			 * the overflow policy is OverflowPolicy::block and are discarded otherwise.
+			 */
+			bool push(const char *record, std::size_t n);
+
+			// Waits until all records pushed before the call are written.
+			void flush();
+
+			// The number of records that are not written due to overflow or I/O errors.
+			std::uint64_t droppedCount() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+			/* Sets how the notices produced with OverflowPolicy::count are written, so that they
+			 * match the format of the records. By default, they are text lines.
+			 */
+			void setDropNoticeWriter(DropNoticeWriter writer) noexcept
+			{
+				m_dropNoticeWriter.store(writer, std::memory_order_relaxed);
+			}
+		private:
+			struct Slot
+			{
+				/* Equals to the position of the slot if the slot is free and to the position + 1
+				 * if a record starts at this slot and is ready to be written.
+				 */
+				std::atomic<std::uint64_t> seq;
+				std::uint32_t size;
+				std::uint32_t count;
+			};
+
+			bool claim(std::size_t count, std::uint64_t &pos);
+			void publish(std::uint64_t pos, std::size_t count, std::size_t size) noexcept;
+			void wakeWriter();
+			void writeDirectly(const char *record, std::size_t n);
+			void run();
+
+			const int m_fd;
+			const OverflowPolicy m_overflowPolicy;
+			const std::size_t m_slotCount;
+			const std::unique_ptr<Slot[]> m_slots;
+			const std::unique_ptr<char[]> m_data;
+
+			// Producers are separated from the writer to avoid false sharing.
+			alignas(64) std::atomic<std::uint64_t> m_tail;
+			alignas(64) std::atomic<std::uint64_t> m_written;
+			std::atomic<std::uint64_t> m_dropped;
+			std::atomic<DropNoticeWriter> m_dropNoticeWriter;
+			std::atomic<bool> m_writerSleeping;
+			std::atomic<unsigned> m_flushWaiters;
+			bool m_stopped;
+
+			std::mutex m_mutex;
+			std::condition_variable m_writerWakeup;
+			std::condition_variable m_flushed;
+			std::mutex m_directWriteMutex;
+			std::thread m_writer;
+		};
+	}
+}
+
+template<typename... Args>
+inline bool afc::logger::AsyncLogger::log(const Args &...args)
+{
+	RecordBuffer &record = _impl::threadRecordBuffer();
+	if (unlikely(!_impl::assembleRecord(record, args...))) {
+		return false;
+	}
+	return push(record.data(), record.size());
+}
+
+template<char... format, typename... Args>
+inline bool afc::logger::AsyncLogger::logFmt(const Format<format...> fmt, const Args &...args)
+{
+	RecordBuffer &record = _impl::threadRecordBuffer();
+	if (unlikely(!_impl::assembleFormattedRecord(record, fmt, args...))) {
+		return false;
+	}
+	return push(record.data(), record.size());
+}
+
+#endif /* AFC_ASYNCLOGGER_HPP_ */
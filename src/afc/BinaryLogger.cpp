@@ -0,0 +1,425 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "BinaryLogger.hpp"
+#include "number.h"
+#include "stream.h"
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+// POSIX API.
+#include <time.h>
+
+using afc::logger::BinaryLogger;
+using afc::logger::BinaryTag;
+using afc::logger::RecordBuffer;
+using std::size_t;
+using std::uint32_t;
+using std::uint64_t;
+
+namespace
+{
+	const char binaryLogMagic[] = {'A', 'F', 'C', 'B', 'L', 'O', 'G'};
+
+	constexpr unsigned char hostByteOrder()
+	{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		return 'L';
+#else
+		return 'B';
+#endif
+	}
+
+	// Format sites are registered from static initialisers, so the registry is created on demand.
+	struct SiteRegistry
+	{
+		std::mutex mutex;
+		std::vector<std::pair<const char *, size_t>> formats;
+	};
+
+	SiteRegistry &siteRegistry()
+	{
+		static SiteRegistry registry;
+		return registry;
+	}
+
+	std::pair<const char *, size_t> formatSite(const uint32_t id)
+	{
+		SiteRegistry &registry = siteRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		return registry.formats[id];
+	}
+
+	template<typename T>
+	inline void reverseBytes(T &value) noexcept
+	{
+		char * const p = reinterpret_cast<char *>(&value);
+		std::reverse(p, p + sizeof(T));
+	}
+
+	// Reads octets from an InputStream, refilling its buffer as needed.
+	class BinaryReader
+	{
+	public:
+		explicit BinaryReader(afc::InputStream &in) : m_in(in), m_pos(0), m_end(0), m_swapBytes(false) {}
+
+		// Numbers are converted to the host byte order if the writer's one differs.
+		void setSwapBytes(const bool swapBytes) noexcept { m_swapBytes = swapBytes; }
+
+		// Returns false if the stream ends before n octets are read.
+		bool read(void * const dest, size_t n)
+		{
+			char *p = static_cast<char *>(dest);
+			while (n != 0) {
+				if (m_pos == m_end && !fill()) {
+					return false;
+				}
+				const size_t count = std::min(n, m_end - m_pos);
+				std::memcpy(p, m_buf + m_pos, count);
+				m_pos += count;
+				p += count;
+				n -= count;
+			}
+			return true;
+		}
+
+		template<typename T>
+		bool readNumber(T &value)
+		{
+			if (!read(&value, sizeof(T))) {
+				return false;
+			}
+			if (m_swapBytes) {
+				reverseBytes(value);
+			}
+			return true;
+		}
+
+		// Returns false if the stream has ended.
+		bool hasMore()
+		{
+			return m_pos != m_end || fill();
+		}
+	private:
+		bool fill()
+		{
+			m_pos = 0;
+			m_end = m_in.read(reinterpret_cast<unsigned char *>(m_buf), sizeof(m_buf));
+			return m_end != 0;
+		}
+
+		afc::InputStream &m_in;
+		size_t m_pos;
+		size_t m_end;
+		bool m_swapBytes;
+		char m_buf[64 * 1024];
+	};
+
+	// Reads the payload of a record from [p, end).
+	class PayloadReader
+	{
+	public:
+		PayloadReader(const char * const begin, const char * const end, const bool swapBytes) noexcept
+			: m_p(begin), m_end(end), m_swapBytes(swapBytes) {}
+
+		template<typename T>
+		bool read(T &value) noexcept
+		{
+			if (size_t(m_end - m_p) < sizeof(T)) {
+				return false;
+			}
+			std::memcpy(&value, m_p, sizeof(T));
+			m_p += sizeof(T);
+			if (m_swapBytes) {
+				reverseBytes(value);
+			}
+			return true;
+		}
+
+		bool readBytes(const char *&data, uint32_t &n) noexcept
+		{
+			if (!read(n) || size_t(m_end - m_p) < n) {
+				return false;
+			}
+			data = m_p;
+			m_p += n;
+			return true;
+		}
+
+		bool atEnd() const noexcept { return m_p == m_end; }
+	private:
+		const char *m_p;
+		const char * const m_end;
+		const bool m_swapBytes;
+	};
+
+	template<typename T>
+	bool renderValue(PayloadReader &payload, RecordBuffer &dest)
+	{
+		T value;
+		return payload.read(value) && afc::logger::logPrint(value, dest);
+	}
+
+	bool renderArgument(PayloadReader &payload, RecordBuffer &dest)
+	{
+		unsigned char tag;
+		if (!payload.read(tag)) {
+			return false;
+		}
+
+		const char *data;
+		uint32_t n;
+		switch (static_cast<BinaryTag>(tag)) {
+		case BinaryTag::int8:
+			return renderValue<std::int8_t>(payload, dest);
+		case BinaryTag::int16:
+			return renderValue<std::int16_t>(payload, dest);
+		case BinaryTag::int32:
+			return renderValue<std::int32_t>(payload, dest);
+		case BinaryTag::int64:
+			return renderValue<std::int64_t>(payload, dest);
+		case BinaryTag::uint8:
+			return renderValue<std::uint8_t>(payload, dest);
+		case BinaryTag::uint16:
+			return renderValue<std::uint16_t>(payload, dest);
+		case BinaryTag::uint32:
+			return renderValue<std::uint32_t>(payload, dest);
+		case BinaryTag::uint64:
+			return renderValue<std::uint64_t>(payload, dest);
+		case BinaryTag::boolean:
+			{
+				unsigned char value;
+				return payload.read(value) && afc::logger::logPrint(value != 0, dest);
+			}
+		case BinaryTag::character:
+			return renderValue<char>(payload, dest);
+		case BinaryTag::float32:
+			return renderValue<float>(payload, dest);
+		case BinaryTag::float64:
+			return renderValue<double>(payload, dest);
+		case BinaryTag::string:
+			return payload.readBytes(data, n) && afc::logger::logText(data, n, dest);
+		case BinaryTag::hex:
+			if (!payload.readBytes(data, n)) {
+				return false;
+			}
+			dest.reserve(dest.size() + 2 * size_t(n));
+			{
+				RecordBuffer::Tail p = dest.borrowTail();
+				for (uint32_t i = 0; i < n; ++i) {
+					p = afc::octetToHex(static_cast<unsigned char>(data[i]), p);
+				}
+				dest.returnTail(p);
+			}
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// YYYY-MM-DDTHH:MM:SS.nnnnnnnnnZ
+	void renderTimestamp(const uint64_t nanos, RecordBuffer &dest)
+	{
+		const ::time_t seconds = static_cast< ::time_t>(nanos / 1000000000);
+		::tm dateTime;
+		::gmtime_r(&seconds, &dateTime);
+
+		char buf[64];
+		const int n = std::snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%09uZ ",
+				dateTime.tm_year + 1900, dateTime.tm_mon + 1, dateTime.tm_mday,
+				dateTime.tm_hour, dateTime.tm_min, dateTime.tm_sec, unsigned(nanos % 1000000000));
+		afc::logger::logText(buf, size_t(n), dest);
+	}
+
+	// Substitutes the arguments for the placeholders the way logToFileFmt() does.
+	bool renderRecord(const std::string &format, PayloadReader &payload, RecordBuffer &dest)
+	{
+		for (size_t i = 0; i < format.size(); ++i) {
+			const char c = format[i];
+			if (c == '#') {
+				if (!renderArgument(payload, dest)) {
+					return false;
+				}
+			} else if (c == '\\') {
+				++i;
+				if (i == format.size()) {
+					return false;
+				}
+				afc::logger::logPrint(format[i], dest);
+			} else {
+				afc::logger::logPrint(c, dest);
+			}
+		}
+		return payload.atEnd() && afc::logger::logPrint('\n', dest);
+	}
+}
+
+uint32_t afc::logger::_impl::registerFormatSite(const char * const format, const size_t n)
+{
+	SiteRegistry &registry = siteRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	registry.formats.emplace_back(format, n);
+	return static_cast<uint32_t>(registry.formats.size() - 1);
+}
+
+BinaryLogger::BinaryLogger(std::FILE * const dest) : m_file(dest), m_asyncLogger(nullptr), m_definedSiteCount(0)
+{
+	const char header[] = {binaryLogMagic[0], binaryLogMagic[1], binaryLogMagic[2], binaryLogMagic[3],
+			binaryLogMagic[4], binaryLogMagic[5], binaryLogMagic[6], char(_impl::binaryLogVersion), char(hostByteOrder())};
+	write(header, sizeof(header));
+}
+
+BinaryLogger::BinaryLogger(AsyncLogger &dest) : m_file(nullptr), m_asyncLogger(&dest), m_definedSiteCount(0)
+{
+	dest.setDropNoticeWriter(writeDropNotice);
+	const char header[] = {binaryLogMagic[0], binaryLogMagic[1], binaryLogMagic[2], binaryLogMagic[3],
+			binaryLogMagic[4], binaryLogMagic[5], binaryLogMagic[6], char(_impl::binaryLogVersion), char(hostByteOrder())};
+	write(header, sizeof(header));
+}
+
+bool BinaryLogger::defineSites(const uint32_t site)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Other sites could be registered by now; all sites up to this one are defined to keep ids dense.
+	std::string buf;
+	for (uint32_t id = m_definedSiteCount.load(std::memory_order_relaxed); id <= site; ++id) {
+		const std::pair<const char *, size_t> format = formatSite(id);
+		const uint32_t formatSize = static_cast<uint32_t>(format.second);
+
+		buf.assign(1, static_cast<char>(_impl::siteDefinitionType));
+		buf.append(reinterpret_cast<const char *>(&id), sizeof(id));
+		buf.append(reinterpret_cast<const char *>(&formatSize), sizeof(formatSize));
+		buf.append(format.first, format.second);
+		if (unlikely(!write(buf.data(), buf.size()))) {
+			return false;
+		}
+		// Records with this site can be written once the definition is queued.
+		m_definedSiteCount.store(id + 1, std::memory_order_release);
+	}
+	return true;
+}
+
+bool BinaryLogger::write(const char * const data, const size_t n)
+{
+	if (m_asyncLogger != nullptr) {
+		return m_asyncLogger->push(data, n);
+	}
+	return std::fwrite(data, 1, n, m_file) == n;
+}
+
+char *BinaryLogger::writeDropNotice(const uint64_t dropped, char *dest) noexcept
+{
+	static_assert(1 + 2 * sizeof(uint64_t) <= AsyncLogger::maxDropNoticeSize, "The drop notice is too large.");
+
+	const uint64_t timestamp = now();
+	*dest++ = static_cast<char>(_impl::dropNoticeType);
+	std::memcpy(dest, &timestamp, sizeof(timestamp));
+	dest += sizeof(timestamp);
+	std::memcpy(dest, &dropped, sizeof(dropped));
+	return dest + sizeof(dropped);
+}
+
+uint64_t BinaryLogger::now() noexcept
+{
+	::timespec t;
+	::clock_gettime(CLOCK_REALTIME, &t);
+	return uint64_t(t.tv_sec) * 1000000000 + uint64_t(t.tv_nsec);
+}
+
+bool afc::logger::decodeBinaryLog(afc::InputStream &in, std::FILE * const dest)
+{
+	BinaryReader reader(in);
+	std::vector<std::string> formats;
+	std::vector<bool> defined;
+	std::vector<char> payload;
+	RecordBuffer line;
+
+	char header[sizeof(binaryLogMagic) + 2];
+	if (!reader.read(header, sizeof(header)) || std::memcmp(header, binaryLogMagic, sizeof(binaryLogMagic)) != 0 ||
+			header[sizeof(binaryLogMagic)] != char(_impl::binaryLogVersion)) {
+		return false;
+	}
+	const char byteOrder = header[sizeof(binaryLogMagic) + 1];
+	if (byteOrder != 'L' && byteOrder != 'B') {
+		return false;
+	}
+	const bool swapBytes = byteOrder != char(hostByteOrder());
+	reader.setSwapBytes(swapBytes);
+
+	while (reader.hasMore()) {
+		unsigned char type;
+		if (!reader.read(&type, 1)) {
+			return false;
+		}
+
+		if (type == _impl::siteDefinitionType) {
+			uint32_t site, n;
+			if (!reader.readNumber(site) || !reader.readNumber(n)) {
+				return false;
+			}
+			std::string format(n, '\0');
+			if (!reader.read(&format[0], n)) {
+				return false;
+			}
+			if (site >= formats.size()) {
+				formats.resize(size_t(site) + 1);
+				defined.resize(size_t(site) + 1);
+			}
+			formats[site] = std::move(format);
+			defined[site] = true;
+		} else if (type == _impl::recordType) {
+			uint32_t site, n;
+			uint64_t timestamp;
+			if (!reader.readNumber(site) || !reader.readNumber(timestamp) || !reader.readNumber(n)) {
+				return false;
+			}
+			payload.resize(n);
+			if (!reader.read(payload.data(), n) || site >= formats.size() || !defined[site]) {
+				return false;
+			}
+
+			line.clear();
+			renderTimestamp(timestamp, line);
+			PayloadReader payloadReader(payload.data(), payload.data() + n, swapBytes);
+			if (!renderRecord(formats[site], payloadReader, line) ||
+					std::fwrite(line.data(), 1, line.size(), dest) != line.size()) {
+				return false;
+			}
+		} else if (type == _impl::dropNoticeType) {
+			uint64_t timestamp, dropped;
+			if (!reader.readNumber(timestamp) || !reader.readNumber(dropped)) {
+				return false;
+			}
+
+			// Rendered the way AsyncLogger writes text notices.
+			static const char prefix[] = "afc::logger: ";
+			static const char suffix[] = " records dropped\n";
+			line.clear();
+			renderTimestamp(timestamp, line);
+			if (!logText(prefix, sizeof(prefix) - 1, line) || !logPrint(dropped, line) ||
+					!logText(suffix, sizeof(suffix) - 1, line) ||
+					std::fwrite(line.data(), 1, line.size(), dest) != line.size()) {
+				return false;
+			}
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
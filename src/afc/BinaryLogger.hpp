@@ -0,0 +1,270 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_BINARYLOGGER_HPP_
+#define AFC_BINARYLOGGER_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+
+#include "AsyncLogger.hpp"
+#include "builtin.hpp"
+#include "logger.hpp"
+
+namespace afc
+{
+	struct InputStream;
+
+	namespace logger
+	{
+		/* The binary log format. All numbers are in the byte order of the writer, which is
+		 * specified in the stream header; the decoder converts them to the host byte order.
+		 *
+		 * header:          "AFCBLOG" version:u8 byteOrder:u8 ('L' or 'B')
+		 * site definition: type:u8 (1) site:u32 formatSize:u32 format
+		 * record:          type:u8 (2) site:u32 timestampNanos:u64 payloadSize:u32 payload
+		 * drop notice:     type:u8 (3) timestampNanos:u64 droppedCount:u64
+		 *
+		 * The payload is a sequence of arguments, each one is a tag (BinaryTag) followed by
+		 * the value. Strings and octet sequences are prefixed with their size as u32.
+		 */
+		enum class BinaryTag : unsigned char
+		{
+			int8 = 1, int16, int32, int64,
+			uint8, uint16, uint32, uint64,
+			boolean, character, float32, float64,
+			// Text, including the values of types with no binary encoding, which are printed with logPrint().
+			string,
+			// Octets that are rendered in hex.
+			hex
+		};
+
+		namespace _impl
+		{
+			constexpr unsigned char binaryLogVersion = 1;
+			constexpr unsigned char siteDefinitionType = 1;
+			constexpr unsigned char recordType = 2;
+			constexpr unsigned char dropNoticeType = 3;
+			// type, site, timestamp, payload size.
+			constexpr std::size_t recordHeaderSize = 1 + 4 + 8 + 4;
+
+			// Format sites are numbered globally, in the order they are first used.
+			std::uint32_t registerFormatSite(const char *format, std::size_t n);
+
+			template<char... chars>
+			struct FormatSite
+			{
+				static std::uint32_t id()
+				{
+					static const std::uint32_t value = registerFormatSite(FormatText<chars...>::value, sizeof...(chars));
+					return value;
+				}
+			};
+
+			inline void appendRaw(RecordBuffer &dest, const void * const data, const std::size_t n)
+			{
+				dest.reserve(dest.size() + n);
+				dest.append(static_cast<const char *>(data), n);
+			}
+
+			template<typename T>
+			inline void appendTagged(RecordBuffer &dest, const BinaryTag tag, const T value)
+			{
+				dest.reserve(dest.size() + 1 + sizeof(T));
+				dest.append(static_cast<char>(tag));
+				dest.append(reinterpret_cast<const char *>(&value), sizeof(T));
+			}
+
+			inline void appendBytes(RecordBuffer &dest, const BinaryTag tag, const char * const data, const std::size_t n)
+			{
+				appendTagged(dest, tag, static_cast<std::uint32_t>(n));
+				appendRaw(dest, data, n);
+			}
+
+			template<typename T>
+			constexpr BinaryTag arithmeticTag() noexcept
+			{
+				return std::is_same<T, bool>::value ? BinaryTag::boolean :
+						std::is_same<T, char>::value ? BinaryTag::character :
+						std::is_same<T, float>::value ? BinaryTag::float32 :
+						std::is_same<T, double>::value ? BinaryTag::float64 :
+						sizeof(T) == 1 ? (std::is_signed<T>::value ? BinaryTag::int8 : BinaryTag::uint8) :
+						sizeof(T) == 2 ? (std::is_signed<T>::value ? BinaryTag::int16 : BinaryTag::uint16) :
+						sizeof(T) == 4 ? (std::is_signed<T>::value ? BinaryTag::int32 : BinaryTag::uint32) :
+						(std::is_signed<T>::value ? BinaryTag::int64 : BinaryTag::uint64);
+			}
+
+			/* The int overloads encode values in binary; the long one is the fallback
+			 * that prints values of all other types as text.
+			 *
+			 * Arithmetic values are matched exactly, so that no implicit conversions apply.
+			 */
+			template<typename T>
+			inline typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, long double>::value, bool>::type
+					logEncode(const T value, RecordBuffer &dest, int)
+			{
+				static_assert(sizeof(T) <= 8, "Integers wider than 64 bits are not supported.");
+				static_assert(!std::is_same<T, bool>::value || sizeof(bool) == 1, "bool is expected to be an octet.");
+				appendTagged(dest, arithmeticTag<T>(), value);
+				return true;
+			}
+
+			inline bool logEncode(const char * const s, RecordBuffer &dest, int)
+			{
+				appendBytes(dest, BinaryTag::string, s, std::strlen(s));
+				return true;
+			}
+
+			// An exact match for char * which would otherwise be ambiguous with the fallback.
+			inline bool logEncode(char * const s, RecordBuffer &dest, int)
+			{
+				return logEncode(static_cast<const char *>(s), dest, 0);
+			}
+
+			inline bool logEncode(const afc::ConstStringRef s, RecordBuffer &dest, int)
+			{
+				appendBytes(dest, BinaryTag::string, s.value(), s.size());
+				return true;
+			}
+
+			inline bool logEncode(const afc::String &s, RecordBuffer &dest, int)
+			{
+				appendBytes(dest, BinaryTag::string, s.data(), s.size());
+				return true;
+			}
+
+			inline bool logEncode(const afc::FastStringBuffer<char> &s, RecordBuffer &dest, int)
+			{
+				appendBytes(dest, BinaryTag::string, s.data(), s.size());
+				return true;
+			}
+
+			inline bool logEncode(const std::pair<const char *, const char *> &s, RecordBuffer &dest, int)
+			{
+				appendBytes(dest, BinaryTag::string, s.first, std::size_t(s.second - s.first));
+				return true;
+			}
+
+			inline bool logEncode(const std::pair<char *, char *> &s, RecordBuffer &dest, int)
+			{
+				appendBytes(dest, BinaryTag::string, s.first, std::size_t(s.second - s.first));
+				return true;
+			}
+
+			template<std::size_t n>
+			inline bool logEncode(const HexEncodedN<n> &value, RecordBuffer &dest, int)
+			{
+				appendBytes(dest, BinaryTag::hex, reinterpret_cast<const char *>(value.val), n);
+				return true;
+			}
+
+			template<typename T>
+			inline bool logEncode(const T &value, RecordBuffer &dest, long)
+			{
+				appendTagged(dest, BinaryTag::string, std::uint32_t(0));
+				const std::size_t start = dest.size();
+				if (unlikely(!logPrint(value, dest))) {
+					return false;
+				}
+				const std::uint32_t size = static_cast<std::uint32_t>(dest.size() - start);
+				std::memcpy(dest.begin() + start - sizeof(size), &size, sizeof(size));
+				return true;
+			}
+
+			inline bool logEncodeAll(RecordBuffer &) noexcept { return true; }
+
+			template<typename Arg, typename... Args>
+			inline bool logEncodeAll(RecordBuffer &dest, const Arg &arg, const Args &...args)
+			{
+				return logEncode(arg, dest, 0) && logEncodeAll(dest, args...);
+			}
+		}
+
+		/* Writes log records in a compact binary form, which is rendered to text offline
+		 * with decodeBinaryLog(). A record contains the id of its format, a timestamp
+		 * and raw values of the arguments, so logging costs little more than copying them.
+		 *
+		 * The formats are written to the stream once, before the first record that uses them.
+		 */
+		class BinaryLogger
+		{
+		public:
+			// Records are written with a single fwrite() call each.
+			explicit BinaryLogger(std::FILE *dest);
+			/* Records are passed to the writer thread of the AsyncLogger given, which must not
+			 * be used for text records. The notices on the records dropped are written as drop notices.
+			 */
+			explicit BinaryLogger(AsyncLogger &dest);
+			BinaryLogger(const BinaryLogger &) = delete;
+			BinaryLogger &operator=(const BinaryLogger &) = delete;
+
+			template<char... format, typename... Args>
+			bool log(Format<format...> fmt, const Args &...args);
+		private:
+			bool defineSites(std::uint32_t site);
+			bool write(const char *data, std::size_t n);
+			static char *writeDropNotice(std::uint64_t dropped, char *dest) noexcept;
+			static std::uint64_t now() noexcept;
+
+			std::FILE * const m_file;
+			AsyncLogger * const m_asyncLogger;
+			// Sites with lesser ids are defined in the stream.
+			std::atomic<std::uint32_t> m_definedSiteCount;
+			std::mutex m_mutex;
+		};
+
+		/* Renders a binary log as text, one line per record: the UTC timestamp followed by
+		 * the formatted record. Returns false if the log is malformed or truncated;
+		 * the records before the error are written to dest.
+		 */
+		bool decodeBinaryLog(afc::InputStream &in, std::FILE *dest);
+	}
+}
+
+template<char... format, typename... Args>
+inline bool afc::logger::BinaryLogger::log(const Format<format...>, const Args &...args)
+{
+	static_assert(_impl::SplitFormatT<format...>::placeholderCount == sizeof...(Args),
+			"The number of arguments does not match the number of placeholders in the format.");
+
+	const std::uint32_t site = _impl::FormatSite<format...>::id();
+	if (unlikely(site >= m_definedSiteCount.load(std::memory_order_acquire)) && !defineSites(site)) {
+		return false;
+	}
+
+	RecordBuffer &record = _impl::threadRecordBuffer();
+	record.clear();
+	record.reserve(_impl::recordHeaderSize + logRecordSize(args...) + 5 * sizeof...(Args));
+	record.append(static_cast<char>(_impl::recordType));
+	_impl::appendRaw(record, &site, sizeof(site));
+	const std::uint64_t timestamp = now();
+	_impl::appendRaw(record, &timestamp, sizeof(timestamp));
+	_impl::appendRaw(record, "\0\0\0\0", 4);
+
+	if (unlikely(!_impl::logEncodeAll(record, args...))) {
+		return false;
+	}
+	const std::uint32_t payloadSize = static_cast<std::uint32_t>(record.size() - _impl::recordHeaderSize);
+	std::memcpy(record.begin() + _impl::recordHeaderSize - sizeof(payloadSize), &payloadSize, sizeof(payloadSize));
+
+	return write(record.data(), record.size());
+}
+
+#endif /* AFC_BINARYLOGGER_HPP_ */
@@ -35,6 +35,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "StringRef.hpp"
 #ifdef AFC_EXCEPTIONS_ENABLED
 	#include <new>
+	#include "Exception.h"
 #else
 	#include <exception>
 #endif
@@ -0,0 +1,189 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "Histogram.hpp"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+	std::atomic<std::size_t> nextShard(0);
+
+	std::size_t roundUpToPowerOfTwo(const std::size_t n) noexcept
+	{
+		std::size_t result = 1;
+		while (result < n) {
+			result <<= 1;
+		}
+		return result;
+	}
+}
+
+std::size_t afc::_impl::nextHistogramShard() noexcept
+{
+	return nextShard.fetch_add(1, std::memory_order_relaxed);
+}
+
+void afc::HistogramSnapshot::merge(const HistogramSnapshot &other) noexcept
+{
+	for (std::size_t i = 0; i < m_counts.size(); ++i) {
+		m_counts[i] += other.m_counts[i];
+	}
+	m_count += other.m_count;
+}
+
+std::uint64_t afc::HistogramSnapshot::min() const noexcept
+{
+	for (std::size_t i = 0; i < m_counts.size(); ++i) {
+		if (m_counts[i] != 0) {
+			return _impl::histogramBucketLowerBound(i);
+		}
+	}
+	return 0;
+}
+
+std::uint64_t afc::HistogramSnapshot::max() const noexcept
+{
+	for (std::size_t i = m_counts.size(); i > 0; --i) {
+		if (m_counts[i - 1] != 0) {
+			return _impl::histogramBucketUpperBound(i - 1);
+		}
+	}
+	return 0;
+}
+
+double afc::HistogramSnapshot::mean() const noexcept
+{
+	if (m_count == 0) {
+		return 0;
+	}
+	double sum = 0;
+	for (std::size_t i = 0; i < m_counts.size(); ++i) {
+		if (m_counts[i] != 0) {
+			const double midpoint = (double(_impl::histogramBucketLowerBound(i)) +
+					double(_impl::histogramBucketUpperBound(i))) / 2;
+			sum += midpoint * double(m_counts[i]);
+		}
+	}
+	return sum / double(m_count);
+}
+
+std::uint64_t afc::HistogramSnapshot::valueAtPercentile(const double percentile) const noexcept
+{
+	if (m_count == 0) {
+		return 0;
+	}
+	const double p = std::min(std::max(percentile, 0.0), 100.0);
+	/* The rank of the value in the sorted sequence of values recorded, starting with one:
+	 * the smallest rank that covers percentile per cent of the values. The product is inexact
+	 * (99.9 * 41000 / 100 exceeds 40959), so a rounding error is not taken for a fraction.
+	 */
+	const double count = double(m_count);
+	const std::uint64_t rank = std::min(std::uint64_t(std::max(std::ceil(p * count / 100 - 1e-9 * count), 1.0)), m_count);
+
+	std::uint64_t seen = 0;
+	for (std::size_t i = 0; i < m_counts.size(); ++i) {
+		seen += m_counts[i];
+		if (seen >= rank) {
+			return _impl::histogramBucketUpperBound(i);
+		}
+	}
+	return max();
+}
+
+std::size_t afc::HistogramSnapshot::maxJSONSize() const noexcept
+{
+	const std::size_t bucketsUsed = std::size_t(std::count_if(m_counts.begin(), m_counts.end(),
+			[](const std::uint64_t count) { return count != 0; }));
+	return (sizeof("{\"count\":,\"min\":,\"max\":,\"mean\":,\"p50\":,\"p90\":,\"p99\":,\"p99.9\":,\"buckets\":[]}") - 1) +
+			7 * maxPrintedSize<std::uint64_t, 10>() + maxPrintedSize<double, 10>() +
+			bucketsUsed * ((sizeof(",[,,]") - 1) + 3 * maxPrintedSize<std::uint64_t, 10>());
+}
+
+afc::Histogram::Histogram(const std::size_t shardCount)
+{
+	std::size_t n = shardCount;
+	if (n == 0) {
+		n = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	n = roundUpToPowerOfTwo(n);
+	m_shardMask = n - 1;
+	m_shards.reset(new Shard[n]);
+	reset();
+}
+
+void afc::Histogram::merge(const Histogram &other) noexcept
+{
+	Shard &dest = shard();
+	for (std::size_t i = 0; i <= other.m_shardMask; ++i) {
+		const Shard &src = other.m_shards[i];
+		for (std::size_t j = 0; j < _impl::histogramBucketCount; ++j) {
+			const std::uint64_t count = src.counts[j].load(std::memory_order_relaxed);
+			if (count != 0) {
+				dest.counts[j].fetch_add(count, std::memory_order_relaxed);
+			}
+		}
+	}
+}
+
+void afc::Histogram::merge(const HistogramSnapshot &other) noexcept
+{
+	Shard &dest = shard();
+	for (std::size_t i = 0; i < _impl::histogramBucketCount; ++i) {
+		if (other.m_counts[i] != 0) {
+			dest.counts[i].fetch_add(other.m_counts[i], std::memory_order_relaxed);
+		}
+	}
+}
+
+void afc::Histogram::reset() noexcept
+{
+	for (std::size_t i = 0; i <= m_shardMask; ++i) {
+		for (std::atomic<std::uint64_t> &count : m_shards[i].counts) {
+			count.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+afc::HistogramSnapshot afc::Histogram::snapshot() const
+{
+	HistogramSnapshot result;
+	for (std::size_t i = 0; i <= m_shardMask; ++i) {
+		for (std::size_t j = 0; j < _impl::histogramBucketCount; ++j) {
+			result.m_counts[j] += m_shards[i].counts[j].load(std::memory_order_relaxed);
+		}
+	}
+	for (const std::uint64_t count : result.m_counts) {
+		result.m_count += count;
+	}
+	return result;
+}
+
+afc::HistogramSnapshot afc::Histogram::snapshotAndReset()
+{
+	HistogramSnapshot result;
+	for (std::size_t i = 0; i <= m_shardMask; ++i) {
+		for (std::size_t j = 0; j < _impl::histogramBucketCount; ++j) {
+			if (m_shards[i].counts[j].load(std::memory_order_relaxed) != 0) {
+				result.m_counts[j] += m_shards[i].counts[j].exchange(0, std::memory_order_relaxed);
+			}
+		}
+	}
+	for (const std::uint64_t count : result.m_counts) {
+		result.m_count += count;
+	}
+	return result;
+}
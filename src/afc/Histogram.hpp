@@ -0,0 +1,269 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_HISTOGRAM_HPP_
+#define AFC_HISTOGRAM_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "logger.hpp"
+#include "number.h"
+
+namespace afc
+{
+	namespace _impl
+	{
+		/* Log-linear buckets: values below 2^histogramPrecisionBits get a bucket each; each
+		 * further power of two is split into 2^histogramPrecisionBits equal buckets. A bucket
+		 * covers less than 1/32 of its lower bound, which is the relative error of the values
+		 * reported.
+		 */
+		constexpr unsigned histogramPrecisionBits = 5;
+		constexpr std::size_t histogramSubBucketCount = std::size_t(1) << histogramPrecisionBits;
+		constexpr std::size_t histogramBucketCount = (64 - histogramPrecisionBits + 1) * histogramSubBucketCount;
+
+		inline std::size_t histogramBucketIndex(const std::uint64_t value) noexcept
+		{
+			if (value < histogramSubBucketCount) {
+				return std::size_t(value);
+			}
+			const unsigned shift = 63 - __builtin_clzll(value) - histogramPrecisionBits;
+			return (std::size_t(shift + 1) << histogramPrecisionBits) +
+					std::size_t((value >> shift) & (histogramSubBucketCount - 1));
+		}
+
+		inline std::uint64_t histogramBucketLowerBound(const std::size_t index) noexcept
+		{
+			if (index < histogramSubBucketCount) {
+				return index;
+			}
+			const unsigned shift = unsigned(index >> histogramPrecisionBits) - 1;
+			return (histogramSubBucketCount + (index & (histogramSubBucketCount - 1))) << shift;
+		}
+
+		inline std::uint64_t histogramBucketUpperBound(const std::size_t index) noexcept
+		{
+			if (index < histogramSubBucketCount) {
+				return index;
+			}
+			const unsigned shift = unsigned(index >> histogramPrecisionBits) - 1;
+			return histogramBucketLowerBound(index) + ((std::uint64_t(1) << shift) - 1);
+		}
+
+		// Assigns shards to threads round-robin.
+		std::size_t nextHistogramShard() noexcept;
+
+		inline std::size_t threadHistogramShard() noexcept
+		{
+			static thread_local const std::size_t shard = nextHistogramShard();
+			return shard;
+		}
+
+		template<typename Iterator>
+		inline Iterator copyText(const char *s, Iterator dest)
+		{
+			for (; *s != '\0'; ++s) {
+				*dest++ = *s;
+			}
+			return dest;
+		}
+	}
+
+	/* The counts of a histogram at a moment in time. The values reported are bucket bounds:
+	 * min() is the lower bound of the lowest bucket used; max() and percentiles are upper bounds.
+	 */
+	class HistogramSnapshot
+	{
+	public:
+		HistogramSnapshot() : m_counts(_impl::histogramBucketCount, 0), m_count(0) {}
+
+		// Adds the counts of the snapshot given to this one.
+		void merge(const HistogramSnapshot &other) noexcept;
+
+		std::uint64_t count() const noexcept { return m_count; }
+		// All the statistics are zero if nothing is recorded.
+		std::uint64_t min() const noexcept;
+		std::uint64_t max() const noexcept;
+		// The mean of the midpoints of the buckets.
+		double mean() const noexcept;
+		// The value that percentile per cent of values recorded do not exceed, e.g. 99.9.
+		std::uint64_t valueAtPercentile(double percentile) const noexcept;
+
+		// The maximal number of characters format() writes.
+		static constexpr std::size_t maxFormattedSize() noexcept
+		{
+			return (sizeof("count= min= p50= p90= p99= p99.9= max=") - 1) + 7 * maxPrintedSize<std::uint64_t, 10>();
+		}
+
+		// Writes a summary, e.g. "count=1000 min=12 p50=95 p90=183 p99=411 p99.9=1023 max=1055".
+		template<typename Iterator>
+		Iterator format(Iterator dest) const;
+
+		std::size_t maxJSONSize() const noexcept;
+
+		/* Writes the statistics and the buckets used as a JSON object:
+		 * {"count":N,"min":N,"max":N,"mean":N,"p50":N,"p90":N,"p99":N,"p99.9":N,
+		 *  "buckets":[[lowerBound,upperBound,count],...]}
+		 */
+		template<typename Iterator>
+		Iterator printJSON(Iterator dest) const;
+	private:
+		friend class Histogram;
+
+		std::vector<std::uint64_t> m_counts;
+		std::uint64_t m_count;
+	};
+
+	/* A histogram of non-negative integer values, e.g. latencies in nanoseconds, that can be
+	 * recorded concurrently from many threads. Each thread records into one of several shards
+	 * of counters with a single relaxed increment; the shards are summed only when a snapshot
+	 * is taken. Values are kept with the relative error of 1/32 at most (see _impl above).
+	 *
+	 * A shard takes 15 KiB.
+	 */
+	class Histogram
+	{
+	public:
+		// The shard count is rounded up to a power of two; zero means one per hardware thread.
+		explicit Histogram(std::size_t shardCount = 0);
+		Histogram(const Histogram &) = delete;
+		Histogram &operator=(const Histogram &) = delete;
+
+		void record(const std::uint64_t value) noexcept
+		{
+			shard().counts[_impl::histogramBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void record(const std::uint64_t value, const std::uint64_t count) noexcept
+		{
+			shard().counts[_impl::histogramBucketIndex(value)].fetch_add(count, std::memory_order_relaxed);
+		}
+
+		// Adds the counts of the histogram given to this one.
+		void merge(const Histogram &other) noexcept;
+		void merge(const HistogramSnapshot &other) noexcept;
+
+		/* Discards the values recorded. Values recorded concurrently are either discarded or kept;
+		 * use snapshotAndReset() to not lose any of them.
+		 */
+		void reset() noexcept;
+
+		HistogramSnapshot snapshot() const;
+		// Takes a snapshot and resets the histogram at once, so that each value gets into a single snapshot.
+		HistogramSnapshot snapshotAndReset();
+
+		std::size_t shardCount() const noexcept { return m_shardMask + 1; }
+	private:
+		struct Shard
+		{
+			std::atomic<std::uint64_t> counts[_impl::histogramBucketCount];
+		};
+
+		Shard &shard() noexcept { return m_shards[_impl::threadHistogramShard() & m_shardMask]; }
+
+		std::size_t m_shardMask;
+		std::unique_ptr<Shard[]> m_shards;
+	};
+
+	namespace logger
+	{
+		template<>
+		inline bool logPrint<const afc::HistogramSnapshot &>(const afc::HistogramSnapshot &val, std::FILE * const dest)
+		{
+			char buf[afc::HistogramSnapshot::maxFormattedSize()];
+			char * const p = &buf[0];
+			return afc::logger::logText(p, val.format(p) - p, dest);
+		}
+
+		template<>
+		inline bool logPrint<const afc::HistogramSnapshot &>(const afc::HistogramSnapshot &val, RecordBuffer &dest)
+		{
+			dest.reserve(dest.size() + afc::HistogramSnapshot::maxFormattedSize());
+			dest.returnTail(val.format(dest.borrowTail()));
+			return true;
+		}
+
+		constexpr std::size_t logPrintedSize(const afc::HistogramSnapshot &) noexcept
+		{
+			return afc::HistogramSnapshot::maxFormattedSize();
+		}
+	}
+}
+
+template<typename Iterator>
+Iterator afc::HistogramSnapshot::format(Iterator dest) const
+{
+	using afc::_impl::copyText;
+
+	dest = copyText("count=", dest);
+	dest = printNumber<10>(m_count, dest);
+	dest = copyText(" min=", dest);
+	dest = printNumber<10>(min(), dest);
+	dest = copyText(" p50=", dest);
+	dest = printNumber<10>(valueAtPercentile(50), dest);
+	dest = copyText(" p90=", dest);
+	dest = printNumber<10>(valueAtPercentile(90), dest);
+	dest = copyText(" p99=", dest);
+	dest = printNumber<10>(valueAtPercentile(99), dest);
+	dest = copyText(" p99.9=", dest);
+	dest = printNumber<10>(valueAtPercentile(99.9), dest);
+	dest = copyText(" max=", dest);
+	return printNumber<10>(max(), dest);
+}
+
+template<typename Iterator>
+Iterator afc::HistogramSnapshot::printJSON(Iterator dest) const
+{
+	using afc::_impl::copyText;
+
+	dest = copyText("{\"count\":", dest);
+	dest = printNumber<10>(m_count, dest);
+	dest = copyText(",\"min\":", dest);
+	dest = printNumber<10>(min(), dest);
+	dest = copyText(",\"max\":", dest);
+	dest = printNumber<10>(max(), dest);
+	dest = copyText(",\"mean\":", dest);
+	dest = printNumber<10>(mean(), dest);
+	dest = copyText(",\"p50\":", dest);
+	dest = printNumber<10>(valueAtPercentile(50), dest);
+	dest = copyText(",\"p90\":", dest);
+	dest = printNumber<10>(valueAtPercentile(90), dest);
+	dest = copyText(",\"p99\":", dest);
+	dest = printNumber<10>(valueAtPercentile(99), dest);
+	dest = copyText(",\"p99.9\":", dest);
+	dest = printNumber<10>(valueAtPercentile(99.9), dest);
+	dest = copyText(",\"buckets\":[", dest);
+	bool first = true;
+	for (std::size_t i = 0; i < m_counts.size(); ++i) {
+		if (m_counts[i] == 0) {
+			continue;
+		}
+		dest = copyText(first ? "[" : ",[", dest);
+		first = false;
+		dest = printNumber<10>(_impl::histogramBucketLowerBound(i), dest);
+		*dest++ = ',';
+		dest = printNumber<10>(_impl::histogramBucketUpperBound(i), dest);
+		*dest++ = ',';
+		dest = printNumber<10>(m_counts[i], dest);
+		*dest++ = ']';
+	}
+	return copyText("]}", dest);
+}
+
+#endif /* AFC_HISTOGRAM_HPP_ */
@@ -1,5 +1,5 @@
 /* libafc - utils to facilitate C++ development.
-Copyright (C) 2010-2013 Dźmitry Laŭčuk
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
 
 libafc is free software: you can redistribute it and/or modify it under
 the terms of the GNU Lesser General Public License as published by
@@ -16,74 +16,264 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #ifndef AFC_STOPWATCH_H_
 #define AFC_STOPWATCH_H_
 
-#include <ctime>
-#include <iomanip>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
+#include <ostream>
+#include "dateutil.hpp"
+#include "logger.hpp"
+#include "number.h"
 
 namespace afc
 {
-	using std::clock_t;
-	using std::clock;
-	using std::ostream;
-	using std::cout;
-	using std::endl;
-	using std::setiosflags;
-	using std::ios_base;
-
-	class Stopwatch
+	namespace helper
 	{
+		// The maximal number of characters printDuration() writes.
+		constexpr std::size_t maxDurationSize() noexcept
+		{
+			return 1 + maxPrintedSize<std::uint_fast64_t, 10>() + 1 + 9 + 1;
+		}
+
+		// Prints a duration in nanoseconds as seconds with nine fractional digits, e.g. "1.000250000s".
+		template<typename Iterator>
+		Iterator printDuration(const std::int_fast64_t nanos, Iterator dest)
+		{
+			std::uint_fast64_t n = static_cast<std::uint_fast64_t>(nanos);
+			if (nanos < 0) {
+				*dest++ = '-';
+				n = -n;
+			}
+			dest = printNumber<10>(n / 1000000000, dest);
+			*dest++ = '.';
+			std::uint_fast32_t fraction = static_cast<std::uint_fast32_t>(n % 1000000000);
+			char digits[9];
+			for (int i = 8; i >= 0; --i) {
+				digits[i] = static_cast<char>('0' + fraction % 10);
+				fraction /= 10;
+			}
+			for (const char c : digits) {
+				*dest++ = c;
+			}
+			*dest++ = 's';
+			return dest;
+		}
+	}
+
+	/* Measures the time that passes while the stopwatch is running with the clock given, which is
+	 * one of the clock tags afc::now() accepts (see dateutil.hpp): MonotonicClock for wall-clock
+	 * latency, ThreadCpuClock or ProcessCpuClock for CPU time or TscClock for the cheapest reads. Each of start(), stop(), resume() and lap() reads the clock once; nothing else is
+	 * done on these paths, so the stopwatch can wrap hot sections.
+	 *
+	 * Up to maxLaps laps are stored; further laps are counted only.
+	 */
+	template<typename Clock = MonotonicClock, std::size_t maxLaps = 16>
+	class BasicStopwatch
+	{
+		static_assert(maxLaps > 0, "a stopwatch must be able to store a lap");
 	public:
-		Stopwatch() throw() : m_started(false), m_stopped(false), m_accumulator(0) {}
-		~Stopwatch() throw() {}
+		typedef std::int_fast64_t duration_type;
 
-		Stopwatch &reset() throw()
+		BasicStopwatch() noexcept
+				: m_started(false), m_running(false), m_start(0), m_elapsed(0), m_lapMark(0), m_lapCount(0) {}
+
+		// Stops the stopwatch and discards the time and the laps measured.
+		BasicStopwatch &reset() noexcept
 		{
-			m_started = m_stopped = false;
-			m_accumulator = 0;
+			m_started = m_running = false;
+			m_elapsed = m_lapMark = 0;
+			m_lapCount = 0;
 			return *this;
 		}
 
-		void start() throw()
+		// Resets the stopwatch and starts it.
+		void start() noexcept
 		{
-			m_stopped = false;
-			m_started = true;
-			m_accumulator = 0;
-			m_start = clock();
+			reset();
+			m_started = m_running = true;
+			m_start = read();
 		}
 
-		Stopwatch &stop() throw()
+		BasicStopwatch &stop() noexcept
 		{
-			if (m_started) {
-				m_accumulator += durationSinceLastResume();
-				m_stopped = true;
+			if (m_running) {
+				m_elapsed += read() - m_start;
+				m_running = false;
 			}
 			return *this;
 		}
 
-		void resume() throw()
+		// Continues measuring after stop() without discarding the time measured.
+		void resume() noexcept
 		{
-			m_stopped = false;
-			m_start = clock();
+			if (!m_running) {
+				m_start = read();
+				m_running = true;
+			}
 		}
 
-		Stopwatch &print(ostream &out = cout)
+		// Records the running time since the previous lap (or since start()) as a lap.
+		void lap() noexcept
+		{
+			const duration_type elapsedTime = elapsed();
+			if (m_lapCount < maxLaps) {
+				m_laps[m_lapCount] = elapsedTime - m_lapMark;
+			}
+			++m_lapCount;
+			m_lapMark = elapsedTime;
+		}
+
+		// The running time in nanoseconds.
+		duration_type elapsed() const noexcept { return m_running ? m_elapsed + (read() - m_start) : m_elapsed; }
+
+		bool running() const noexcept { return m_running; }
+
+		// The number of laps recorded, including the ones that are not stored.
+		std::size_t lapCount() const noexcept { return m_lapCount; }
+		std::size_t storedLapCount() const noexcept { return m_lapCount < maxLaps ? m_lapCount : maxLaps; }
+		// The durations of the laps stored, in nanoseconds.
+		const duration_type *laps() const noexcept { return m_laps; }
+
+		/* The maximal number of characters format() writes: the running time and the laps,
+		 * e.g. "1.500000000s laps: 0.500000000s 1.000000000s (3 more)".
+		 */
+		static constexpr std::size_t maxFormattedSize() noexcept
+		{
+			return helper::maxDurationSize() + (sizeof(" laps:") - 1) + maxLaps * (1 + helper::maxDurationSize()) +
+					(sizeof(" ( more)") - 1) + maxPrintedSize<std::size_t, 10>();
+		}
+
+		template<typename Iterator>
+		Iterator format(Iterator dest) const;
+
+		/* Writes format() followed by '\n', or "Not started\n" if the stopwatch has not been
+		 * started since it was created or reset. The format flags of the stream are not used.
+		 */
+		BasicStopwatch &print(std::ostream &out = std::cout)
 		{
 			if (m_started) {
-				const clock_t totalTime = m_stopped ? m_accumulator : m_accumulator + durationSinceLastResume();
-				ios_base::fmtflags old = cout.flags(ios_base::fixed);
-				cout << static_cast<double>(totalTime)/CLOCKS_PER_SEC << "s" << endl;
-				cout.flags(old);
+				char buf[maxFormattedSize() + 1];
+				char * const end = format(buf);
+				*end = '\n';
+				out.write(buf, end + 1 - buf);
 			} else {
-				out << "Not started" << endl;
+				out.write("Not started\n", sizeof("Not started\n") - 1);
 			}
 			return *this;
 		}
 	private:
-		inline clock_t durationSinceLastResume() throw() {return clock() - m_start;}
+		static duration_type read() noexcept { return afc::now(Clock()).nanos(); }
+
+		bool m_started;
+		bool m_running;
+		duration_type m_start;
+		duration_type m_elapsed;
+		// The running time at the end of the previous lap.
+		duration_type m_lapMark;
+		std::size_t m_lapCount;
+		duration_type m_laps[maxLaps];
+	};
+
+	/* Measures wall-clock time. Use BasicStopwatch<ProcessCpuClock> for the CPU time of the process
+	 * that std::clock() reports.
+	 */
+	typedef BasicStopwatch<> Stopwatch;
+
+	// A stopwatch view to log by afc::logger facilities. It captures the running time on construction.
+	struct StopwatchView
+	{
+		template<typename Clock, std::size_t maxLaps>
+		StopwatchView(const BasicStopwatch<Clock, maxLaps> &stopwatch) noexcept
+				: elapsed(stopwatch.elapsed()), laps(stopwatch.laps()), storedLapCount(stopwatch.storedLapCount()),
+				  lapCount(stopwatch.lapCount()) {}
 
-		bool m_started, m_stopped;
-		clock_t m_start, m_accumulator;
+		std::size_t maxFormattedSize() const noexcept
+		{
+			return helper::maxDurationSize() + (sizeof(" laps:") - 1) + storedLapCount * (1 + helper::maxDurationSize()) +
+					(sizeof(" ( more)") - 1) + maxPrintedSize<std::size_t, 10>();
+		}
+
+		template<typename Iterator>
+		Iterator format(Iterator dest) const
+		{
+			dest = helper::printDuration(elapsed, dest);
+			if (lapCount == 0) {
+				return dest;
+			}
+			dest = copyText(" laps:", dest);
+			for (std::size_t i = 0; i < storedLapCount; ++i) {
+				*dest++ = ' ';
+				dest = helper::printDuration(laps[i], dest);
+			}
+			if (lapCount > storedLapCount) {
+				dest = copyText(" (", dest);
+				dest = printNumber<10>(lapCount - storedLapCount, dest);
+				dest = copyText(" more)", dest);
+			}
+			return dest;
+		}
+
+		const std::int_fast64_t elapsed;
+		const std::int_fast64_t * const laps;
+		const std::size_t storedLapCount;
+		const std::size_t lapCount;
+	private:
+		template<typename Iterator>
+		static Iterator copyText(const char *s, Iterator dest)
+		{
+			for (; *s != '\0'; ++s) {
+				*dest++ = *s;
+			}
+			return dest;
+		}
 	};
+
+	namespace logger
+	{
+		template<>
+		inline bool logPrint<const afc::StopwatchView &>(const afc::StopwatchView &val, std::FILE * const dest)
+		{
+			// Written a lap at a time to keep the buffer on the stack bounded.
+			char buf[afc::helper::maxDurationSize() + 1];
+			if (!logText(buf, afc::helper::printDuration(val.elapsed, buf) - buf, dest)) {
+				return false;
+			}
+			if (val.lapCount == 0) {
+				return true;
+			}
+			if (!logText(" laps:", sizeof(" laps:") - 1, dest)) {
+				return false;
+			}
+			for (std::size_t i = 0; i < val.storedLapCount; ++i) {
+				buf[0] = ' ';
+				if (!logText(buf, afc::helper::printDuration(val.laps[i], buf + 1) - buf, dest)) {
+					return false;
+				}
+			}
+			if (val.lapCount > val.storedLapCount) {
+				return logText(" (", 2, dest) && logPrint(val.lapCount - val.storedLapCount, dest) &&
+						logText(" more)", sizeof(" more)") - 1, dest);
+			}
+			return true;
+		}
+
+		template<>
+		inline bool logPrint<const afc::StopwatchView &>(const afc::StopwatchView &val, RecordBuffer &dest)
+		{
+			dest.reserve(dest.size() + val.maxFormattedSize());
+			dest.returnTail(val.format(dest.borrowTail()));
+			return true;
+		}
+
+		inline std::size_t logPrintedSize(const afc::StopwatchView &val) noexcept { return val.maxFormattedSize(); }
+	}
+}
+
+template<typename Clock, std::size_t maxLaps>
+template<typename Iterator>
+inline Iterator afc::BasicStopwatch<Clock, maxLaps>::format(Iterator dest) const
+{
+	return StopwatchView(*this).format(dest);
 }
 
 #endif /*AFC_STOPWATCH_H_*/
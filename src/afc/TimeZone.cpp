@@ -0,0 +1,602 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "TimeZone.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <mutex>
+#include <utility>
+
+// POSIX API.
+#include <time.h>
+
+#include "dateutil.hpp"
+
+using std::int_fast64_t;
+using std::size_t;
+using afc::helper::daysFromCivil;
+using afc::helper::floorDiv;
+
+std::atomic<const afc::TimeZone *> afc::_impl::localTimeZone(nullptr);
+
+namespace
+{
+	constexpr long secondsPerDay = 24 * 60 * 60;
+
+	// A date of a POSIX TZ rule: Jn (a day of a non-leap year), n (a day of the year) or Mm.w.d.
+	struct RuleDate
+	{
+		char kind; // 'J', 'D' or 'M'.
+		unsigned day;
+		unsigned week;
+		unsigned month;
+		// The local time of the day the transition happens at, in seconds.
+		long time;
+	};
+
+	struct Rule
+	{
+		std::string stdName;
+		std::string dstName;
+		// Positive east of UTC, unlike the offsets in the rule itself.
+		long stdOffset;
+		long dstOffset;
+		bool dst;
+		RuleDate start;
+		RuleDate end;
+	};
+
+	inline bool isDigit(const char c) noexcept
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	inline bool isAlpha(const char c) noexcept
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+	}
+
+	bool parseNumber(const char *&p, const unsigned maxDigits, unsigned &dest) noexcept
+	{
+		const char * const start = p;
+		dest = 0;
+		while (isDigit(*p) && p - start < maxDigits) {
+			dest = dest * 10 + unsigned(*p - '0');
+			++p;
+		}
+		return p != start;
+	}
+
+	bool parseRuleName(const char *&p, std::string &dest)
+	{
+		const char * const start = p;
+		if (*p == '<') {
+			while (*++p != '>') {
+				if (*p == '\0') {
+					return false;
+				}
+			}
+			dest.assign(start + 1, p);
+			++p;
+		} else {
+			while (isAlpha(*p)) {
+				++p;
+			}
+			dest.assign(start, p);
+		}
+		return dest.size() >= 3;
+	}
+
+	// [+|-]hh[:mm[:ss]]
+	bool parseRuleTime(const char *&p, long &dest) noexcept
+	{
+		const bool negative = *p == '-';
+		if (*p == '+' || *p == '-') {
+			++p;
+		}
+		unsigned hours, minutes = 0, seconds = 0;
+		if (!parseNumber(p, 3, hours) || hours > 167) {
+			return false;
+		}
+		if (*p == ':') {
+			++p;
+			if (!parseNumber(p, 2, minutes) || minutes > 59) {
+				return false;
+			}
+			if (*p == ':') {
+				++p;
+				if (!parseNumber(p, 2, seconds) || seconds > 59) {
+					return false;
+				}
+			}
+		}
+		const long time = long(hours) * 3600 + long(minutes) * 60 + long(seconds);
+		dest = negative ? -time : time;
+		return true;
+	}
+
+	bool parseRuleDate(const char *&p, RuleDate &dest) noexcept
+	{
+		if (*p == 'J') {
+			++p;
+			dest.kind = 'J';
+			if (!parseNumber(p, 3, dest.day) || dest.day < 1 || dest.day > 365) {
+				return false;
+			}
+		} else if (*p == 'M') {
+			++p;
+			dest.kind = 'M';
+			if (!parseNumber(p, 2, dest.month) || dest.month < 1 || dest.month > 12 || *p++ != '.' ||
+					!parseNumber(p, 1, dest.week) || dest.week < 1 || dest.week > 5 || *p++ != '.' ||
+					!parseNumber(p, 1, dest.day) || dest.day > 6) {
+				return false;
+			}
+		} else {
+			dest.kind = 'D';
+			if (!parseNumber(p, 3, dest.day) || dest.day > 365) {
+				return false;
+			}
+		}
+
+		dest.time = 2 * 3600;
+		if (*p == '/') {
+			++p;
+			return parseRuleTime(p, dest.time);
+		}
+		return true;
+	}
+
+	// std offset [dst [offset] [,start[/time],end[/time]]]
+	bool parseRule(const char *p, Rule &dest)
+	{
+		long offset;
+		if (!parseRuleName(p, dest.stdName) || !parseRuleTime(p, offset)) {
+			return false;
+		}
+		dest.stdOffset = -offset;
+
+		dest.dst = *p != '\0';
+		if (!dest.dst) {
+			return true;
+		}
+		if (!parseRuleName(p, dest.dstName)) {
+			return false;
+		}
+		if (*p != ',' && *p != '\0') {
+			if (!parseRuleTime(p, offset)) {
+				return false;
+			}
+			dest.dstOffset = -offset;
+		} else {
+			dest.dstOffset = dest.stdOffset + 3600;
+		}
+
+		if (*p == '\0') {
+			// The default rule of POSIX implementations: M3.2.0,M11.1.0.
+			const char *defaultRule = "M3.2.0,M11.1.0";
+			return parseRuleDate(defaultRule, dest.start) && *defaultRule++ == ',' && parseRuleDate(defaultRule, dest.end);
+		}
+		return *p++ == ',' && parseRuleDate(p, dest.start) && *p++ == ',' && parseRuleDate(p, dest.end) && *p == '\0';
+	}
+
+	inline bool isLeapYear(const int_fast64_t year) noexcept
+	{
+		return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+	}
+
+	// The day (since epoch) the rule date falls on in the year given.
+	int_fast64_t ruleDay(const RuleDate &date, const int year) noexcept
+	{
+		switch (date.kind) {
+		case 'J':
+			// February 29 is never counted.
+			return daysFromCivil(year, 1, 1) + date.day - 1 + (isLeapYear(year) && date.day >= 60 ? 1 : 0);
+		case 'D':
+			return daysFromCivil(year, 1, 1) + date.day;
+		default:
+		{
+			const int_fast64_t firstDay = daysFromCivil(year, date.month, 1);
+			const int_fast64_t nextMonthFirstDay = date.month == 12 ?
+					daysFromCivil(year + 1, 1, 1) : daysFromCivil(year, date.month + 1, 1);
+			// 1970-01-01 is Thursday.
+			const unsigned firstWeekDay = unsigned(firstDay - floorDiv(firstDay + 4, 7) * 7 + 4);
+			int_fast64_t day = firstDay + (date.day + 7 - firstWeekDay) % 7 + 7 * (date.week - 1);
+			// The fifth week means the last one.
+			while (day >= nextMonthFirstDay) {
+				day -= 7;
+			}
+			return day;
+		}
+		}
+	}
+
+	inline std::uint_fast32_t readUint32(const unsigned char * const p) noexcept
+	{
+		return (std::uint_fast32_t(p[0]) << 24) | (std::uint_fast32_t(p[1]) << 16) |
+				(std::uint_fast32_t(p[2]) << 8) | std::uint_fast32_t(p[3]);
+	}
+
+	inline int_fast64_t readInt32(const unsigned char * const p) noexcept
+	{
+		return std::int32_t(readUint32(p));
+	}
+
+	inline int_fast64_t readInt64(const unsigned char * const p) noexcept
+	{
+		return std::int64_t((std::uint64_t(readUint32(p)) << 32) | readUint32(p + 4));
+	}
+
+	struct TZifHeader
+	{
+		char version;
+		std::uint_fast32_t isUtCount;
+		std::uint_fast32_t isStdCount;
+		std::uint_fast32_t leapCount;
+		std::uint_fast32_t timeCount;
+		std::uint_fast32_t typeCount;
+		std::uint_fast32_t charCount;
+
+		// The size of the data block that follows the header.
+		std::size_t dataSize(const std::size_t timeSize) const noexcept
+		{
+			return timeCount * timeSize + timeCount + typeCount * 6 + charCount +
+					leapCount * (timeSize + 4) + isStdCount + isUtCount;
+		}
+	};
+
+	constexpr std::size_t tzifHeaderSize = 44;
+
+	bool readTZifHeader(const unsigned char * const p, const unsigned char * const end, TZifHeader &dest) noexcept
+	{
+		if (std::size_t(end - p) < tzifHeaderSize || std::memcmp(p, "TZif", 4) != 0) {
+			return false;
+		}
+		dest.version = char(p[4]);
+		dest.isUtCount = readUint32(p + 20);
+		dest.isStdCount = readUint32(p + 24);
+		dest.leapCount = readUint32(p + 28);
+		dest.timeCount = readUint32(p + 32);
+		dest.typeCount = readUint32(p + 36);
+		dest.charCount = readUint32(p + 40);
+		return dest.typeCount != 0 && dest.typeCount <= 256 && dest.charCount != 0 &&
+				(dest.isUtCount == 0 || dest.isUtCount == dest.typeCount) &&
+				(dest.isStdCount == 0 || dest.isStdCount == dest.typeCount) &&
+				// Sizes are limited to keep their products in range.
+				dest.leapCount <= 0xffff && dest.timeCount <= 0xffff && dest.charCount <= 0xffff;
+	}
+
+	bool readFile(const char * const path, std::string &dest)
+	{
+		std::FILE * const file = std::fopen(path, "rb");
+		if (file == nullptr) {
+			return false;
+		}
+		char buf[4096];
+		std::size_t n;
+		while ((n = std::fread(buf, 1, sizeof(buf), file)) > 0) {
+			dest.append(buf, n);
+		}
+		const bool success = !std::ferror(file);
+		std::fclose(file);
+		return success;
+	}
+
+	std::mutex localTimeZoneMutex;
+
+	// Must be called with localTimeZoneMutex held.
+	bool refreshLocalTimeZoneInternal()
+	{
+		::tzset();
+		std::unique_ptr<afc::TimeZone> timeZone = afc::TimeZone::load(std::getenv("TZ"));
+		const bool success = timeZone != nullptr;
+		if (!success) {
+			timeZone.reset(new afc::TimeZone());
+		}
+		// The zone replaced is kept alive since it can still be in use.
+		afc::_impl::localTimeZone.store(timeZone.release(), std::memory_order_release);
+		return success;
+	}
+}
+
+struct afc::TimeZone::Builder
+{
+	Builder() : zone(new TimeZone())
+	{
+		zone->m_offsets.clear();
+		zone->m_abbreviations.clear();
+	}
+
+	std::uint16_t addOffset(const long gmtOffset, const bool dst, const char * const abbreviation, const std::size_t n)
+	{
+		for (std::size_t i = 0; i < zone->m_offsets.size(); ++i) {
+			const Offset &offset = zone->m_offsets[i];
+			const std::size_t pos = abbreviationPositions[i];
+			if (offset.gmtOffset == gmtOffset && offset.dst == dst &&
+					zone->m_abbreviations.compare(pos, n, abbreviation, n) == 0 &&
+					zone->m_abbreviations[pos + n] == '\0') {
+				return std::uint16_t(i);
+			}
+		}
+		abbreviationPositions.push_back(zone->m_abbreviations.size());
+		zone->m_abbreviations.append(abbreviation, n);
+		zone->m_abbreviations.push_back('\0');
+		zone->m_offsets.push_back(Offset{gmtOffset, dst, nullptr});
+		return std::uint16_t(zone->m_offsets.size() - 1);
+	}
+
+	void setInitialOffset(const std::uint16_t offsetIndex) { zone->m_offsetIndices[0] = offsetIndex; }
+
+	void addTransition(const int_fast64_t time, const std::uint16_t offsetIndex)
+	{
+		if (offsetIndex != zone->m_offsetIndices.back()) {
+			zone->m_transitions.push_back(time);
+			zone->m_offsetIndices.push_back(offsetIndex);
+		}
+	}
+
+	// Generates the transitions of the rule after the time given up to lastRuleYear.
+	void addRuleTransitions(const Rule &rule, const int_fast64_t after, const bool initial)
+	{
+		const std::uint16_t stdIndex = addOffset(rule.stdOffset, false, rule.stdName.data(), rule.stdName.size());
+		if (!rule.dst) {
+			if (initial) {
+				setInitialOffset(stdIndex);
+			}
+			return;
+		}
+		const std::uint16_t dstIndex = addOffset(rule.dstOffset, true, rule.dstName.data(), rule.dstName.size());
+
+		std::int_fast64_t year;
+		unsigned month, day;
+		afc::helper::civilFromDays(floorDiv(after, secondsPerDay), year, month, day);
+
+		for (int y = int(year); y <= lastRuleYear; ++y) {
+			std::pair<int_fast64_t, std::uint16_t> transitions[2] = {
+				{ruleDay(rule.start, y) * secondsPerDay + rule.start.time - rule.stdOffset, dstIndex},
+				{ruleDay(rule.end, y) * secondsPerDay + rule.end.time - rule.dstOffset, stdIndex}};
+			if (transitions[1].first < transitions[0].first) {
+				std::swap(transitions[0], transitions[1]);
+			}
+			if (initial && y == int(year)) {
+				// Before the first transition, the offset of the end of the previous year is in effect.
+				setInitialOffset(transitions[1].second);
+			}
+			for (const auto &transition : transitions) {
+				if (transition.first > after) {
+					addTransition(transition.first, transition.second);
+				}
+			}
+		}
+	}
+
+	std::unique_ptr<TimeZone> finish()
+	{
+		TimeZone &z = *zone;
+		for (std::size_t i = 0; i < z.m_offsets.size(); ++i) {
+			z.m_offsets[i].abbreviation = z.m_abbreviations.c_str() + abbreviationPositions[i];
+		}
+		z.m_localTransitions.resize(z.m_transitions.size());
+		for (std::size_t i = 0; i < z.m_transitions.size(); ++i) {
+			/* Local times skipped or repeated by the transition belong to the interval before it,
+			 * so the transition is at the later of its local times.
+			 */
+			z.m_localTransitions[i] = z.m_transitions[i] + std::max(z.m_offsets[z.m_offsetIndices[i]].gmtOffset,
+					z.m_offsets[z.m_offsetIndices[i + 1]].gmtOffset);
+		}
+		return std::move(zone);
+	}
+
+	std::unique_ptr<TimeZone> zone;
+	std::vector<std::size_t> abbreviationPositions;
+};
+
+afc::TimeZone::TimeZone()
+	: m_offsetIndices(1, 0), m_offsets(1, Offset{0, false, nullptr}), m_abbreviations("UTC")
+{
+	m_offsets[0].abbreviation = m_abbreviations.c_str();
+}
+
+std::unique_ptr<afc::TimeZone> afc::TimeZone::fromRule(const char * const rule)
+{
+	Rule parsedRule;
+	if (!parseRule(rule, parsedRule)) {
+		return nullptr;
+	}
+	Builder builder;
+	builder.addRuleTransitions(parsedRule, daysFromCivil(firstRuleYear, 1, 1) * secondsPerDay, true);
+	return builder.finish();
+}
+
+std::unique_ptr<afc::TimeZone> afc::TimeZone::fromTZif(const char * const data, const std::size_t size)
+{
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+	const unsigned char * const end = p + size;
+
+	TZifHeader header;
+	if (!readTZifHeader(p, end, header)) {
+		return nullptr;
+	}
+	std::size_t timeSize = 4;
+	if (header.version >= '2') {
+		// Skipping the version 1 data; the 64-bit data follows it.
+		p += tzifHeaderSize + header.dataSize(4);
+		if (p > end || !readTZifHeader(p, end, header)) {
+			return nullptr;
+		}
+		timeSize = 8;
+	}
+	p += tzifHeaderSize;
+	if (std::size_t(end - p) < header.dataSize(timeSize)) {
+		return nullptr;
+	}
+
+	const unsigned char * const times = p;
+	const unsigned char * const typeIndices = times + header.timeCount * timeSize;
+	const unsigned char * const types = typeIndices + header.timeCount;
+	const char * const chars = reinterpret_cast<const char *>(types + header.typeCount * 6);
+
+	Builder builder;
+	std::uint16_t offsetIndices[256];
+	for (std::size_t i = 0; i < header.typeCount; ++i) {
+		const unsigned char * const type = types + i * 6;
+		const std::size_t abbreviationIndex = type[5];
+		if (type[4] > 1 || abbreviationIndex >= header.charCount) {
+			return nullptr;
+		}
+		const char * const abbreviation = chars + abbreviationIndex;
+		offsetIndices[i] = builder.addOffset(long(readInt32(type)), type[4] != 0, abbreviation,
+				strnlen(abbreviation, header.charCount - abbreviationIndex));
+	}
+	// The first type is in effect before the first transition.
+	builder.setInitialOffset(offsetIndices[0]);
+
+	int_fast64_t lastTransition = daysFromCivil(firstRuleYear, 1, 1) * secondsPerDay;
+	for (std::size_t i = 0; i < header.timeCount; ++i) {
+		const int_fast64_t time = timeSize == 8 ? readInt64(times + i * 8) : readInt32(times + i * 4);
+		if ((i > 0 && time <= lastTransition) || typeIndices[i] >= header.typeCount) {
+			return nullptr;
+		}
+		builder.addTransition(time, offsetIndices[typeIndices[i]]);
+		lastTransition = time;
+	}
+
+	if (timeSize == 8) {
+		// The footer: '\n' rule '\n'. It defines the transitions after the last one listed.
+		p += header.dataSize(timeSize);
+		if (p == end || *p != '\n') {
+			return nullptr;
+		}
+		const unsigned char * const ruleEnd = static_cast<const unsigned char *>(std::memchr(p + 1, '\n', end - p - 1));
+		if (ruleEnd == nullptr) {
+			return nullptr;
+		}
+		const std::string ruleText(p + 1, ruleEnd);
+		if (!ruleText.empty()) {
+			Rule rule;
+			if (!parseRule(ruleText.c_str(), rule)) {
+				return nullptr;
+			}
+			builder.addRuleTransitions(rule, lastTransition, header.timeCount == 0);
+		}
+	}
+	return builder.finish();
+}
+
+std::unique_ptr<afc::TimeZone> afc::TimeZone::load(const char * const tz)
+{
+	std::string path;
+	if (tz == nullptr) {
+		path = "/etc/localtime";
+	} else if (*tz == '\0') {
+		return std::unique_ptr<TimeZone>(new TimeZone());
+	} else {
+		const char * const name = *tz == ':' ? tz + 1 : tz;
+		if (*name != '/') {
+			const char * const dir = std::getenv("TZDIR");
+			path = dir != nullptr && *dir != '\0' ? dir : "/usr/share/zoneinfo";
+			path += '/';
+		}
+		path += name;
+	}
+
+	std::string data;
+	if (readFile(path.c_str(), data)) {
+		std::unique_ptr<TimeZone> result = fromTZif(data.data(), data.size());
+		if (result != nullptr) {
+			return result;
+		}
+	}
+	return tz != nullptr && *tz != ':' ? fromRule(tz) : nullptr;
+}
+
+void afc::TimeZone::toLocal(const int_fast64_t utcSeconds, std::tm &dest) const noexcept
+{
+	const Offset &offset = offsetAt(utcSeconds);
+	const int_fast64_t localSeconds = utcSeconds + offset.gmtOffset;
+	const int_fast64_t days = floorDiv(localSeconds, secondsPerDay);
+	unsigned secondOfDay = unsigned(localSeconds - days * secondsPerDay);
+
+	std::int_fast64_t year;
+	unsigned month, day;
+	afc::helper::civilFromDays(days, year, month, day);
+
+	dest.tm_year = int(year - 1900);
+	dest.tm_mon = int(month - 1);
+	dest.tm_mday = int(day);
+	dest.tm_hour = int(secondOfDay / 3600);
+	secondOfDay %= 3600;
+	dest.tm_min = int(secondOfDay / 60);
+	dest.tm_sec = int(secondOfDay % 60);
+	// 1970-01-01 is Thursday.
+	dest.tm_wday = int(days + 4 - floorDiv(days + 4, 7) * 7);
+	dest.tm_yday = int(days - daysFromCivil(year, 1, 1));
+	dest.tm_isdst = offset.dst ? 1 : 0;
+	// Note: tm_gmtoff and tm_zone are not a part of the standard C++11.
+	dest.tm_gmtoff = offset.gmtOffset;
+	dest.tm_zone = offset.abbreviation;
+}
+
+int_fast64_t afc::TimeZone::toUtc(const std::tm &local) const noexcept
+{
+	// Out-of-range fields are carried over as mktime() does.
+	const int_fast64_t years = floorDiv(local.tm_mon, 12);
+	const int_fast64_t localSeconds =
+			(daysFromCivil(local.tm_year + 1900 + years, unsigned(local.tm_mon - years * 12 + 1), 1) + local.tm_mday - 1) *
+			secondsPerDay + int_fast64_t(local.tm_hour) * 3600 + int_fast64_t(local.tm_min) * 60 + local.tm_sec;
+
+	const std::size_t i = transitionIndex(m_localTransitions, localSeconds);
+	const Offset *offset = &m_offsets[m_offsetIndices[i]];
+	const bool dst = local.tm_isdst > 0;
+	if (local.tm_isdst >= 0 && offset->dst != dst) {
+		/* An offset of a neighbouring interval with the DST flag requested: preferably the one
+		 * the local time maps to (for times that occur twice), otherwise any, as mktime() does.
+		 */
+		const Offset *candidate = nullptr;
+		for (const std::size_t j : {i + 1, i - 1}) {
+			if (j < m_offsetIndices.size() && m_offsets[m_offsetIndices[j]].dst == dst) {
+				const Offset &neighbour = m_offsets[m_offsetIndices[j]];
+				if (&offsetAt(localSeconds - neighbour.gmtOffset) == &neighbour) {
+					candidate = &neighbour;
+					break;
+				}
+				if (candidate == nullptr) {
+					candidate = &neighbour;
+				}
+			}
+		}
+		if (candidate != nullptr) {
+			offset = candidate;
+		}
+	}
+	return localSeconds - offset->gmtOffset;
+}
+
+const afc::TimeZone &afc::_impl::loadLocalTimeZone()
+{
+	std::lock_guard<std::mutex> lock(localTimeZoneMutex);
+	if (_impl::localTimeZone.load(std::memory_order_relaxed) == nullptr) {
+		refreshLocalTimeZoneInternal();
+	}
+	return *_impl::localTimeZone.load(std::memory_order_relaxed);
+}
+
+bool afc::refreshLocalTimeZone()
+{
+	std::lock_guard<std::mutex> lock(localTimeZoneMutex);
+	return refreshLocalTimeZoneInternal();
+}
@@ -0,0 +1,138 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_TIMEZONE_HPP_
+#define AFC_TIMEZONE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "builtin.hpp"
+
+namespace afc
+{
+	/* An immutable table of the UTC offsets of a time zone and the times they change at.
+	 * Converting a time in either direction is a binary search in the table plus arithmetic;
+	 * neither the process time zone nor the tz lock of the C library is involved.
+	 *
+	 * Transitions that follow the last one listed in TZif data (or that are defined by a POSIX
+	 * TZ rule only) are generated from the rule up to the year lastRuleYear; the offset in effect
+	 * after that is used for all later times. Leap seconds are not accounted for.
+	 */
+	class TimeZone
+	{
+	public:
+		static constexpr int firstRuleYear = 1900;
+		static constexpr int lastRuleYear = 2200;
+
+		struct Offset
+		{
+			// In seconds, positive east of UTC.
+			long gmtOffset;
+			bool dst;
+			const char *abbreviation;
+		};
+
+		// Creates UTC.
+		TimeZone();
+
+		TimeZone(const TimeZone &) = delete;
+		TimeZone &operator=(const TimeZone &) = delete;
+
+		/* Loads the time zone the value of the environment variable TZ refers to, as tzset() does:
+		 * nullptr means /etc/localtime, an empty value means UTC, otherwise the value is a TZif file
+		 * (absolute or relative to TZDIR, optionally prefixed with ':') or a POSIX TZ rule.
+		 * Returns nullptr if the time zone cannot be loaded.
+		 */
+		static std::unique_ptr<TimeZone> load(const char *tz);
+		// Returns nullptr if the data is malformed.
+		static std::unique_ptr<TimeZone> fromTZif(const char *data, std::size_t size);
+		// E.g. "CET-1CEST,M3.5.0,M10.5.0/3". Returns nullptr if the rule is malformed.
+		static std::unique_ptr<TimeZone> fromRule(const char *rule);
+
+		// The offset in effect at the time given (in seconds since epoch).
+		const Offset &offsetAt(const std::int_fast64_t utcSeconds) const noexcept
+		{
+			return m_offsets[m_offsetIndices[transitionIndex(m_transitions, utcSeconds)]];
+		}
+
+		/* The offset in effect at the local time given (in seconds since epoch as if the time were UTC).
+		 * A local time that is skipped by a transition, or that occurs twice, gets the offset in effect
+		 * before the transition.
+		 */
+		const Offset &localOffsetAt(const std::int_fast64_t localSeconds) const noexcept
+		{
+			return m_offsets[m_offsetIndices[transitionIndex(m_localTransitions, localSeconds)]];
+		}
+
+		// Decomposes the time given as localtime_r() does.
+		void toLocal(std::int_fast64_t utcSeconds, std::tm &dest) const noexcept;
+
+		/* Converts the local time given to seconds since epoch as mktime() does, except that
+		 * the fields are not normalised in place. tm_isdst, if not negative, selects between
+		 * offsets in effect around a transition.
+		 */
+		std::int_fast64_t toUtc(const std::tm &local) const noexcept;
+	private:
+		// The index of the interval (between transitions) the time belongs to; 0 is before the first transition.
+		static std::size_t transitionIndex(const std::vector<std::int_fast64_t> &transitions,
+				const std::int_fast64_t t) noexcept
+		{
+			return std::size_t(std::upper_bound(transitions.begin(), transitions.end(), t) - transitions.begin());
+		}
+
+		struct Builder;
+
+		// Transition times in seconds since epoch.
+		std::vector<std::int_fast64_t> m_transitions;
+		// The local times of the transitions, in the greater of the offsets in effect around them.
+		std::vector<std::int_fast64_t> m_localTransitions;
+		// Indices of the offsets in effect in the intervals; the first one is before the first transition.
+		std::vector<std::uint16_t> m_offsetIndices;
+		std::vector<Offset> m_offsets;
+		// Zero-terminated abbreviations referred to by the offsets.
+		std::string m_abbreviations;
+	};
+
+	namespace _impl
+	{
+		extern std::atomic<const TimeZone *> localTimeZone;
+
+		const TimeZone &loadLocalTimeZone();
+	}
+
+	/* The local time zone. It is loaded on first use; reading it is a single atomic load.
+	 * The reference is valid until the process ends, even if the zone is refreshed.
+	 */
+	inline const TimeZone &localTimeZone()
+	{
+		const TimeZone * const timeZone = _impl::localTimeZone.load(std::memory_order_acquire);
+		return likely(timeZone != nullptr) ? *timeZone : _impl::loadLocalTimeZone();
+	}
+
+	/* Reloads the local time zone, e.g. after TZ is changed, and calls tzset(). Threads that use
+	 * the zone replaced are not blocked; it is kept alive. Returns false if the zone cannot be
+	 * loaded, in which case UTC is used, as the C library does.
+	 */
+	bool refreshLocalTimeZone();
+}
+
+#endif /* AFC_TIMEZONE_HPP_ */
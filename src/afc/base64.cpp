@@ -0,0 +1,349 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "base64.hpp"
+#include "platform.h"
+#include "stream.h"
+
+#ifdef AFC_AMD64
+	#include <cstring>
+	#include <immintrin.h>
+	#include "cpu/features.h"
+#endif
+
+// 0xff - not a Base64 character, 0xfe - padding, 0xfd - white space.
+const unsigned char afc::_impl::base64DecodeTable[0x100] = {
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfd, 0xfd, 0xff, 0xff, 0xfd, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xfd, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+				0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xfe, 0xff, 0xff,
+				0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+				0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+				0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+const unsigned char afc::_impl::base64UrlDecodeTable[0x100] = {
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfd, 0xfd, 0xff, 0xff, 0xfd, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xfd, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff,
+				0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xfe, 0xff, 0xff,
+				0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+				0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0x3f,
+				0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+				0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+				0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+#ifdef AFC_AMD64
+namespace
+{
+	using afc::Base64Alphabet;
+
+	/* The vectorised Base64 encoding and decoding by Wojciech Muła and Daniel Lemire
+	 * ("Faster Base64 Encoding and Decoding Using AVX2 Instructions", 2018).
+	 *
+	 * Encoding: each 3 octets are spread to four octets holding one 6-bit index each
+	 * by a shuffle and two multiplications. Indices are translated
+	 * to ASCII by adding an offset that depends on the range the index belongs to,
+	 * the range being turned into a pshufb lookup index by a saturated subtraction.
+	 *
+	 * Decoding: the high and low nibbles of each character index two lookup tables
+	 * with bit sets; a character is valid if the sets intersect. The offset to subtract
+	 * from a valid character is looked up by its high nibble. 6-bit digits are then
+	 * packed with multiply-add instructions.
+	 */
+
+	// The offsets to add to indices for each range id: 'a'-'z', '0'-'9', '+', '/', 'A'-'Z'.
+	__attribute__((target("ssse3")))
+	inline __m128i encodeOffsets128(const Base64Alphabet alphabet)
+	{
+		const char c62 = alphabet == Base64Alphabet::standard ? '+' : '-';
+		const char c63 = alphabet == Base64Alphabet::standard ? '/' : '_';
+		return _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+				'0' - 52, '0' - 52, '0' - 52, c62 - 62, c63 - 63, 'A', 0, 0);
+	}
+
+	__attribute__((target("ssse3")))
+	inline __m128i encodeSplit(__m128i in)
+	{
+		// Octets ABC are placed as BACB (big-endian 16-bit pairs) to be split into 6-bit indices.
+		in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+		const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+		const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+		const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+		const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+		return _mm_or_si128(t1, t3);
+	}
+
+	__attribute__((target("ssse3")))
+	inline __m128i encodeTranslate(const __m128i indices, const __m128i offsets)
+	{
+		// 0 for 26..51, 1..10 for 52..61, 11 for 62, 12 for 63; then 13 for 0..25.
+		__m128i rangeIds = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+		const __m128i upperCase = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+		rangeIds = _mm_or_si128(rangeIds, _mm_and_si128(upperCase, _mm_set1_epi8(13)));
+		return _mm_add_epi8(_mm_shuffle_epi8(offsets, rangeIds), indices);
+	}
+
+	__attribute__((target("ssse3")))
+	std::size_t encodeSsse3(const unsigned char * const src, const std::size_t n, char *dest,
+			const Base64Alphabet alphabet)
+	{
+		const __m128i offsets = encodeOffsets128(alphabet);
+		std::size_t i = 0;
+		// 16 octets are loaded while 12 are encoded.
+		for (; n - i >= 16; i += 12, dest += 16) {
+			const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dest), encodeTranslate(encodeSplit(in), offsets));
+		}
+		return i;
+	}
+
+	__attribute__((target("avx2")))
+	std::size_t encodeAvx2(const unsigned char * const src, const std::size_t n, char *dest,
+			const Base64Alphabet alphabet)
+	{
+		const __m256i offsets = _mm256_broadcastsi128_si256(encodeOffsets128(alphabet));
+		const __m256i shuffle = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+				10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+		std::size_t i = 0;
+		// Each 128-bit lane encodes 12 octets; 28 octets are loaded while 24 are encoded.
+		for (; n - i >= 28; i += 24, dest += 32) {
+			const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+			const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 12));
+			__m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+			in = _mm256_shuffle_epi8(in, shuffle);
+			const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+			const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+			const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+			const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+			const __m256i indices = _mm256_or_si256(t1, t3);
+
+			__m256i rangeIds = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+			const __m256i upperCase = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+			rangeIds = _mm256_or_si256(rangeIds, _mm256_and_si256(upperCase, _mm256_set1_epi8(13)));
+			const __m256i out = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, rangeIds), indices);
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(dest), out);
+		}
+		return i;
+	}
+
+	// Bit sets for low nibbles of characters of the standard alphabet.
+	__attribute__((target("ssse3")))
+	inline __m128i decodeLowNibbleSets128()
+	{
+		return _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+				0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+	}
+
+	// Bit sets for high nibbles of characters of the standard alphabet.
+	__attribute__((target("ssse3")))
+	inline __m128i decodeHighNibbleSets128()
+	{
+		return _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+				0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	}
+
+	// The offsets to add to characters by their high nibbles; '/' is indexed as 1.
+	__attribute__((target("ssse3")))
+	inline __m128i decodeOffsets128()
+	{
+		return _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	}
+
+	/* Decodes 16 characters to 12 octets (in the lowest 12 octets of out).
+	 * Returns false if any character is not a 6-bit digit.
+	 */
+	template<Base64Alphabet alphabet>
+	__attribute__((target("ssse3")))
+	inline bool decodeSsse3(__m128i in, __m128i &out)
+	{
+		const __m128i mask2f = _mm_set1_epi8(0x2f);
+
+		bool valid = true;
+		if (alphabet == Base64Alphabet::urlSafe) {
+			// '+' and '/' are invalid; '-' and '_' are translated into them.
+			const __m128i standardOnly = _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('+')),
+					_mm_cmpeq_epi8(in, mask2f));
+			valid = _mm_movemask_epi8(standardOnly) == 0;
+			in = _mm_xor_si128(in, _mm_and_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('-')),
+					_mm_set1_epi8('-' ^ '+')));
+			in = _mm_xor_si128(in, _mm_and_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('_')),
+					_mm_set1_epi8('_' ^ '/')));
+		}
+
+		const __m128i highNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), mask2f);
+		const __m128i lowNibbles = _mm_and_si128(in, mask2f);
+		const __m128i lowSets = _mm_shuffle_epi8(decodeLowNibbleSets128(), lowNibbles);
+		const __m128i highSets = _mm_shuffle_epi8(decodeHighNibbleSets128(), highNibbles);
+		const __m128i invalid = _mm_cmpeq_epi8(_mm_and_si128(lowSets, highSets), _mm_setzero_si128());
+		if (!valid || _mm_movemask_epi8(invalid) != 0xffff) {
+			return false;
+		}
+
+		const __m128i slash = _mm_cmpeq_epi8(in, mask2f);
+		const __m128i offsets = _mm_shuffle_epi8(decodeOffsets128(), _mm_add_epi8(slash, highNibbles));
+		const __m128i digits = _mm_add_epi8(in, offsets);
+
+		// 00aaaaaa 00bbbbbb 00cccccc 00dddddd -> aaaaaabb bbbbcccc ccdddddd in reverse order.
+		const __m128i pairs = _mm_maddubs_epi16(digits, _mm_set1_epi32(0x01400140));
+		const __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+		out = _mm_shuffle_epi8(quads, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+		return true;
+	}
+
+	template<Base64Alphabet alphabet>
+	__attribute__((target("ssse3")))
+	std::size_t decodeSsse3(const char * const src, const std::size_t n, unsigned char *dest)
+	{
+		std::size_t i = 0;
+		for (; n - i >= 16; i += 16, dest += 12) {
+			__m128i out;
+			if (!decodeSsse3<alphabet>(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), out)) {
+				break;
+			}
+			_mm_storel_epi64(reinterpret_cast<__m128i *>(dest), out);
+			const std::uint32_t last = static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(out, 8)));
+			std::memcpy(dest + 8, &last, 4);
+		}
+		return i;
+	}
+
+	template<Base64Alphabet alphabet>
+	__attribute__((target("avx2")))
+	std::size_t decodeAvx2(const char * const src, const std::size_t n, unsigned char *dest)
+	{
+		const __m256i mask2f = _mm256_set1_epi8(0x2f);
+		const __m256i lowNibbleSets = _mm256_broadcastsi128_si256(decodeLowNibbleSets128());
+		const __m256i highNibbleSets = _mm256_broadcastsi128_si256(decodeHighNibbleSets128());
+		const __m256i decodeOffsets = _mm256_broadcastsi128_si256(decodeOffsets128());
+		const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+				2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+		std::size_t i = 0;
+		for (; n - i >= 32; i += 32, dest += 24) {
+			__m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+
+			bool valid = true;
+			if (alphabet == Base64Alphabet::urlSafe) {
+				const __m256i standardOnly = _mm256_or_si256(_mm256_cmpeq_epi8(in, _mm256_set1_epi8('+')),
+						_mm256_cmpeq_epi8(in, mask2f));
+				valid = _mm256_testz_si256(standardOnly, standardOnly);
+				in = _mm256_xor_si256(in, _mm256_and_si256(_mm256_cmpeq_epi8(in, _mm256_set1_epi8('-')),
+						_mm256_set1_epi8('-' ^ '+')));
+				in = _mm256_xor_si256(in, _mm256_and_si256(_mm256_cmpeq_epi8(in, _mm256_set1_epi8('_')),
+						_mm256_set1_epi8('_' ^ '/')));
+			}
+
+			const __m256i highNibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask2f);
+			const __m256i lowNibbles = _mm256_and_si256(in, mask2f);
+			const __m256i lowSets = _mm256_shuffle_epi8(lowNibbleSets, lowNibbles);
+			const __m256i highSets = _mm256_shuffle_epi8(highNibbleSets, highNibbles);
+			if (!valid || !_mm256_testz_si256(lowSets, highSets)) {
+				break;
+			}
+
+			const __m256i slash = _mm256_cmpeq_epi8(in, mask2f);
+			const __m256i offsets = _mm256_shuffle_epi8(decodeOffsets, _mm256_add_epi8(slash, highNibbles));
+			const __m256i digits = _mm256_add_epi8(in, offsets);
+
+			const __m256i pairs = _mm256_maddubs_epi16(digits, _mm256_set1_epi32(0x01400140));
+			const __m256i quads = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+			// Each lane holds 12 octets; moving them together to the lowest 24 octets.
+			const __m256i out = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(quads, pack),
+					_mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dest), _mm256_castsi256_si128(out));
+			_mm_storel_epi64(reinterpret_cast<__m128i *>(dest + 16), _mm256_extracti128_si256(out, 1));
+		}
+		return i;
+	}
+}
+#endif
+
+std::size_t afc::_impl::encodeBase64Simd(const unsigned char * const src, const std::size_t n, char * const dest,
+		const Base64Alphabet alphabet) noexcept
+{
+#ifdef AFC_AMD64
+	const afc::cpu::Features &features = afc::cpu::features();
+	std::size_t encodedSize = 0;
+	if (features.avx2) {
+		encodedSize = encodeAvx2(src, n, dest, alphabet);
+	}
+	if (features.ssse3) {
+		encodedSize += encodeSsse3(src + encodedSize, n - encodedSize, dest + encodedSize / 3 * 4, alphabet);
+	}
+	return encodedSize;
+#else
+	return 0;
+#endif
+}
+
+std::size_t afc::_impl::decodeBase64Simd(const char * const src, const std::size_t n, unsigned char * const dest,
+		const Base64Alphabet alphabet) noexcept
+{
+#ifdef AFC_AMD64
+	const afc::cpu::Features &features = afc::cpu::features();
+	std::size_t decodedSize = 0;
+	if (alphabet == Base64Alphabet::standard) {
+		if (features.avx2) {
+			decodedSize = decodeAvx2<Base64Alphabet::standard>(src, n, dest);
+		}
+		if (features.ssse3) {
+			decodedSize += decodeSsse3<Base64Alphabet::standard>(src + decodedSize, n - decodedSize,
+					dest + decodedSize / 4 * 3);
+		}
+	} else {
+		if (features.avx2) {
+			decodedSize = decodeAvx2<Base64Alphabet::urlSafe>(src, n, dest);
+		}
+		if (features.ssse3) {
+			decodedSize += decodeSsse3<Base64Alphabet::urlSafe>(src + decodedSize, n - decodedSize,
+					dest + decodedSize / 4 * 3);
+		}
+	}
+	return decodedSize;
+#else
+	return 0;
+#endif
+}
+
+void afc::OutputStreamSink::operator()(const char * const data, const std::size_t n)
+{
+	m_out.write(reinterpret_cast<const unsigned char *>(data), n);
+}
+
+void afc::OutputStreamSink::operator()(const unsigned char * const data, const std::size_t n)
+{
+	m_out.write(data, n);
+}
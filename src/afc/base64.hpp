@@ -18,13 +18,129 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <limits>
+#include <type_traits>
+#include "builtin.hpp"
+#include "math_utils.h"
 
 namespace afc
 {
-	template<typename InputIterator, typename OutputIterator>
+	enum class Base64Alphabet
+	{
+		// RFC 4648, section 4.
+		standard,
+		// RFC 4648, section 5: '-' and '_' are used instead of '+' and '/'.
+		urlSafe
+	};
+
+	enum class Base64DecodeMode
+	{
+		// Only alphabet characters and padding that completes the last quad are allowed.
+		strict,
+		// Spaces, tabs and line breaks are skipped; padding can be omitted or incomplete.
+		lenient
+	};
+
+	template<Base64Alphabet alphabet = Base64Alphabet::standard, typename InputIterator, typename OutputIterator>
 	OutputIterator encodeBase64(InputIterator begin, std::size_t size, OutputIterator dest);
 
+	/* Decodes Base64 data from [begin, end) and writes the octets decoded to dest.
+	 *
+	 * If the input is malformed then errorHandler is invoked with the iterator that points
+	 * to the first invalid character (or end if the input is incomplete) and decoding stops.
+	 * The octets decoded before the error are written to dest in any case.
+	 *
+	 * Returns the iterator past the last octet written.
+	 */
+	template<Base64DecodeMode mode = Base64DecodeMode::strict, Base64Alphabet alphabet = Base64Alphabet::standard,
+			typename InputIterator, typename OutputIterator, typename ErrorHandler>
+	OutputIterator decodeBase64(InputIterator begin, InputIterator end, OutputIterator dest,
+			ErrorHandler errorHandler);
+
+	struct OutputStream;
+
+	// Passes the data written by Base64Encoder and Base64Decoder to an afc::OutputStream.
+	class OutputStreamSink
+	{
+	public:
+		explicit OutputStreamSink(OutputStream &out) noexcept : m_out(out) {}
+
+		void operator()(const char *data, std::size_t n);
+		void operator()(const unsigned char *data, std::size_t n);
+	private:
+		OutputStream &m_out;
+	};
+
+	/* Encodes data as Base64 incrementally. Data can be split into chunks at arbitrary
+	 * positions; up to two octets that do not make a triplet are kept till the next chunk.
+	 *
+	 * The characters encoded are passed in runs to sink(const char *, std::size_t).
+	 * Memory used does not depend on the size of data.
+	 */
+	template<typename Sink, Base64Alphabet alphabet = Base64Alphabet::standard>
+	class Base64Encoder
+	{
+	public:
+		explicit Base64Encoder(Sink sink) : m_sink(sink), m_tailSize(0) {}
+
+		void write(const unsigned char *data, std::size_t n);
+		void write(const char * const data, const std::size_t n)
+		{
+			write(reinterpret_cast<const unsigned char *>(data), n);
+		}
+
+		// Encodes the octets kept and the padding. The encoder can be used for new data afterwards.
+		void finish();
+	private:
+		// A multiple of 4.
+		static constexpr std::size_t bufSize = 4096;
+
+		Sink m_sink;
+		unsigned char m_tail[2];
+		unsigned m_tailSize;
+	};
+
+	/* Decodes Base64 data incrementally. Data can be split into chunks at arbitrary
+	 * positions; an incomplete quad is kept till the next chunk.
+	 *
+	 * The octets decoded are passed in runs to sink(const unsigned char *, std::size_t).
+	 * If the data is malformed then write() or finish() returns false and errorOffset()
+	 * tells the offset of the first invalid character from the beginning of data
+	 * (or the size of data if it is incomplete). The octets decoded before the error
+	 * are passed to sink in any case.
+	 */
+	template<typename Sink, Base64DecodeMode mode = Base64DecodeMode::strict,
+			Base64Alphabet alphabet = Base64Alphabet::standard>
+	class Base64Decoder
+	{
+	public:
+		explicit Base64Decoder(Sink sink)
+			: m_sink(sink), m_quad(0), m_quadSize(0), m_paddingSize(0), m_offset(0), m_failed(false) {}
+
+		bool write(const char *data, std::size_t n);
+
+		// Decodes the incomplete quad kept. The decoder can be used for new data afterwards.
+		bool finish();
+
+		std::size_t errorOffset() const noexcept { return m_offset; }
+	private:
+		// A multiple of 3.
+		static constexpr std::size_t bufSize = 3072;
+
+		bool fail(std::size_t offset) noexcept;
+
+		Sink m_sink;
+		std::uint_fast32_t m_quad;
+		unsigned m_quadSize;
+		// The number of padding characters read after m_quad.
+		unsigned m_paddingSize;
+		// The number of characters read so far or the offset of the error.
+		std::size_t m_offset;
+		bool m_failed;
+	};
+
 	/*
 	 * Returns the size content of a given size encoded as Base64.
 	 * There is no protection from numeric overflow. Only non-negative
@@ -37,6 +153,16 @@ namespace afc
 		return (inputSize * 4 / 3 + 3) & ~3;
 	}
 
+	/*
+	 * Returns the maximal size of content Base64 data of a given size is decoded into.
+	 * Only non-negative values are expected as input.
+	 */
+	template<typename T>
+	constexpr T maxBase64DecodedSize(const T inputSize)
+	{
+		return inputSize / 4 * 3 + inputSize % 4 * 3 / 4;
+	}
+
 	namespace _impl
 	{
 		static const char base64EncodeTable[] = {
@@ -49,8 +175,68 @@ namespace afc
 				'w', 'x', 'y', 'z', '0', '1', '2', '3',
 				'4', '5', '6', '7', '8', '9', '+', '/' };
 
+		static const char base64UrlEncodeTable[] = {
+				'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
+				'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+				'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
+				'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+				'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n',
+				'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+				'w', 'x', 'y', 'z', '0', '1', '2', '3',
+				'4', '5', '6', '7', '8', '9', '-', '_' };
+
+		// Values of base64DecodeTable and base64UrlDecodeTable that are not 6-bit digits.
+		constexpr unsigned char base64Invalid = 0xff;
+		constexpr unsigned char base64Padding = 0xfe;
+		constexpr unsigned char base64Space = 0xfd;
+
+		// Maps characters to 6-bit digits or to one of the special values above.
+		extern const unsigned char base64DecodeTable[0x100];
+		extern const unsigned char base64UrlDecodeTable[0x100];
+
+		template<Base64Alphabet alphabet>
+		inline const char *base64EncodeTableFor() noexcept
+		{
+			return alphabet == Base64Alphabet::standard ? base64EncodeTable : base64UrlEncodeTable;
+		}
+
+		template<Base64Alphabet alphabet>
+		inline const unsigned char *base64DecodeTableFor() noexcept
+		{
+			return alphabet == Base64Alphabet::standard ? base64DecodeTable : base64UrlDecodeTable;
+		}
+
+		/* Encodes as many triplets from src as the SIMD kernels available on this CPU can process.
+		 * Returns the number of octets encoded which is a multiple of 3. Exactly 4/3 of this
+		 * number of characters is written to dest.
+		 */
+		std::size_t encodeBase64Simd(const unsigned char *src, std::size_t n, char *dest,
+				Base64Alphabet alphabet) noexcept;
+
+		/* Decodes as many quads from src as the SIMD kernels available on this CPU can process.
+		 * Decoding stops before the first block that contains a character that is not a 6-bit
+		 * digit, including padding and spaces. Returns the number of characters decoded which
+		 * is a multiple of 4. Exactly 3/4 of this number of octets is written to dest.
+		 */
+		std::size_t decodeBase64Simd(const char *src, std::size_t n, unsigned char *dest,
+				Base64Alphabet alphabet) noexcept;
+
+		template<typename T>
+		struct IsOctetPointer : std::integral_constant<bool, std::is_pointer<T>::value &&
+				(std::is_same<typename std::remove_cv<typename std::remove_pointer<T>::type>::type, char>::value ||
+				std::is_same<typename std::remove_cv<typename std::remove_pointer<T>::type>::type, unsigned char>::value ||
+				std::is_same<typename std::remove_cv<typename std::remove_pointer<T>::type>::type, signed char>::value)>
+		{
+		};
+
+		template<typename T>
+		struct IsMutableOctetPointer : std::integral_constant<bool, IsOctetPointer<T>::value &&
+				!std::is_const<typename std::remove_pointer<T>::type>::value>
+		{
+		};
+
 		template<typename Iterator>
-		inline Iterator encodeTriplet(Iterator p, char * const dest) noexcept
+		inline Iterator encodeTriplet(Iterator p, char * const dest, const char * const encodeTable) noexcept
 		{
 			// Casting all chars to unsigned chars, because the result of applying >> is defined for the latter.
 			const unsigned char v0 = static_cast<unsigned char>(*p);
@@ -69,27 +255,83 @@ namespace afc
 			const size_t pos4 = v2 & 0x3f;
 			assert(pos4 < 64);
 
-			dest[0] = base64EncodeTable[pos1];
-			dest[1] = base64EncodeTable[pos2];
-			dest[2] = base64EncodeTable[pos3];
-			dest[3] = base64EncodeTable[pos4];
+			dest[0] = encodeTable[pos1];
+			dest[1] = encodeTable[pos2];
+			dest[2] = encodeTable[pos3];
+			dest[3] = encodeTable[pos4];
 
 			return p;
 		}
+
+		template<Base64Alphabet alphabet, typename InputIterator, typename OutputIterator>
+		inline std::size_t encodeBase64Blocks(InputIterator &, std::size_t, OutputIterator &, std::false_type) noexcept
+		{
+			return 0;
+		}
+
+		template<Base64Alphabet alphabet, typename InputIterator, typename OutputIterator>
+		inline std::size_t encodeBase64Blocks(InputIterator &p, const std::size_t size, OutputIterator &dest,
+				std::true_type) noexcept
+		{
+			const std::size_t encodedSize = encodeBase64Simd(reinterpret_cast<const unsigned char *>(p), size,
+					reinterpret_cast<char *>(dest), alphabet);
+			p += encodedSize;
+			dest += encodedSize / 3 * 4;
+			return encodedSize;
+		}
+
+		template<Base64Alphabet alphabet, typename InputIterator, typename OutputIterator>
+		inline void decodeBase64Blocks(InputIterator &, InputIterator, OutputIterator &, std::false_type) noexcept
+		{
+		}
+
+		template<Base64Alphabet alphabet, typename InputIterator, typename OutputIterator>
+		inline void decodeBase64Blocks(InputIterator &p, const InputIterator end, OutputIterator &dest,
+				std::true_type) noexcept
+		{
+			const std::size_t decodedSize = decodeBase64Simd(reinterpret_cast<const char *>(p),
+					static_cast<std::size_t>(end - p), reinterpret_cast<unsigned char *>(dest), alphabet);
+			p += decodedSize;
+			dest += decodedSize / 4 * 3;
+		}
+
+		// Writes the octets of an incomplete quad of 2 or 3 digits.
+		template<typename OutputIterator>
+		inline OutputIterator writeBase64Tail(const std::uint_fast32_t quad, const unsigned quadSize,
+				OutputIterator dest)
+		{
+			assert(quadSize == 2 || quadSize == 3);
+
+			if (quadSize == 2) {
+				*dest = static_cast<unsigned char>(quad >> 4);
+				++dest;
+			} else {
+				*dest = static_cast<unsigned char>(quad >> 10);
+				++dest;
+				*dest = static_cast<unsigned char>(quad >> 2);
+				++dest;
+			}
+			return dest;
+		}
 	}
 }
 
 static_assert(std::numeric_limits<unsigned char>::digits == 8, "8-bit bytes (chars) are supported only.");
 
-template<typename InputIterator, typename OutputIterator>
+template<afc::Base64Alphabet alphabet, typename InputIterator, typename OutputIterator>
 OutputIterator afc::encodeBase64(InputIterator begin, std::size_t size, OutputIterator dest)
 {
+	const char * const encodeTable = afc::_impl::base64EncodeTableFor<alphabet>();
+
+	InputIterator p = begin;
+	size -= afc::_impl::encodeBase64Blocks<alphabet>(p, size, dest, std::integral_constant<bool,
+			afc::_impl::IsOctetPointer<InputIterator>::value && afc::_impl::IsMutableOctetPointer<OutputIterator>::value>());
+
 	const std::size_t tailSize = size % 3;
 	char chunk[4];
 
-	InputIterator p = begin;
 	for (std::size_t i = size - tailSize; i != 0; i -= 3) {
-		p = afc::_impl::encodeTriplet(p, chunk);
+		p = afc::_impl::encodeTriplet(p, chunk, encodeTable);
 		dest = std::copy_n(chunk, 4, dest);
 	}
 
@@ -106,7 +348,7 @@ OutputIterator afc::encodeBase64(InputIterator begin, std::size_t size, OutputIt
 		}
 		tail[2] = 0;
 
-		afc::_impl::encodeTriplet(tail, chunk);
+		afc::_impl::encodeTriplet(tail, chunk, encodeTable);
 
 		if (tailSize == 1) {
 			chunk[2] = '=';
@@ -119,4 +361,250 @@ OutputIterator afc::encodeBase64(InputIterator begin, std::size_t size, OutputIt
 	return dest;
 }
 
+template<afc::Base64DecodeMode mode, afc::Base64Alphabet alphabet,
+		typename InputIterator, typename OutputIterator, typename ErrorHandler>
+OutputIterator afc::decodeBase64(InputIterator begin, const InputIterator end, OutputIterator dest,
+		ErrorHandler errorHandler)
+{
+	using namespace afc::_impl;
+
+	typedef std::integral_constant<bool, IsOctetPointer<InputIterator>::value &&
+			IsMutableOctetPointer<OutputIterator>::value> UseBlocks;
+
+	const unsigned char * const decodeTable = base64DecodeTableFor<alphabet>();
+
+	InputIterator p = begin;
+	std::uint_fast32_t quad = 0;
+	unsigned quadSize = 0;
+	unsigned paddingSize;
+	// Whole quads are decoded by the SIMD kernels at the beginning and after each space.
+	bool decodeBlocks = true;
+
+	for (;;) {
+		if (decodeBlocks && quadSize == 0) {
+			decodeBase64Blocks<alphabet>(p, end, dest, UseBlocks());
+			decodeBlocks = false;
+		}
+		if (p == end) {
+			break;
+		}
+
+		const unsigned char value = decodeTable[static_cast<unsigned char>(*p)];
+		if (likely(value < 64)) {
+			quad = (quad << 6) | value;
+			if (++quadSize == 4) {
+				*dest = static_cast<unsigned char>(quad >> 16);
+				++dest;
+				*dest = static_cast<unsigned char>(quad >> 8);
+				++dest;
+				*dest = static_cast<unsigned char>(quad);
+				++dest;
+				quad = 0;
+				quadSize = 0;
+			}
+		} else if (mode == Base64DecodeMode::lenient && value == base64Space) {
+			decodeBlocks = true;
+		} else if (value == base64Padding) {
+			goto padding;
+		} else {
+			goto error;
+		}
+		++p;
+	}
+
+	if (quadSize == 0) {
+		return dest;
+	}
+	// The padding is missing.
+	if (mode == Base64DecodeMode::strict || quadSize == 1) {
+		goto error;
+	}
+	return writeBase64Tail(quad, quadSize, dest);
+
+padding:
+	// p points to the first padding character.
+	if (quadSize < 2) {
+		goto error;
+	}
+	if (mode == Base64DecodeMode::strict) {
+		// The bits that are not a part of the octets encoded must be zero.
+		if ((quad & (quadSize == 2 ? 0x0f : 0x03)) != 0) {
+			goto error;
+		}
+	}
+
+	paddingSize = 0;
+	for (; p != end; ++p) {
+		const unsigned char value = decodeTable[static_cast<unsigned char>(*p)];
+		if (value == base64Padding && paddingSize < 4 - quadSize) {
+			++paddingSize;
+		} else if (mode != Base64DecodeMode::lenient || value != base64Space) {
+			goto error;
+		}
+	}
+	if (mode == Base64DecodeMode::strict && paddingSize != 4 - quadSize) {
+		goto error;
+	}
+	return writeBase64Tail(quad, quadSize, dest);
+
+error:
+	errorHandler(p);
+	return dest;
+}
+
+template<typename Sink, afc::Base64Alphabet alphabet>
+void afc::Base64Encoder<Sink, alphabet>::write(const unsigned char *data, std::size_t n)
+{
+	char buf[bufSize];
+
+	if (m_tailSize != 0) {
+		// Completing the triplet started by the previous chunk.
+		unsigned char triplet[3];
+		std::copy_n(m_tail, m_tailSize, triplet);
+		while (m_tailSize < 3 && n > 0) {
+			triplet[m_tailSize++] = *data++;
+			--n;
+		}
+		if (m_tailSize < 3) {
+			std::copy_n(triplet, m_tailSize, m_tail);
+			return;
+		}
+		encodeBase64<alphabet>(triplet, 3, buf);
+		m_sink(static_cast<const char *>(buf), std::size_t(4));
+	}
+
+	const std::size_t tripletsSize = n - n % 3;
+	for (std::size_t i = 0; i < tripletsSize;) {
+		const std::size_t chunkSize = afc::math::min(tripletsSize - i, bufSize / 4 * 3);
+		char * const end = encodeBase64<alphabet>(data + i, chunkSize, buf);
+		m_sink(static_cast<const char *>(buf), static_cast<std::size_t>(end - buf));
+		i += chunkSize;
+	}
+
+	m_tailSize = static_cast<unsigned>(n - tripletsSize);
+	std::copy_n(data + tripletsSize, m_tailSize, m_tail);
+}
+
+template<typename Sink, afc::Base64Alphabet alphabet>
+void afc::Base64Encoder<Sink, alphabet>::finish()
+{
+	if (m_tailSize != 0) {
+		char buf[4];
+		encodeBase64<alphabet>(m_tail, m_tailSize, buf);
+		m_tailSize = 0;
+		m_sink(static_cast<const char *>(buf), std::size_t(4));
+	}
+}
+
+template<typename Sink, afc::Base64DecodeMode mode, afc::Base64Alphabet alphabet>
+bool afc::Base64Decoder<Sink, mode, alphabet>::write(const char * const data, const std::size_t n)
+{
+	using namespace afc::_impl;
+
+	if (unlikely(m_failed)) {
+		return false;
+	}
+
+	const unsigned char * const decodeTable = base64DecodeTableFor<alphabet>();
+	unsigned char buf[bufSize];
+	std::size_t bufPos = 0;
+
+	for (std::size_t i = 0; i < n;) {
+		if (m_quadSize == 0) {
+			// Whole quads are decoded by the SIMD kernels directly.
+			const std::size_t maxSize = afc::math::min(n - i, (bufSize - bufPos) / 3 * 4);
+			const std::size_t decodedSize = decodeBase64Simd(data + i, maxSize, buf + bufPos, alphabet);
+			i += decodedSize;
+			bufPos += decodedSize / 4 * 3;
+			if (bufSize - bufPos < 3) {
+				m_sink(static_cast<const unsigned char *>(buf), bufPos);
+				bufPos = 0;
+				continue;
+			}
+			if (i == n) {
+				break;
+			}
+		}
+
+		const unsigned char value = decodeTable[static_cast<unsigned char>(data[i])];
+		if (m_paddingSize != 0) {
+			// Only padding that completes the quad (and spaces in the lenient mode) can follow.
+			if (value == base64Padding && m_paddingSize < 4 - m_quadSize) {
+				++m_paddingSize;
+			} else if (mode != Base64DecodeMode::lenient || value != base64Space) {
+				goto error;
+			}
+		} else if (likely(value < 64)) {
+			m_quad = (m_quad << 6) | value;
+			if (++m_quadSize == 4) {
+				buf[bufPos++] = static_cast<unsigned char>(m_quad >> 16);
+				buf[bufPos++] = static_cast<unsigned char>(m_quad >> 8);
+				buf[bufPos++] = static_cast<unsigned char>(m_quad);
+				m_quad = 0;
+				m_quadSize = 0;
+				if (bufSize - bufPos < 3) {
+					m_sink(static_cast<const unsigned char *>(buf), bufPos);
+					bufPos = 0;
+				}
+			}
+		} else if (mode == Base64DecodeMode::lenient && value == base64Space) {
+			// Skipping.
+		} else if (value == base64Padding && m_quadSize >= 2) {
+			// The bits that are not a part of the octets encoded must be zero in the strict mode.
+			if (mode == Base64DecodeMode::strict && (m_quad & (m_quadSize == 2 ? 0x0f : 0x03)) != 0) {
+				goto error;
+			}
+			m_paddingSize = 1;
+		} else {
+			goto error;
+		}
+		++i;
+		continue;
+	error:
+		if (bufPos != 0) {
+			m_sink(static_cast<const unsigned char *>(buf), bufPos);
+		}
+		return fail(m_offset + i);
+	}
+
+	if (bufPos != 0) {
+		m_sink(static_cast<const unsigned char *>(buf), bufPos);
+	}
+	m_offset += n;
+	return true;
+}
+
+template<typename Sink, afc::Base64DecodeMode mode, afc::Base64Alphabet alphabet>
+bool afc::Base64Decoder<Sink, mode, alphabet>::finish()
+{
+	if (unlikely(m_failed)) {
+		return false;
+	}
+
+	if (m_quadSize != 0) {
+		if (m_paddingSize == 0 ? mode == Base64DecodeMode::strict || m_quadSize == 1 :
+				mode == Base64DecodeMode::strict && m_paddingSize != 4 - m_quadSize) {
+			return fail(m_offset);
+		}
+
+		unsigned char buf[2];
+		unsigned char * const end = afc::_impl::writeBase64Tail(m_quad, m_quadSize, buf);
+		m_sink(static_cast<const unsigned char *>(buf), static_cast<std::size_t>(end - buf));
+	}
+
+	m_quad = 0;
+	m_quadSize = 0;
+	m_paddingSize = 0;
+	m_offset = 0;
+	return true;
+}
+
+template<typename Sink, afc::Base64DecodeMode mode, afc::Base64Alphabet alphabet>
+bool afc::Base64Decoder<Sink, mode, alphabet>::fail(const std::size_t offset) noexcept
+{
+	m_failed = true;
+	m_offset = offset;
+	return false;
+}
+
 #endif /* AFC_BASE64_HPP_ */
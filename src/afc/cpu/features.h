@@ -0,0 +1,94 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_CPU_FEATURES_H_
+#define AFC_CPU_FEATURES_H_
+
+#include "../platform.h"
+
+#if defined AFC_X86 || defined AFC_AMD64
+	#include <cpuid.h>
+#endif
+
+namespace afc
+{
+namespace cpu
+{
+	/* Instruction set extensions that are both supported by the CPU and enabled by the OS.
+	 * Extensions that use wide registers are reported only if the OS saves their state
+	 * on context switches.
+	 */
+	struct Features
+	{
+		bool ssse3;
+		bool sse41;
+		bool pclmul;
+		bool avx2;
+		bool avx512f;
+		bool vpclmulqdq;
+		bool sha;
+		// The time stamp counter runs at a constant rate in all ACPI P-, C- and T-states.
+		bool invariantTsc;
+	};
+
+	namespace _impl
+	{
+		inline Features detectFeatures() noexcept
+		{
+			Features features = {};
+#if defined AFC_X86 || defined AFC_AMD64
+			unsigned eax, ebx, ecx, edx;
+
+			if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+				return features;
+			}
+			features.ssse3 = (ecx & bit_SSSE3) != 0;
+			features.sse41 = (ecx & bit_SSE4_1) != 0;
+			features.pclmul = (ecx & bit_PCLMUL) != 0;
+
+			unsigned xcr0 = 0;
+			if ((ecx & bit_OSXSAVE) != 0) {
+				unsigned xcr0Hi;
+				__asm__ ("xgetbv" : "=a" (xcr0), "=d" (xcr0Hi) : "c" (0));
+			}
+			// XMM and YMM state; opmask and ZMM state in addition for AVX-512.
+			const bool avxEnabled = (xcr0 & 0x06) == 0x06;
+			const bool avx512Enabled = (xcr0 & 0xe6) == 0xe6;
+
+			if (__get_cpuid_max(0, nullptr) >= 7) {
+				__cpuid_count(7, 0, eax, ebx, ecx, edx);
+				features.avx2 = avxEnabled && (ebx & bit_AVX2) != 0;
+				features.avx512f = avx512Enabled && (ebx & bit_AVX512F) != 0;
+				features.vpclmulqdq = features.avx512f && (ecx & bit_VPCLMULQDQ) != 0;
+				features.sha = (ebx & bit_SHA) != 0;
+			}
+			if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+				features.invariantTsc = (edx & (1u << 8)) != 0;
+			}
+#endif
+			return features;
+		}
+	}
+
+	// Returns the features of the CPU the process runs on. They are detected once, on the first call.
+	inline const Features &features() noexcept
+	{
+		static const Features features = _impl::detectFeatures();
+		return features;
+	}
+}
+}
+
+#endif /* AFC_CPU_FEATURES_H_ */
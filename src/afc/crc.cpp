@@ -16,7 +16,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include "crc.hpp"
 #include "builtin.hpp"
+#include "math_utils.h"
+#include "stream.h"
+#include <cstring>
 #include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef AFC_AMD64
+	#include <immintrin.h>
+	#include "cpu/features.h"
+#endif
 
 namespace
 {
@@ -176,6 +187,281 @@ namespace
 
 		return crc;
 	}
+
+	// Multiplies a reflected polynomial by x modulo P.
+	constexpr std::uint64_t multiplyByX(const std::uint64_t a)
+	{
+		return (a & 1) ? (a >> 1) ^ afc::crc64Reversed_impl::polynome : a >> 1;
+	}
+
+	// Multiplies two reflected polynomials modulo P (Horner's scheme from the highest term of a).
+	constexpr std::uint64_t multiplyModP(const std::uint64_t a, const std::uint64_t b,
+			const unsigned i = 0, const std::uint64_t acc = 0)
+	{
+		return i == 64 ? acc : multiplyModP(a, b, i + 1, multiplyByX(acc) ^ (((a >> i) & 1) != 0 ? b : 0));
+	}
+
+	// x^n mod P in the reflected bit order.
+	constexpr std::uint64_t xPowerModP(const unsigned n)
+	{
+		return n < 64 ? std::uint64_t(1) << (63 - n) : multiplyModP(xPowerModP(n / 2), xPowerModP(n - n / 2));
+	}
+
+	// x^(8*n) mod P in the reflected bit order, i.e. the multiplier that appends n zero octets to a remainder.
+	std::uint64_t xPowerModPOctets(std::size_t n)
+	{
+		std::uint64_t result = std::uint64_t(1) << 63; // x^0
+		std::uint64_t square = xPowerModP(8);
+		for (; n != 0; n >>= 1) {
+			if ((n & 1) != 0) {
+				result = multiplyModP(result, square);
+			}
+			square = multiplyModP(square, square);
+		}
+		return result;
+	}
+
+	// Data smaller than this is not split between threads since starting a thread costs more.
+	constexpr std::size_t minParallelChunkSize = 1024 * 1024;
+
+	// The size of a portion of a stream checksummed at a time is limited to bound the memory used.
+	constexpr std::size_t maxParallelBatchSize = 32 * 1024 * 1024;
+
+	unsigned parallelThreadCount(const unsigned threadCount)
+	{
+		if (threadCount != 0) {
+			return threadCount;
+		}
+		const unsigned hardwareThreadCount = std::thread::hardware_concurrency();
+		return hardwareThreadCount != 0 ? hardwareThreadCount : 1;
+	}
+
+	// Joins all the threads started on destruction so that no thread is left running if an exception is thrown.
+	class ThreadGroup
+	{
+	public:
+		explicit ThreadGroup(const std::size_t capacity) { m_threads.reserve(capacity); }
+		ThreadGroup(const ThreadGroup &) = delete;
+		ThreadGroup &operator=(const ThreadGroup &) = delete;
+		~ThreadGroup() { join(); }
+
+		template<typename Function>
+		void start(Function &&f) { m_threads.emplace_back(std::forward<Function>(f)); }
+
+		void join()
+		{
+			for (std::thread &t : m_threads) {
+				t.join();
+			}
+			m_threads.clear();
+		}
+	private:
+		std::vector<std::thread> m_threads;
+	};
+
+	// Reads as much data as the stream has up to n octets.
+	std::size_t readFully(afc::InputStream &in, unsigned char * const data, const std::size_t n)
+	{
+		std::size_t total = 0;
+		while (total < n) {
+			const std::size_t count = in.read(data + total, n - total);
+			if (count == 0) {
+				break;
+			}
+			total += count;
+		}
+		return total;
+	}
+
+#ifdef AFC_AMD64
+	/* Carry-less multiplication folding (Intel, "Fast CRC Computation for Generic Polynomials
+	 * Using PCLMULQDQ Instruction").
+	 *
+	 * A 128-bit chunk A*x^64 + B that is followed by D bits of data contributes
+	 * (A*x^64 + B)*x^D = A*x^(D+64) + B*x^D to the remainder. Both multipliers can be reduced
+	 * modulo P in advance, so the chunk is folded onto the chunk D bits ahead with two
+	 * 64x64 carry-less multiplications and no data dependency on the bytes in between.
+	 *
+	 * With the reflected bit order the product of two 64-bit values is one bit short
+	 * of the 128-bit reflected result, so x^(D+63) and x^(D-1) are used as the multipliers.
+	 */
+
+	// The multipliers to fold a 128-bit chunk onto the chunk that is distance bits ahead.
+	struct FoldConstants
+	{
+		std::uint64_t lo;
+		std::uint64_t hi;
+	};
+
+	constexpr FoldConstants foldConstants(const unsigned distance)
+	{
+		return FoldConstants{xPowerModP(distance + 63), xPowerModP(distance - 1)};
+	}
+
+	constexpr FoldConstants fold128 = foldConstants(128);
+	constexpr FoldConstants fold256 = foldConstants(256);
+	constexpr FoldConstants fold384 = foldConstants(384);
+	constexpr FoldConstants fold512 = foldConstants(512);
+	constexpr FoldConstants fold2048 = foldConstants(2048);
+
+	// The minimal data sizes the carry-less multiplication kernels are used for.
+	constexpr std::size_t pclmulMinSize = 64;
+	constexpr std::size_t vpclmulMinSize = 256;
+
+	__attribute__((target("pclmul")))
+	inline __m128i fold(const __m128i x, const __m128i k, const __m128i next)
+	{
+		return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11)),
+				next);
+	}
+
+	__attribute__((target("pclmul")))
+	inline __m128i load128(const unsigned char * const p)
+	{
+		return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+	}
+
+	__attribute__((target("pclmul")))
+	inline __m128i constants128(const FoldConstants k)
+	{
+		return _mm_set_epi64x(static_cast<long long>(k.hi), static_cast<long long>(k.lo));
+	}
+
+	/* Folds the remaining 128-bit chunks onto x and reduces it to the final CRC.
+	 *
+	 * x is the pending remainder followed by the data [p, end). The CRC of this message
+	 * is the CRC of the 16 octets of x calculated with the zero initial value and then
+	 * updated with the tail that does not fill a 128-bit chunk.
+	 */
+	__attribute__((target("pclmul")))
+	std::uint64_t crc64PclmulFinish(__m128i x, const unsigned char *p, const unsigned char * const end)
+	{
+		const __m128i k128 = constants128(fold128);
+		for (; end - p >= 16; p += 16) {
+			x = fold(x, k128, load128(p));
+		}
+
+		alignas(16) unsigned char remainder[16];
+		_mm_store_si128(reinterpret_cast<__m128i *>(remainder), x);
+		std::uint_fast64_t crc = crc64Fast64Impl(0, remainder, sizeof(remainder));
+
+		for (; p != end; ++p) {
+			crc = afc::crc64Reversed_impl::crc64ReverseStep(crc, *p);
+		}
+		return crc;
+	}
+
+	// Processes 64 octets per iteration in four independent 128-bit lanes.
+	__attribute__((target("pclmul")))
+	std::uint64_t crc64Pclmul(const std::uint64_t currentCrc, const unsigned char * const data, const std::size_t n)
+	{
+		assert(n >= pclmulMinSize);
+
+		const unsigned char *p = data;
+		const unsigned char * const end = data + n;
+
+		// The current CRC is a remainder to be added to the first 64 bits of the data.
+		__m128i x0 = _mm_xor_si128(load128(p), _mm_cvtsi64_si128(static_cast<long long>(currentCrc)));
+		__m128i x1 = load128(p + 16);
+		__m128i x2 = load128(p + 32);
+		__m128i x3 = load128(p + 48);
+		p += 64;
+
+		const __m128i k512 = constants128(fold512);
+		for (; end - p >= 64; p += 64) {
+			x0 = fold(x0, k512, load128(p));
+			x1 = fold(x1, k512, load128(p + 16));
+			x2 = fold(x2, k512, load128(p + 32));
+			x3 = fold(x3, k512, load128(p + 48));
+		}
+
+		const __m128i k128 = constants128(fold128);
+		__m128i x = fold(x0, k128, x1);
+		x = fold(x, k128, x2);
+		x = fold(x, k128, x3);
+
+		return crc64PclmulFinish(x, p, end);
+	}
+
+	__attribute__((target("avx512f,vpclmulqdq,pclmul")))
+	inline __m512i fold(const __m512i x, const __m512i k, const __m512i next)
+	{
+		// 0x96 is a ^ b ^ c.
+		return _mm512_ternarylogic_epi64(_mm512_clmulepi64_epi128(x, k, 0x00), _mm512_clmulepi64_epi128(x, k, 0x11),
+				next, 0x96);
+	}
+
+	__attribute__((target("avx512f,vpclmulqdq,pclmul")))
+	inline __m512i load512(const unsigned char * const p)
+	{
+		return _mm512_loadu_si512(p);
+	}
+
+	__attribute__((target("avx512f,vpclmulqdq,pclmul")))
+	inline __m512i constants512(const FoldConstants k)
+	{
+		const long long lo = static_cast<long long>(k.lo), hi = static_cast<long long>(k.hi);
+		return _mm512_set_epi64(hi, lo, hi, lo, hi, lo, hi, lo);
+	}
+
+	/* Processes 256 octets per iteration in sixteen independent 128-bit lanes packed
+	 * into four 512-bit registers.
+	 */
+	__attribute__((target("avx512f,vpclmulqdq,pclmul")))
+	std::uint64_t crc64Vpclmul(const std::uint64_t currentCrc, const unsigned char * const data, const std::size_t n)
+	{
+		assert(n >= vpclmulMinSize);
+
+		const unsigned char *p = data;
+		const unsigned char * const end = data + n;
+
+		__m512i x0 = _mm512_xor_si512(load512(p), _mm512_set_epi64(0, 0, 0, 0, 0, 0, 0,
+				static_cast<long long>(currentCrc)));
+		__m512i x1 = load512(p + 64);
+		__m512i x2 = load512(p + 128);
+		__m512i x3 = load512(p + 192);
+		p += 256;
+
+		const __m512i k2048 = constants512(fold2048);
+		for (; end - p >= 256; p += 256) {
+			x0 = fold(x0, k2048, load512(p));
+			x1 = fold(x1, k2048, load512(p + 64));
+			x2 = fold(x2, k2048, load512(p + 128));
+			x3 = fold(x3, k2048, load512(p + 192));
+		}
+
+		const __m512i k512 = constants512(fold512);
+		__m512i x = fold(x0, k512, x1);
+		x = fold(x, k512, x2);
+		x = fold(x, k512, x3);
+		for (; end - p >= 64; p += 64) {
+			x = fold(x, k512, load512(p));
+		}
+
+		// The last lane is kept as is, the three others are folded onto it.
+		const __m512i k = _mm512_set_epi64(0, 0,
+				static_cast<long long>(fold128.hi), static_cast<long long>(fold128.lo),
+				static_cast<long long>(fold256.hi), static_cast<long long>(fold256.lo),
+				static_cast<long long>(fold384.hi), static_cast<long long>(fold384.lo));
+		alignas(64) unsigned char lanes[64];
+		_mm512_store_si512(lanes, _mm512_mask_mov_epi64(fold(x, k, _mm512_setzero_si512()), 0xc0, x));
+		const __m128i y = _mm_xor_si128(_mm_xor_si128(load128(lanes), load128(lanes + 16)),
+				_mm_xor_si128(load128(lanes + 32), load128(lanes + 48)));
+
+		return crc64PclmulFinish(y, p, end);
+	}
+
+	inline std::uint_fast64_t crc64ClmulUpdate(const std::uint_fast64_t currentCrc,
+			const unsigned char * const data, const std::size_t n)
+	{
+		assert(n >= pclmulMinSize);
+
+		if (afc::cpu::features().vpclmulqdq && n >= vpclmulMinSize) {
+			return crc64Vpclmul(currentCrc, data, n);
+		}
+		return crc64Pclmul(currentCrc, data, n);
+	}
+#endif
 }
 
 // CRC64 value for each 00 00 00 00 00 00 00 xx.
@@ -727,6 +1013,12 @@ std::uint_fast64_t afc::crc64ReversedUpdate(const std::uint_fast64_t currentCrc,
 {
 	assert(currentCrc == (currentCrc & 0xffffffffffffffff));
 
+#ifdef AFC_AMD64
+	if (n >= pclmulMinSize && afc::cpu::features().pclmul) {
+		return crc64ClmulUpdate(currentCrc, data, n);
+	}
+#endif
+
 	std::uint_fast64_t crc = currentCrc;
 
 	if (afc::crc64Reversed_impl::suitableForAutoFastAligned8()) {
@@ -769,6 +1061,11 @@ std::uint_fast64_t afc::crc64ReversedUpdate(const std::uint_fast64_t currentCrc,
 std::uint_fast64_t afc::crc64ReversedUpdate_Aligned8Impl(const std::uint_fast64_t currentCrc,
 		const unsigned char * const data, const std::size_t n)
 {
+#ifdef AFC_AMD64
+	if (n >= pclmulMinSize && afc::cpu::features().pclmul) {
+		return crc64ClmulUpdate(currentCrc, data, n);
+	}
+#endif
 	return crc64ReversedUpdate_Aligned8Impl_Inline(currentCrc, data, n);
 }
 
@@ -802,3 +1099,89 @@ std::uint_fast64_t afc::crc64ReversedUpdate_Fast64(const std::uint_fast64_t curr
 		return currentCrc;
 	}
 }
+
+std::uint_fast64_t afc::crc64ReversedCombine(const std::uint_fast64_t crcA, const std::uint_fast64_t crcB,
+		const std::size_t lenB)
+{
+	assert(crcA == (crcA & 0xffffffffffffffff));
+	assert(crcB == (crcB & 0xffffffffffffffff));
+
+	/* CRC with the zero initial value and no final xor is linear: appending B to A
+	 * is the same as appending lenB zero octets to A and adding the CRC of B.
+	 */
+	return multiplyModP(crcA, xPowerModPOctets(lenB)) ^ crcB;
+}
+
+std::uint_fast64_t afc::crc64ReversedUpdateParallel(const std::uint_fast64_t currentCrc,
+		const unsigned char * const data, const std::size_t n, const unsigned threadCount)
+{
+	const std::size_t chunkCount = afc::math::min<std::size_t>(parallelThreadCount(threadCount),
+			n / minParallelChunkSize);
+	if (chunkCount <= 1) {
+		return crc64ReversedUpdate(currentCrc, data, n);
+	}
+
+	const std::size_t chunkSize = n / chunkCount;
+	const std::size_t lastChunkSize = n - (chunkCount - 1) * chunkSize;
+	std::unique_ptr<std::uint_fast64_t[]> chunkCrcs(new std::uint_fast64_t[chunkCount]);
+
+	{
+		ThreadGroup threads(chunkCount - 1);
+		for (std::size_t i = 1; i < chunkCount; ++i) {
+			threads.start([&chunkCrcs, data, i, chunkCount, chunkSize, lastChunkSize]() {
+				chunkCrcs[i] = crc64ReversedUpdate(0, data + i * chunkSize,
+						i == chunkCount - 1 ? lastChunkSize : chunkSize);
+			});
+		}
+		// The calling thread processes the first chunk.
+		chunkCrcs[0] = crc64ReversedUpdate(currentCrc, data, chunkSize);
+		threads.join();
+	}
+
+	const std::uint64_t chunkShift = xPowerModPOctets(chunkSize);
+	std::uint_fast64_t crc = chunkCrcs[0];
+	for (std::size_t i = 1; i < chunkCount - 1; ++i) {
+		crc = multiplyModP(crc, chunkShift) ^ chunkCrcs[i];
+	}
+	return crc64ReversedCombine(crc, chunkCrcs[chunkCount - 1], lastChunkSize);
+}
+
+std::uint_fast64_t afc::crc64ReversedUpdateParallel(const std::uint_fast64_t currentCrc, InputStream &in,
+		const unsigned threadCount, const std::size_t chunkSize)
+{
+	assert(chunkSize > 0);
+
+	const unsigned actualThreadCount = parallelThreadCount(threadCount);
+	const std::size_t bufSize = chunkSize < maxParallelBatchSize / actualThreadCount ?
+			actualThreadCount * chunkSize : maxParallelBatchSize;
+
+	/* The buffers are allocated as the data arrives so that short streams do not cost
+	 * a full batch of memory.
+	 */
+	const std::size_t firstChunkSize = afc::math::min(chunkSize, bufSize);
+	std::unique_ptr<unsigned char[]> buf(new unsigned char[firstChunkSize]);
+	std::size_t n = readFully(in, buf.get(), firstChunkSize);
+	if (n == firstChunkSize && firstChunkSize < bufSize) {
+		std::unique_ptr<unsigned char[]> batch(new unsigned char[bufSize]);
+		std::memcpy(batch.get(), buf.get(), n);
+		n += readFully(in, batch.get() + n, bufSize - n);
+		buf = std::move(batch);
+	}
+	if (n < bufSize) {
+		return crc64ReversedUpdateParallel(currentCrc, buf.get(), n, actualThreadCount);
+	}
+	std::unique_ptr<unsigned char[]> nextBuf(new unsigned char[bufSize]);
+
+	std::uint_fast64_t crc = currentCrc;
+	ThreadGroup hasher(1);
+	while (n == bufSize) {
+		// Checksumming the data read while reading the next portion.
+		hasher.start([&crc, &buf, bufSize, actualThreadCount]() {
+			crc = crc64ReversedUpdateParallel(crc, buf.get(), bufSize, actualThreadCount);
+		});
+		n = readFully(in, nextBuf.get(), bufSize);
+		hasher.join();
+		std::swap(buf, nextBuf);
+	}
+	return crc64ReversedUpdateParallel(crc, buf.get(), n, actualThreadCount);
+}
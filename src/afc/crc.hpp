@@ -110,6 +110,48 @@ namespace afc
 		return crc64ReversedUpdate_Aligned8(0, data, n);
 	}
 
+	/* Calculates CRC-64 ECMA (reversed) of the concatenation AB given crcA of A, crcB of B
+	 * and the size of B in octets. crcA can be any current CRC, crcB must be calculated
+	 * with the zero initial CRC.
+	 *
+	 * This allows to checksum chunks of data independently and in any order, and combine
+	 * the checksums afterwards. It takes O(log(lenB)) operations.
+	 */
+	std::uint_fast64_t crc64ReversedCombine(std::uint_fast64_t crcA, std::uint_fast64_t crcB, std::size_t lenB);
+
+	/* Works as crc64ReversedUpdate() but splits the data into chunks checksummed by threadCount
+	 * threads. If threadCount is zero then std::thread::hardware_concurrency() threads are used.
+	 * Data that is too small to benefit from multiple threads is processed by the calling thread.
+	 */
+	std::uint_fast64_t crc64ReversedUpdateParallel(std::uint_fast64_t currentCrc,
+			const unsigned char *data, std::size_t n, unsigned threadCount = 0);
+
+	inline std::uint_fast64_t crc64ReversedParallel(const unsigned char * const data, const std::size_t n,
+			const unsigned threadCount = 0)
+	{
+		return crc64ReversedUpdateParallel(0, data, n, threadCount);
+	}
+
+	struct InputStream;
+
+	/* Reads the stream till its end and calculates CRC-64 ECMA (reversed) of the data read.
+	 *
+	 * The stream is read by the calling thread, chunkSize octets per each of threadCount
+	 * threads at a time (but no more than 32 MiB). Each portion read is checksummed in
+	 * parallel while the next one is being read.
+	 *
+	 * At most two buffers of the portion size are used, i.e. 64 MiB. They are allocated as
+	 * the data arrives: a stream of up to chunkSize octets takes a single chunk-sized buffer,
+	 * and the second buffer is allocated only if the stream is longer than a portion.
+	 */
+	std::uint_fast64_t crc64ReversedUpdateParallel(std::uint_fast64_t currentCrc, InputStream &in,
+			unsigned threadCount = 0, std::size_t chunkSize = 4 * 1024 * 1024);
+
+	inline std::uint_fast64_t crc64ReversedParallel(InputStream &in, const unsigned threadCount = 0)
+	{
+		return crc64ReversedUpdateParallel(0, in, threadCount);
+	}
+
 	// CRC-64-ECMA with LSB-first bit order (reversed) with native platform byte endianness.
 	template<typename Iterator>
 	std::uint_fast64_t crc64ReversedUpdate(const std::uint_fast64_t currentCrc, Iterator begin, Iterator end)
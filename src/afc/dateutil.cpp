@@ -16,9 +16,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include "dateutil.hpp"
 
+#include <cstring>
+#include <limits>
 #include <time.h>
 
 #include "builtin.hpp"
+#include "cpu/features.h"
 #include "ensure_ascii.hpp"
 #include "StringRef.hpp"
 
@@ -100,113 +103,180 @@ namespace
 		return true;
 	}
 
-	// TODO optimise performance.
-	bool parseDateTime(const char * const begin, const char * const end, tm &dateTime)
+	inline bool isDigit(const char c) noexcept
 	{
-		register const char *p = begin;
-		if (unlikely(std::size_t(end - p) != "XXXX-XX-XXTXX:XX:XX+XXXX"_s.size())) {
-			return false;
-		}
-		if (unlikely(!parseFourDigits(p, dateTime.tm_year))) {
-			return false;
-		}
-		dateTime.tm_year -= 1900;
+		return c >= u8"0"[0] && c <= u8"9"[0];
+	}
 
-		if (unlikely(*p != u8"-"[0])) {
-			return false;
-		}
-		++p;
+	inline unsigned daysInMonth(const unsigned year, const unsigned month) noexcept
+	{
+		static const unsigned char days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
 
-		if (unlikely(!parseTwoDigits(p, dateTime.tm_mon))) {
-			return false;
-		}
-		--dateTime.tm_mon;
+		const bool leapYear = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+		return month == 2 && leapYear ? 29 : days[month - 1];
+	}
 
-		if (unlikely(*p != u8"-"[0])) {
+	// Parses +hh, +hhmm, +hh:mm and their negative counterparts.
+	inline bool parseTimeZoneOffset(const char *p, const char * const end, long &gmtOffset) noexcept
+	{
+		const char sign = *p++;
+		unsigned hours, minutes = 0;
+		if (unlikely(end - p < 2 || !parseTwoDigits(p, hours))) {
 			return false;
 		}
-		++p;
-
-		if (unlikely(!parseTwoDigits(p, dateTime.tm_mday))) {
-			return false;
+		if (p != end) {
+			if (*p == u8":"[0]) {
+				++p;
+			}
+			if (unlikely(end - p != 2 || !parseTwoDigits(p, minutes))) {
+				return false;
+			}
 		}
-
-		if (unlikely(*p != u8"T"[0])) {
+		if (unlikely(hours > 23 || minutes > 59)) {
 			return false;
 		}
-		++p;
 
-		if (unlikely(!parseTwoDigits(p, dateTime.tm_hour))) {
-			return false;
-		}
+		const long offset = long(hours * 60 + minutes) * 60;
+		gmtOffset = sign == u8"+"[0] ? offset : -offset;
+		return true;
+	}
 
-		if (unlikely(*p != u8":"[0])) {
+	bool parseDateTime(const char *p, const char * const end, std::int_fast64_t &seconds,
+			std::uint_fast32_t &nanoseconds, long &gmtOffset) noexcept
+	{
+		if (unlikely(std::size_t(end - p) < "XXXX-XX-XXTXX:XX:XXZ"_s.size())) {
 			return false;
 		}
-		++p;
 
-		if (unlikely(!parseTwoDigits(p, dateTime.tm_min))) {
+		// The fixed-size part is within the range.
+		unsigned year, month, day, hour, minute, second;
+		if (unlikely(!parseFourDigits(p, year) || *p++ != u8"-"[0] ||
+				!parseTwoDigits(p, month) || *p++ != u8"-"[0] ||
+				!parseTwoDigits(p, day) || *p++ != u8"T"[0] ||
+				!parseTwoDigits(p, hour) || *p++ != u8":"[0] ||
+				!parseTwoDigits(p, minute) || *p++ != u8":"[0] ||
+				!parseTwoDigits(p, second))) {
 			return false;
 		}
-
-		if (unlikely(*p != u8":"[0])) {
+		// 60 is for leap seconds.
+		if (unlikely(month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month) ||
+				hour > 23 || minute > 59 || second > 60)) {
 			return false;
 		}
-		++p;
 
-		if (unlikely(!parseTwoDigits(p, dateTime.tm_sec))) {
-			return false;
+		std::uint_fast32_t nanos = 0;
+		if (*p == u8"."[0] || *p == u8","[0]) {
+			++p;
+			const char * const fractionStart = p;
+			// Digits beyond nanoseconds are ignored.
+			for (std::uint_fast32_t scale = 100000000; p != end && isDigit(*p); ++p, scale /= 10) {
+				nanos += std::uint_fast32_t(*p - u8"0"[0]) * scale;
+			}
+			if (unlikely(p == fractionStart || p == end)) {
+				return false;
+			}
 		}
 
-		register decltype(dateTime.tm_gmtoff) zoneMul, zoneOffsetHours, zoneOffsetMinutes;
-
-		const char c = *p;
-		if (c == u8"+"[0]) {
-			zoneMul = 60;
-		} else if (likely(c == u8"-"[0])) {
-			zoneMul = -60;
+		long offset;
+		if (*p == u8"Z"[0]) {
+			if (unlikely(++p != end)) {
+				return false;
+			}
+			offset = 0;
+		} else if (likely(*p == u8"+"[0] || *p == u8"-"[0])) {
+			if (unlikely(!parseTimeZoneOffset(p, end, offset))) {
+				return false;
+			}
 		} else {
 			return false;
 		}
-		++p;
 
-		if (unlikely(!parseTwoDigits(p, zoneOffsetHours))) {
-			return false;
-		}
+		seconds = afc::helper::daysFromCivil(year, month, day) * (24 * 60 * 60) +
+				std::int_fast64_t(hour * (60 * 60) + minute * 60 + second) - offset;
+		nanoseconds = nanos;
+		gmtOffset = offset;
+		return true;
+	}
+}
 
-		if (unlikely(!parseTwoDigits(p, zoneOffsetMinutes))) {
-			return false;
+#if defined AFC_X86 || defined AFC_AMD64
+namespace
+{
+	// Reads the TSC and the monotonic clock at (nearly) the same moment.
+	void readTscAndMonotonicClock(std::uint64_t &tsc, std::int_fast64_t &nanos) noexcept
+	{
+		// The pair with the shortest read window out of several is taken.
+		std::uint64_t bestWindow = std::numeric_limits<std::uint64_t>::max();
+		tsc = 0;
+		nanos = 0;
+		for (int i = 0; i < 16; ++i) {
+			const std::uint64_t before = __rdtsc();
+			const std::int_fast64_t time = afc::now(afc::monotonicClock).nanos();
+			const std::uint64_t after = __rdtsc();
+			if (after - before < bestWindow) {
+				bestWindow = after - before;
+				tsc = before + (after - before) / 2;
+				nanos = time;
+			}
 		}
+	}
+}
+#endif
 
-		dateTime.tm_gmtoff = zoneMul * (zoneOffsetHours * 60 + zoneOffsetMinutes);
+afc::_impl::TscCalibration afc::_impl::calibrateTsc() noexcept
+{
+	TscCalibration calibration = {};
+#if defined AFC_X86 || defined AFC_AMD64
+	if (!afc::cpu::features().invariantTsc) {
+		return calibration;
+	}
 
-		dateTime.tm_isdst = -1; // It's unknown if DST is in effect.
+	std::uint64_t tsc0, tsc1;
+	std::int_fast64_t nanos0, nanos1;
+	readTscAndMonotonicClock(tsc0, nanos0);
+	const ::timespec interval = {0, 10000000};
+	::nanosleep(&interval, nullptr);
+	readTscAndMonotonicClock(tsc1, nanos1);
 
-		return true;
+	if (tsc1 <= tsc0 || nanos1 <= nanos0) {
+		return calibration;
 	}
+	calibration.available = true;
+	calibration.tscBase = tsc1;
+	calibration.nanosBase = nanos1;
+	calibration.rate = std::uint64_t((__int128(nanos1 - nanos0) << tscRateShift) / (tsc1 - tsc0));
+#endif
+	return calibration;
+}
+
+void afc::ISODateTimeFormatter::render(const std::int_fast64_t second, const long gmtOffset) noexcept
+{
+	char * const dateTimeEnd = helper::printISODateTime(second + gmtOffset, m_text);
+	char * const end = helper::printISOTimeZone(gmtOffset, dateTimeEnd);
+
+	m_second = second;
+	m_gmtOffset = gmtOffset;
+	m_dateTimeSize = std::size_t(dateTimeEnd - m_text);
+	m_size = std::size_t(end - m_text);
+}
+
+bool afc::parseISODateTime(const char * const begin, const char * const end, std::int_fast64_t &seconds,
+		std::uint_fast32_t &nanoseconds, long &gmtOffset) noexcept
+{
+	return parseDateTime(begin, end, seconds, nanoseconds, gmtOffset);
 }
 
 bool afc::parseISODateTime(const char * const str, time_t &dest)
 {
-	tm dateTime;
+	std::int_fast64_t seconds;
+	std::uint_fast32_t nanoseconds;
+	long gmtOffset;
 
-	if (!parseDateTime(str, dateTime)) {
+	if (!parseDateTime(str, str + std::strlen(str), seconds, nanoseconds, gmtOffset)) {
 		return false;
 	}
 
-	/* 1. Flush time zone offset into seconds to make a UTC time.
-	 * 2. Make a local value out of the tm structure with the UTC time. It is shifted towards future by
-	 *    amount of negated ::timezone.
-	 * 3. Make a time_t value out of the tm structure with the local time.
-	 *
-	 * Unfortunately, this code is not portable. It compiles in Debian Wheezy with GCC 4.7.
-	 * In addition, this code cannot tolerate the system time zone changed in the middle of processing.
-	 */
-	dateTime.tm_sec -= dateTime.tm_gmtoff;
-	dateTime.tm_sec -= timezone;
-	dateTime.tm_gmtoff = -timezone;
-
-	dest = mktime(&dateTime);
+	dest = time_t(seconds);
 	return true;
 }
 
@@ -225,53 +295,20 @@ bool afc::parseISODateTime(const char * const str, afc::DateTime &dest)
 
 bool afc::parseISODateTime(const char * const str, TimestampTZ &dest)
 {
-	tm dateTime;
-
-	if (unlikely(!parseDateTime(str, dateTime))) {
-		return false;
-	}
-
-	/* 1. Flush time zone offset into seconds to make a UTC time.
-	 * 2. Make a local value out of the tm structure with the UTC time. It is shifted towards future by
-	 *    amount of negated ::timezone.
-	 * 3. Make a time_t value out of the tm structure with the local time.
-	 *
-	 * Unfortunately, this code is not portable. It compiles in Debian Wheezy with GCC 4.7.
-	 * In addition, this code cannot tolerate the system time zone changed in the middle of processing.
-	 */
-	const int gmtOffset = dateTime.tm_gmtoff;
-	dateTime.tm_sec -= gmtOffset;
-	dateTime.tm_sec -= timezone;
-	dateTime.tm_gmtoff = -timezone;
-
-	dest.setMillis(static_cast<Timestamp::time_type>(mktime(&dateTime)) * 1000);
-	dest.setGmtOffset(gmtOffset);
-	return true;
+	return parseISODateTime(str, str + std::strlen(str), dest);
 }
 
 bool afc::parseISODateTime(const char * const begin, const char * const end, TimestampTZ &dest)
 {
-	tm dateTime;
+	std::int_fast64_t seconds;
+	std::uint_fast32_t nanoseconds;
+	long gmtOffset;
 
-	if (unlikely(!parseDateTime(begin, end, dateTime))) {
+	if (unlikely(!parseDateTime(begin, end, seconds, nanoseconds, gmtOffset))) {
 		return false;
 	}
 
-	// TODO make this a part of parseDateTime called above.
-	/* 1. Flush time zone offset into seconds to make a UTC time.
-	 * 2. Make a local value out of the tm structure with the UTC time. It is shifted towards future by
-	 *    amount of negated ::timezone.
-	 * 3. Make a time_t value out of the tm structure with the local time.
-	 *
-	 * Unfortunately, this code is not portable. It compiles in Debian Wheezy with GCC 4.7.
-	 * In addition, this code cannot tolerate the system time zone changed in the middle of processing.
-	 */
-	const int gmtOffset = dateTime.tm_gmtoff;
-	dateTime.tm_sec -= gmtOffset;
-	dateTime.tm_sec -= timezone;
-	dateTime.tm_gmtoff = -timezone;
-
-	dest.setMillis(static_cast<Timestamp::time_type>(mktime(&dateTime)) * 1000);
+	dest.setMillis(seconds * 1000 + nanoseconds / 1000000);
 	dest.setGmtOffset(gmtOffset);
 	return true;
 }
@@ -16,11 +16,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #ifndef AFCDATEUTIL_HPP_
 #define AFCDATEUTIL_HPP_
 
+#include "builtin.hpp"
 #include "logger.hpp"
+#include <algorithm>
 #include <cstddef>
 #include <ctime>
 #include <cstdint>
 #include "number.h"
+#include "platform.h"
+#include "TimeZone.hpp"
+
+#if defined AFC_X86 || defined AFC_AMD64
+	#include <x86intrin.h>
+#endif
 
 /* getCurrentUTCTimeSeconds() relies upon posix-compatible format of std::time_t.
  * Each POSIX implementation must have unistd.h available.
@@ -54,6 +62,38 @@ namespace afc
 		time_type m_millis;
 	};
 
+	// A timestamp with nanosecond precision.
+	class TimestampNanos
+	{
+	public:
+		typedef std::int_fast64_t time_type;
+
+		// Creates a TimestampNanos in an undefined state.
+		explicit TimestampNanos() {}
+
+		explicit TimestampNanos(const time_type nanos) : m_nanos(nanos) {}
+
+		explicit TimestampNanos(const ::timespec &time) noexcept
+				: m_nanos(static_cast<time_type>(time.tv_sec) * 1000000000 + time.tv_nsec) {}
+
+		// Rounds the time down to milliseconds.
+		explicit operator Timestamp() const noexcept
+		{
+			return Timestamp((m_nanos >= 0 ? m_nanos : m_nanos - 999999) / 1000000);
+		}
+
+		// Rounds the time down to seconds.
+		explicit operator ::time_t() const noexcept
+		{
+			return static_cast< ::time_t >((m_nanos >= 0 ? m_nanos : m_nanos - 999999999) / 1000000000);
+		}
+
+		void setNanos(const time_type nanos) noexcept { m_nanos = nanos; }
+		time_type nanos() const noexcept { return m_nanos; }
+	private:
+		time_type m_nanos;
+	};
+
 	class TimestampTZ : public Timestamp
 	{
 	public:
@@ -119,9 +159,10 @@ namespace afc
 
 		DateTime(const std::tm &dateTime) noexcept : m_tm(dateTime) {}
 
+		// The time is decomposed in the local time zone (see localTimeZone()).
 		DateTime &operator=(const std::time_t timestamp) noexcept
 		{
-			::localtime_r(&timestamp, &m_tm);
+			localTimeZone().toLocal(timestamp, m_tm);
 
 			return *this;
 		}
@@ -137,14 +178,10 @@ namespace afc
 			return m_tm;
 		}
 
+		// The time is interpreted in the local time zone (see localTimeZone()), as mktime() does.
 		Timestamp timestamp() const noexcept
 		{
-			::tm t = m_tm; // must make a copy of tm since mktime potentially modifies its argument.
-
-			/* This implementation works only for POSIX-compatible systems that store time in
-			 * std::time_t as the number of seconds since epoch.
-			 */
-			return Timestamp(static_cast<Timestamp::time_type>(::mktime(&t)) * 1000);
+			return Timestamp(static_cast<Timestamp::time_type>(localTimeZone().toUtc(m_tm)) * 1000);
 		}
 
 		void setYear(const long year) noexcept { m_tm.tm_year = year - 1900; }
@@ -182,6 +219,16 @@ namespace afc
 		unsigned m_millisecond;
 	};
 
+	/* Parses YYYY-MM-DDThh:mm:ss[.fraction](Z|+hh[[:]mm]|-hh[[:]mm]) to the number of seconds since
+	 * epoch, the nanoseconds within the second (digits of the fraction beyond nanoseconds are ignored)
+	 * and the time zone offset in seconds. Neither the process time zone nor mktime() is used.
+	 *
+	 * The overloads that accept std::time_t and TimestampTZ accept the same format; TimestampTZ
+	 * is rounded down to milliseconds.
+	 */
+	bool parseISODateTime(const char *begin, const char *end, std::int_fast64_t &seconds,
+			std::uint_fast32_t &nanoseconds, long &gmtOffset) noexcept;
+
 	// TODO support expanded ISO date format (create another function for this).
 	bool parseISODateTime(const char *begin, const char *end, TimestampTZ &dest);
 	bool parseISODateTime(const char *str, TimestampTZ &dest);
@@ -194,15 +241,91 @@ namespace afc
 		return sizeof("-XX-XXTXX:XX:XX+XXXX") - 1 + afc::maxPrintedSize<decltype(std::tm::tm_year), 10>();
 	}
 
+	constexpr std::size_t maxISODateTimeMillisSize() noexcept
+	{
+		return maxISODateTimeSize() + sizeof(".XXX") - 1;
+	}
+
+	// Formats the time as YYYY-MM-DDThh:mm:ss+hhmm.
 	template<typename Iterator>
 	Iterator formatISODateTime(const TimestampTZ &time, Iterator dest);
 
+	// Formats the time as YYYY-MM-DDThh:mm:ss.sss+hhmm.
+	template<typename Iterator>
+	Iterator formatISODateTimeMillis(const TimestampTZ &time, Iterator dest);
+
+	/* Clocks now() reads. The realtime clocks count time since epoch and jump when the system
+	 * time is set; the monotonic clock counts time since an unspecified point and never jumps.
+	 * The coarse clock is several times cheaper to read but has the resolution of a timer tick
+	 * (1-4 ms on Linux). The CPU clocks count the CPU time consumed by the calling thread and by
+	 * all threads of the process, respectively.
+	 */
+	struct RealtimeClock { static constexpr ::clockid_t id = CLOCK_REALTIME; };
+	struct CoarseRealtimeClock { static constexpr ::clockid_t id = CLOCK_REALTIME_COARSE; };
+	struct MonotonicClock { static constexpr ::clockid_t id = CLOCK_MONOTONIC; };
+	struct ThreadCpuClock { static constexpr ::clockid_t id = CLOCK_THREAD_CPUTIME_ID; };
+	struct ProcessCpuClock { static constexpr ::clockid_t id = CLOCK_PROCESS_CPUTIME_ID; };
+
+	/* Reads the time stamp counter of the CPU and converts it to the time of the monotonic clock
+	 * with the rate measured against it on the first read (which takes about 10 ms). A read takes
+	 * a few nanoseconds. The rate is measured with an error of a few ppm, so the clock is meant
+	 * for timing intervals rather than for keeping time over hours. It is used only if the TSC
+	 * is invariant (see cpu::features()); otherwise, the monotonic clock is read.
+	 */
+	struct TscClock {};
+
+	constexpr RealtimeClock realtimeClock = {};
+	constexpr CoarseRealtimeClock coarseRealtimeClock = {};
+	constexpr MonotonicClock monotonicClock = {};
+	constexpr ThreadCpuClock threadCpuClock = {};
+	constexpr ProcessCpuClock processCpuClock = {};
+	constexpr TscClock tscClock = {};
+
+	// The current time since epoch with millisecond precision.
 	inline Timestamp now()
 	{
-		/* This implementation works only for POSIX-compatible systems that store time in
-		 * std::time_t as the number of seconds since epoch.
-		 */
-		return Timestamp(static_cast<Timestamp::time_type>(::time(nullptr)) * 1000);
+		::timespec time;
+		::clock_gettime(CLOCK_REALTIME, &time);
+		return static_cast<Timestamp>(TimestampNanos(time));
+	}
+
+	template<typename Clock>
+	inline TimestampNanos now(Clock) noexcept
+	{
+		::timespec time;
+		::clock_gettime(Clock::id, &time);
+		return TimestampNanos(time);
+	}
+
+	namespace _impl
+	{
+		struct TscCalibration
+		{
+			bool available;
+			std::uint64_t tscBase;
+			// The time of the monotonic clock at tscBase.
+			std::int_fast64_t nanosBase;
+			// Nanoseconds per tick, as a fixed-point number with tscRateShift fractional bits.
+			std::uint64_t rate;
+		};
+
+		constexpr unsigned tscRateShift = 32;
+
+		TscCalibration calibrateTsc() noexcept;
+	}
+
+	inline TimestampNanos now(TscClock) noexcept
+	{
+		static const _impl::TscCalibration calibration = _impl::calibrateTsc();
+
+#if defined AFC_X86 || defined AFC_AMD64
+		if (likely(calibration.available)) {
+			const std::int64_t ticks = std::int64_t(__rdtsc() - calibration.tscBase);
+			return TimestampNanos(calibration.nanosBase +
+					std::int_fast64_t((__int128(ticks) * calibration.rate) >> _impl::tscRateShift));
+		}
+#endif
+		return now(monotonicClock);
 	}
 
 	namespace helper
@@ -212,6 +335,45 @@ namespace afc
 			static const bool initialised;
 		};
 
+		inline std::int_fast64_t floorDiv(const std::int_fast64_t x, const std::int_fast64_t y) noexcept
+		{
+			return (x >= 0 ? x : x - y + 1) / y;
+		}
+
+		/* Converts the number of days since 1970-01-01 to a date of the proleptic Gregorian calendar
+		 * with the algorithm civil_from_days by Howard Hinnant. The first month is 1.
+		 *
+		 * Days are counted from 0000-03-01 in 400-year eras, so that the leap day is the last day
+		 * of a year and the lengths of months (starting from March) follow a linear pattern.
+		 */
+		inline void civilFromDays(std::int_fast64_t days, std::int_fast64_t &year, unsigned &month, unsigned &day) noexcept
+		{
+			days += 719468;
+			const std::int_fast64_t era = floorDiv(days, 146097);
+			const unsigned dayOfEra = unsigned(days - era * 146097); // [0, 146096]
+			const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365; // [0, 399]
+			const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100); // [0, 365]
+			const unsigned shiftedMonth = (5 * dayOfYear + 2) / 153; // [0, 11], March is 0.
+
+			day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+			month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+			year = era * 400 + yearOfEra + (month <= 2 ? 1 : 0);
+		}
+
+		/* Converts a date of the proleptic Gregorian calendar to the number of days since 1970-01-01
+		 * with the algorithm days_from_civil by Howard Hinnant, the inverse of civilFromDays().
+		 * The first month is 1.
+		 */
+		inline std::int_fast64_t daysFromCivil(std::int_fast64_t year, const unsigned month, const unsigned day) noexcept
+		{
+			year -= month <= 2 ? 1 : 0;
+			const std::int_fast64_t era = floorDiv(year, 400);
+			const unsigned yearOfEra = unsigned(year - era * 400); // [0, 399]
+			const unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1; // [0, 365]
+			const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear; // [0, 146096]
+			return era * 146097 + std::int_fast64_t(dayOfEra) - 719468;
+		}
+
 		template<typename T, typename Iterator>
 		inline Iterator printISOYear(const T year, Iterator dest)
 		{
@@ -232,8 +394,105 @@ namespace afc
 			}
 			return dest;
 		}
+
+		// Prints YYYY-MM-DDThh:mm:ss for the number of seconds since epoch given (in the local time).
+		template<typename Iterator>
+		inline Iterator printISODateTime(const std::int_fast64_t seconds, Iterator dest)
+		{
+			const std::int_fast64_t days = floorDiv(seconds, 24 * 60 * 60);
+			unsigned secondOfDay = unsigned(seconds - days * (24 * 60 * 60));
+
+			std::int_fast64_t year;
+			unsigned month, day;
+			civilFromDays(days, year, month, day);
+
+			const unsigned hour = secondOfDay / (60 * 60);
+			secondOfDay -= hour * (60 * 60);
+			const unsigned minute = secondOfDay / 60;
+			const unsigned second = secondOfDay - minute * 60;
+
+			dest = printISOYear(year, dest);
+			*dest++ = '-';
+			dest = afc::printTwoDigits(month, dest);
+			*dest++ = '-';
+			dest = afc::printTwoDigits(day, dest);
+			*dest++ = 'T';
+			dest = afc::printTwoDigits(hour, dest);
+			*dest++ = ':';
+			dest = afc::printTwoDigits(minute, dest);
+			*dest++ = ':';
+			dest = afc::printTwoDigits(second, dest);
+			return dest;
+		}
+
+		// Prints .sss for the milliseconds given.
+		template<typename Iterator>
+		inline Iterator printISOMillis(const unsigned millis, Iterator dest)
+		{
+			const unsigned hundreds = millis / 100;
+			*dest++ = '.';
+			*dest++ = afc::digitToChar<10>(hundreds);
+			return afc::printTwoDigits(millis - hundreds * 100, dest);
+		}
+
+		// The time zone offset format is +hhmm or -hhmm.
+		template<typename Iterator>
+		inline Iterator printISOTimeZone(const long gmtOffset, Iterator dest)
+		{
+			const unsigned long offsetMinutes = (gmtOffset >= 0 ? gmtOffset : -gmtOffset) / 60;
+			*dest++ = gmtOffset >= 0 ? '+' : '-';
+			// TODO think what to do if gmtoff has three-digit hour value.
+			dest = afc::printTwoDigits((offsetMinutes / 60) % 100, dest);
+			dest = afc::printTwoDigits(offsetMinutes % 60, dest);
+			return dest;
+		}
 	}
 
+	/* Formats timestamps as formatISODateTime() and formatISODateTimeMillis() do. The text of
+	 * the second formatted last is cached, so that for a timestamp within the same second
+	 * (and with the same time zone offset) only the milliseconds are rendered.
+	 */
+	class ISODateTimeFormatter
+	{
+	public:
+		ISODateTimeFormatter() noexcept : m_second(0), m_gmtOffset(0), m_dateTimeSize(0), m_size(0) {}
+
+		template<typename Iterator>
+		Iterator format(const TimestampTZ &time, Iterator dest)
+		{
+			update(helper::floorDiv(time.millis(), 1000), time.getGmtOffset());
+			return std::copy(m_text, m_text + m_size, dest);
+		}
+
+		template<typename Iterator>
+		Iterator formatMillis(const TimestampTZ &time, Iterator dest)
+		{
+			const std::int_fast64_t second = helper::floorDiv(time.millis(), 1000);
+			update(second, time.getGmtOffset());
+
+			dest = std::copy(m_text, m_text + m_dateTimeSize, dest);
+			dest = helper::printISOMillis(unsigned(time.millis() - second * 1000), dest);
+			return std::copy(m_text + m_dateTimeSize, m_text + m_size, dest);
+		}
+	private:
+		void update(const std::int_fast64_t second, const long gmtOffset) noexcept
+		{
+			if (unlikely(m_size == 0 || second != m_second || gmtOffset != m_gmtOffset)) {
+				render(second, gmtOffset);
+			}
+		}
+
+		void render(std::int_fast64_t second, long gmtOffset) noexcept;
+
+		std::int_fast64_t m_second;
+		long m_gmtOffset;
+		// The date and time up to seconds followed by the time zone offset.
+		char m_text[maxISODateTimeSize()];
+		std::size_t m_dateTimeSize;
+		// Zero if nothing is cached.
+		std::size_t m_size;
+	};
+
 	// A timestamp view to log by afc::logger facilities.
 	struct ISODateTimeView
 	{
@@ -244,6 +503,15 @@ namespace afc
 
 	namespace logger
 	{
+		namespace _impl
+		{
+			inline afc::ISODateTimeFormatter &threadISODateTimeFormatter() noexcept
+			{
+				static thread_local afc::ISODateTimeFormatter formatter;
+				return formatter;
+			}
+		}
+
 		template<>
 		inline bool logPrint<const afc::ISODateTimeView &>(const afc::ISODateTimeView &val, std::FILE * const dest)
 		{
@@ -251,45 +519,40 @@ namespace afc
 			ts = static_cast<std::time_t>(val.ref);
 			char buf[afc::maxISODateTimeSize()];
 			char * const p = &buf[0];
-			char * const q = afc::formatISODateTime(ts, p);
+			char * const q = _impl::threadISODateTimeFormatter().format(ts, p);
 			return afc::logger::logText(p, q - p, dest);
 		}
+
+		template<>
+		inline bool logPrint<const afc::ISODateTimeView &>(const afc::ISODateTimeView &val, RecordBuffer &dest)
+		{
+			afc::TimestampTZ ts;
+			ts = static_cast<std::time_t>(val.ref);
+			dest.reserve(dest.size() + afc::maxISODateTimeSize());
+			dest.returnTail(_impl::threadISODateTimeFormatter().format(ts, dest.borrowTail()));
+			return true;
+		}
+
+		constexpr std::size_t logPrintedSize(const afc::ISODateTimeView &) noexcept { return afc::maxISODateTimeSize(); }
 	}
 }
 
 template<typename Iterator>
 Iterator afc::formatISODateTime(const afc::TimestampTZ &time, Iterator dest)
 {
-	std::tm t = static_cast<std::tm>(time); // Normalised value.
-	assert(t.tm_mon >= 0 && t.tm_mon <= 11);
-	assert(t.tm_mday >= 1 && t.tm_mday <= 31);
-	assert(t.tm_hour >= 0 && t.tm_hour <= 23);
-	assert(t.tm_min >= 0 && t.tm_min <= 59);
-	assert(t.tm_sec >= 0 && t.tm_sec <= 60); // 60 is for leap seconds.
-
-	dest = afc::helper::printISOYear(t.tm_year + 1900, dest);
-	*dest++ = '-';
-	dest = afc::printTwoDigits(t.tm_mon + 1, dest);
-	*dest++ = '-';
-	dest = afc::printTwoDigits(t.tm_mday, dest);
-	*dest++ = 'T';
-	dest = afc::printTwoDigits(t.tm_hour, dest);
-	*dest++ = ':';
-	dest = afc::printTwoDigits(t.tm_min, dest);
-	*dest++ = ':';
-	dest = afc::printTwoDigits(t.tm_sec, dest);
-
-	// The time zone offset format is +hhmm or -hhmm.
-	std::int_fast16_t offsetHoursMinutes = t.tm_gmtoff / 60;
-	std::int_fast16_t offsetHours = offsetHoursMinutes / 60;
-	std::int_fast16_t offsetMinutes = offsetHoursMinutes - offsetHours * 60;
-	// TODO think what to do if gmtoff has three-digit hour value.
-	offsetHours %= 100;
-
-	*dest++ = offsetHours >= 0 ? '+' : '-';
-	dest = afc::printTwoDigits(offsetHours, dest);
-	dest = afc::printTwoDigits(offsetMinutes, dest);
-	return dest;
+	const long gmtOffset = time.getGmtOffset();
+	dest = afc::helper::printISODateTime(afc::helper::floorDiv(time.millis(), 1000) + gmtOffset, dest);
+	return afc::helper::printISOTimeZone(gmtOffset, dest);
+}
+
+template<typename Iterator>
+Iterator afc::formatISODateTimeMillis(const afc::TimestampTZ &time, Iterator dest)
+{
+	const long gmtOffset = time.getGmtOffset();
+	const std::int_fast64_t second = afc::helper::floorDiv(time.millis(), 1000);
+	dest = afc::helper::printISODateTime(second + gmtOffset, dest);
+	dest = afc::helper::printISOMillis(unsigned(time.millis() - second * 1000), dest);
+	return afc::helper::printISOTimeZone(gmtOffset, dest);
 }
 
 #endif /* AFCDATEUTIL_HPP_ */
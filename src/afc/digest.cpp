@@ -0,0 +1,594 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "md5.hpp"
+#include "sha.hpp"
+#include "builtin.hpp"
+#include "platform.h"
+#include "stream.h"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#ifdef AFC_AMD64
+	#include <immintrin.h>
+	#include "cpu/features.h"
+#endif
+
+using std::uint32_t;
+using std::uint64_t;
+using std::size_t;
+
+namespace
+{
+	// Enough for the whole data of most small files to be read in a single call.
+	constexpr size_t streamBufferSize = 16 * 1024;
+
+	inline uint32_t rotl(const uint32_t x, const unsigned n) noexcept
+	{
+		return (x << n) | (x >> (32 - n));
+	}
+
+	inline uint32_t rotr(const uint32_t x, const unsigned n) noexcept
+	{
+		return (x >> n) | (x << (32 - n));
+	}
+
+	// Compilers turn both functions into a single load (with bswap for big-endian values).
+	inline uint32_t loadLE32(const unsigned char * const p) noexcept
+	{
+		return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+	}
+
+	inline uint32_t loadBE32(const unsigned char * const p) noexcept
+	{
+		return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+	}
+
+	inline void storeLE32(const uint32_t x, unsigned char * const p) noexcept
+	{
+		p[0] = static_cast<unsigned char>(x);
+		p[1] = static_cast<unsigned char>(x >> 8);
+		p[2] = static_cast<unsigned char>(x >> 16);
+		p[3] = static_cast<unsigned char>(x >> 24);
+	}
+
+	inline void storeBE32(const uint32_t x, unsigned char * const p) noexcept
+	{
+		p[0] = static_cast<unsigned char>(x >> 24);
+		p[1] = static_cast<unsigned char>(x >> 16);
+		p[2] = static_cast<unsigned char>(x >> 8);
+		p[3] = static_cast<unsigned char>(x);
+	}
+
+	/* The Merkle–Damgård framing shared by MD5, SHA-1 and SHA-256: 64-octet blocks,
+	 * of which the incomplete one is buffered. Whole blocks are compressed right
+	 * from the input, with no copying.
+	 */
+	template<typename Compress>
+	void digestUpdate(uint32_t * const state, uint64_t &size, unsigned char * const buf,
+			const unsigned char *data, size_t n, Compress compress) noexcept
+	{
+		constexpr size_t blockSize = 64;
+		const size_t buffered = static_cast<size_t>(size % blockSize);
+		size += n;
+
+		if (buffered != 0) {
+			const size_t count = std::min(n, blockSize - buffered);
+			std::memcpy(buf + buffered, data, count);
+			if (buffered + count < blockSize) {
+				return;
+			}
+			compress(state, buf, 1);
+			data += count;
+			n -= count;
+		}
+
+		const size_t blockCount = n / blockSize;
+		if (blockCount != 0) {
+			compress(state, data, blockCount);
+			data += blockCount * blockSize;
+			n -= blockCount * blockSize;
+		}
+		std::memcpy(buf, data, n);
+	}
+
+	// Appends 0x80, zeros and the message length in bits to the buffered data.
+	template<bool bigEndian, typename Compress>
+	void digestFinish(uint32_t * const state, const uint64_t size, unsigned char * const buf,
+			Compress compress) noexcept
+	{
+		constexpr size_t blockSize = 64;
+		constexpr size_t lengthOffset = blockSize - 8;
+		size_t buffered = static_cast<size_t>(size % blockSize);
+
+		buf[buffered++] = 0x80;
+		if (buffered > lengthOffset) {
+			std::memset(buf + buffered, 0, blockSize - buffered);
+			compress(state, buf, 1);
+			buffered = 0;
+		}
+		std::memset(buf + buffered, 0, lengthOffset - buffered);
+
+		const uint64_t bitSize = size * 8;
+		for (size_t i = 0; i < 8; ++i) {
+			buf[lengthOffset + i] = static_cast<unsigned char>(bigEndian ? bitSize >> (56 - 8 * i) : bitSize >> (8 * i));
+		}
+		compress(state, buf, 1);
+	}
+
+	template<typename Digest>
+	void digestUpdate(Digest &digest, afc::InputStream &in)
+	{
+		unsigned char buf[streamBufferSize];
+		size_t n;
+		while ((n = in.read(buf, streamBufferSize)) != 0) {
+			digest.update(buf, n);
+		}
+	}
+
+	/* MD5 (RFC 1321). The auxiliary functions F and G are rewritten to use
+	 * one operation less each:
+	 *     F(x, y, z) = (x & y) | (~x & z) = z ^ (x & (y ^ z))
+	 *     G(x, y, z) = (x & z) | (y & ~z) = y ^ (z & (x ^ y))
+	 */
+	#define AFC_MD5_STEP(f, a, b, c, d, x, t, s) \
+		(a) += f((b), (c), (d)) + (x) + uint32_t(t); \
+		(a) = rotl((a), (s)) + (b);
+
+	#define AFC_MD5_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+	#define AFC_MD5_G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+	#define AFC_MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+	#define AFC_MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+
+	void md5Compress(uint32_t * const state, const unsigned char *data, size_t blockCount) noexcept
+	{
+		uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+
+		for (; blockCount != 0; --blockCount, data += 64) {
+			uint32_t x[16];
+			for (size_t i = 0; i < 16; ++i) {
+				x[i] = loadLE32(data + 4 * i);
+			}
+			const uint32_t a0 = a, b0 = b, c0 = c, d0 = d;
+
+			AFC_MD5_STEP(AFC_MD5_F, a, b, c, d, x[ 0], 0xd76aa478,  7)
+			AFC_MD5_STEP(AFC_MD5_F, d, a, b, c, x[ 1], 0xe8c7b756, 12)
+			AFC_MD5_STEP(AFC_MD5_F, c, d, a, b, x[ 2], 0x242070db, 17)
+			AFC_MD5_STEP(AFC_MD5_F, b, c, d, a, x[ 3], 0xc1bdceee, 22)
+			AFC_MD5_STEP(AFC_MD5_F, a, b, c, d, x[ 4], 0xf57c0faf,  7)
+			AFC_MD5_STEP(AFC_MD5_F, d, a, b, c, x[ 5], 0x4787c62a, 12)
+			AFC_MD5_STEP(AFC_MD5_F, c, d, a, b, x[ 6], 0xa8304613, 17)
+			AFC_MD5_STEP(AFC_MD5_F, b, c, d, a, x[ 7], 0xfd469501, 22)
+			AFC_MD5_STEP(AFC_MD5_F, a, b, c, d, x[ 8], 0x698098d8,  7)
+			AFC_MD5_STEP(AFC_MD5_F, d, a, b, c, x[ 9], 0x8b44f7af, 12)
+			AFC_MD5_STEP(AFC_MD5_F, c, d, a, b, x[10], 0xffff5bb1, 17)
+			AFC_MD5_STEP(AFC_MD5_F, b, c, d, a, x[11], 0x895cd7be, 22)
+			AFC_MD5_STEP(AFC_MD5_F, a, b, c, d, x[12], 0x6b901122,  7)
+			AFC_MD5_STEP(AFC_MD5_F, d, a, b, c, x[13], 0xfd987193, 12)
+			AFC_MD5_STEP(AFC_MD5_F, c, d, a, b, x[14], 0xa679438e, 17)
+			AFC_MD5_STEP(AFC_MD5_F, b, c, d, a, x[15], 0x49b40821, 22)
+
+			AFC_MD5_STEP(AFC_MD5_G, a, b, c, d, x[ 1], 0xf61e2562,  5)
+			AFC_MD5_STEP(AFC_MD5_G, d, a, b, c, x[ 6], 0xc040b340,  9)
+			AFC_MD5_STEP(AFC_MD5_G, c, d, a, b, x[11], 0x265e5a51, 14)
+			AFC_MD5_STEP(AFC_MD5_G, b, c, d, a, x[ 0], 0xe9b6c7aa, 20)
+			AFC_MD5_STEP(AFC_MD5_G, a, b, c, d, x[ 5], 0xd62f105d,  5)
+			AFC_MD5_STEP(AFC_MD5_G, d, a, b, c, x[10], 0x02441453,  9)
+			AFC_MD5_STEP(AFC_MD5_G, c, d, a, b, x[15], 0xd8a1e681, 14)
+			AFC_MD5_STEP(AFC_MD5_G, b, c, d, a, x[ 4], 0xe7d3fbc8, 20)
+			AFC_MD5_STEP(AFC_MD5_G, a, b, c, d, x[ 9], 0x21e1cde6,  5)
+			AFC_MD5_STEP(AFC_MD5_G, d, a, b, c, x[14], 0xc33707d6,  9)
+			AFC_MD5_STEP(AFC_MD5_G, c, d, a, b, x[ 3], 0xf4d50d87, 14)
+			AFC_MD5_STEP(AFC_MD5_G, b, c, d, a, x[ 8], 0x455a14ed, 20)
+			AFC_MD5_STEP(AFC_MD5_G, a, b, c, d, x[13], 0xa9e3e905,  5)
+			AFC_MD5_STEP(AFC_MD5_G, d, a, b, c, x[ 2], 0xfcefa3f8,  9)
+			AFC_MD5_STEP(AFC_MD5_G, c, d, a, b, x[ 7], 0x676f02d9, 14)
+			AFC_MD5_STEP(AFC_MD5_G, b, c, d, a, x[12], 0x8d2a4c8a, 20)
+
+			AFC_MD5_STEP(AFC_MD5_H, a, b, c, d, x[ 5], 0xfffa3942,  4)
+			AFC_MD5_STEP(AFC_MD5_H, d, a, b, c, x[ 8], 0x8771f681, 11)
+			AFC_MD5_STEP(AFC_MD5_H, c, d, a, b, x[11], 0x6d9d6122, 16)
+			AFC_MD5_STEP(AFC_MD5_H, b, c, d, a, x[14], 0xfde5380c, 23)
+			AFC_MD5_STEP(AFC_MD5_H, a, b, c, d, x[ 1], 0xa4beea44,  4)
+			AFC_MD5_STEP(AFC_MD5_H, d, a, b, c, x[ 4], 0x4bdecfa9, 11)
+			AFC_MD5_STEP(AFC_MD5_H, c, d, a, b, x[ 7], 0xf6bb4b60, 16)
+			AFC_MD5_STEP(AFC_MD5_H, b, c, d, a, x[10], 0xbebfbc70, 23)
+			AFC_MD5_STEP(AFC_MD5_H, a, b, c, d, x[13], 0x289b7ec6,  4)
+			AFC_MD5_STEP(AFC_MD5_H, d, a, b, c, x[ 0], 0xeaa127fa, 11)
+			AFC_MD5_STEP(AFC_MD5_H, c, d, a, b, x[ 3], 0xd4ef3085, 16)
+			AFC_MD5_STEP(AFC_MD5_H, b, c, d, a, x[ 6], 0x04881d05, 23)
+			AFC_MD5_STEP(AFC_MD5_H, a, b, c, d, x[ 9], 0xd9d4d039,  4)
+			AFC_MD5_STEP(AFC_MD5_H, d, a, b, c, x[12], 0xe6db99e5, 11)
+			AFC_MD5_STEP(AFC_MD5_H, c, d, a, b, x[15], 0x1fa27cf8, 16)
+			AFC_MD5_STEP(AFC_MD5_H, b, c, d, a, x[ 2], 0xc4ac5665, 23)
+
+			AFC_MD5_STEP(AFC_MD5_I, a, b, c, d, x[ 0], 0xf4292244,  6)
+			AFC_MD5_STEP(AFC_MD5_I, d, a, b, c, x[ 7], 0x432aff97, 10)
+			AFC_MD5_STEP(AFC_MD5_I, c, d, a, b, x[14], 0xab9423a7, 15)
+			AFC_MD5_STEP(AFC_MD5_I, b, c, d, a, x[ 5], 0xfc93a039, 21)
+			AFC_MD5_STEP(AFC_MD5_I, a, b, c, d, x[12], 0x655b59c3,  6)
+			AFC_MD5_STEP(AFC_MD5_I, d, a, b, c, x[ 3], 0x8f0ccc92, 10)
+			AFC_MD5_STEP(AFC_MD5_I, c, d, a, b, x[10], 0xffeff47d, 15)
+			AFC_MD5_STEP(AFC_MD5_I, b, c, d, a, x[ 1], 0x85845dd1, 21)
+			AFC_MD5_STEP(AFC_MD5_I, a, b, c, d, x[ 8], 0x6fa87e4f,  6)
+			AFC_MD5_STEP(AFC_MD5_I, d, a, b, c, x[15], 0xfe2ce6e0, 10)
+			AFC_MD5_STEP(AFC_MD5_I, c, d, a, b, x[ 6], 0xa3014314, 15)
+			AFC_MD5_STEP(AFC_MD5_I, b, c, d, a, x[13], 0x4e0811a1, 21)
+			AFC_MD5_STEP(AFC_MD5_I, a, b, c, d, x[ 4], 0xf7537e82,  6)
+			AFC_MD5_STEP(AFC_MD5_I, d, a, b, c, x[11], 0xbd3af235, 10)
+			AFC_MD5_STEP(AFC_MD5_I, c, d, a, b, x[ 2], 0x2ad7d2bb, 15)
+			AFC_MD5_STEP(AFC_MD5_I, b, c, d, a, x[ 9], 0xeb86d391, 21)
+
+			a += a0;
+			b += b0;
+			c += c0;
+			d += d0;
+		}
+
+		state[0] = a;
+		state[1] = b;
+		state[2] = c;
+		state[3] = d;
+	}
+
+	#undef AFC_MD5_I
+	#undef AFC_MD5_H
+	#undef AFC_MD5_G
+	#undef AFC_MD5_F
+	#undef AFC_MD5_STEP
+
+	void sha1CompressPortable(uint32_t * const state, const unsigned char *data, size_t blockCount) noexcept
+	{
+		uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+		for (; blockCount != 0; --blockCount, data += 64) {
+			// The message schedule is kept in a circular buffer of 16 words.
+			uint32_t w[16];
+			for (size_t i = 0; i < 16; ++i) {
+				w[i] = loadBE32(data + 4 * i);
+			}
+			const uint32_t a0 = a, b0 = b, c0 = c, d0 = d, e0 = e;
+
+			for (size_t i = 0; i < 80; ++i) {
+				uint32_t x;
+				if (i < 16) {
+					x = w[i];
+				} else {
+					x = rotl(w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15], 1);
+					w[i & 15] = x;
+				}
+
+				uint32_t f;
+				if (i < 20) {
+					f = (d ^ (b & (c ^ d))) + 0x5a827999;
+				} else if (i < 40) {
+					f = (b ^ c ^ d) + 0x6ed9eba1;
+				} else if (i < 60) {
+					f = ((b & c) | (d & (b | c))) + 0x8f1bbcdc;
+				} else {
+					f = (b ^ c ^ d) + 0xca62c1d6;
+				}
+
+				const uint32_t t = rotl(a, 5) + f + e + x;
+				e = d;
+				d = c;
+				c = rotl(b, 30);
+				b = a;
+				a = t;
+			}
+
+			a += a0;
+			b += b0;
+			c += c0;
+			d += d0;
+			e += e0;
+		}
+
+		state[0] = a;
+		state[1] = b;
+		state[2] = c;
+		state[3] = d;
+		state[4] = e;
+	}
+
+	alignas(16) const uint32_t sha256RoundConstants[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+	};
+
+	void sha256CompressPortable(uint32_t * const state, const unsigned char *data, size_t blockCount) noexcept
+	{
+		for (; blockCount != 0; --blockCount, data += 64) {
+			uint32_t w[64];
+			for (size_t i = 0; i < 16; ++i) {
+				w[i] = loadBE32(data + 4 * i);
+			}
+			for (size_t i = 16; i < 64; ++i) {
+				const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+				const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+				w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+			}
+
+			uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+					e = state[4], f = state[5], g = state[6], h = state[7];
+
+			for (size_t i = 0; i < 64; ++i) {
+				const uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+				const uint32_t ch = g ^ (e & (f ^ g));
+				const uint32_t t1 = h + s1 + ch + sha256RoundConstants[i] + w[i];
+				const uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+				const uint32_t maj = (a & b) | (c & (a | b));
+				const uint32_t t2 = s0 + maj;
+				h = g;
+				g = f;
+				f = e;
+				e = d + t1;
+				d = c;
+				c = b;
+				b = a;
+				a = t1 + t2;
+			}
+
+			state[0] += a;
+			state[1] += b;
+			state[2] += c;
+			state[3] += d;
+			state[4] += e;
+			state[5] += f;
+			state[6] += g;
+			state[7] += h;
+		}
+	}
+
+#ifdef AFC_AMD64
+	/* SHA-1 with the SHA extensions. Each group of four rounds is a separate instantiation
+	 * since sha1rnds4 takes the round function as an immediate. The message schedule
+	 * is kept in four registers: W[g & 3] holds the words for the group g.
+	 */
+	__attribute__((target("sha,sse4.1"), always_inline))
+	inline void sha1NiGroups(__m128i &, __m128i &, __m128i, __m128i (&)[4],
+			std::integral_constant<unsigned, 20>) noexcept
+	{
+	}
+
+	template<unsigned g>
+	__attribute__((target("sha,sse4.1"), always_inline))
+	inline void sha1NiGroups(__m128i &abcd, __m128i &prevAbcd, const __m128i e0, __m128i (&w)[4],
+			std::integral_constant<unsigned, g>) noexcept
+	{
+		const __m128i e = g == 0 ? _mm_add_epi32(e0, w[0]) : _mm_sha1nexte_epu32(prevAbcd, w[g & 3]);
+		if (g >= 3 && g <= 18) {
+			w[(g + 1) & 3] = _mm_sha1msg2_epu32(w[(g + 1) & 3], w[g & 3]);
+		}
+		prevAbcd = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e, g / 5);
+		if (g >= 1 && g <= 16) {
+			w[(g - 1) & 3] = _mm_sha1msg1_epu32(w[(g - 1) & 3], w[g & 3]);
+		}
+		if (g >= 2 && g <= 17) {
+			w[(g - 2) & 3] = _mm_xor_si128(w[(g - 2) & 3], w[g & 3]);
+		}
+		sha1NiGroups(abcd, prevAbcd, e0, w, std::integral_constant<unsigned, g + 1>());
+	}
+
+	__attribute__((target("sha,sse4.1")))
+	void sha1CompressNi(uint32_t * const state, const unsigned char *data, size_t blockCount) noexcept
+	{
+		// Reverses the order of the octets: the words are big-endian and A is the highest one.
+		const __m128i mask = _mm_set_epi64x(0x0001020304050607, 0x08090a0b0c0d0e0f);
+
+		__m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0x1b);
+		__m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+		for (; blockCount != 0; --blockCount, data += 64) {
+			const __m128i abcdSave = abcd;
+			__m128i w[4];
+			for (size_t i = 0; i < 4; ++i) {
+				w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16 * i)), mask);
+			}
+
+			__m128i prevAbcd;
+			sha1NiGroups(abcd, prevAbcd, e0, w, std::integral_constant<unsigned, 0>());
+
+			e0 = _mm_sha1nexte_epu32(prevAbcd, e0);
+			abcd = _mm_add_epi32(abcd, abcdSave);
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_shuffle_epi32(abcd, 0x1b));
+		state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+	}
+
+	/* SHA-256 with the SHA extensions. sha256rnds2 keeps the state as ABEF and CDGH
+	 * and performs two rounds; the group g of four rounds uses W[g & 3] and computes
+	 * the message words for the groups ahead.
+	 */
+	__attribute__((target("sha,sse4.1"), always_inline))
+	inline void sha256NiGroups(__m128i &, __m128i &, __m128i (&)[4], std::integral_constant<unsigned, 16>) noexcept
+	{
+	}
+
+	template<unsigned g>
+	__attribute__((target("sha,sse4.1"), always_inline))
+	inline void sha256NiGroups(__m128i &abef, __m128i &cdgh, __m128i (&w)[4],
+			std::integral_constant<unsigned, g>) noexcept
+	{
+		__m128i msg = _mm_add_epi32(w[g & 3],
+				_mm_load_si128(reinterpret_cast<const __m128i *>(sha256RoundConstants + 4 * g)));
+		cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);
+		if (g >= 3 && g <= 14) {
+			const __m128i tmp = _mm_alignr_epi8(w[g & 3], w[(g - 1) & 3], 4);
+			w[(g + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(w[(g + 1) & 3], tmp), w[g & 3]);
+		}
+		msg = _mm_shuffle_epi32(msg, 0x0e);
+		abef = _mm_sha256rnds2_epu32(abef, cdgh, msg);
+		if (g >= 1 && g <= 12) {
+			w[(g - 1) & 3] = _mm_sha256msg1_epu32(w[(g - 1) & 3], w[g & 3]);
+		}
+		sha256NiGroups(abef, cdgh, w, std::integral_constant<unsigned, g + 1>());
+	}
+
+	__attribute__((target("sha,sse4.1")))
+	void sha256CompressNi(uint32_t * const state, const unsigned char *data, size_t blockCount) noexcept
+	{
+		// Converts the big-endian words of the message to the native order.
+		const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0b, 0x0405060700010203);
+
+		const __m128i dcba = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0xb1);
+		const __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state + 4)), 0x1b);
+		__m128i abef = _mm_alignr_epi8(dcba, efgh, 8);
+		__m128i cdgh = _mm_blend_epi16(efgh, dcba, 0xf0);
+
+		for (; blockCount != 0; --blockCount, data += 64) {
+			const __m128i abefSave = abef;
+			const __m128i cdghSave = cdgh;
+			__m128i w[4];
+			for (size_t i = 0; i < 4; ++i) {
+				w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16 * i)), mask);
+			}
+
+			sha256NiGroups(abef, cdgh, w, std::integral_constant<unsigned, 0>());
+
+			abef = _mm_add_epi32(abef, abefSave);
+			cdgh = _mm_add_epi32(cdgh, cdghSave);
+		}
+
+		const __m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+		const __m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_blend_epi16(feba, dchg, 0xf0));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+	}
+#endif
+
+	void sha1Compress(uint32_t * const state, const unsigned char * const data, const size_t blockCount) noexcept
+	{
+#ifdef AFC_AMD64
+		const afc::cpu::Features &features = afc::cpu::features();
+		if (features.sha && features.sse41) {
+			sha1CompressNi(state, data, blockCount);
+			return;
+		}
+#endif
+		sha1CompressPortable(state, data, blockCount);
+	}
+
+	void sha256Compress(uint32_t * const state, const unsigned char * const data, const size_t blockCount) noexcept
+	{
+#ifdef AFC_AMD64
+		const afc::cpu::Features &features = afc::cpu::features();
+		if (features.sha && features.sse41) {
+			sha256CompressNi(state, data, blockCount);
+			return;
+		}
+#endif
+		sha256CompressPortable(state, data, blockCount);
+	}
+}
+
+void afc::Md5::reset() noexcept
+{
+	m_state[0] = 0x67452301;
+	m_state[1] = 0xefcdab89;
+	m_state[2] = 0x98badcfe;
+	m_state[3] = 0x10325476;
+	m_size = 0;
+}
+
+void afc::Md5::update(const unsigned char * const data, const std::size_t n) noexcept
+{
+	digestUpdate(m_state, m_size, m_buf, data, n, md5Compress);
+}
+
+void afc::Md5::update(InputStream &in)
+{
+	digestUpdate(*this, in);
+}
+
+void afc::Md5::finish(unsigned char * const dest) noexcept
+{
+	digestFinish<false>(m_state, m_size, m_buf, md5Compress);
+	for (size_t i = 0; i < 4; ++i) {
+		storeLE32(m_state[i], dest + 4 * i);
+	}
+	reset();
+}
+
+void afc::Sha1::reset() noexcept
+{
+	m_state[0] = 0x67452301;
+	m_state[1] = 0xefcdab89;
+	m_state[2] = 0x98badcfe;
+	m_state[3] = 0x10325476;
+	m_state[4] = 0xc3d2e1f0;
+	m_size = 0;
+}
+
+void afc::Sha1::update(const unsigned char * const data, const std::size_t n) noexcept
+{
+	digestUpdate(m_state, m_size, m_buf, data, n, sha1Compress);
+}
+
+void afc::Sha1::update(InputStream &in)
+{
+	digestUpdate(*this, in);
+}
+
+void afc::Sha1::finish(unsigned char * const dest) noexcept
+{
+	digestFinish<true>(m_state, m_size, m_buf, sha1Compress);
+	for (size_t i = 0; i < 5; ++i) {
+		storeBE32(m_state[i], dest + 4 * i);
+	}
+	reset();
+}
+
+void afc::Sha256::reset() noexcept
+{
+	m_state[0] = 0x6a09e667;
+	m_state[1] = 0xbb67ae85;
+	m_state[2] = 0x3c6ef372;
+	m_state[3] = 0xa54ff53a;
+	m_state[4] = 0x510e527f;
+	m_state[5] = 0x9b05688c;
+	m_state[6] = 0x1f83d9ab;
+	m_state[7] = 0x5be0cd19;
+	m_size = 0;
+}
+
+void afc::Sha256::update(const unsigned char * const data, const std::size_t n) noexcept
+{
+	digestUpdate(m_state, m_size, m_buf, data, n, sha256Compress);
+}
+
+void afc::Sha256::update(InputStream &in)
+{
+	digestUpdate(*this, in);
+}
+
+void afc::Sha256::finish(unsigned char * const dest) noexcept
+{
+	digestFinish<true>(m_state, m_size, m_buf, sha256Compress);
+	for (size_t i = 0; i < 8; ++i) {
+		storeBE32(m_state[i], dest + 4 * i);
+	}
+	reset();
+}
@@ -21,10 +21,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include <algorithm>
 #include <cctype>
+#include <cstddef>
+#include <cstdint>
 #include <iterator>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+	#include <immintrin.h>
+#endif
 
 #include <afc/builtin.hpp>
+#include <afc/compile_time_math.h>
+#include <afc/number.h>
 #include <afc/utils.h>
 
 namespace afc
@@ -39,6 +49,445 @@ namespace json
 			typedef typename std::iterator_traits<I>::iterator_category ICategory;
 			return std::is_same<ICategory, std::random_access_iterator_tag>::value;
 		}
+
+		// JSON spaces are matched as std::isspace() does it in the "C" locale.
+		inline bool isSpace(const char c) noexcept
+		{
+			return c == u8" "[0] || static_cast<unsigned char>(c - u8"\t"[0]) <= u8"\r"[0] - u8"\t"[0];
+		}
+
+		inline bool isStructuralChar(const char c) noexcept
+		{
+			return c == u8"{"[0] || c == u8"}"[0] || c == u8"["[0] || c == u8"]"[0] ||
+					c == u8":"[0] || c == u8","[0] || c == u8"\""[0];
+		}
+
+		template<typename Iterator>
+		inline Iterator skipSpaces(Iterator begin, Iterator end)
+		{
+			return std::find_if(begin, end, [](const char c) { return !std::isspace(c); });
+		}
+
+		template<typename Iterator>
+		inline Iterator findStructuralChar(Iterator begin, Iterator end)
+		{
+			return std::find_if(begin, end, [](const char c) { return isStructuralChar(c); });
+		}
+
+	#ifdef __SSE2__
+		/* Contiguous input is scanned in blocks of 16 (SSE2) or 32 (AVX2) characters.
+		 * Each block is turned into a bit mask of matching characters so that the position
+		 * of the first (non-)matching character is found by a single count-trailing-zeros.
+		 * The tail that does not fill a whole block is processed character by character.
+		 */
+		inline __m128i spaceMask128(const __m128i chunk) noexcept
+		{
+			// (c - '\t') <= ('\r' - '\t') in unsigned arithmetic is the range check for '\t'..'\r'.
+			const __m128i shifted = _mm_sub_epi8(chunk, _mm_set1_epi8(u8"\t"[0]));
+			const __m128i inRange = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(u8"\r"[0] - u8"\t"[0])), shifted);
+			return _mm_or_si128(inRange, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(u8" "[0])));
+		}
+
+		inline __m128i structuralMask128(const __m128i chunk) noexcept
+		{
+			const __m128i braces = _mm_or_si128(
+					_mm_cmpeq_epi8(chunk, _mm_set1_epi8(u8"{"[0])), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(u8"}"[0])));
+			const __m128i brackets = _mm_or_si128(
+					_mm_cmpeq_epi8(chunk, _mm_set1_epi8(u8"["[0])), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(u8"]"[0])));
+			const __m128i separators = _mm_or_si128(
+					_mm_cmpeq_epi8(chunk, _mm_set1_epi8(u8":"[0])), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(u8","[0])));
+			return _mm_or_si128(_mm_or_si128(braces, brackets),
+					_mm_or_si128(separators, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(u8"\""[0]))));
+		}
+
+		#ifdef __AVX2__
+		inline __m256i spaceMask256(const __m256i chunk) noexcept
+		{
+			const __m256i shifted = _mm256_sub_epi8(chunk, _mm256_set1_epi8(u8"\t"[0]));
+			const __m256i inRange = _mm256_cmpeq_epi8(
+					_mm256_min_epu8(shifted, _mm256_set1_epi8(u8"\r"[0] - u8"\t"[0])), shifted);
+			return _mm256_or_si256(inRange, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(u8" "[0])));
+		}
+
+		inline __m256i structuralMask256(const __m256i chunk) noexcept
+		{
+			const __m256i braces = _mm256_or_si256(
+					_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(u8"{"[0])), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(u8"}"[0])));
+			const __m256i brackets = _mm256_or_si256(
+					_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(u8"["[0])), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(u8"]"[0])));
+			const __m256i separators = _mm256_or_si256(
+					_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(u8":"[0])), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(u8","[0])));
+			return _mm256_or_si256(_mm256_or_si256(braces, brackets),
+					_mm256_or_si256(separators, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(u8"\""[0]))));
+		}
+		#endif
+
+		inline const char *skipSpaces(const char *p, const char * const end) noexcept
+		{
+			/* Most of the values in JSON are separated by at most a single space so the first
+			 * character is checked before any vector is loaded.
+			 */
+			if (p == end || !isSpace(*p)) {
+				return p;
+			}
+			++p;
+		#ifdef __AVX2__
+			while (end - p >= 32) {
+				const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+				const std::uint32_t nonSpaces = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(spaceMask256(chunk)));
+				if (nonSpaces != 0) {
+					return p + __builtin_ctz(nonSpaces);
+				}
+				p += 32;
+			}
+		#endif
+			while (end - p >= 16) {
+				const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+				const unsigned nonSpaces = ~static_cast<unsigned>(_mm_movemask_epi8(spaceMask128(chunk))) & 0xffff;
+				if (nonSpaces != 0) {
+					return p + __builtin_ctz(nonSpaces);
+				}
+				p += 16;
+			}
+			while (p != end && isSpace(*p)) {
+				++p;
+			}
+			return p;
+		}
+
+		inline const char *findStructuralChar(const char *p, const char * const end) noexcept
+		{
+		#ifdef __AVX2__
+			while (end - p >= 32) {
+				const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+				const std::uint32_t matches = static_cast<std::uint32_t>(_mm256_movemask_epi8(structuralMask256(chunk)));
+				if (matches != 0) {
+					return p + __builtin_ctz(matches);
+				}
+				p += 32;
+			}
+		#endif
+			while (end - p >= 16) {
+				const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+				const unsigned matches = static_cast<unsigned>(_mm_movemask_epi8(structuralMask128(chunk)));
+				if (matches != 0) {
+					return p + __builtin_ctz(matches);
+				}
+				p += 16;
+			}
+			while (p != end && !isStructuralChar(*p)) {
+				++p;
+			}
+			return p;
+		}
+
+		inline char *skipSpaces(char * const begin, char * const end) noexcept
+		{
+			return const_cast<char *>(skipSpaces(const_cast<const char *>(begin), const_cast<const char *>(end)));
+		}
+
+		inline char *findStructuralChar(char * const begin, char * const end) noexcept
+		{
+			return const_cast<char *>(findStructuralChar(const_cast<const char *>(begin), const_cast<const char *>(end)));
+		}
+
+		// Returns the first quotation mark or reverse solidus, i.e. the end of an unescaped run of a JSON string.
+		inline const char *findStringSpecialChar(const char *p, const char * const end) noexcept
+		{
+		#ifdef __AVX2__
+			while (end - p >= 32) {
+				const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+				const __m256i specials = _mm256_or_si256(
+						_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(u8"\""[0])),
+						_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(u8"\\"[0])));
+				const std::uint32_t matches = static_cast<std::uint32_t>(_mm256_movemask_epi8(specials));
+				if (matches != 0) {
+					return p + __builtin_ctz(matches);
+				}
+				p += 32;
+			}
+		#endif
+			while (end - p >= 16) {
+				const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+				const __m128i specials = _mm_or_si128(
+						_mm_cmpeq_epi8(chunk, _mm_set1_epi8(u8"\""[0])), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(u8"\\"[0])));
+				const unsigned matches = static_cast<unsigned>(_mm_movemask_epi8(specials));
+				if (matches != 0) {
+					return p + __builtin_ctz(matches);
+				}
+				p += 16;
+			}
+			while (p != end && *p != u8"\""[0] && *p != u8"\\"[0]) {
+				++p;
+			}
+			return p;
+		}
+	#else
+		inline const char *findStringSpecialChar(const char *p, const char * const end) noexcept
+		{
+			while (p != end && *p != u8"\""[0] && *p != u8"\\"[0]) {
+				++p;
+			}
+			return p;
+		}
+	#endif
+
+		// Indicates if CharDestination accepts runs of characters as (const char *, std::size_t).
+		template<typename CharDestination>
+		struct IsBulkCharDestination
+		{
+		private:
+			template<typename Dest>
+			static auto test(int) -> decltype(std::declval<Dest &>()(std::declval<const char *>(), std::size_t(0)),
+					std::true_type());
+			template<typename Dest>
+			static std::false_type test(...);
+		public:
+			static constexpr bool value = decltype(test<CharDestination>(0))::value;
+		};
+
+		// Single characters are passed in as runs of size one to destinations that accept runs only.
+		template<typename CharDestination>
+		inline auto putChar(CharDestination &dest, const char c, int) -> decltype(dest(c), void())
+		{
+			dest(c);
+		}
+
+		template<typename CharDestination>
+		inline void putChar(CharDestination &dest, const char c, long)
+		{
+			dest(&c, std::size_t(1));
+		}
+
+		// Returns false if c does not denote a valid single-character escape sequence.
+		inline bool unescapeChar(char &c) noexcept
+		{
+			if (c == u8"\""[0] || c == u8"\\"[0] || c == u8"/"[0]) {
+				// c is already valid.
+			} else if (c == u8"b"[0]) {
+				c = u8"\b"[0];
+			} else if (c == u8"f"[0]) {
+				c = u8"\f"[0];
+			} else if (c == u8"n"[0]) {
+				c = u8"\n"[0];
+			} else if (c == u8"r"[0]) {
+				c = u8"\r"[0];
+			} else if (c == u8"t"[0]) {
+				c = u8"\t"[0];
+			} else {
+				return false;
+			}
+			return true;
+		}
+
+		enum class UnescapeStatus
+		{
+			success,
+			prematureEnd,
+			malformedJson
+		};
+
+		/* Reads four hex digits that follow the character 'u' the iterator points to.
+		 * Upon success the iterator points to the last hex digit.
+		 */
+		template<typename Iterator>
+		inline UnescapeStatus parseHexCodeUnit(Iterator &i, const Iterator end, std::uint_fast32_t &dest)
+		{
+			std::uint_fast32_t result = 0;
+			for (int k = 0; k < 4; ++k) {
+				if (unlikely(++i == end)) {
+					return UnescapeStatus::prematureEnd;
+				}
+				const unsigned char digit = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(*i)];
+				if (unlikely(digit >= 16)) {
+					return UnescapeStatus::malformedJson;
+				}
+				result = (result << 4) | digit;
+			}
+			dest = result;
+			return UnescapeStatus::success;
+		}
+
+		// Returns the number of UTF-8 code units written.
+		inline std::size_t encodeUTF8(const std::uint_fast32_t codePoint, char * const dest) noexcept
+		{
+			if (codePoint < 0x80) {
+				dest[0] = static_cast<char>(codePoint);
+				return 1;
+			} else if (codePoint < 0x800) {
+				dest[0] = static_cast<char>(0xc0 | (codePoint >> 6));
+				dest[1] = static_cast<char>(0x80 | (codePoint & 0x3f));
+				return 2;
+			} else if (codePoint < 0x10000) {
+				dest[0] = static_cast<char>(0xe0 | (codePoint >> 12));
+				dest[1] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+				dest[2] = static_cast<char>(0x80 | (codePoint & 0x3f));
+				return 3;
+			} else {
+				dest[0] = static_cast<char>(0xf0 | (codePoint >> 18));
+				dest[1] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+				dest[2] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+				dest[3] = static_cast<char>(0x80 | (codePoint & 0x3f));
+				return 4;
+			}
+		}
+
+		/* Decodes the escape sequence \uXXXX (or a surrogate pair \uXXXX\uXXXX) into UTF-8.
+		 * The iterator points to the character 'u' and is moved to the last hex digit decoded.
+		 * Unpaired surrogates are treated as malformed JSON.
+		 */
+		template<typename Iterator>
+		inline UnescapeStatus unescapeUnicode(Iterator &i, const Iterator end, char (&dest)[4], std::size_t &n)
+		{
+			std::uint_fast32_t codePoint;
+			UnescapeStatus status = parseHexCodeUnit(i, end, codePoint);
+			if (unlikely(status != UnescapeStatus::success)) {
+				return status;
+			}
+
+			if (unlikely(codePoint >= 0xd800 && codePoint <= 0xdfff)) {
+				if (codePoint >= 0xdc00) {
+					// A low surrogate without the high one.
+					return UnescapeStatus::malformedJson;
+				}
+
+				if (unlikely(++i == end)) {
+					return UnescapeStatus::prematureEnd;
+				}
+				if (unlikely(*i != u8"\\"[0])) {
+					return UnescapeStatus::malformedJson;
+				}
+				if (unlikely(++i == end)) {
+					return UnescapeStatus::prematureEnd;
+				}
+				if (unlikely(*i != u8"u"[0])) {
+					return UnescapeStatus::malformedJson;
+				}
+
+				std::uint_fast32_t lowSurrogate;
+				status = parseHexCodeUnit(i, end, lowSurrogate);
+				if (unlikely(status != UnescapeStatus::success)) {
+					return status;
+				}
+				if (unlikely(lowSurrogate < 0xdc00 || lowSurrogate > 0xdfff)) {
+					return UnescapeStatus::malformedJson;
+				}
+				codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (lowSurrogate - 0xdc00);
+			}
+
+			n = encodeUTF8(codePoint, dest);
+			return UnescapeStatus::success;
+		}
+
+		template<typename Iterator, typename CharDestination, typename ErrorHandler>
+		inline Iterator parseCharsToUTF8(Iterator begin, Iterator end, CharDestination &dest,
+				ErrorHandler &errorHandler, std::false_type)
+		{
+			Iterator i = begin;
+			if (unlikely(i == end)) {
+				goto prematureEnd;
+			}
+
+			do {
+				char c = *i;
+
+				if (c == u8"\""[0]) {
+					return i;
+				}
+
+				if (unlikely(c == u8"\\"[0])) {
+					++i;
+					if (unlikely(i == end)) {
+						goto prematureEnd;
+					}
+
+					c = *i;
+					if (c == u8"u"[0]) {
+						char utf8[4];
+						std::size_t n;
+						switch (unescapeUnicode(i, end, utf8, n)) {
+						case UnescapeStatus::success: break;
+						case UnescapeStatus::prematureEnd: goto prematureEnd;
+						case UnescapeStatus::malformedJson: goto malformedJson;
+						}
+						for (std::size_t k = 0; k < n; ++k) {
+							putChar(dest, utf8[k], 0);
+						}
+						continue;
+					}
+					if (unlikely(!unescapeChar(c))) {
+						goto malformedJson;
+					}
+				}
+
+				putChar(dest, c, 0);
+			} while (++i != end);
+
+			return i;
+		prematureEnd:
+			errorHandler.prematureEnd();
+			return end;
+		malformedJson:
+			errorHandler.malformedJson(i);
+			return end;
+		}
+
+		/* Unescaped runs of characters are found by findStringSpecialChar() and passed to
+		 * the destination by a single call each. Escape sequences are passed in one by one.
+		 */
+		template<typename CharPointer, typename CharDestination, typename ErrorHandler>
+		inline CharPointer parseCharsToUTF8(const CharPointer begin, const CharPointer end,
+				CharDestination &dest, ErrorHandler &errorHandler, std::true_type)
+		{
+			CharPointer i = begin;
+			if (unlikely(i == end)) {
+				goto prematureEnd;
+			}
+
+			for (;;) {
+				const std::size_t runSize = findStringSpecialChar(i, end) - i;
+				if (runSize != 0) {
+					dest(static_cast<const char *>(i), runSize);
+					i += runSize;
+				}
+
+				if (i == end || *i == u8"\""[0]) {
+					return i;
+				}
+
+				// *i is the reverse solidus.
+				++i;
+				if (unlikely(i == end)) {
+					goto prematureEnd;
+				}
+
+				char c = *i;
+				if (c == u8"u"[0]) {
+					char utf8[4];
+					std::size_t n;
+					switch (unescapeUnicode(i, end, utf8, n)) {
+					case UnescapeStatus::success: break;
+					case UnescapeStatus::prematureEnd: goto prematureEnd;
+					case UnescapeStatus::malformedJson: goto malformedJson;
+					}
+					dest(static_cast<const char *>(utf8), n);
+				} else if (likely(unescapeChar(c))) {
+					putChar(dest, c, 0);
+				} else {
+					goto malformedJson;
+				}
+
+				if (++i == end) {
+					return i;
+				}
+			}
+		prematureEnd:
+			errorHandler.prematureEnd();
+			return end;
+		malformedJson:
+			errorHandler.malformedJson(i);
+			return end;
+		}
 	}
 
 	enum SpacePolicy {
@@ -48,10 +497,25 @@ namespace json
 		trailingSpaces
 	};
 
+	/* Returns the first non-space character in the range given.
+	 *
+	 * If the iterator is a raw pointer to char then the input is scanned with SIMD
+	 * instructions available at compile time.
+	 */
 	// TODO define noexcept
 	template<typename Iterator>
 	inline Iterator skipSpaces(Iterator begin, Iterator end) {
-		return std::find_if(begin, end, [](const char c) { return !std::isspace(c); });
+		return _impl::skipSpaces(begin, end);
+	}
+
+	/* Returns the first JSON structural character (one of {}[]:," ) in the range given.
+	 *
+	 * If the iterator is a raw pointer to char then the input is scanned with SIMD
+	 * instructions available at compile time.
+	 */
+	template<typename Iterator>
+	inline Iterator findStructuralChar(Iterator begin, Iterator end) {
+		return _impl::findStructuralChar(begin, end);
 	}
 
 	template<SpacePolicy spacePolicy, typename Iterator>
@@ -353,62 +817,318 @@ namespace json
 		return skipTrailingSpaces<spacePolicy>(i, end);
 	}
 
-	template<typename Iterator, typename CharDestination, typename ErrorHandler>
-	inline const char *parseCharsToUTF8(Iterator begin, Iterator end, CharDestination dest, ErrorHandler &errorHandler)
+	namespace _impl
 	{
-		Iterator i = begin;
-		if (unlikely(i == end)) {
-			goto prematureEnd;
+		template<std::size_t... is>
+		struct IndexSequence {};
+
+		template<typename Seq1, typename Seq2>
+		struct ConcatIndexSequences;
+
+		template<std::size_t... is1, std::size_t... is2>
+		struct ConcatIndexSequences<IndexSequence<is1...>, IndexSequence<is2...>>
+		{
+			typedef IndexSequence<is1..., (sizeof...(is1) + is2)...> type;
+		};
+
+		// Logarithmic instantiation depth allows for long sequences.
+		template<std::size_t n>
+		struct MakeIndexSequence
+		{
+			typedef typename ConcatIndexSequences<typename MakeIndexSequence<n / 2>::type,
+					typename MakeIndexSequence<n - n / 2>::type>::type type;
+		};
+
+		template<>
+		struct MakeIndexSequence<0> { typedef IndexSequence<> type; };
+
+		template<>
+		struct MakeIndexSequence<1> { typedef IndexSequence<0> type; };
+
+		// FNV-1a with a variable offset basis which is used as the seed of the perfect hash.
+		constexpr std::uint32_t propertyNameHashStep(const std::uint32_t hash, const char c) noexcept
+		{
+			return (hash ^ static_cast<unsigned char>(c)) * std::uint32_t(16777619);
 		}
 
-		do {
-			char c = *i;
+		constexpr std::uint32_t propertyNameHash(const char * const s, const std::size_t n, const std::uint32_t hash) noexcept
+		{
+			return n == 0 ? hash : propertyNameHash(s + 1, n - 1, propertyNameHashStep(hash, *s));
+		}
 
-			if (c == u8"\""[0]) {
-				return i;
-			}
+		// Fibonacci hashing takes the well-mixed high bits of the product.
+		constexpr std::size_t propertySlot(const std::uint32_t hash, const unsigned bits) noexcept
+		{
+			return static_cast<std::uint32_t>(hash * std::uint32_t(0x9e3779b1)) >> (32 - bits);
+		}
+
+		constexpr bool containsSlot(const std::size_t) noexcept { return false; }
+
+		template<typename... Slots>
+		constexpr bool containsSlot(const std::size_t slot, const std::size_t first, const Slots... rest) noexcept
+		{
+			return slot == first || containsSlot(slot, rest...);
+		}
+
+		constexpr bool distinctSlots() noexcept { return true; }
+
+		template<typename... Slots>
+		constexpr bool distinctSlots(const std::size_t first, const Slots... rest) noexcept
+		{
+			return !containsSlot(first, rest...) && distinctSlots(rest...);
+		}
+
+		/* Is not constexpr so that evaluating it in a constant expression is a compile-time error.
+		 * This happens if property names are duplicated.
+		 */
+		inline std::uint32_t perfectPropertyHashNotFound() noexcept { return 0; }
 
-			if (likely(c != u8"\\"[0])) {
-				goto callDest;
+		template<typename... Names>
+		constexpr std::uint32_t findPropertyHashSeed(const std::uint32_t seed, const unsigned attemptsLeft,
+				const unsigned bits, const Names... names) noexcept
+		{
+			return attemptsLeft == 0 ? perfectPropertyHashNotFound() :
+					distinctSlots(propertySlot(propertyNameHash(names.value(), names.size(), seed), bits)...) ?
+							seed :
+							findPropertyHashSeed(seed + 1, attemptsLeft - 1, bits, names...);
+		}
+
+		template<std::size_t n>
+		struct PropertySlots
+		{
+			std::size_t value[n];
+		};
+
+		// Returns the index of the property plus one, or zero if the slot is empty.
+		template<std::size_t n>
+		constexpr unsigned char slotOwner(const std::size_t slot, const PropertySlots<n> &slots, const std::size_t i) noexcept
+		{
+			return i == n ? 0 : slots.value[i] == slot ? static_cast<unsigned char>(i + 1) : slotOwner(slot, slots, i + 1);
+		}
+	}
+
+	/* A perfect hash table of JSON property names to be used by parseProperty() and parseProperties().
+	 *
+	 * It must be created by propertyNames() and assigned to a constexpr variable so that
+	 * the hash function is chosen and the table is built at compile time.
+	 */
+	template<std::size_t n>
+	struct PropertyNameTable
+	{
+		static_assert(n > 0 && n < 0xff, "Unsupported number of properties.");
+
+		// The load factor is at most 1/16 so that a collision-free seed is found in a few attempts.
+		static constexpr unsigned bits = afc::bitCount(n) + 4;
+		static constexpr std::size_t size = std::size_t(1) << bits;
+
+		// Returns n if there is no property with the name given.
+		template<typename Iterator>
+		std::size_t find(const Iterator name, const std::size_t nameSize, const std::uint32_t nameHash) const
+		{
+			const unsigned char entry = slots[_impl::propertySlot(nameHash, bits)];
+			if (likely(entry != 0)) {
+				const std::size_t i = entry - 1;
+				if (likely(afc::equal(names[i], sizes[i], name, nameSize))) {
+					return i;
+				}
 			}
+			return n;
+		}
 
-			++i;
+		std::uint32_t seed;
+		const char *names[n];
+		std::size_t sizes[n];
+		unsigned char slots[size];
+	};
+
+	template<std::size_t n>
+	constexpr unsigned PropertyNameTable<n>::bits;
+
+	template<std::size_t n>
+	constexpr std::size_t PropertyNameTable<n>::size;
+
+	namespace _impl
+	{
+		template<std::size_t n, std::size_t... is, typename... Names>
+		constexpr PropertyNameTable<n> makePropertyNameTable(IndexSequence<is...>, const std::uint32_t seed,
+				const PropertySlots<n> slots, const Names... names) noexcept
+		{
+			return PropertyNameTable<n>{seed, {names.value()...}, {names.size()...}, {slotOwner(is, slots, 0)...}};
+		}
+
+		template<std::size_t n, typename... Names>
+		constexpr PropertyNameTable<n> makePropertyNameTable(const std::uint32_t seed, const Names... names) noexcept
+		{
+			return makePropertyNameTable<n>(typename MakeIndexSequence<PropertyNameTable<n>::size>::type(), seed,
+					PropertySlots<n>{{propertySlot(propertyNameHash(names.value(), names.size(), seed),
+							PropertyNameTable<n>::bits)...}},
+					names...);
+		}
+
+		template<std::size_t i, typename Iterator, typename ErrorHandler, typename ValueParsers>
+		Iterator invokeValueParser(ValueParsers &valueParsers, Iterator begin, Iterator end, ErrorHandler &errorHandler)
+		{
+			return std::get<i>(valueParsers)(begin, end, errorHandler);
+		}
+
+		// Calls the value parser with the index given by means of a jump table.
+		template<typename Iterator, typename ErrorHandler, typename ValueParsers, std::size_t... is>
+		inline Iterator invokeValueParser(const std::size_t index, ValueParsers &valueParsers,
+				Iterator begin, Iterator end, ErrorHandler &errorHandler, IndexSequence<is...>)
+		{
+			typedef Iterator (*Invoker)(ValueParsers &, Iterator, Iterator, ErrorHandler &);
+			static constexpr Invoker invokers[] = {&invokeValueParser<is, Iterator, ErrorHandler, ValueParsers>...};
+			return invokers[index](valueParsers, begin, end, errorHandler);
+		}
+
+		template<SpacePolicy spacePolicy, typename Iterator, std::size_t n, typename ErrorHandler, typename ValueParsers>
+		inline Iterator parseProperty(Iterator begin, Iterator end, const PropertyNameTable<n> &propertyNames,
+				ErrorHandler &errorHandler, ValueParsers &valueParsers)
+		{
+			Iterator i = skipLeadingSpaces<spacePolicy>(begin, end);
 			if (unlikely(i == end)) {
 				goto prematureEnd;
 			}
-
-			c = *i;
-			if (c == u8"\""[0] || c == u8"\\"[0] || c == u8"/"[0]) {
-				// c is already valid.
-				goto callDest;
-			} else if (c == u8"b"[0]) {
-				c = u8"\b"[0];
-			} else if (c == u8"f"[0]) {
-				c = u8"\f"[0];
-			} else if (c == u8"n"[0]) {
-				c = u8"\n"[0];
-			} else if (c == u8"r"[0]) {
-				c = u8"\r"[0];
-			} else if (c == u8"t"[0]) {
-				c = u8"\t"[0];
-			} else if (c == u8"u"[0]) {
-				// TODO support unicode escapes.
-				goto malformedJson;
-			} else {
+			if (unlikely(*i != u8"\""[0])) {
 				goto malformedJson;
 			}
 
-		callDest:
-			dest(c);
-		} while (++i != end);
+			{
+				const Iterator nameBegin = ++i;
+				std::size_t nameSize = 0;
+				std::uint32_t nameHash = propertyNames.seed;
+				/* The name is scanned and hashed in a single loop. Names with escape sequences
+				 * are rejected since they would have to be unescaped before being looked up.
+				 */
+				for (;;) {
+					if (unlikely(i == end)) {
+						goto prematureEnd;
+					}
+					const char c = *i;
+					if (c == u8"\""[0]) {
+						break;
+					}
+					if (unlikely(c == u8"\\"[0])) {
+						goto malformedJson;
+					}
+					nameHash = propertyNameHashStep(nameHash, c);
+					++nameSize;
+					++i;
+				}
 
-		return i;
-	prematureEnd:
-		errorHandler.prematureEnd();
-		return end;
-	malformedJson:
-		errorHandler.malformedJson(i);
-		return end;
+				const std::size_t index = propertyNames.find(nameBegin, nameSize, nameHash);
+				if (unlikely(index == n)) {
+					errorHandler.malformedJson(nameBegin);
+					return end;
+				}
+
+				i = parseColon<Iterator, ErrorHandler, spacePolicy>(++i, end, errorHandler);
+				if (unlikely(!errorHandler.valid())) {
+					return end;
+				}
+
+				i = invokeValueParser(index, valueParsers, i, end, errorHandler, typename MakeIndexSequence<n>::type());
+				if (unlikely(!errorHandler.valid())) {
+					return end;
+				}
+			}
+
+			return skipTrailingSpaces<spacePolicy>(i, end);
+		prematureEnd:
+			errorHandler.prematureEnd();
+			return end;
+		malformedJson:
+			errorHandler.malformedJson(i);
+			return end;
+		}
+	}
+
+	/* Creates a perfect hash table of the property names given as afc::ConstStringRef instances
+	 * (e.g. u8"name"_s). The result must be assigned to a constexpr variable:
+	 *
+	 *     constexpr auto personProperties = afc::json::propertyNames(u8"id"_s, u8"name"_s, u8"age"_s);
+	 *
+	 * Duplicate property names result in a compile-time error.
+	 */
+	template<typename... Names>
+	constexpr PropertyNameTable<sizeof...(Names)> propertyNames(const Names... names) noexcept
+	{
+		return _impl::makePropertyNameTable<sizeof...(Names)>(
+				_impl::findPropertyHashSeed(2166136261u, 256, PropertyNameTable<sizeof...(Names)>::bits, names...),
+				names...);
+	}
+
+	/* Parses a single property of a JSON object whose name is one of propertyNames and dispatches
+	 * its value to the value parser with the same index as the property name has. Each value
+	 * parser has the signature of the value parser passed to parsePropertyValue().
+	 *
+	 * The property name is matched by a single hash table lookup and a single comparison,
+	 * without copying it. Unknown property names are reported as malformed JSON.
+	 */
+	template<SpacePolicy spacePolicy = spaces, typename Iterator, std::size_t n, typename ErrorHandler,
+			typename... ValueParsers>
+	inline Iterator parseProperty(Iterator begin, Iterator end, const PropertyNameTable<n> &propertyNames,
+			ErrorHandler &errorHandler, ValueParsers &&...valueParsers)
+	{
+		static_assert(sizeof...(ValueParsers) == n, "There must be a value parser for each property name.");
+
+		std::tuple<ValueParsers &...> valueParserRefs(valueParsers...);
+		return _impl::parseProperty<spacePolicy>(begin, end, propertyNames, errorHandler, valueParserRefs);
+	}
+
+	/* Parses the comma-separated properties of a JSON object body in any order (see parseProperty()).
+	 * The position after the last property is returned so that it can be used as an ObjectBodyParser
+	 * in parseObject().
+	 */
+	template<typename Iterator, std::size_t n, typename ErrorHandler, typename... ValueParsers>
+	inline Iterator parseProperties(Iterator begin, Iterator end, const PropertyNameTable<n> &propertyNames,
+			ErrorHandler &errorHandler, ValueParsers &&...valueParsers)
+	{
+		static_assert(sizeof...(ValueParsers) == n, "There must be a value parser for each property name.");
+
+		std::tuple<ValueParsers &...> valueParserRefs(valueParsers...);
+
+		Iterator i = skipSpaces(begin, end);
+		if (unlikely(i == end)) {
+			errorHandler.prematureEnd();
+			return end;
+		}
+		if (*i == u8"}"[0]) {
+			return i;
+		}
+
+		for (;;) {
+			i = _impl::parseProperty<spaces>(i, end, propertyNames, errorHandler, valueParserRefs);
+			if (unlikely(!errorHandler.valid())) {
+				return end;
+			}
+			if (unlikely(i == end)) {
+				errorHandler.prematureEnd();
+				return end;
+			}
+			if (*i != u8","[0]) {
+				return i;
+			}
+			++i;
+		}
+	}
+
+	/* Parses the body of a JSON string (i.e. without quotation marks) and passes the characters
+	 * decoded to dest. The position of the closing quotation mark is returned.
+	 *
+	 * If dest accepts runs of characters as (const char *, std::size_t) and the input is
+	 * a range of raw pointers to char then unescaped runs are found with SIMD instructions
+	 * available at compile time and each of them is passed to dest by a single call. This
+	 * allows for copying whole runs at once, e.g. by FastStringBuffer::append(const char *, std::size_t).
+	 * Otherwise dest is invoked once per character.
+	 */
+	template<typename Iterator, typename CharDestination, typename ErrorHandler>
+	inline Iterator parseCharsToUTF8(Iterator begin, Iterator end, CharDestination dest, ErrorHandler &errorHandler)
+	{
+		typedef std::integral_constant<bool, (std::is_same<Iterator, const char *>::value ||
+				std::is_same<Iterator, char *>::value) &&
+				_impl::IsBulkCharDestination<CharDestination>::value> UseBulkPath;
+		return _impl::parseCharsToUTF8(begin, end, dest, errorHandler, UseBulkPath());
 	}
 }
 }
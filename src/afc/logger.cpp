@@ -16,11 +16,87 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include "logger.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "builtin.hpp"
 
+using afc::logger::LogLevel;
+using afc::logger::LogModule;
+
+namespace
+{
+	struct ModuleRegistry
+	{
+		std::mutex mutex;
+		std::vector<LogModule *> modules;
+		// Levels set by name; they are applied to modules created later.
+		std::vector<std::pair<std::string, LogLevel>> levels;
+	};
+
+	ModuleRegistry &moduleRegistry()
+	{
+		static ModuleRegistry registry;
+		return registry;
+	}
+}
+
+LogModule afc::logger::_impl::defaultLogModule(afc::logger::_impl::DefaultLogModuleTag(), afc::logger::defaultLogLevel);
+
+afc::logger::LogModule::LogModule(const char * const name, const LogLevel level)
+		: m_name(name), m_level(static_cast<unsigned char>(level)), m_registered(true)
+{
+	ModuleRegistry &registry = moduleRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	for (const auto &moduleLevel : registry.levels) {
+		if (moduleLevel.first == name) {
+			setLevel(moduleLevel.second);
+			break;
+		}
+	}
+	registry.modules.push_back(this);
+}
+
+afc::logger::LogModule::~LogModule()
+{
+	if (m_registered) {
+		ModuleRegistry &registry = moduleRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		registry.modules.erase(std::find(registry.modules.begin(), registry.modules.end(), this));
+	}
+}
+
+std::size_t afc::logger::setLogLevel(const char * const moduleName, const LogLevel level)
+{
+	ModuleRegistry &registry = moduleRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	auto moduleLevel = std::find_if(registry.levels.begin(), registry.levels.end(),
+			[moduleName](const std::pair<std::string, LogLevel> &x) { return x.first == moduleName; });
+	if (moduleLevel == registry.levels.end()) {
+		registry.levels.emplace_back(moduleName, level);
+	} else {
+		moduleLevel->second = level;
+	}
+
+	std::size_t count = 0;
+	for (LogModule * const module : registry.modules) {
+		if (std::strcmp(module->name(), moduleName) == 0) {
+			module->setLevel(level);
+			++count;
+		}
+	}
+	return count;
+}
+
 bool afc::logger::logInternalFmt(const char *format, std::initializer_list<Printer *> params, std::FILE * const dest)
 {
 	auto paramPtr = params.begin();
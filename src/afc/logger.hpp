@@ -18,15 +18,23 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #define AFC_LOGGER_HPP_
 
 #include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <initializer_list>
 #include "number.h"
 #include <type_traits>
+#include <utility>
 
 // POSIX API.
 #include <stdio.h>
+#include <time.h>
 
+#include "builtin.hpp"
 #include "ensure_ascii.hpp" // needed to ensure that '\n' != EOF.
 #include "FastStringBuffer.hpp"
 #include "number.h"
@@ -52,7 +60,7 @@ namespace afc
 		}
 
 		template<typename T>
-		inline typename std::enable_if<!std::is_integral<typename std::decay<T>::type>::value, bool>::type logPrint(T &&value, FILE *dest);
+		inline typename std::enable_if<!std::is_arithmetic<typename std::decay<T>::type>::value, bool>::type logPrint(T &&value, FILE *dest);
 
 		template<typename T>
 		inline typename std::enable_if<std::is_integral<typename std::decay<T>::type>::value, bool>::type logPrint(T &&value, FILE * const dest) noexcept
@@ -111,14 +119,20 @@ namespace afc
 		}
 
 		template<typename T>
-		inline typename std::enable_if<std::is_floating_point<T>::value, bool>::type logPrint(const T &value, FILE * const dest) noexcept
+		inline typename std::enable_if<std::is_same<T, float>::value || std::is_same<T, double>::value, bool>::type
+				logPrint(const T &value, FILE * const dest) noexcept
 		{
-			// TODO improve performance.
-			// TODO handle buffer overflow.
-			char buf[128];
-			std::size_t n = std::snprintf(buf, 128, "%Lf", static_cast<long double>(value));
-			// TODO improve performance.
-			return logPrint(buf, n, dest);
+			char buf[afc::maxPrintedSize<T, 10>()];
+			char * const end = afc::printNumber<10>(value, buf);
+			return logText(buf, end - buf, dest);
+		}
+
+		inline bool logPrint(const long double value, FILE * const dest) noexcept
+		{
+			// Enough for the sign, 21 significant digits, the decimal point and the exponent.
+			char buf[32];
+			const int n = std::snprintf(buf, sizeof(buf), "%.21Lg", value);
+			return n >= 0 && logText(buf, afc::math::min<std::size_t>(n, sizeof(buf) - 1), dest);
 		}
 
 		// A hex-encoded view of binary data of constexpr size to be logged.
@@ -143,6 +157,204 @@ namespace afc
 			return true;
 		}
 
+		/* The same overloads for a record that is assembled in memory to be written as a whole.
+		 * They reserve space in the buffer themselves.
+		 */
+		typedef afc::FastStringBuffer<char> RecordBuffer;
+
+		inline bool logText(const char * const s, const std::size_t n, RecordBuffer &dest)
+		{
+			dest.reserve(dest.size() + n);
+			dest.append(s, n);
+			return true;
+		}
+
+		/* Values of the types that specialise only the FILE * overload of logPrint() are printed
+		 * into a memory stream, and the text is appended to the record.
+		 */
+		template<typename T>
+		inline typename std::enable_if<!std::is_arithmetic<typename std::decay<T>::type>::value, bool>::type logPrint(T &&value, RecordBuffer &dest)
+		{
+			char *text = nullptr;
+			std::size_t size = 0;
+			std::FILE * const stream = ::open_memstream(&text, &size);
+			if (unlikely(stream == nullptr)) {
+				return false;
+			}
+			const bool printed = logPrint<T>(std::forward<T>(value), stream);
+			const bool closed = std::fclose(stream) == 0;
+			const bool result = printed && closed && logText(text, size, dest);
+			std::free(text);
+			return result;
+		}
+
+		template<typename T>
+		inline typename std::enable_if<std::is_integral<typename std::decay<T>::type>::value, bool>::type logPrint(T &&value, RecordBuffer &dest)
+		{
+			using U = typename std::decay<T>::type;
+
+			dest.reserve(dest.size() + afc::maxPrintedSize<U, 10>());
+			dest.returnTail(afc::printNumber<10>(value, dest.borrowTail()));
+			return true;
+		}
+
+		inline bool logPrint(const char c, RecordBuffer &dest)
+		{
+			dest.reserve(dest.size() + 1);
+			dest.append(c);
+			return true;
+		}
+
+		inline bool logPrint(const afc::ConstStringRef s, RecordBuffer &dest)
+		{
+			return logText(s.value(), s.size(), dest);
+		}
+
+		inline bool logPrint(const afc::FastStringBuffer<char> &s, RecordBuffer &dest)
+		{
+			return logText(s.data(), s.size(), dest);
+		}
+
+		inline bool logPrint(const afc::String &s, RecordBuffer &dest)
+		{
+			return logText(s.data(), s.size(), dest);
+		}
+
+		inline bool logPrint(const bool b, RecordBuffer &dest)
+		{
+			using afc::operator"" _s;
+			return logPrint(b ? "true"_s : "false"_s, dest);
+		}
+
+		inline bool logPrint(const char * const s, RecordBuffer &dest)
+		{
+			return logText(s, std::strlen(s), dest);
+		}
+
+		inline bool logPrint(const char * const s, std::size_t n, RecordBuffer &dest)
+		{
+			return logText(s, n, dest);
+		}
+
+		inline bool logPrint(const std::pair<const char *, const char *> &s, RecordBuffer &dest)
+		{
+			return logText(s.first, std::size_t(s.second - s.first), dest);
+		}
+
+		inline bool logPrint(const std::pair<char *, char *> &s, RecordBuffer &dest)
+		{
+			return logText(s.first, std::size_t(s.second - s.first), dest);
+		}
+
+		template<typename T>
+		inline typename std::enable_if<std::is_same<T, float>::value || std::is_same<T, double>::value, bool>::type
+				logPrint(const T &value, RecordBuffer &dest)
+		{
+			dest.reserve(dest.size() + afc::maxPrintedSize<T, 10>());
+			dest.returnTail(afc::printNumber<10>(value, dest.borrowTail()));
+			return true;
+		}
+
+		inline bool logPrint(const long double value, RecordBuffer &dest)
+		{
+			char buf[32];
+			const int n = std::snprintf(buf, sizeof(buf), "%.21Lg", value);
+			return n >= 0 && logText(buf, afc::math::min<std::size_t>(n, sizeof(buf) - 1), dest);
+		}
+
+		template<std::size_t n>
+		inline bool logPrint(const HexEncodedN<n> &value, RecordBuffer &dest)
+		{
+			dest.reserve(dest.size() + 2 * n);
+			RecordBuffer::Tail p = dest.borrowTail();
+			std::for_each(value.val, value.val + n,
+					[&p](const unsigned char b) { p = afc::octetToHex(b, p); });
+			dest.returnTail(p);
+			return true;
+		}
+
+		inline bool logToBufferInternal(RecordBuffer &) noexcept { return true; }
+
+		template<typename Arg, typename... Args>
+		inline bool logToBufferInternal(RecordBuffer &dest, const Arg &arg, const Args &...args)
+		{
+			return logPrint(arg, dest) && logToBufferInternal(dest, args...);
+		}
+
+		namespace _impl
+		{
+			template<typename T>
+			constexpr std::size_t arithmeticPrintedSize(std::true_type) noexcept { return afc::maxPrintedSize<T, 10>(); }
+
+			template<typename T>
+			constexpr std::size_t arithmeticPrintedSize(std::false_type) noexcept { return 0; }
+		}
+
+		/* An upper bound of the number of characters logPrint() produces for a value, or zero if
+		 * it is unknown. Used to allocate the buffer for a record at once; a value that exceeds
+		 * the estimate is still printed as a whole.
+		 */
+		template<typename T>
+		constexpr std::size_t logPrintedSize(const T &) noexcept
+		{
+			return _impl::arithmeticPrintedSize<T>(std::integral_constant<bool,
+					std::is_integral<T>::value || std::is_same<T, float>::value || std::is_same<T, double>::value>());
+		}
+
+		constexpr std::size_t logPrintedSize(char) noexcept { return 1; }
+		constexpr std::size_t logPrintedSize(bool) noexcept { return 5; }
+		constexpr std::size_t logPrintedSize(long double) noexcept { return 32; }
+		inline std::size_t logPrintedSize(const afc::ConstStringRef s) noexcept { return s.size(); }
+		inline std::size_t logPrintedSize(const afc::FastStringBuffer<char> &s) noexcept { return s.size(); }
+		inline std::size_t logPrintedSize(const afc::String &s) noexcept { return s.size(); }
+		inline std::size_t logPrintedSize(const char * const s) noexcept { return std::strlen(s); }
+
+		inline std::size_t logPrintedSize(const std::pair<const char *, const char *> &s) noexcept
+		{
+			return std::size_t(s.second - s.first);
+		}
+
+		inline std::size_t logPrintedSize(const std::pair<char *, char *> &s) noexcept
+		{
+			return std::size_t(s.second - s.first);
+		}
+
+		template<std::size_t n>
+		constexpr std::size_t logPrintedSize(const HexEncodedN<n> &) noexcept { return 2 * n; }
+
+		// The estimated size of a record with the values given, including the line terminator.
+		inline std::size_t logRecordSize() noexcept { return 1; }
+
+		template<typename Arg, typename... Args>
+		inline std::size_t logRecordSize(const Arg &arg, const Args &...args) noexcept
+		{
+			return logPrintedSize(arg) + logRecordSize(args...);
+		}
+
+		namespace _impl
+		{
+			/* The buffer records are assembled in. Its memory is reused by all records logged
+			 * by the thread, so logPrint() overloads must not log themselves.
+			 */
+			inline RecordBuffer &threadRecordBuffer()
+			{
+				static thread_local RecordBuffer buf;
+				return buf;
+			}
+
+			// Writes an assembled record with a single fwrite() call.
+			template<bool flush>
+			inline bool writeRecord(const RecordBuffer &record, std::FILE * const dest) noexcept
+			{ FileLock fileLock(dest);
+				bool success = logText(record.data(), record.size(), dest);
+				if (flush) {
+					// Flushing the buffer even if logging payload fails.
+					success &= (std::fflush(dest) != EOF);
+				}
+				return success;
+			}
+		}
+
 		class Printer
 		{
 		public:
@@ -192,6 +404,184 @@ namespace afc
 			return success;
 		}
 
+		/* A format string that is parsed at compile time. It is created with the macro AFC_FMT,
+		 * e.g. AFC_FMT("# of # items"), and has the same syntax as formats of logToFileFmt():
+		 * '#' is a placeholder, '\\' escapes the next character.
+		 *
+		 * The literal text is split into segments and each argument is passed to logPrint()
+		 * directly. A mismatch between the number of placeholders and the number of
+		 * arguments is a compile-time error.
+		 */
+		template<char... chars>
+		struct Format {};
+
+		namespace _impl
+		{
+			constexpr std::size_t maxFormatSize = 256;
+
+			template<std::size_t n>
+			constexpr char formatChar(const char (&s)[n], const std::size_t i) noexcept
+			{
+				return i < n ? s[i] : '\0';
+			}
+
+			// Takes the first n characters of a pack.
+			template<bool done, std::size_t n, typename Taken, char... chars>
+			struct TakeFormat;
+
+			template<std::size_t n, char... taken, char... chars>
+			struct TakeFormat<true, n, Format<taken...>, chars...>
+			{
+				typedef Format<taken...> type;
+			};
+
+			template<std::size_t n, char... taken, char c, char... chars>
+			struct TakeFormat<false, n, Format<taken...>, c, chars...>
+			{
+				typedef typename TakeFormat<n == 1, n - 1, Format<taken..., c>, chars...>::type type;
+			};
+
+			template<std::size_t n, char... chars>
+			constexpr typename TakeFormat<n == 0, n, Format<>, chars...>::type makeFormat() noexcept
+			{
+				static_assert(n <= maxFormatSize, "The format string is too long.");
+				return typename TakeFormat<n == 0, n, Format<>, chars...>::type();
+			}
+		}
+
+		#define AFC_FMT_CHARS_4(s, i) ::afc::logger::_impl::formatChar(s, (i)), \
+				::afc::logger::_impl::formatChar(s, (i) + 1), ::afc::logger::_impl::formatChar(s, (i) + 2), \
+				::afc::logger::_impl::formatChar(s, (i) + 3)
+		#define AFC_FMT_CHARS_16(s, i) AFC_FMT_CHARS_4(s, (i)), AFC_FMT_CHARS_4(s, (i) + 4), \
+				AFC_FMT_CHARS_4(s, (i) + 8), AFC_FMT_CHARS_4(s, (i) + 12)
+		#define AFC_FMT_CHARS_64(s, i) AFC_FMT_CHARS_16(s, (i)), AFC_FMT_CHARS_16(s, (i) + 16), \
+				AFC_FMT_CHARS_16(s, (i) + 32), AFC_FMT_CHARS_16(s, (i) + 48)
+		#define AFC_FMT_CHARS_256(s, i) AFC_FMT_CHARS_64(s, (i)), AFC_FMT_CHARS_64(s, (i) + 64), \
+				AFC_FMT_CHARS_64(s, (i) + 128), AFC_FMT_CHARS_64(s, (i) + 192)
+
+		// Turns a string literal of up to 256 characters into a Format.
+		#define AFC_FMT(s) (::afc::logger::_impl::makeFormat<sizeof(s) - 1, AFC_FMT_CHARS_256(s, 0)>())
+
+		namespace _impl
+		{
+			// A segment of literal text between two placeholders.
+			template<char... chars>
+			struct FormatText
+			{
+				static constexpr std::size_t size = sizeof...(chars);
+				static constexpr char value[sizeof...(chars) + 1] = {chars..., '\0'};
+			};
+
+			template<char... chars>
+			constexpr char FormatText<chars...>::value[sizeof...(chars) + 1];
+
+			template<typename... Segments>
+			struct FormatTextSize;
+
+			template<>
+			struct FormatTextSize<> : std::integral_constant<std::size_t, 0> {};
+
+			template<typename Segment, typename... Segments>
+			struct FormatTextSize<Segment, Segments...>
+					: std::integral_constant<std::size_t, Segment::size + FormatTextSize<Segments...>::value> {};
+
+			template<typename... Segments>
+			struct FormatSegments
+			{
+				static constexpr std::size_t placeholderCount = sizeof...(Segments) - 1;
+				// The size of the literal text of the format.
+				static constexpr std::size_t textSize = FormatTextSize<Segments...>::value;
+			};
+
+			template<typename T>
+			struct AlwaysFalse : std::false_type {};
+
+			// Consumes chars one by one, accumulating the current segment in Text.
+			template<typename Text, typename Segments, char... chars>
+			struct SplitFormat;
+
+			template<char... text, typename... Segments>
+			struct SplitFormat<FormatText<text...>, FormatSegments<Segments...>>
+			{
+				typedef FormatSegments<Segments..., FormatText<text...>> type;
+			};
+
+			template<char... text, typename... Segments, char c, char... chars>
+			struct SplitFormat<FormatText<text...>, FormatSegments<Segments...>, c, chars...>
+			{
+				typedef typename SplitFormat<FormatText<text..., c>, FormatSegments<Segments...>, chars...>::type type;
+			};
+
+			template<char... text, typename... Segments, char... chars>
+			struct SplitFormat<FormatText<text...>, FormatSegments<Segments...>, '#', chars...>
+			{
+				typedef typename SplitFormat<FormatText<>, FormatSegments<Segments..., FormatText<text...>>, chars...>::type type;
+			};
+
+			template<char... text, typename... Segments, char c, char... chars>
+			struct SplitFormat<FormatText<text...>, FormatSegments<Segments...>, '\\', c, chars...>
+			{
+				typedef typename SplitFormat<FormatText<text..., c>, FormatSegments<Segments...>, chars...>::type type;
+			};
+
+			template<char... text, typename... Segments>
+			struct SplitFormat<FormatText<text...>, FormatSegments<Segments...>, '\\'>
+			{
+				static_assert(AlwaysFalse<FormatText<text...>>::value, "Premature end of an escape sequence.");
+				typedef FormatSegments<Segments..., FormatText<text...>> type;
+			};
+
+			template<char... chars>
+			using SplitFormatT = typename SplitFormat<FormatText<>, FormatSegments<>, chars...>::type;
+
+			template<typename Text, typename Dest>
+			inline bool logFormatText(Dest &dest)
+			{
+				// Empty segments are eliminated at compile time.
+				return Text::size == 0 || logText(Text::value, Text::size, dest);
+			}
+
+			template<typename Dest, typename Text>
+			inline bool logFormatted(Dest &dest, FormatSegments<Text>)
+			{
+				return logFormatText<Text>(dest);
+			}
+
+			template<typename Dest, typename Text, typename... Segments, typename Arg, typename... Args>
+			inline bool logFormatted(Dest &dest, FormatSegments<Text, Segments...>, const Arg &arg, const Args &...args)
+			{
+				return logFormatText<Text>(dest) && logPrint(arg, dest) &&
+						logFormatted(dest, FormatSegments<Segments...>(), args...);
+			}
+
+			// Writes the formatted record followed by '\n'.
+			template<typename Dest, char... format, typename... Args>
+			inline bool logFormattedLine(Dest &dest, Format<format...>, const Args &...args)
+			{
+				typedef SplitFormatT<format...> Segments;
+				static_assert(Segments::placeholderCount == sizeof...(Args),
+						"The number of arguments does not match the number of placeholders in the format.");
+
+				return logFormatted(dest, Segments(), args...) && logPrint('\n', dest);
+			}
+
+			// Assembles a formatted record in the buffer given.
+			template<char... format, typename... Args>
+			inline bool assembleFormattedRecord(RecordBuffer &record, const Format<format...> fmt, const Args &...args)
+			{
+				record.clear();
+				record.reserve(SplitFormatT<format...>::textSize + logRecordSize(args...));
+				return logFormattedLine(record, fmt, args...);
+			}
+		}
+
+		template<bool flush, char... format, typename... Args>
+		inline bool logToFileFmt(std::FILE *dest, const Format<format...> fmt, const Args &...args)
+		{
+			RecordBuffer &record = _impl::threadRecordBuffer();
+			return _impl::assembleFormattedRecord(record, fmt, args...) && _impl::writeRecord<flush>(record, dest);
+		}
+
 		inline bool logToFileInternal(FILE *) noexcept { return true; }
 
 		// TODO define noexcept
@@ -201,16 +591,27 @@ namespace afc
 			return logPrint(arg, dest) && logToFileInternal(dest, args...);
 		}
 
+		namespace _impl
+		{
+			// Assembles a record with the values given and the line terminator in the buffer given.
+			template<typename... Args>
+			inline bool assembleRecord(RecordBuffer &record, const Args &...args)
+			{
+				record.clear();
+				record.reserve(logRecordSize(args...));
+				return logToBufferInternal(record, args...) && logPrint('\n', record);
+			}
+		}
+
+		/* The record is assembled in memory and then written with a single fwrite() call,
+		 * so that it is not interleaved with records written concurrently, and unbuffered
+		 * streams (e.g. stderr) issue a single write(2) per record.
+		 */
 		template<bool flush, typename... Args>
 		inline bool logToFile(std::FILE * const dest, const Args &...args)
-				noexcept(noexcept(logToFileInternal(dest, args...)))
-		{ FileLock fileLock(dest);
-			bool success = (logToFileInternal(dest, args...) && std::fputc('\n', dest) != EOF);
-			if (flush) {
-				// Flushing the buffer even if logging payload fails.
-				success &= (std::fflush(dest) != EOF);
-			}
-			return success;
+		{
+			RecordBuffer &record = _impl::threadRecordBuffer();
+			return _impl::assembleRecord(record, args...) && _impl::writeRecord<flush>(record, dest);
 		}
 
 		#ifdef NDEBUG
@@ -219,6 +620,14 @@ namespace afc
 
 			template<typename... Args>
 			inline bool logDebugFmt(const char *format, const Args &...args) { /* Nothing to do. */ return true; }
+
+			template<char... format, typename... Args>
+			inline bool logDebugFmt(const Format<format...>, const Args &...args) noexcept
+			{
+				static_assert(_impl::SplitFormatT<format...>::placeholderCount == sizeof...(Args),
+						"The number of arguments does not match the number of placeholders in the format.");
+				return true;
+			}
 		#else
 			template<typename... Args>
 			inline bool logDebug(const Args &...args) noexcept(noexcept(logToFile<true>(stdout, args...)))
@@ -231,6 +640,12 @@ namespace afc
 			{
 				return logToFileFmt<true>(stdout, format, args...);
 			}
+
+			template<char... format, typename... Args>
+			inline bool logDebugFmt(const Format<format...> fmt, const Args &...args)
+			{
+				return logToFileFmt<true>(stdout, fmt, args...);
+			}
 		#endif
 
 		template<typename... Args>
@@ -245,6 +660,12 @@ namespace afc
 			return logToFileFmt<false>(stderr, format, args...);
 		}
 
+		template<char... format, typename... Args>
+		inline bool logErrorFmt(const Format<format...> fmt, const Args &...args)
+		{
+			return logToFileFmt<false>(stderr, fmt, args...);
+		}
+
 		#ifdef AFC_TRACE
 			template<typename... Args>
 			inline bool logTrace(const Args &...args) noexcept(noexcept(logToFile<true>(stdout, args...)))
@@ -257,14 +678,314 @@ namespace afc
 			{
 				return logToFileFmt<true>(stdout, format, args...);
 			}
+
+			template<char... format, typename... Args>
+			inline bool logTraceFmt(const Format<format...> fmt, const Args &...args)
+			{
+				return logToFileFmt<true>(stdout, fmt, args...);
+			}
 		#else
 			template<typename... Args>
 			inline bool logTrace(const Args &...args) noexcept { /* Nothing to do. */ return true; }
 
 			template<typename... Args>
 			inline bool logTraceFmt(const char *format, const Args &...args) { /* Nothing to do. */ return true; }
+
+			template<char... format, typename... Args>
+			inline bool logTraceFmt(const Format<format...>, const Args &...args) noexcept
+			{
+				static_assert(_impl::SplitFormatT<format...>::placeholderCount == sizeof...(Args),
+						"The number of arguments does not match the number of placeholders in the format.");
+				return true;
+			}
 		#endif
+
+		/* Log levels that are checked at run time. A record is logged if its level is not
+		 * less than the level of the module it is logged to.
+		 */
+		enum class LogLevel : unsigned char
+		{
+			trace,
+			debug,
+			error,
+			// Disables logging to a module.
+			off
+		};
+
+		// The initial level of modules follows the compile-time switches of logDebug() and logTrace().
+		#if defined AFC_TRACE
+			constexpr LogLevel defaultLogLevel = LogLevel::trace;
+		#elif !defined NDEBUG
+			constexpr LogLevel defaultLogLevel = LogLevel::debug;
+		#else
+			constexpr LogLevel defaultLogLevel = LogLevel::error;
+		#endif
+
+		/* A named group of log statements that share a log level which can be changed at run time.
+		 * Modules are meant to be objects with static storage duration, e.g.
+		 *     afc::logger::LogModule netLog("net");
+		 *     ...
+		 *     AFC_MODULE_LOG(netLog, debug, "received ", n, " bytes");
+		 *
+		 * Checking whether a level is enabled is a single relaxed load. The level is not
+		 * synchronised with anything else, so a thread can see a new level with a delay.
+		 */
+		namespace _impl
+		{
+			struct DefaultLogModuleTag {};
+		}
+
+		class LogModule
+		{
+		public:
+			explicit LogModule(const char *name, LogLevel level = defaultLogLevel);
+
+			// Creates the default module, which is initialised statically and is not registered.
+			constexpr LogModule(_impl::DefaultLogModuleTag, const LogLevel level) noexcept
+					: m_name(""), m_level(static_cast<unsigned char>(level)), m_registered(false) {}
+
+			~LogModule();
+
+			LogModule(const LogModule &) = delete;
+			LogModule &operator=(const LogModule &) = delete;
+
+			const char *name() const noexcept { return m_name; }
+
+			LogLevel level() const noexcept { return LogLevel(m_level.load(std::memory_order_relaxed)); }
+			void setLevel(const LogLevel level) noexcept
+			{
+				m_level.store(static_cast<unsigned char>(level), std::memory_order_relaxed);
+			}
+
+			bool enabled(const LogLevel level) const noexcept
+			{
+				return static_cast<unsigned char>(level) >= m_level.load(std::memory_order_relaxed);
+			}
+		private:
+			const char * const m_name;
+			std::atomic<unsigned char> m_level;
+			const bool m_registered;
+		};
+
+		namespace _impl
+		{
+			extern LogModule defaultLogModule;
+		}
+
+		// The module used by AFC_LOG. It can be used before static initialisation completes.
+		inline LogModule &defaultLogModule() noexcept { return _impl::defaultLogModule; }
+
+		/* Sets the level of the modules with the name given, including modules created later.
+		 * Returns the number of live modules updated.
+		 */
+		std::size_t setLogLevel(const char *moduleName, LogLevel level);
+
+		inline void setLogLevel(const LogLevel level) noexcept { defaultLogModule().setLevel(level); }
+
+		namespace _impl
+		{
+			template<typename... Args>
+			inline bool logAtLevel(const LogLevel level, const Args &...args)
+			{
+				return level == LogLevel::error ? logToFile<false>(stderr, args...) : logToFile<true>(stdout, args...);
+			}
+
+			template<char... format, typename... Args>
+			inline bool logAtLevel(const LogLevel level, const Format<format...> fmt, const Args &...args)
+			{
+				return level == LogLevel::error ?
+						logToFileFmt<false>(stderr, fmt, args...) : logToFileFmt<true>(stdout, fmt, args...);
+			}
+		}
+
+		namespace _impl
+		{
+			inline std::uint64_t zeroAsOne() noexcept
+			{
+				assert(false && "the parameter must be positive");
+				return 1;
+			}
+
+			// Parameters that must be positive are asserted to be so and are treated as one otherwise.
+			constexpr std::uint64_t atLeastOne(const std::uint64_t value) noexcept
+			{
+				return value != 0 ? value : zeroAsOne();
+			}
+		}
+
+		/* Per-site state of 1-in-n sampling of log records. It is lock-free, and objects with
+		 * static storage duration are initialised statically.
+		 */
+		class LogSampler
+		{
+		public:
+			constexpr LogSampler() noexcept : m_count(0) {}
+
+			LogSampler(const LogSampler &) = delete;
+			LogSampler &operator=(const LogSampler &) = delete;
+
+			/* Returns true for the 1st, (n+1)th, (2n+1)th, ... call. On success, suppressed is set to
+			 * the number of calls skipped since the previous successful one. n is expected to be
+			 * the same for all calls; zero is treated as one.
+			 */
+			bool acquire(std::uint64_t n, std::uint64_t &suppressed) noexcept
+			{
+				n = _impl::atLeastOne(n);
+				const std::uint64_t count = m_count.fetch_add(1, std::memory_order_relaxed);
+				if (likely(count % n != 0)) {
+					return false;
+				}
+				suppressed = count == 0 ? 0 : n - 1;
+				return true;
+			}
+		private:
+			std::atomic<std::uint64_t> m_count;
+		};
+
+		/* Per-site state of a token bucket that allows up to burst log records at once and
+		 * recordsPerSecond records per second on average. It is lock-free: the bucket is
+		 * represented by the time at which it becomes full again (the generic cell rate
+		 * algorithm), which is updated with a single CAS. Objects with static storage duration
+		 * are initialised statically. Zero recordsPerSecond or burst is treated as one.
+		 */
+		class LogRateLimiter
+		{
+		public:
+			constexpr LogRateLimiter(const std::uint32_t recordsPerSecond, const std::uint32_t burst) noexcept
+					: m_interval(std::uint64_t(1000000000) / _impl::atLeastOne(recordsPerSecond)),
+					  m_maxDelay(m_interval * _impl::atLeastOne(burst)), m_fullAt(0), m_suppressed(0) {}
+
+			LogRateLimiter(const LogRateLimiter &) = delete;
+			LogRateLimiter &operator=(const LogRateLimiter &) = delete;
+
+			/* Takes a token from the bucket if it is not empty. On success, suppressed is set to the
+			 * number of calls that found the bucket empty since the previous successful one.
+			 */
+			bool acquire(std::uint64_t &suppressed) noexcept
+			{
+				/* A coarse clock is several times cheaper than a precise one; its resolution
+				 * (a few milliseconds) is good enough for rates of log records.
+				 */
+				::timespec time;
+			#ifdef CLOCK_MONOTONIC_COARSE
+				::clock_gettime(CLOCK_MONOTONIC_COARSE, &time);
+			#else
+				::clock_gettime(CLOCK_MONOTONIC, &time);
+			#endif
+				return acquire(std::uint64_t(time.tv_sec) * 1000000000 + time.tv_nsec, suppressed);
+			}
+
+			/* The same as above at the time given, in nanoseconds of a monotonic clock. All the calls
+			 * for a limiter must use the same clock.
+			 */
+			bool acquire(const std::uint64_t now, std::uint64_t &suppressed) noexcept
+			{
+				std::uint64_t fullAt = m_fullAt.load(std::memory_order_relaxed);
+				std::uint64_t newFullAt;
+				do {
+					newFullAt = std::max(fullAt, now) + m_interval;
+					if (newFullAt - now > m_maxDelay) {
+						m_suppressed.fetch_add(1, std::memory_order_relaxed);
+						return false;
+					}
+				} while (!m_fullAt.compare_exchange_weak(fullAt, newFullAt, std::memory_order_relaxed));
+
+				suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+				return true;
+			}
+		private:
+			// The time in nanoseconds it takes for a token to be added to the bucket.
+			const std::uint64_t m_interval;
+			// The time it takes for the empty bucket to become full.
+			const std::uint64_t m_maxDelay;
+			std::atomic<std::uint64_t> m_fullAt;
+			std::atomic<std::uint64_t> m_suppressed;
+		};
+
+		namespace _impl
+		{
+			// Appends the notice on the records suppressed at a site to the record given.
+			inline bool appendSuppressedNotice(RecordBuffer &record, const std::uint64_t suppressed)
+			{
+				using afc::operator"" _s;
+				return suppressed == 0 ||
+						logToBufferInternal(record, "afc::logger: "_s, suppressed, " similar records suppressed\n"_s);
+			}
+
+			template<typename... Args>
+			inline bool logErrorAfterSuppressed(const std::uint64_t suppressed, const Args &...args)
+			{
+				RecordBuffer &record = _impl::threadRecordBuffer();
+				return _impl::assembleRecord(record, args...) && appendSuppressedNotice(record, suppressed) &&
+						_impl::writeRecord<false>(record, stderr);
+			}
+
+			template<char... format, typename... Args>
+			inline bool logErrorAfterSuppressed(const std::uint64_t suppressed, const Format<format...> fmt,
+					const Args &...args)
+			{
+				RecordBuffer &record = _impl::threadRecordBuffer();
+				return _impl::assembleFormattedRecord(record, fmt, args...) &&
+						appendSuppressedNotice(record, suppressed) && _impl::writeRecord<false>(record, stderr);
+			}
+		}
+
+		/* Logs every n-th record of the site given to stderr, as logError() or logErrorFmt() with
+		 * AFC_FMT do. A record that follows suppressed ones is followed by a notice with their number.
+		 * Returns true if the record is either logged successfully or suppressed.
+		 */
+		template<typename... Args>
+		inline bool logErrorEveryN(LogSampler &site, const std::uint64_t n, const Args &...args)
+		{
+			std::uint64_t suppressed;
+			return !site.acquire(n, suppressed) || _impl::logErrorAfterSuppressed(suppressed, args...);
+		}
+
+		/* Logs a record of the site given to stderr if the rate limit of the site allows it,
+		 * as logError() or logErrorFmt() with AFC_FMT do. A record that follows suppressed ones
+		 * is followed by a notice with their number. Returns true if the record is either logged
+		 * successfully or suppressed.
+		 */
+		template<typename... Args>
+		inline bool logErrorRateLimited(LogRateLimiter &site, const Args &...args)
+		{
+			std::uint64_t suppressed;
+			return !site.acquire(suppressed) || _impl::logErrorAfterSuppressed(suppressed, args...);
+		}
 	}
 }
 
+/* Logs a record to the module given if the level given (trace, debug or error) is enabled
+ * for it. The arguments are the same as those of logDebug() or logDebugFmt() with AFC_FMT.
+ * They are evaluated only if the record is logged. Records of the level error go to stderr,
+ * the others go to stdout.
+ *
+ * Evaluates to true if the record is either logged successfully or disabled.
+ */
+#define AFC_MODULE_LOG(module, level, ...) \
+	(unlikely((module).enabled(::afc::logger::LogLevel::level)) ? \
+			::afc::logger::_impl::logAtLevel(::afc::logger::LogLevel::level, __VA_ARGS__) : true)
+
+// Logs a record to the default module.
+#define AFC_LOG(level, ...) AFC_MODULE_LOG(::afc::logger::_impl::defaultLogModule, level, __VA_ARGS__)
+
+/* Versions of logErrorEveryN() and logErrorRateLimited() that keep the state of the call site
+ * in a static variable of their own. The arguments are evaluated only if the record is logged.
+ */
+#define AFC_LOG_ERROR_EVERY_N(n, ...) \
+	([&]() -> bool { \
+		static ::afc::logger::LogSampler afc_logSite; \
+		std::uint64_t afc_suppressed; \
+		return !afc_logSite.acquire((n), afc_suppressed) || \
+				::afc::logger::_impl::logErrorAfterSuppressed(afc_suppressed, __VA_ARGS__); \
+	}())
+
+#define AFC_LOG_ERROR_RATE_LIMITED(recordsPerSecond, burst, ...) \
+	([&]() -> bool { \
+		static ::afc::logger::LogRateLimiter afc_logSite((recordsPerSecond), (burst)); \
+		std::uint64_t afc_suppressed; \
+		return !afc_logSite.acquire(afc_suppressed) || \
+				::afc::logger::_impl::logErrorAfterSuppressed(afc_suppressed, __VA_ARGS__); \
+	}())
+
 #endif /* AFC_LOGGER_HPP_ */
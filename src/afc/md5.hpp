@@ -16,24 +16,54 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #ifndef AFC_MD5_HPP_
 #define AFC_MD5_HPP_
 
-#include <ctime>
 #include <cstddef>
-#include <openssl/md5.h>
+#include <cstdint>
 #include "ensure_ascii.hpp"
 #include "number.h"
 
 namespace afc
 {
-	template<typename OutputIterator>
-	OutputIterator md5String(const unsigned char * const data, std::size_t n, const OutputIterator dest)
+	struct InputStream;
+
+	/* Incremental MD5 (RFC 1321).
+	 *
+	 * Data is passed in by update() in chunks of any size. finish() writes the digest
+	 * and resets the context so that it can be used for new data.
+	 */
+	class Md5
 	{
-		unsigned char hash[MD5_DIGEST_LENGTH];
-		MD5(data, n, hash);
+	public:
+		static constexpr std::size_t digestSize = 16;
+		static constexpr std::size_t blockSize = 64;
+
+		Md5() noexcept { reset(); }
+
+		void reset() noexcept;
+
+		void update(const unsigned char *data, std::size_t n) noexcept;
+		void update(const char * const data, const std::size_t n) noexcept
+		{
+			update(reinterpret_cast<const unsigned char *>(data), n);
+		}
+		// Reads the stream till its end. Memory used does not depend on the size of the stream.
+		void update(InputStream &in);
 
+		// Writes digestSize octets to dest.
+		void finish(unsigned char *dest) noexcept;
+	private:
+		std::uint32_t m_state[4];
+		std::uint64_t m_size;
+		unsigned char m_buf[blockSize];
+	};
+
+	// Writes a digest as lower-case hex digits; 2*n characters are written.
+	template<typename OutputIterator>
+	OutputIterator digestToHex(const unsigned char * const digest, const std::size_t n, OutputIterator dest)
+	{
 		OutputIterator p = dest;
-		for (size_t i = 0; i < MD5_DIGEST_LENGTH; ++i) {
-			const unsigned char b = hash[i] & 0xff;
+		for (std::size_t i = 0; i < n; ++i) {
 			// 0xff is applied just in case non-octet bytes are used.
+			const unsigned char b = digest[i] & 0xff;
 			*p = hexToChar(b >> 4);
 			++p;
 			*p = hexToChar(b & 0xf);
@@ -42,6 +72,17 @@ namespace afc
 		return p;
 	}
 
+	template<typename OutputIterator>
+	OutputIterator md5String(const unsigned char * const data, std::size_t n, const OutputIterator dest)
+	{
+		unsigned char hash[Md5::digestSize];
+		Md5 md5;
+		md5.update(data, n);
+		md5.finish(hash);
+
+		return digestToHex(hash, Md5::digestSize, dest);
+	}
+
 	/*
 	 * Calculates the MD5 hash of a given binary data and passes it in the lower-case hex format
 	 * as an ASCII sequence using to a given appender.
@@ -54,10 +95,10 @@ namespace afc
 	inline void appendMD5String(const unsigned char * const data, const std::size_t n, Appender appender)
 	{
 		// Contains the encoded hash value.
-		char hashString[2 * MD5_DIGEST_LENGTH];
+		char hashString[2 * Md5::digestSize];
 
 		md5String(data, n, &hashString[0]);
-		appender(hashString, 2 * MD5_DIGEST_LENGTH);
+		appender(hashString, 2 * Md5::digestSize);
 	}
 }
 
@@ -16,14 +16,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #ifndef AFC_NUMBER_H_
 #define AFC_NUMBER_H_
 
+#include <algorithm>
 #include <cassert>
+#include <cfloat>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <limits>
 #include <type_traits>
 
 #include "builtin.hpp"
 #include "math_utils.h"
+#include "platform.h"
 
 namespace afc
 {
@@ -62,6 +67,11 @@ namespace afc
 	template<typename T>
 	constexpr char hexToChar(const T digit) noexcept { return digitToChar<16>(digit); }
 
+	/* Prints integral and floating-point (float and double) numbers. Floating-point numbers are printed
+	 * in base 10 only, with the shortest sequence of digits that is parsed back to the same value. The
+	 * format follows ECMAScript Number::toString: 123, 0.001, 1.5e+21, 1e-7, NaN, Infinity, except that
+	 * negative zero is printed as -0.
+	 */
 	// TODO think of defining conditional noexcept.
 	template<unsigned char base, typename T, typename OutputIterator>
 	OutputIterator printNumber(const T value, OutputIterator dest);
@@ -71,6 +81,11 @@ namespace afc
 	template<unsigned char base, typename T, typename Appender>
 	void appendNumber(const T value, Appender appender);
 
+	/* Parses integral and floating-point (float and double) numbers. Floating-point numbers are parsed
+	 * in base 10 only, are rounded correctly, and must be passed in via forward iterators. They are
+	 * accepted in the form -?(digits|digits.digits?|.digits)([eE][+-]?digits)?. Values that are out
+	 * of range of T are reported as errors for floating-point numbers as well as for integral ones.
+	 */
 	// TODO think of defining conditional noexcept.
 	template<unsigned char base, afc::ParseMode parseMode = ParseMode::all,
 			typename T, typename Iterator, typename ErrorHandler>
@@ -104,6 +119,166 @@ namespace afc
 					std::numeric_limits<T>::max() / base :
 					(std::is_signed<T>::value ? -(std::numeric_limits<T>::min() / base) : 0);
 		}
+
+		template<typename T, unsigned char base>
+		constexpr std::size_t maxPrintedSize(std::false_type) noexcept;
+
+		template<typename T, unsigned char base>
+		constexpr std::size_t maxPrintedSize(std::true_type) noexcept;
+
+		template<unsigned char base, typename T, typename OutputIterator>
+		OutputIterator printNumber(T value, OutputIterator dest, std::false_type);
+
+		template<unsigned char base, typename T, typename OutputIterator>
+		OutputIterator printNumber(T value, OutputIterator dest, std::true_type);
+
+		// Prints an unsigned integer in an arbitrary base.
+		template<unsigned char base, typename T, typename OutputIterator>
+		OutputIterator printUnsigned(T value, OutputIterator dest, std::false_type);
+
+		// Prints an unsigned integer in base 10.
+		template<unsigned char base, typename T, typename OutputIterator>
+		OutputIterator printUnsigned(T value, OutputIterator dest, std::true_type);
+
+		// Prints an unsigned integer in base 10 directly to the memory pointed to by dest.
+		template<unsigned char base, typename T>
+		char *printUnsigned(T value, char *dest, std::true_type);
+
+		// Returns the number of decimal digits in value.
+		inline unsigned decimalDigitCount(std::uint64_t value) noexcept;
+
+		// Prints decimal digits of value so that the last digit precedes end. Returns the first digit printed.
+		template<typename T>
+		inline char *printDecimalBackward(T value, char *end) noexcept;
+
+		template<unsigned char base, afc::ParseMode parseMode, typename T, typename Iterator, typename ErrorHandler>
+		Iterator parseNumber(Iterator begin, Iterator end, T &result, ErrorHandler errorHandler, std::false_type);
+
+		// Parses an integer char by char.
+		template<unsigned char base, afc::ParseMode parseMode, typename T, typename Iterator, typename ErrorHandler>
+		Iterator parseInteger(Iterator begin, Iterator end, T &result, ErrorHandler errorHandler, std::false_type);
+
+		// Parses a decimal integer from contiguous memory eight digits at a time.
+		template<unsigned char base, afc::ParseMode parseMode, typename T, typename Iterator, typename ErrorHandler>
+		Iterator parseInteger(Iterator begin, Iterator end, T &result, ErrorHandler errorHandler, std::true_type);
+
+		template<unsigned char base, afc::ParseMode parseMode, typename T, typename Iterator, typename ErrorHandler>
+		Iterator parseNumber(Iterator begin, Iterator end, T &result, ErrorHandler errorHandler, std::true_type);
+
+		template<unsigned char base, afc::ParseMode parseMode, typename T, typename ErrorHandler>
+		const char *parseNumber(const char *input, T &result, ErrorHandler errorHandler, std::false_type);
+
+		template<unsigned char base, afc::ParseMode parseMode, typename T, typename ErrorHandler>
+		const char *parseNumber(const char *input, T &result, ErrorHandler errorHandler, std::true_type);
+
+		// Parameters of an IEEE 754 binary floating-point format.
+		struct FloatFormat
+		{
+			int mantissaExplicitBits;
+			std::int32_t minimumExponent;
+			std::int32_t infinitePower;
+			std::int64_t minExponentRoundToEven;
+			std::int64_t maxExponentRoundToEven;
+			std::int64_t smallestPowerOfTen;
+			std::int64_t largestPowerOfTen;
+		};
+
+		template<typename T>
+		struct FloatTraits;
+
+		template<>
+		struct FloatTraits<double>
+		{
+			using Bits = std::uint64_t;
+
+			static constexpr FloatFormat format() noexcept { return FloatFormat{52, -1023, 0x7ff, -4, 23, -342, 308}; }
+
+			// Integers up to 2^53 and powers of ten up to 10^22 are exact doubles.
+			static constexpr std::uint64_t maxExactMantissa = std::uint64_t(1) << 53;
+			static constexpr int maxExactPowerOfTen = 22;
+
+			static double exactPowerOfTen(const int i) noexcept
+			{
+				static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+						1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+				return powers[i];
+			}
+		};
+
+		template<>
+		struct FloatTraits<float>
+		{
+			using Bits = std::uint32_t;
+
+			static constexpr FloatFormat format() noexcept { return FloatFormat{23, -127, 0xff, -17, 10, -64, 38}; }
+
+			// Integers up to 2^24 and powers of ten up to 10^10 are exact floats.
+			static constexpr std::uint64_t maxExactMantissa = std::uint64_t(1) << 24;
+			static constexpr int maxExactPowerOfTen = 10;
+
+			static float exactPowerOfTen(const int i) noexcept
+			{
+				static const float powers[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+				return powers[i];
+			}
+		};
+
+		// A floating-point number as a biased binary exponent and a mantissa without the implicit bit.
+		struct AdjustedMantissa
+		{
+			std::uint64_t mantissa;
+			std::int32_t power2;
+
+			bool operator==(const AdjustedMantissa &o) const noexcept
+			{
+				return mantissa == o.mantissa && power2 == o.power2;
+			}
+		};
+
+		// A decimal number 0.d1d2...dn * 10^decimalPoint with no leading or trailing zeros.
+		struct Decimal
+		{
+			// Enough to round any double correctly.
+			static constexpr std::size_t maxDigits = 768;
+
+			std::size_t digitCount;
+			std::int32_t decimalPoint;
+			// Set if non-zero digits were dropped.
+			bool truncated;
+			unsigned char digits[maxDigits];
+		};
+
+		// Converts w * 10^q to the nearest floating-point number (Eisel-Lemire algorithm).
+		AdjustedMantissa computeFloat(std::int64_t q, std::uint64_t w, const FloatFormat &format) noexcept;
+
+		// Converts d to the nearest floating-point number. d is consumed.
+		AdjustedMantissa computeFloat(Decimal &d, const FloatFormat &format) noexcept;
+
+		// A positive decimal number digits * 10^exponent with no trailing zeros in digits.
+		struct ShortestDecimal
+		{
+			std::uint64_t digits;
+			std::int32_t exponent;
+		};
+
+		/* Converts a positive finite floating-point number to the shortest decimal that is rounded back to it.
+		 * If there are several such decimals then the closest one is chosen (Schubfach algorithm).
+		 */
+		ShortestDecimal toShortestDecimal(std::uint64_t mantissa, std::int32_t biasedExponent,
+				const FloatFormat &format) noexcept;
+
+		template<typename T>
+		T toFloat(const bool negative, const AdjustedMantissa &value) noexcept
+		{
+			using Bits = typename FloatTraits<T>::Bits;
+
+			const Bits bits = static_cast<Bits>(value.mantissa) |
+					static_cast<Bits>(value.power2) << FloatTraits<T>::format().mantissaExplicitBits |
+					static_cast<Bits>(negative) << (sizeof(Bits) * 8 - 1);
+			T result;
+			std::memcpy(&result, &bits, sizeof(T));
+			return result;
+		}
 	}
 
 	template<typename T = void>
@@ -114,6 +289,9 @@ namespace afc
 		static const char octetToHexTable[256][2];
 		static const char digitChars[number_limits::MAX_BASE];
 		static const unsigned char asciiToDigit[256];
+		// "00", "01", ..., "99".
+		static const char digitPairs[200];
+		static const std::uint64_t powersOfTen[20];
 	};
 }
 
@@ -141,6 +319,25 @@ constexpr std::size_t afc::printedSize(T val) noexcept
 
 template<typename T, unsigned char base>
 constexpr std::size_t afc::maxPrintedSize() noexcept
+{
+	return _impl::maxPrintedSize<T, base>(std::is_floating_point<T>());
+}
+
+template<typename T, unsigned char base>
+constexpr std::size_t afc::_impl::maxPrintedSize(std::true_type) noexcept
+{
+	static_assert(std::is_same<T, double>::value || std::is_same<T, float>::value,
+			"Only float and double are supported.");
+	static_assert(base == 10, "Floating-point numbers are supported in base 10 only.");
+
+	/* Either a sign with 21 integer digits, or a sign, '0.', five zeros and all significant digits.
+	 * The exponential notation and NaN/Infinity are shorter.
+	 */
+	return afc::math::max<std::size_t>(22, 8 + std::numeric_limits<T>::max_digits10);
+}
+
+template<typename T, unsigned char base>
+constexpr std::size_t afc::_impl::maxPrintedSize(std::false_type) noexcept
 {
 	static_assert(std::is_integral<T>::value, "T must be an integral type.");
 
@@ -194,6 +391,36 @@ inline void afc::appendNumber(const T value, Appender appender)
 	appender(begin, end);
 }
 
+inline unsigned afc::_impl::decimalDigitCount(const std::uint64_t value) noexcept
+{
+	// An approximation of log10 via log2, which is either exact or one less than needed.
+	const unsigned approximation = (64 - __builtin_clzll(value | 1)) * 1233 >> 12;
+	return approximation + ((value | 1) >= afc::numdata<>::powersOfTen[approximation]);
+}
+
+template<typename T>
+inline char *afc::_impl::printDecimalBackward(T value, char *end) noexcept
+{
+	static_assert(std::is_unsigned<T>::value, "T must be an unsigned type.");
+
+	using Promoted = typename std::common_type<T, unsigned>::type;
+
+	Promoted val = value;
+	while (val >= 100) {
+		const Promoted nextVal = val / 100;
+		end -= 2;
+		std::memcpy(end, &afc::numdata<>::digitPairs[2 * (val - nextVal * 100)], 2);
+		val = nextVal;
+	}
+	if (val >= 10) {
+		end -= 2;
+		std::memcpy(end, &afc::numdata<>::digitPairs[2 * val], 2);
+	} else {
+		*--end = static_cast<char>(u8"0"[0] + val);
+	}
+	return end;
+}
+
 template<typename T, typename Iterator>
 inline Iterator afc::printTwoDigits(const T value, Iterator dest)
 {
@@ -220,21 +447,19 @@ inline Iterator afc::printFourDigits(const T value, Iterator dest)
 }
 
 template<unsigned char base, typename T, typename Iterator>
-Iterator afc::printNumber(const T value, register Iterator dest)
+inline Iterator afc::printNumber(const T value, const Iterator dest)
+{
+	return _impl::printNumber<base>(value, dest, std::is_floating_point<T>());
+}
+
+template<unsigned char base, typename T, typename Iterator>
+Iterator afc::_impl::printNumber(const T value, register Iterator dest, std::false_type)
 {
 	static_assert(std::is_integral<T>::value, "Integral types are supported only.");
 	static_assert(base >= afc::number_limits::MIN_BASE && base <= afc::number_limits::MAX_BASE, "Unsupported base.");
 
 	typedef typename std::make_unsigned<T>::type UnsignedT;
 
-	/* TODO modify iterator-based afc::printNumber so that it is possible to avoid copying digits
-	 * to the intermediate buffer (in the reverse order).
-	 */
-
-	// The buffer that contains digits in the reverse order. The highest digit is not stored here.
-	char digits[maxDigitCount<base, T>() - 1];
-	std::size_t i = 0;
-
 	/** If value is equal to the min signed value then the negation of it is either
 	 *  max signed value (for ones' complement and sign/magnitude signed representations) or
 	 *  min signed value itself (for the two's complement representation). In the latter case
@@ -250,8 +475,22 @@ Iterator afc::printNumber(const T value, register Iterator dest)
 		++dest;
 	}
 
+	return printUnsigned<base>(val, dest, std::integral_constant<bool, base == 10>());
+}
+
+template<unsigned char base, typename T, typename Iterator>
+Iterator afc::_impl::printUnsigned(T val, register Iterator dest, std::false_type)
+{
+	/* TODO modify iterator-based afc::printNumber so that it is possible to avoid copying digits
+	 * to the intermediate buffer (in the reverse order).
+	 */
+
+	// The buffer that contains digits in the reverse order. The highest digit is not stored here.
+	char digits[maxDigitCount<base, T>() - 1];
+	std::size_t i = 0;
+
 	while (val >= base) {
-		const UnsignedT nextVal = val / base;
+		const T nextVal = val / base;
 		digits[i++] = digitToChar<base>(val - nextVal * base);
 		val = nextVal;
 	}
@@ -267,9 +506,229 @@ Iterator afc::printNumber(const T value, register Iterator dest)
 	return dest;
 }
 
+template<unsigned char base, typename T, typename Iterator>
+inline Iterator afc::_impl::printUnsigned(const T val, const Iterator dest, std::true_type)
+{
+	// The number of digits is unknown in advance so they are printed to the buffer first.
+	char digits[maxDigitCount<10, T>()];
+	char * const end = digits + sizeof(digits);
+	return std::copy(printDecimalBackward(val, end), end, dest);
+}
+
+template<unsigned char base, typename T>
+inline char *afc::_impl::printUnsigned(const T val, char * const dest, std::true_type)
+{
+	char * const end = dest + decimalDigitCount(val);
+	printDecimalBackward(val, end);
+	return end;
+}
+
+template<unsigned char base, typename T, typename Iterator>
+Iterator afc::_impl::printNumber(const T value, Iterator dest, std::true_type)
+{
+	static_assert(std::is_same<T, double>::value || std::is_same<T, float>::value,
+			"Only float and double are supported.");
+	static_assert(base == 10, "Floating-point numbers are supported in base 10 only.");
+
+	using Traits = FloatTraits<T>;
+	using Bits = typename Traits::Bits;
+	constexpr int mantissaBits = Traits::format().mantissaExplicitBits;
+	constexpr Bits mantissaMask = (Bits(1) << mantissaBits) - 1;
+	constexpr std::int32_t infinitePower = Traits::format().infinitePower;
+
+	Bits bits;
+	std::memcpy(&bits, &value, sizeof(T));
+	const std::uint64_t mantissa = bits & mantissaMask;
+	const std::int32_t biasedExponent = static_cast<std::int32_t>(bits >> mantissaBits) & infinitePower;
+
+	if (unlikely(biasedExponent == infinitePower)) {
+		const char *s;
+		if (mantissa != 0) {
+			s = u8"NaN";
+		} else {
+			s = bits >> (sizeof(Bits) * 8 - 1) ? u8"-Infinity" : u8"Infinity";
+		}
+		for (; *s != '\0'; ++s) {
+			*dest = *s;
+			++dest;
+		}
+		return dest;
+	}
+
+	if (bits >> (sizeof(Bits) * 8 - 1)) {
+		*dest = u8"-"[0];
+		++dest;
+	}
+	if (biasedExponent == 0 && mantissa == 0) {
+		*dest = u8"0"[0];
+		++dest;
+		return dest;
+	}
+
+	const ShortestDecimal decimal = toShortestDecimal(mantissa, biasedExponent, Traits::format());
+
+	char digits[std::numeric_limits<T>::max_digits10];
+	char * const digitsEnd = digits + sizeof(digits);
+	char * const digitsBegin = printDecimalBackward(decimal.digits, digitsEnd);
+	const int digitCount = static_cast<int>(digitsEnd - digitsBegin);
+	// The value is 0.digits * 10^point.
+	const int point = decimal.exponent + digitCount;
+
+	if (digitCount <= point && point <= 21) {
+		dest = std::copy(digitsBegin, digitsEnd, dest);
+		for (int i = digitCount; i < point; ++i) {
+			*dest = u8"0"[0];
+			++dest;
+		}
+	} else if (0 < point && point <= 21) {
+		dest = std::copy(digitsBegin, digitsBegin + point, dest);
+		*dest = u8"."[0];
+		++dest;
+		dest = std::copy(digitsBegin + point, digitsEnd, dest);
+	} else if (-6 < point && point <= 0) {
+		*dest = u8"0"[0];
+		++dest;
+		*dest = u8"."[0];
+		++dest;
+		for (int i = point; i < 0; ++i) {
+			*dest = u8"0"[0];
+			++dest;
+		}
+		dest = std::copy(digitsBegin, digitsEnd, dest);
+	} else {
+		*dest = *digitsBegin;
+		++dest;
+		if (digitCount > 1) {
+			*dest = u8"."[0];
+			++dest;
+			dest = std::copy(digitsBegin + 1, digitsEnd, dest);
+		}
+		*dest = u8"e"[0];
+		++dest;
+		const int exponent = point - 1;
+		if (exponent < 0) {
+			*dest = u8"-"[0];
+			++dest;
+			dest = printNumber<10>(static_cast<unsigned>(-exponent), dest, std::false_type());
+		} else {
+			*dest = u8"+"[0];
+			++dest;
+			dest = printNumber<10>(static_cast<unsigned>(exponent), dest, std::false_type());
+		}
+	}
+	return dest;
+}
+
+template<unsigned char base, afc::ParseMode parseMode, typename T, typename Iterator, typename ErrorHandler>
+inline Iterator afc::parseNumber(const Iterator begin, const Iterator end, T &dest, ErrorHandler errorHandler)
+{
+	return _impl::parseNumber<base, parseMode>(begin, end, dest, errorHandler, std::is_floating_point<T>());
+}
+
+template<unsigned char base, afc::ParseMode parseMode, typename T, typename ErrorHandler>
+inline const char *afc::parseNumber(const char * const input, T &dest, ErrorHandler errorHandler)
+{
+	return _impl::parseNumber<base, parseMode>(input, dest, errorHandler, std::is_floating_point<T>());
+}
+
+template<unsigned char base, afc::ParseMode parseMode, typename T, typename Iterator, typename ErrorHandler>
+inline Iterator afc::_impl::parseNumber(const Iterator begin, const Iterator end, T &dest, ErrorHandler errorHandler,
+		std::false_type)
+{
+	return parseInteger<base, parseMode>(begin, end, dest, errorHandler, std::integral_constant<bool, base == 10 &&
+			(std::is_same<Iterator, const char *>::value || std::is_same<Iterator, char *>::value)>());
+}
+
+template<unsigned char base, afc::ParseMode parseMode, typename T, typename Iterator, typename ErrorHandler>
+Iterator afc::_impl::parseInteger(const Iterator begin, const Iterator end, T &dest, ErrorHandler errorHandler,
+		std::true_type)
+{
+	static_assert(std::is_integral<T>::value, "Integral types are supported only.");
+	static_assert(parseMode == ParseMode::all || parseMode == ParseMode::scan, "Unsupported parsing mode.");
+
+#ifdef AFC_LE
+	typedef typename std::make_unsigned<T>::type UnsignedT;
+
+	/* Numbers up to this many digits cannot overflow std::uint64_t. Longer numbers, as well as
+	 * malformed and out-of-range ones, are passed to the char-by-char parser so that the errors
+	 * reported are exactly the same.
+	 */
+	constexpr std::size_t maxFastDigits = afc::math::min<std::size_t>(maxDigitCount<10, UnsignedT>(), 19);
+	// The magnitude of std::numeric_limits<T>::min() without overflowing T.
+	constexpr std::uint64_t maxNegative = std::is_signed<T>::value ?
+			static_cast<std::uint64_t>(-(std::numeric_limits<T>::min() + 1)) + 1 : 0;
+
+	Iterator p = begin;
+	bool negative = false;
+	if (std::is_signed<T>::value && p != end && *p == u8"-"[0]) {
+		negative = true;
+		++p;
+	}
+
+	const Iterator digitsBegin = p;
+	std::uint64_t value = 0;
+	while (end - p >= 8) {
+		std::uint64_t chunk;
+		std::memcpy(&chunk, p, 8);
+		// Digits become 0..9, the high bit is set for all other chars up to the first non-digit one.
+		chunk ^= 0x3030303030303030;
+		const std::uint64_t nonDigits = ((chunk + 0x7676767676767676) | chunk) & 0x8080808080808080;
+		const unsigned digitCount = nonDigits == 0 ? 8 : __builtin_ctzll(nonDigits) >> 3;
+
+		if (std::size_t(p - digitsBegin) + digitCount > maxFastDigits) {
+			goto generic;
+		}
+		if (digitCount == 0) {
+			goto digitsEnd;
+		}
+
+		// Dropping non-digits; leading zeros are shifted in.
+		chunk <<= 64 - 8 * digitCount;
+		chunk = chunk * 10 + (chunk >> 8);
+		chunk = ((chunk & 0x000000ff000000ff) * (100 + (UINT64_C(1000000) << 32)) +
+				((chunk >> 16) & 0x000000ff000000ff) * (1 + (UINT64_C(10000) << 32))) >> 32;
+		value = value * afc::numdata<>::powersOfTen[digitCount] + static_cast<std::uint32_t>(chunk);
+		p += digitCount;
+		if (digitCount < 8) {
+			goto digitsEnd;
+		}
+	}
+	for (; p != end; ++p) {
+		const unsigned digit = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(*p)];
+		if (digit >= 10) {
+			break;
+		}
+		if (unlikely(std::size_t(p - digitsBegin) == maxFastDigits)) {
+			goto generic;
+		}
+		value = value * 10 + digit;
+	}
+
+digitsEnd:
+	if (unlikely(p == digitsBegin || (parseMode == ParseMode::all && p != end))) {
+		goto generic;
+	}
+	if (negative) {
+		if (unlikely(value > maxNegative)) {
+			goto generic;
+		}
+		dest = value == 0 ? T(0) : static_cast<T>(-static_cast<T>(value - 1) - 1);
+	} else {
+		if (unlikely(value > static_cast<UnsignedT>(std::numeric_limits<T>::max()))) {
+			goto generic;
+		}
+		dest = static_cast<T>(value);
+	}
+	return p;
+
+generic:
+#endif
+	return parseInteger<base, parseMode>(begin, end, dest, errorHandler, std::false_type());
+}
+
 // TODO optimise performance
 template<unsigned char base, afc::ParseMode parseMode, typename T, typename Iterator, typename ErrorHandler>
-Iterator afc::parseNumber(Iterator begin, Iterator end, T &dest, ErrorHandler errorHandler)
+Iterator afc::_impl::parseInteger(Iterator begin, Iterator end, T &dest, ErrorHandler errorHandler, std::false_type)
 {
 	static_assert(std::is_integral<T>::value, "Integral types are supported only.");
 	static_assert(base >= afc::number_limits::MIN_BASE && base <= afc::number_limits::MAX_BASE, "Unsupported base.");
@@ -305,17 +764,18 @@ Iterator afc::parseNumber(Iterator begin, Iterator end, T &dest, ErrorHandler er
 	if (c > 0xff) {
 		goto error;
 	}
-	result = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(c)];
-	if (unlikely(result >= base)) {
+	// T is not used to hold the digit since it can be a signed char which is too narrow.
+	if (unlikely(afc::numdata<>::asciiToDigit[static_cast<unsigned char>(c)] >= base)) {
 		goto error;
 	}
+	result = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(c)];
 
 	while (++p != end) {
 		c = *p;
 		if (c > 0xff) {
 			goto error;
 		}
-		const T digit = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(c)];
+		const unsigned char digit = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(c)];
 		if (unlikely(digit >= base)) {
 			switch (parseMode) {
 			case ParseMode::all: goto error;
@@ -372,7 +832,7 @@ error:
 
 // TODO optimise performance
 template<unsigned char base, afc::ParseMode parseMode, typename T, typename ErrorHandler>
-const char *afc::parseNumber(const char * const input, T &dest, ErrorHandler errorHandler)
+const char *afc::_impl::parseNumber(const char * const input, T &dest, ErrorHandler errorHandler, std::false_type)
 {
 	static_assert(std::is_integral<T>::value, "Integral types are supported only.");
 	static_assert(base >= afc::number_limits::MIN_BASE && base <= afc::number_limits::MAX_BASE, "Unsupported base.");
@@ -412,10 +872,11 @@ const char *afc::parseNumber(const char * const input, T &dest, ErrorHandler err
 	if (c > 0xff) {
 		goto error;
 	}
-	result = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(c)];
-	if (unlikely(result >= base)) {
+	// T is not used to hold the digit since it can be a signed char which is too narrow.
+	if (unlikely(afc::numdata<>::asciiToDigit[static_cast<unsigned char>(c)] >= base)) {
 		goto error;
 	}
+	result = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(c)];
 
 	for (;;) {
 		c = *p;
@@ -427,7 +888,7 @@ const char *afc::parseNumber(const char * const input, T &dest, ErrorHandler err
 		}
 		++p;
 
-		const T digit = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(c)];
+		const unsigned char digit = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(c)];
 		if (unlikely(digit >= base)) {
 			switch (parseMode) {
 			case ParseMode::all: goto error;
@@ -482,6 +943,185 @@ error:
 	return p;
 }
 
+template<unsigned char base, afc::ParseMode parseMode, typename T, typename Iterator, typename ErrorHandler>
+Iterator afc::_impl::parseNumber(const Iterator begin, const Iterator end, T &dest, ErrorHandler errorHandler,
+		std::true_type)
+{
+	static_assert(std::is_same<T, double>::value || std::is_same<T, float>::value,
+			"Only float and double are supported.");
+	static_assert(base == 10, "Floating-point numbers are supported in base 10 only.");
+	static_assert(parseMode == ParseMode::all || parseMode == ParseMode::scan, "Unsupported parsing mode.");
+	static_assert(std::is_base_of<std::forward_iterator_tag,
+			typename std::iterator_traits<Iterator>::iterator_category>::value,
+			"Floating-point numbers can be parsed via forward iterators only.");
+
+	using Traits = FloatTraits<T>;
+	// 10^19 - 1 fits into std::uint64_t.
+	constexpr unsigned maxSignificantDigits = 19;
+
+	bool negative = false;
+	bool hasDigits = false;
+	// Set if non-zero digits beyond maxSignificantDigits are dropped from mantissa.
+	bool truncated = false;
+	std::uint64_t mantissa = 0;
+	unsigned significantDigits = 0;
+	// The decimal exponent that applies to mantissa.
+	std::int64_t exponent = 0;
+	// The exponent as it is specified explicitly in the input.
+	std::int64_t explicitExponent = 0;
+	unsigned digit;
+	Iterator digitsBegin;
+	Iterator digitsEnd;
+	AdjustedMantissa value;
+
+	Iterator p = begin;
+	if (unlikely(p == end)) {
+		goto error;
+	}
+	if (*p == u8"-"[0]) {
+		negative = true;
+		if (unlikely(++p == end)) {
+			goto error;
+		}
+	}
+
+	digitsBegin = p;
+	for (; p != end; ++p) {
+		digit = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(*p)];
+		if (digit >= 10) {
+			break;
+		}
+		hasDigits = true;
+		if (likely(significantDigits < maxSignificantDigits)) {
+			mantissa = mantissa * 10 + digit;
+			significantDigits += mantissa != 0;
+		} else {
+			++exponent;
+			truncated |= digit != 0;
+		}
+	}
+	if (p != end && *p == u8"."[0]) {
+		while (++p != end) {
+			digit = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(*p)];
+			if (digit >= 10) {
+				break;
+			}
+			hasDigits = true;
+			if (likely(significantDigits < maxSignificantDigits)) {
+				mantissa = mantissa * 10 + digit;
+				significantDigits += mantissa != 0;
+				--exponent;
+			} else {
+				truncated |= digit != 0;
+			}
+		}
+	}
+	if (unlikely(!hasDigits)) {
+		goto error;
+	}
+	digitsEnd = p;
+
+	if (p != end && (*p == u8"e"[0] || *p == u8"E"[0])) {
+		const Iterator exponentBegin = p;
+		bool negativeExponent = false;
+		if (++p != end && (*p == u8"-"[0] || *p == u8"+"[0])) {
+			negativeExponent = *p == u8"-"[0];
+			++p;
+		}
+		if (p == end || (digit = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(*p)]) >= 10) {
+			switch (parseMode) {
+			case ParseMode::all: goto error;
+			case ParseMode::scan: p = exponentBegin; goto exponentEnd;
+			}
+		}
+		do {
+			// Large enough to saturate to zero or infinity, small enough not to overflow.
+			if (explicitExponent < 0x10000) {
+				explicitExponent = explicitExponent * 10 + digit;
+			}
+		} while (++p != end && (digit = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(*p)]) < 10);
+		if (negativeExponent) {
+			explicitExponent = -explicitExponent;
+		}
+		exponent += explicitExponent;
+	}
+exponentEnd:
+	if (parseMode == ParseMode::all && p != end) {
+		goto error;
+	}
+
+	if (mantissa == 0) {
+		dest = negative ? -T(0) : T(0);
+		return p;
+	}
+
+	if (FLT_EVAL_METHOD == 0 && !truncated && mantissa <= Traits::maxExactMantissa &&
+			exponent >= -Traits::maxExactPowerOfTen && exponent <= Traits::maxExactPowerOfTen) {
+		// Clinger's fast path: both operands are exact so the single operation is rounded correctly.
+		T result = static_cast<T>(mantissa);
+		if (exponent < 0) {
+			result /= Traits::exactPowerOfTen(static_cast<int>(-exponent));
+		} else {
+			result *= Traits::exactPowerOfTen(static_cast<int>(exponent));
+		}
+		dest = negative ? -result : result;
+		return p;
+	}
+
+	value = computeFloat(exponent, mantissa, Traits::format());
+	if (truncated && !(value == computeFloat(exponent, mantissa + 1, Traits::format()))) {
+		// The dropped digits affect rounding. Falling back to the exact algorithm.
+		Decimal decimal;
+		decimal.digitCount = 0;
+		decimal.truncated = false;
+		std::int64_t decimalPoint = 0;
+		bool fraction = false;
+		for (Iterator q = digitsBegin; q != digitsEnd; ++q) {
+			if (*q == u8"."[0]) {
+				fraction = true;
+				continue;
+			}
+			digit = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(*q)];
+			if (decimal.digitCount == 0 && digit == 0) {
+				// Leading zeros.
+				decimalPoint -= fraction;
+				continue;
+			}
+			decimalPoint += !fraction;
+			if (decimal.digitCount < Decimal::maxDigits) {
+				decimal.digits[decimal.digitCount++] = static_cast<unsigned char>(digit);
+			} else {
+				decimal.truncated |= digit != 0;
+			}
+		}
+		while (decimal.digits[decimal.digitCount - 1] == 0) {
+			--decimal.digitCount;
+		}
+		decimalPoint += explicitExponent;
+		decimal.decimalPoint = static_cast<std::int32_t>(
+				decimalPoint < -0x100000 ? -0x100000 : (decimalPoint > 0x100000 ? 0x100000 : decimalPoint));
+
+		value = computeFloat(decimal, Traits::format());
+	}
+
+	if (unlikely(value.power2 == Traits::format().infinitePower)) {
+		p = begin;
+		goto error;
+	}
+	dest = toFloat<T>(negative, value);
+	return p;
+error:
+	errorHandler(p);
+	return p;
+}
+
+template<unsigned char base, afc::ParseMode parseMode, typename T, typename ErrorHandler>
+inline const char *afc::_impl::parseNumber(const char * const input, T &dest, ErrorHandler errorHandler,
+		std::true_type)
+{
+	return parseNumber<base, parseMode>(input, input + std::strlen(input), dest, errorHandler, std::true_type());
+}
+
 template<typename T>
 const char afc::numdata<T>::digitChars[afc::number_limits::MAX_BASE] =
 			{'0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
@@ -525,6 +1165,28 @@ const char afc::numdata<T>::octetToHexTable[256][2] = {
 		{'f', '8'}, {'f', '9'}, {'f', 'a'}, {'f', 'b'}, {'f', 'c'}, {'f', 'd'}, {'f', 'e'}, {'f', 'f'}
 };
 
+template<typename T>
+const char afc::numdata<T>::digitPairs[200] = {
+		'0', '0', '0', '1', '0', '2', '0', '3', '0', '4', '0', '5', '0', '6', '0', '7', '0', '8', '0', '9',
+		'1', '0', '1', '1', '1', '2', '1', '3', '1', '4', '1', '5', '1', '6', '1', '7', '1', '8', '1', '9',
+		'2', '0', '2', '1', '2', '2', '2', '3', '2', '4', '2', '5', '2', '6', '2', '7', '2', '8', '2', '9',
+		'3', '0', '3', '1', '3', '2', '3', '3', '3', '4', '3', '5', '3', '6', '3', '7', '3', '8', '3', '9',
+		'4', '0', '4', '1', '4', '2', '4', '3', '4', '4', '4', '5', '4', '6', '4', '7', '4', '8', '4', '9',
+		'5', '0', '5', '1', '5', '2', '5', '3', '5', '4', '5', '5', '5', '6', '5', '7', '5', '8', '5', '9',
+		'6', '0', '6', '1', '6', '2', '6', '3', '6', '4', '6', '5', '6', '6', '6', '7', '6', '8', '6', '9',
+		'7', '0', '7', '1', '7', '2', '7', '3', '7', '4', '7', '5', '7', '6', '7', '7', '7', '8', '7', '9',
+		'8', '0', '8', '1', '8', '2', '8', '3', '8', '4', '8', '5', '8', '6', '8', '7', '8', '8', '8', '9',
+		'9', '0', '9', '1', '9', '2', '9', '3', '9', '4', '9', '5', '9', '6', '9', '7', '9', '8', '9', '9'
+};
+
+template<typename T>
+const std::uint64_t afc::numdata<T>::powersOfTen[20] = {
+		UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+		UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000), UINT64_C(1000000000),
+		UINT64_C(10000000000), UINT64_C(100000000000), UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+		UINT64_C(1000000000000000), UINT64_C(10000000000000000), UINT64_C(100000000000000000), UINT64_C(1000000000000000000), UINT64_C(10000000000000000000)
+};
+
 template<typename T>
 const unsigned char afc::numdata<T>::asciiToDigit[256] = {
 		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
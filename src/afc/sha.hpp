@@ -0,0 +1,84 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_SHA_HPP_
+#define AFC_SHA_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace afc
+{
+	struct InputStream;
+
+	/* Incremental SHA-1 (FIPS 180-4).
+	 *
+	 * Data is passed in by update() in chunks of any size. finish() writes the digest
+	 * and resets the context so that it can be used for new data. SHA extensions
+	 * are used on x86 CPUs that support them.
+	 */
+	class Sha1
+	{
+	public:
+		static constexpr std::size_t digestSize = 20;
+		static constexpr std::size_t blockSize = 64;
+
+		Sha1() noexcept { reset(); }
+
+		void reset() noexcept;
+
+		void update(const unsigned char *data, std::size_t n) noexcept;
+		void update(const char * const data, const std::size_t n) noexcept
+		{
+			update(reinterpret_cast<const unsigned char *>(data), n);
+		}
+		// Reads the stream till its end. Memory used does not depend on the size of the stream.
+		void update(InputStream &in);
+
+		// Writes digestSize octets to dest.
+		void finish(unsigned char *dest) noexcept;
+	private:
+		std::uint32_t m_state[5];
+		std::uint64_t m_size;
+		unsigned char m_buf[blockSize];
+	};
+
+	// Incremental SHA-256 (FIPS 180-4). The interface is the same as the one of Sha1.
+	class Sha256
+	{
+	public:
+		static constexpr std::size_t digestSize = 32;
+		static constexpr std::size_t blockSize = 64;
+
+		Sha256() noexcept { reset(); }
+
+		void reset() noexcept;
+
+		void update(const unsigned char *data, std::size_t n) noexcept;
+		void update(const char * const data, const std::size_t n) noexcept
+		{
+			update(reinterpret_cast<const unsigned char *>(data), n);
+		}
+		void update(InputStream &in);
+
+		void finish(unsigned char *dest) noexcept;
+	private:
+		std::uint32_t m_state[8];
+		std::uint64_t m_size;
+		unsigned char m_buf[blockSize];
+	};
+}
+
+#endif /* AFC_SHA_HPP_ */
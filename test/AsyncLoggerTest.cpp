@@ -0,0 +1,281 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "AsyncLoggerTest.hpp"
+#include <afc/AsyncLogger.hpp>
+#include <afc/StringRef.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+// POSIX API.
+#include <unistd.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::AsyncLoggerTest);
+
+using afc::logger::AsyncLogger;
+using afc::logger::OverflowPolicy;
+
+namespace
+{
+	class TempFile
+	{
+	public:
+		TempFile()
+		{
+			char path[] = "/tmp/afc_AsyncLoggerTest_XXXXXX";
+			m_fd = ::mkstemp(path);
+			CPPUNIT_ASSERT(m_fd >= 0);
+			::unlink(path);
+		}
+		TempFile(const TempFile &) = delete;
+		TempFile &operator=(const TempFile &) = delete;
+		~TempFile() { ::close(m_fd); }
+
+		int fd() const noexcept { return m_fd; }
+
+		std::string content() const
+		{
+			std::string result;
+			char buf[4096];
+			::ssize_t n;
+			::off_t offset = 0;
+			while ((n = ::pread(m_fd, buf, sizeof(buf), offset)) > 0) {
+				result.append(buf, std::size_t(n));
+				offset += n;
+			}
+			return result;
+		}
+	private:
+		int m_fd;
+	};
+
+	std::vector<std::string> lines(const std::string &s)
+	{
+		std::vector<std::string> result;
+		std::size_t start = 0;
+		for (std::size_t i = 0; i < s.size(); ++i) {
+			if (s[i] == '\n') {
+				result.emplace_back(s, start, i - start);
+				start = i + 1;
+			}
+		}
+		CPPUNIT_ASSERT_EQUAL(s.size(), start);
+		return result;
+	}
+
+	// Reads everything written to the pipe in a separate thread.
+	class PipeReader
+	{
+	public:
+		explicit PipeReader(const int fd) : m_fd(fd) {}
+		PipeReader(const PipeReader &) = delete;
+		PipeReader &operator=(const PipeReader &) = delete;
+		~PipeReader() { join(); }
+
+		void start()
+		{
+			m_thread = std::thread([this]() {
+				char buf[4096];
+				::ssize_t n;
+				while ((n = ::read(m_fd, buf, sizeof(buf))) > 0) {
+					m_content.append(buf, std::size_t(n));
+				}
+			});
+		}
+
+		void join()
+		{
+			if (m_thread.joinable()) {
+				m_thread.join();
+			}
+		}
+
+		const std::string &content() const noexcept { return m_content; }
+	private:
+		const int m_fd;
+		std::string m_content;
+		std::thread m_thread;
+	};
+
+	/* Fills the ring of the logger given while nobody reads the pipe, so that
+	 * the writer thread is blocked. Returns the number of records accepted.
+	 */
+	std::size_t pushUntilOverflow(AsyncLogger &logger)
+	{
+		const std::string record(100, 'x');
+		std::size_t accepted = 0;
+		while (logger.log(record.c_str())) {
+			++accepted;
+		}
+		return accepted;
+	}
+}
+
+void afc::AsyncLoggerTest::testLog()
+{
+	using afc::operator"" _s;
+
+	TempFile file;
+	{
+		AsyncLogger logger(file.fd());
+		CPPUNIT_ASSERT(logger.log("hello, ", "world"_s, '!'));
+		CPPUNIT_ASSERT(logger.log(123, ' ', -45L, ' ', true, ' ', 0u));
+		CPPUNIT_ASSERT(logger.log());
+		CPPUNIT_ASSERT(logger.push("raw\n", 4));
+		CPPUNIT_ASSERT(logger.logFmt(AFC_FMT("# of \\# #"), 3, "items"));
+	}
+
+	CPPUNIT_ASSERT_EQUAL(std::string("hello, world!\n123 -45 true 0\n\nraw\n3 of # items\n"), file.content());
+}
+
+void afc::AsyncLoggerTest::testFlush()
+{
+	TempFile file;
+	AsyncLogger logger(file.fd());
+
+	CPPUNIT_ASSERT(logger.log("first"));
+	logger.flush();
+	CPPUNIT_ASSERT_EQUAL(std::string("first\n"), file.content());
+
+	CPPUNIT_ASSERT(logger.log("second"));
+	logger.flush();
+	CPPUNIT_ASSERT_EQUAL(std::string("first\nsecond\n"), file.content());
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), logger.droppedCount());
+}
+
+void afc::AsyncLoggerTest::testConcurrentProducers()
+{
+	constexpr unsigned threadCount = 4;
+	constexpr unsigned recordCount = 20000;
+
+	TempFile file;
+	{
+		// A small ring makes producers wrap around and wait for the writer thread.
+		AsyncLogger logger(file.fd(), 4096);
+
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < threadCount; ++t) {
+			threads.emplace_back([&logger, t]() {
+				for (unsigned i = 0; i < recordCount; ++i) {
+					// Records of different sizes occupy different numbers of slots.
+					logger.log("thread ", t, " record ", i, ' ', std::string(i % 150, 'a').c_str());
+				}
+			});
+		}
+		for (std::thread &thread : threads) {
+			thread.join();
+		}
+		CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), logger.droppedCount());
+	}
+
+	const std::vector<std::string> result = lines(file.content());
+	CPPUNIT_ASSERT_EQUAL(std::size_t(threadCount * recordCount), result.size());
+
+	// Records of each thread are written whole and in order.
+	unsigned next[threadCount] = {};
+	for (const std::string &line : result) {
+		unsigned t, i;
+		int prefixSize;
+		CPPUNIT_ASSERT_EQUAL(2, std::sscanf(line.c_str(), "thread %u record %u %n", &t, &i, &prefixSize));
+		CPPUNIT_ASSERT(t < threadCount);
+		CPPUNIT_ASSERT_EQUAL(next[t], i);
+		CPPUNIT_ASSERT_EQUAL(std::string(i % 150, 'a'), line.substr(std::size_t(prefixSize)));
+		++next[t];
+	}
+}
+
+void afc::AsyncLoggerTest::testLargeRecord()
+{
+	TempFile file;
+	const std::string large(10000, 'z');
+	{
+		AsyncLogger logger(file.fd(), 4096);
+		CPPUNIT_ASSERT(logger.log("before"));
+		CPPUNIT_ASSERT(logger.log(large.c_str()));
+		CPPUNIT_ASSERT(logger.log("after"));
+	}
+
+	CPPUNIT_ASSERT_EQUAL("before\n" + large + "\nafter\n", file.content());
+}
+
+void afc::AsyncLoggerTest::testOverflow_Drop()
+{
+	int fds[2];
+	CPPUNIT_ASSERT_EQUAL(0, ::pipe(fds));
+	PipeReader reader(fds[0]);
+	std::size_t accepted;
+	{
+		AsyncLogger logger(fds[1], 4096, OverflowPolicy::drop);
+		accepted = pushUntilOverflow(logger);
+		CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), logger.droppedCount());
+
+		CPPUNIT_ASSERT(!logger.push(std::string(3000, 'y').c_str(), 3000));
+		CPPUNIT_ASSERT_EQUAL(std::uint64_t(2), logger.droppedCount());
+
+		reader.start();
+	}
+	::close(fds[1]);
+	reader.join();
+	::close(fds[0]);
+
+	const std::vector<std::string> result = lines(reader.content());
+	CPPUNIT_ASSERT_EQUAL(accepted, result.size());
+	for (const std::string &line : result) {
+		CPPUNIT_ASSERT_EQUAL(std::string(100, 'x'), line);
+	}
+}
+
+void afc::AsyncLoggerTest::testOverflow_Count()
+{
+	int fds[2];
+	CPPUNIT_ASSERT_EQUAL(0, ::pipe(fds));
+	PipeReader reader(fds[0]);
+	std::size_t accepted;
+	std::uint64_t dropped;
+	{
+		AsyncLogger logger(fds[1], 4096, OverflowPolicy::count);
+		accepted = pushUntilOverflow(logger);
+		reader.start();
+
+		// The number of records dropped is reported along with the records that follow.
+		while (!logger.log("resumed")) {
+			std::this_thread::yield();
+		}
+		dropped = logger.droppedCount();
+	}
+	::close(fds[1]);
+	reader.join();
+	::close(fds[0]);
+
+	const std::vector<std::string> result = lines(reader.content());
+	std::size_t records = 0;
+	std::uint64_t reported = 0;
+	for (const std::string &line : result) {
+		unsigned long long n;
+		if (std::sscanf(line.c_str(), "afc::logger: %llu records dropped", &n) == 1) {
+			reported += n;
+		} else {
+			++records;
+		}
+	}
+	CPPUNIT_ASSERT(dropped > 0);
+	CPPUNIT_ASSERT_EQUAL(dropped, reported);
+	CPPUNIT_ASSERT_EQUAL(accepted + 1, records);
+	CPPUNIT_ASSERT_EQUAL(std::string("resumed"), result.back());
+}
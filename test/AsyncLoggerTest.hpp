@@ -0,0 +1,44 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_ASYNCLOGGERTEST_HPP_
+#define AFC_ASYNCLOGGERTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class AsyncLoggerTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(AsyncLoggerTest);
+		CPPUNIT_TEST(testLog);
+		CPPUNIT_TEST(testFlush);
+		CPPUNIT_TEST(testConcurrentProducers);
+		CPPUNIT_TEST(testLargeRecord);
+		CPPUNIT_TEST(testOverflow_Drop);
+		CPPUNIT_TEST(testOverflow_Count);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testLog();
+		void testFlush();
+		void testConcurrentProducers();
+		void testLargeRecord();
+		void testOverflow_Drop();
+		void testOverflow_Count();
+	};
+}
+
+#endif /* AFC_ASYNCLOGGERTEST_HPP_ */
@@ -15,6 +15,10 @@ You should have received a copy of the GNU Lesser General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "Base64Test.hpp"
 #include <afc/base64.hpp>
+#include <afc/math_utils.h>
+#include <afc/stream.h>
+#include <cstddef>
+#include <list>
 #include <string>
 #include <iterator>
 
@@ -22,6 +26,71 @@ using namespace std;
 
 CPPUNIT_TEST_SUITE_REGISTRATION(afc::Base64Test);
 
+namespace
+{
+	const std::size_t noError = std::size_t(-1);
+
+	// Decodes input as a contiguous char sequence; errorPosition is set to noError if there is no error.
+	template<afc::Base64DecodeMode mode, afc::Base64Alphabet alphabet = afc::Base64Alphabet::standard>
+	string decode(const string &input, std::size_t &errorPosition)
+	{
+		string result(afc::maxBase64DecodedSize(input.size()), 0);
+		errorPosition = noError;
+		char * const end = afc::decodeBase64<mode, alphabet>(input.data(), input.data() + input.size(), &result[0],
+				[&](const char * const p) { errorPosition = p - input.data(); });
+		result.resize(end - result.data());
+		return result;
+	}
+
+	// Decodes input as a char sequence that is not contiguous.
+	template<afc::Base64DecodeMode mode, afc::Base64Alphabet alphabet = afc::Base64Alphabet::standard>
+	string decodeList(const string &input, std::size_t &errorPosition)
+	{
+		const list<char> in(input.begin(), input.end());
+		string result;
+		errorPosition = noError;
+		afc::decodeBase64<mode, alphabet>(in.begin(), in.end(), back_inserter(result),
+				[&](const list<char>::const_iterator p) { errorPosition = std::distance(in.begin(), p); });
+		return result;
+	}
+
+	struct StringAppender
+	{
+		string &dest;
+
+		void operator()(const char * const data, const std::size_t n) { dest.append(data, n); }
+		void operator()(const unsigned char * const data, const std::size_t n)
+		{
+			dest.append(reinterpret_cast<const char *>(data), n);
+		}
+	};
+
+	class StringOutputStream : public afc::OutputStream
+	{
+	public:
+		virtual void write(const unsigned char * const data, const std::size_t n)
+		{
+			m_data.append(reinterpret_cast<const char *>(data), n);
+		}
+
+		const string &data() const { return m_data; }
+	private:
+		string m_data;
+	};
+
+	// Chunk sizes that cover splits inside quads, triplets and the buffers of the encoder and decoder.
+	const std::size_t chunkSizes[] = {1, 2, 3, 4, 5, 7, 16, 31, 100, 4095, 5000};
+
+	string testData(const std::size_t n)
+	{
+		string data(n, 0);
+		for (std::size_t i = 0; i < n; ++i) {
+			data[i] = static_cast<char>(i * 97 + (i >> 4));
+		}
+		return data;
+	}
+}
+
 void afc::Base64Test::testEncodeBase64String_EmptyString()
 {
 	string result;
@@ -115,3 +184,391 @@ void afc::Base64Test::testBase64Size_UnsignedLong()
 	CPPUNIT_ASSERT_EQUAL(8ul, afc::base64Size(5ul));
 	CPPUNIT_ASSERT_EQUAL(16ul, afc::base64Size(10ul));
 }
+
+void afc::Base64Test::testEncodeBase64_UrlSafe()
+{
+	string result;
+	encodeBase64<Base64Alphabet::urlSafe>("\xfb\xff\xbf", 3, back_inserter(result));
+	CPPUNIT_ASSERT_EQUAL(string("-_-_"), result);
+
+	result.clear();
+	encodeBase64("\xfb\xff\xbf", 3, back_inserter(result));
+	CPPUNIT_ASSERT_EQUAL(string("+/+/"), result);
+
+	result.clear();
+	encodeBase64<Base64Alphabet::urlSafe>("\xfb\xf0", 2, back_inserter(result));
+	CPPUNIT_ASSERT_EQUAL(string("-_A="), result);
+}
+
+void afc::Base64Test::testEncodeBase64_LongData()
+{
+	const string data = testData(300);
+	const list<char> dataList(data.begin(), data.end());
+
+	for (std::size_t n = 0; n <= data.size(); ++n) {
+		string expected;
+		encodeBase64(dataList.begin(), n, back_inserter(expected));
+		string result(base64Size(n), 0);
+		CPPUNIT_ASSERT_EQUAL(&result[0] + result.size(), encodeBase64(data.data(), n, &result[0]));
+		CPPUNIT_ASSERT_EQUAL(expected, result);
+
+		string expectedUrlSafe;
+		encodeBase64<Base64Alphabet::urlSafe>(dataList.begin(), n, back_inserter(expectedUrlSafe));
+		string resultUrlSafe(base64Size(n), 0);
+		encodeBase64<Base64Alphabet::urlSafe>(reinterpret_cast<const unsigned char *>(data.data()), n,
+				&resultUrlSafe[0]);
+		CPPUNIT_ASSERT_EQUAL(expectedUrlSafe, resultUrlSafe);
+	}
+}
+
+void afc::Base64Test::testDecodeBase64_Strict()
+{
+	std::size_t errorPosition;
+
+	CPPUNIT_ASSERT_EQUAL(string(), decode<Base64DecodeMode::strict>("", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+	CPPUNIT_ASSERT_EQUAL(string("M"), decode<Base64DecodeMode::strict>("TQ==", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+	CPPUNIT_ASSERT_EQUAL(string("Ma"), decode<Base64DecodeMode::strict>("TWE=", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+	CPPUNIT_ASSERT_EQUAL(string("Man"), decode<Base64DecodeMode::strict>("TWFu", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+	CPPUNIT_ASSERT_EQUAL(string("TripleMa"), decode<Base64DecodeMode::strict>("VHJpcGxlTWE=", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+	CPPUNIT_ASSERT_EQUAL(string("\xfb\xff\xbf"), decode<Base64DecodeMode::strict>("+/+/", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+
+	CPPUNIT_ASSERT_EQUAL(string("TripleM"), decodeList<Base64DecodeMode::strict>("VHJpcGxlTQ==", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+}
+
+void afc::Base64Test::testDecodeBase64_StrictMalformed()
+{
+	std::size_t errorPosition;
+
+	// Missing or incomplete padding.
+	CPPUNIT_ASSERT_EQUAL(string("Man"), decode<Base64DecodeMode::strict>("TWFuTQ", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(6), errorPosition);
+	decode<Base64DecodeMode::strict>("TQ=", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(3), errorPosition);
+	decode<Base64DecodeMode::strict>("T===", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(1), errorPosition);
+	decode<Base64DecodeMode::strict>("====", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(0), errorPosition);
+
+	// Too much padding or data after padding.
+	decode<Base64DecodeMode::strict>("TWE==", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(4), errorPosition);
+	decode<Base64DecodeMode::strict>("TQ==TQ==", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(4), errorPosition);
+
+	// Non-zero bits that are not a part of the octets encoded.
+	decode<Base64DecodeMode::strict>("TR==", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2), errorPosition);
+	decode<Base64DecodeMode::strict>("TWF=", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(3), errorPosition);
+
+	// Characters not from the alphabet.
+	CPPUNIT_ASSERT_EQUAL(string("Man"), decode<Base64DecodeMode::strict>("TWFu TWFu", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(4), errorPosition);
+	decode<Base64DecodeMode::strict>("TW-u", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2), errorPosition);
+	decode<Base64DecodeMode::strict>("TWF\x80", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(3), errorPosition);
+
+	decodeList<Base64DecodeMode::strict>("TWFuT!==", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(5), errorPosition);
+}
+
+void afc::Base64Test::testDecodeBase64_Lenient()
+{
+	std::size_t errorPosition;
+
+	CPPUNIT_ASSERT_EQUAL(string("M"), decode<Base64DecodeMode::lenient>("TQ", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+	CPPUNIT_ASSERT_EQUAL(string("M"), decode<Base64DecodeMode::lenient>("TQ=", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+	CPPUNIT_ASSERT_EQUAL(string("Ma"), decode<Base64DecodeMode::lenient>("TWE", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+	CPPUNIT_ASSERT_EQUAL(string("ManMa"), decode<Base64DecodeMode::lenient>(" TW\tFu\r\nTW E = \n", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+	CPPUNIT_ASSERT_EQUAL(string(), decode<Base64DecodeMode::lenient>(" \r\n", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+	// Non-zero unused bits are ignored.
+	CPPUNIT_ASSERT_EQUAL(string("M"), decode<Base64DecodeMode::lenient>("TR==", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+
+	CPPUNIT_ASSERT_EQUAL(string("ManMa"), decodeList<Base64DecodeMode::lenient>("TWFu\nTWE", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+}
+
+void afc::Base64Test::testDecodeBase64_LenientMalformed()
+{
+	std::size_t errorPosition;
+
+	// A single dangling digit.
+	CPPUNIT_ASSERT_EQUAL(string("Man"), decode<Base64DecodeMode::lenient>("TWFuT", errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(5), errorPosition);
+	decode<Base64DecodeMode::lenient>("TWFuT=", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(5), errorPosition);
+
+	decode<Base64DecodeMode::lenient>("TQ===", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(4), errorPosition);
+	decode<Base64DecodeMode::lenient>("TQ= TQ", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(4), errorPosition);
+	decode<Base64DecodeMode::lenient>("TW.u", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2), errorPosition);
+}
+
+void afc::Base64Test::testDecodeBase64_UrlSafe()
+{
+	std::size_t errorPosition;
+
+	CPPUNIT_ASSERT_EQUAL(string("\xfb\xff\xbf"),
+			(decode<Base64DecodeMode::strict, Base64Alphabet::urlSafe>("-_-_", errorPosition)));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+	CPPUNIT_ASSERT_EQUAL(string("\xfb\xf0"),
+			(decode<Base64DecodeMode::lenient, Base64Alphabet::urlSafe>("-_A", errorPosition)));
+	CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+
+	decode<Base64DecodeMode::strict, Base64Alphabet::urlSafe>("-_+_", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2), errorPosition);
+	decode<Base64DecodeMode::strict>("-_-_", errorPosition);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(0), errorPosition);
+}
+
+void afc::Base64Test::testDecodeBase64_LongData()
+{
+	const string data = testData(300);
+
+	for (std::size_t n = 0; n <= data.size(); ++n) {
+		std::size_t errorPosition;
+
+		string encoded;
+		encodeBase64(data.data(), n, back_inserter(encoded));
+		CPPUNIT_ASSERT_EQUAL(data.substr(0, n), decode<Base64DecodeMode::strict>(encoded, errorPosition));
+		CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+
+		string urlSafeEncoded;
+		encodeBase64<Base64Alphabet::urlSafe>(data.data(), n, back_inserter(urlSafeEncoded));
+		CPPUNIT_ASSERT_EQUAL(data.substr(0, n),
+				(decode<Base64DecodeMode::strict, Base64Alphabet::urlSafe>(urlSafeEncoded, errorPosition)));
+		CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+
+		// MIME-like lines of 76 characters without padding.
+		string lines;
+		for (std::size_t i = 0; i < encoded.size(); i += 76) {
+			lines += encoded.substr(i, 76);
+			lines += "\r\n";
+		}
+		while (lines.find('=') != string::npos) {
+			lines.erase(lines.find('='), 1);
+		}
+		CPPUNIT_ASSERT_EQUAL(data.substr(0, n), decode<Base64DecodeMode::lenient>(lines, errorPosition));
+		CPPUNIT_ASSERT_EQUAL(noError, errorPosition);
+	}
+}
+
+void afc::Base64Test::testDecodeBase64_LongDataMalformed()
+{
+	const string data = testData(150);
+	string encoded;
+	encodeBase64(data.data(), data.size(), back_inserter(encoded));
+
+	for (std::size_t i = 0; i < encoded.size(); ++i) {
+		for (const char c : {'*', '=', ' ', '-', '\0', '\xff'}) {
+			string malformed = encoded;
+			malformed[i] = c;
+
+			std::size_t errorPosition, expectedErrorPosition;
+			const string result = decode<Base64DecodeMode::strict>(malformed, errorPosition);
+			const string expected = decodeList<Base64DecodeMode::strict>(malformed, expectedErrorPosition);
+			// Padding after 2 or 3 digits is valid if the unused bits are zero; the digit after it is not.
+			const bool validPadding = c == '=' && i % 4 >= 2 && errorPosition == i + 1;
+			CPPUNIT_ASSERT(validPadding || errorPosition == i);
+			CPPUNIT_ASSERT_EQUAL(expectedErrorPosition, errorPosition);
+			CPPUNIT_ASSERT_EQUAL(expected, result);
+			CPPUNIT_ASSERT_EQUAL(data.substr(0, i / 4 * 3), result);
+		}
+	}
+}
+
+void afc::Base64Test::testMaxBase64DecodedSize()
+{
+	CPPUNIT_ASSERT_EQUAL(0u, afc::maxBase64DecodedSize(0u));
+	CPPUNIT_ASSERT_EQUAL(0u, afc::maxBase64DecodedSize(1u));
+	CPPUNIT_ASSERT_EQUAL(1u, afc::maxBase64DecodedSize(2u));
+	CPPUNIT_ASSERT_EQUAL(2u, afc::maxBase64DecodedSize(3u));
+	CPPUNIT_ASSERT_EQUAL(3u, afc::maxBase64DecodedSize(4u));
+	CPPUNIT_ASSERT_EQUAL(6ul, afc::maxBase64DecodedSize(8ul));
+	CPPUNIT_ASSERT_EQUAL(7ul, afc::maxBase64DecodedSize(10ul));
+}
+
+void afc::Base64Test::testBase64Encoder_Chunks()
+{
+	const string data = testData(20000);
+
+	for (const std::size_t size : {std::size_t(0), std::size_t(1), std::size_t(2), std::size_t(3), std::size_t(100),
+			data.size()}) {
+		string expected;
+		encodeBase64(data.data(), size, back_inserter(expected));
+
+		for (const std::size_t chunkSize : chunkSizes) {
+			string result;
+			Base64Encoder<StringAppender> encoder(StringAppender{result});
+			for (std::size_t i = 0; i < size; i += chunkSize) {
+				encoder.write(data.data() + i, afc::math::min(chunkSize, size - i));
+			}
+			encoder.finish();
+			CPPUNIT_ASSERT_EQUAL(expected, result);
+		}
+	}
+
+	// The encoder is reusable after finish().
+	string result;
+	Base64Encoder<StringAppender, Base64Alphabet::urlSafe> encoder(StringAppender{result});
+	encoder.write("\xfb\xff", 2);
+	encoder.finish();
+	encoder.write("M", 1);
+	encoder.finish();
+	CPPUNIT_ASSERT_EQUAL(string("-_8=TQ=="), result);
+}
+
+void afc::Base64Test::testBase64Encoder_OutputStream()
+{
+	StringOutputStream out;
+	Base64Encoder<OutputStreamSink> encoder{OutputStreamSink(out)};
+	encoder.write("Tri", 3);
+	encoder.write("pleM", 4);
+	encoder.write("a", 1);
+	encoder.finish();
+
+	CPPUNIT_ASSERT_EQUAL(string("VHJpcGxlTWE="), out.data());
+}
+
+void afc::Base64Test::testBase64Decoder_Chunks()
+{
+	const string data = testData(20000);
+
+	for (const std::size_t size : {std::size_t(0), std::size_t(1), std::size_t(2), std::size_t(3), std::size_t(100),
+			data.size()}) {
+		string encoded;
+		encodeBase64(data.data(), size, back_inserter(encoded));
+
+		for (const std::size_t chunkSize : chunkSizes) {
+			string result;
+			Base64Decoder<StringAppender> decoder(StringAppender{result});
+			for (std::size_t i = 0; i < encoded.size(); i += chunkSize) {
+				CPPUNIT_ASSERT(decoder.write(encoded.data() + i, afc::math::min(chunkSize, encoded.size() - i)));
+			}
+			CPPUNIT_ASSERT(decoder.finish());
+			CPPUNIT_ASSERT_EQUAL(data.substr(0, size), result);
+		}
+	}
+}
+
+void afc::Base64Test::testBase64Decoder_Lenient()
+{
+	const string data = testData(1000);
+	string encoded;
+	encodeBase64<Base64Alphabet::urlSafe>(data.data(), data.size(), back_inserter(encoded));
+
+	string lines;
+	for (std::size_t i = 0; i < encoded.size(); i += 76) {
+		lines += encoded.substr(i, 76);
+		lines += "\r\n";
+	}
+	lines.erase(lines.find('='));
+
+	for (const std::size_t chunkSize : chunkSizes) {
+		string result;
+		Base64Decoder<StringAppender, Base64DecodeMode::lenient, Base64Alphabet::urlSafe> decoder(
+				StringAppender{result});
+		for (std::size_t i = 0; i < lines.size(); i += chunkSize) {
+			CPPUNIT_ASSERT(decoder.write(lines.data() + i, afc::math::min(chunkSize, lines.size() - i)));
+		}
+		CPPUNIT_ASSERT(decoder.finish());
+		CPPUNIT_ASSERT_EQUAL(data, result);
+	}
+
+	// Padding split between chunks, followed by spaces.
+	string result;
+	Base64Decoder<StringAppender, Base64DecodeMode::lenient> decoder(StringAppender{result});
+	CPPUNIT_ASSERT(decoder.write("TQ", 2));
+	CPPUNIT_ASSERT(decoder.write("=", 1));
+	CPPUNIT_ASSERT(decoder.write(" =\n", 3));
+	CPPUNIT_ASSERT(decoder.finish());
+	CPPUNIT_ASSERT_EQUAL(string("M"), result);
+}
+
+void afc::Base64Test::testBase64Decoder_Malformed()
+{
+	{
+		string result;
+		Base64Decoder<StringAppender> decoder(StringAppender{result});
+		CPPUNIT_ASSERT(decoder.write("TWFu", 4));
+		CPPUNIT_ASSERT(decoder.write("TW", 2));
+		CPPUNIT_ASSERT(!decoder.write("F*", 2));
+		CPPUNIT_ASSERT_EQUAL(std::size_t(7), decoder.errorOffset());
+		CPPUNIT_ASSERT_EQUAL(string("Man"), result);
+		// The decoder stays failed.
+		CPPUNIT_ASSERT(!decoder.write("TWFu", 4));
+		CPPUNIT_ASSERT(!decoder.finish());
+		CPPUNIT_ASSERT_EQUAL(std::size_t(7), decoder.errorOffset());
+	}
+
+	{
+		// Incomplete padding.
+		string result;
+		Base64Decoder<StringAppender> decoder(StringAppender{result});
+		CPPUNIT_ASSERT(decoder.write("TWFuTQ", 6));
+		CPPUNIT_ASSERT(decoder.write("=", 1));
+		CPPUNIT_ASSERT(!decoder.finish());
+		CPPUNIT_ASSERT_EQUAL(std::size_t(7), decoder.errorOffset());
+		CPPUNIT_ASSERT_EQUAL(string("Man"), result);
+	}
+
+	{
+		// Data after padding.
+		string result;
+		Base64Decoder<StringAppender> decoder(StringAppender{result});
+		CPPUNIT_ASSERT(decoder.write("TQ=", 3));
+		CPPUNIT_ASSERT(!decoder.write("=TQ==", 5));
+		CPPUNIT_ASSERT_EQUAL(std::size_t(4), decoder.errorOffset());
+	}
+
+	{
+		// A dangling digit is an error in the lenient mode as well.
+		string result;
+		Base64Decoder<StringAppender, Base64DecodeMode::lenient> decoder(StringAppender{result});
+		CPPUNIT_ASSERT(decoder.write("TWFuT", 5));
+		CPPUNIT_ASSERT(!decoder.finish());
+		CPPUNIT_ASSERT_EQUAL(std::size_t(5), decoder.errorOffset());
+	}
+
+	{
+		// An error far from the beginning is reported with the offset in the whole data.
+		const string data = testData(10000);
+		string encoded;
+		encodeBase64(data.data(), data.size(), back_inserter(encoded));
+		encoded[9001] = '.';
+
+		string result;
+		Base64Decoder<StringAppender> decoder(StringAppender{result});
+		CPPUNIT_ASSERT(decoder.write(encoded.data(), 5000));
+		CPPUNIT_ASSERT(!decoder.write(encoded.data() + 5000, encoded.size() - 5000));
+		CPPUNIT_ASSERT_EQUAL(std::size_t(9001), decoder.errorOffset());
+		CPPUNIT_ASSERT_EQUAL(data.substr(0, 9000 / 4 * 3), result);
+	}
+}
+
+void afc::Base64Test::testBase64Decoder_OutputStream()
+{
+	StringOutputStream out;
+	Base64Decoder<OutputStreamSink> decoder{OutputStreamSink(out)};
+	CPPUNIT_ASSERT(decoder.write("VHJpc", 5));
+	CPPUNIT_ASSERT(decoder.write("GxlTWE=", 7));
+	CPPUNIT_ASSERT(decoder.finish());
+
+	CPPUNIT_ASSERT_EQUAL(string("TripleMa"), out.data());
+}
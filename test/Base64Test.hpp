@@ -36,6 +36,22 @@ namespace afc
 		CPPUNIT_TEST(testEncodeBase64String_TwoTripletsAndTwoOctets);
 		CPPUNIT_TEST(testBase64Size_Unsigned);
 		CPPUNIT_TEST(testBase64Size_UnsignedLong);
+		CPPUNIT_TEST(testEncodeBase64_UrlSafe);
+		CPPUNIT_TEST(testEncodeBase64_LongData);
+		CPPUNIT_TEST(testDecodeBase64_Strict);
+		CPPUNIT_TEST(testDecodeBase64_StrictMalformed);
+		CPPUNIT_TEST(testDecodeBase64_Lenient);
+		CPPUNIT_TEST(testDecodeBase64_LenientMalformed);
+		CPPUNIT_TEST(testDecodeBase64_UrlSafe);
+		CPPUNIT_TEST(testDecodeBase64_LongData);
+		CPPUNIT_TEST(testDecodeBase64_LongDataMalformed);
+		CPPUNIT_TEST(testMaxBase64DecodedSize);
+		CPPUNIT_TEST(testBase64Encoder_Chunks);
+		CPPUNIT_TEST(testBase64Encoder_OutputStream);
+		CPPUNIT_TEST(testBase64Decoder_Chunks);
+		CPPUNIT_TEST(testBase64Decoder_Lenient);
+		CPPUNIT_TEST(testBase64Decoder_Malformed);
+		CPPUNIT_TEST(testBase64Decoder_OutputStream);
 		CPPUNIT_TEST_SUITE_END();
 	public:
 		void testEncodeBase64String_EmptyString();
@@ -49,6 +65,22 @@ namespace afc
 		void testEncodeBase64String_TwoTripletsAndTwoOctets();
 		void testBase64Size_Unsigned();
 		void testBase64Size_UnsignedLong();
+		void testEncodeBase64_UrlSafe();
+		void testEncodeBase64_LongData();
+		void testDecodeBase64_Strict();
+		void testDecodeBase64_StrictMalformed();
+		void testDecodeBase64_Lenient();
+		void testDecodeBase64_LenientMalformed();
+		void testDecodeBase64_UrlSafe();
+		void testDecodeBase64_LongData();
+		void testDecodeBase64_LongDataMalformed();
+		void testMaxBase64DecodedSize();
+		void testBase64Encoder_Chunks();
+		void testBase64Encoder_OutputStream();
+		void testBase64Decoder_Chunks();
+		void testBase64Decoder_Lenient();
+		void testBase64Decoder_Malformed();
+		void testBase64Decoder_OutputStream();
 	};
 }
 
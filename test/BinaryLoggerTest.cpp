@@ -0,0 +1,345 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "BinaryLoggerTest.hpp"
+#include <afc/BinaryLogger.hpp>
+#include <afc/StringRef.hpp>
+#include <afc/stream.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+// POSIX API.
+#include <unistd.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::BinaryLoggerTest);
+
+using afc::logger::AsyncLogger;
+using afc::logger::BinaryLogger;
+using afc::logger::OverflowPolicy;
+
+namespace
+{
+	// The size of the timestamp prepended to each decoded record: "YYYY-MM-DDTHH:MM:SS.nnnnnnnnnZ ".
+	constexpr std::size_t timestampSize = 31;
+
+	class MemoryInputStream : public afc::InputStream
+	{
+	public:
+		explicit MemoryInputStream(const std::string &data) : m_data(data), m_pos(0) {}
+
+		virtual std::size_t read(unsigned char * const data, const std::size_t n)
+		{
+			const std::size_t count = std::min(n, m_data.size() - m_pos);
+			std::memcpy(data, m_data.data() + m_pos, count);
+			m_pos += count;
+			return count;
+		}
+
+		virtual void reset() { m_pos = 0; }
+
+		virtual std::size_t skip(const std::size_t n)
+		{
+			const std::size_t count = std::min(n, m_data.size() - m_pos);
+			m_pos += count;
+			return count;
+		}
+
+		virtual void close() {}
+	private:
+		const std::string m_data;
+		std::size_t m_pos;
+	};
+
+	std::string readAll(std::FILE * const file)
+	{
+		std::fflush(file);
+		std::rewind(file);
+		std::string result;
+		char buf[4096];
+		std::size_t n;
+		while ((n = std::fread(buf, 1, sizeof(buf), file)) > 0) {
+			result.append(buf, n);
+		}
+		return result;
+	}
+
+	// Decodes the log given, returning the text or "<error>" with the text decoded before the error.
+	std::string decode(const std::string &binaryLog)
+	{
+		MemoryInputStream in(binaryLog);
+		std::FILE * const out = std::tmpfile();
+		CPPUNIT_ASSERT(out != nullptr);
+		const bool success = afc::logger::decodeBinaryLog(in, out);
+		std::string result = readAll(out);
+		std::fclose(out);
+		return success ? result : result + "<error>";
+	}
+
+	// Removes the timestamps that start the lines.
+	std::string stripTimestamps(const std::string &s)
+	{
+		std::string result;
+		std::size_t start = 0;
+		while (start < s.size()) {
+			const std::size_t end = s.find('\n', start);
+			CPPUNIT_ASSERT(end != std::string::npos);
+			CPPUNIT_ASSERT(end - start >= timestampSize);
+			result.append(s, start + timestampSize, end + 1 - start - timestampSize);
+			start = end + 1;
+		}
+		return result;
+	}
+
+	void logRecords(BinaryLogger &logger)
+	{
+		using afc::operator"" _s;
+
+		const unsigned char octets[] = {0x00, 0x7f, 0xff};
+		const std::string s = "std::string";
+		char mutableText[] = "mutable";
+		char * const mutableString = mutableText;
+
+		CPPUNIT_ASSERT(logger.log(AFC_FMT("plain text")));
+		CPPUNIT_ASSERT(logger.log(AFC_FMT("ints: # # # # # #"), std::int8_t(-8), std::uint16_t(65535),
+				std::numeric_limits<int>::min(), 4000000000u, std::numeric_limits<long long>::min(),
+				std::numeric_limits<unsigned long long>::max()));
+		CPPUNIT_ASSERT(logger.log(AFC_FMT("misc: # # # # \\#"), true, 'c', 1.5, 0.25f));
+		CPPUNIT_ASSERT(logger.log(AFC_FMT("strings: # # # #"), "literal", "ref"_s, s.c_str(), mutableString));
+		CPPUNIT_ASSERT(logger.log(AFC_FMT("hex: #, text fallback: #"), afc::logger::HexEncodedN<3>(octets), 2.5L));
+		// The same site again.
+		CPPUNIT_ASSERT(logger.log(AFC_FMT("plain text")));
+	}
+
+	// Appends a number in the byte order opposite to the host one.
+	template<typename T>
+	void appendSwapped(std::string &dest, const T value)
+	{
+		char buf[sizeof(T)];
+		std::memcpy(buf, &value, sizeof(T));
+		std::reverse(buf, buf + sizeof(T));
+		dest.append(buf, sizeof(T));
+	}
+
+	const char * const expectedRecords =
+			"plain text\n"
+			"ints: -8 65535 -2147483648 4000000000 -9223372036854775808 18446744073709551615\n"
+			"misc: true c 1.5 0.25 #\n"
+			"strings: literal ref std::string mutable\n"
+			"hex: 007fff, text fallback: 2.5\n"
+			"plain text\n";
+}
+
+void afc::BinaryLoggerTest::testLogAndDecode()
+{
+	std::FILE * const file = std::tmpfile();
+	CPPUNIT_ASSERT(file != nullptr);
+	{
+		BinaryLogger logger(file);
+		logRecords(logger);
+	}
+	const std::string binaryLog = readAll(file);
+	std::fclose(file);
+
+	CPPUNIT_ASSERT_EQUAL(std::string(expectedRecords), stripTimestamps(decode(binaryLog)));
+}
+
+void afc::BinaryLoggerTest::testLogAndDecode_AsyncLogger()
+{
+	std::FILE * const file = std::tmpfile();
+	CPPUNIT_ASSERT(file != nullptr);
+	{
+		AsyncLogger asyncLogger(::fileno(file));
+		BinaryLogger logger(asyncLogger);
+		logRecords(logger);
+	}
+	const std::string binaryLog = readAll(file);
+	std::fclose(file);
+
+	CPPUNIT_ASSERT_EQUAL(std::string(expectedRecords), stripTimestamps(decode(binaryLog)));
+}
+
+void afc::BinaryLoggerTest::testLogAndDecode_AsyncLoggerOverflow()
+{
+	int fds[2];
+	CPPUNIT_ASSERT_EQUAL(0, ::pipe(fds));
+	std::string binaryLog;
+	std::thread reader;
+	std::size_t accepted = 0;
+	std::uint64_t dropped;
+	{
+		AsyncLogger asyncLogger(fds[1], 4096, OverflowPolicy::count);
+		BinaryLogger logger(asyncLogger);
+		// Nobody reads the pipe, so the writer thread blocks and the ring overflows.
+		const std::string s(100, 'x');
+		while (logger.log(AFC_FMT("record #"), s.c_str())) {
+			++accepted;
+		}
+
+		reader = std::thread([&binaryLog, &fds]() {
+			char buf[4096];
+			::ssize_t n;
+			while ((n = ::read(fds[0], buf, sizeof(buf))) > 0) {
+				binaryLog.append(buf, std::size_t(n));
+			}
+		});
+		// The number of records dropped is reported along with the records that follow.
+		while (!logger.log(AFC_FMT("resumed"))) {
+			std::this_thread::yield();
+		}
+		dropped = asyncLogger.droppedCount();
+	}
+	::close(fds[1]);
+	reader.join();
+	::close(fds[0]);
+
+	const std::string text = stripTimestamps(decode(binaryLog));
+	std::size_t records = 0;
+	std::uint64_t reported = 0;
+	std::size_t start = 0;
+	while (start < text.size()) {
+		const std::size_t end = text.find('\n', start);
+		CPPUNIT_ASSERT(end != std::string::npos);
+		const std::string line = text.substr(start, end - start);
+		unsigned long long n;
+		if (std::sscanf(line.c_str(), "afc::logger: %llu records dropped", &n) == 1) {
+			reported += n;
+		} else {
+			CPPUNIT_ASSERT(line == "record " + std::string(100, 'x') || line == "resumed");
+			++records;
+		}
+		start = end + 1;
+	}
+	CPPUNIT_ASSERT(dropped > 0);
+	CPPUNIT_ASSERT_EQUAL(dropped, reported);
+	CPPUNIT_ASSERT_EQUAL(accepted + 1, records);
+}
+
+void afc::BinaryLoggerTest::testTimestamp()
+{
+	std::FILE * const file = std::tmpfile();
+	CPPUNIT_ASSERT(file != nullptr);
+	// std::time() may read a coarse clock that lags behind CLOCK_REALTIME the logger uses.
+	::timespec before, after;
+	CPPUNIT_ASSERT_EQUAL(0, ::clock_gettime(CLOCK_REALTIME, &before));
+	{
+		BinaryLogger logger(file);
+		CPPUNIT_ASSERT(logger.log(AFC_FMT("#"), 1));
+	}
+	CPPUNIT_ASSERT_EQUAL(0, ::clock_gettime(CLOCK_REALTIME, &after));
+	const std::string text = decode(readAll(file));
+	std::fclose(file);
+
+	CPPUNIT_ASSERT_EQUAL(timestampSize + 2, text.size());
+	std::tm dateTime = {};
+	unsigned nanos;
+	CPPUNIT_ASSERT_EQUAL(7, std::sscanf(text.c_str(), "%4d-%2d-%2dT%2d:%2d:%2d.%9uZ", &dateTime.tm_year,
+			&dateTime.tm_mon, &dateTime.tm_mday, &dateTime.tm_hour, &dateTime.tm_min, &dateTime.tm_sec, &nanos));
+	dateTime.tm_year -= 1900;
+	dateTime.tm_mon -= 1;
+	const std::time_t logged = ::timegm(&dateTime);
+	CPPUNIT_ASSERT(before.tv_sec <= logged && logged <= after.tv_sec);
+}
+
+void afc::BinaryLoggerTest::testDecode_ForeignByteOrder()
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	const char byteOrder = 'B';
+#else
+	const char byteOrder = 'L';
+#endif
+	// 2017-07-14T02:40:00.123456789Z
+	const std::uint64_t timestamp = 1500000000123456789ULL;
+	const std::string format = "# # # # #";
+
+	std::string binaryLog("AFCBLOG\x01", 8);
+	binaryLog += byteOrder;
+
+	binaryLog += char(1);
+	appendSwapped(binaryLog, std::uint32_t(0));
+	appendSwapped(binaryLog, std::uint32_t(format.size()));
+	binaryLog += format;
+
+	std::string payload;
+	payload += char(afc::logger::BinaryTag::uint16);
+	appendSwapped(payload, std::uint16_t(0x1234));
+	payload += char(afc::logger::BinaryTag::int32);
+	appendSwapped(payload, std::int32_t(-100000));
+	payload += char(afc::logger::BinaryTag::int64);
+	appendSwapped(payload, std::numeric_limits<std::int64_t>::min());
+	payload += char(afc::logger::BinaryTag::float64);
+	appendSwapped(payload, 1.5);
+	payload += char(afc::logger::BinaryTag::string);
+	appendSwapped(payload, std::uint32_t(4));
+	payload += "text";
+
+	binaryLog += char(2);
+	appendSwapped(binaryLog, std::uint32_t(0));
+	appendSwapped(binaryLog, timestamp);
+	appendSwapped(binaryLog, std::uint32_t(payload.size()));
+	binaryLog += payload;
+
+	binaryLog += char(3);
+	appendSwapped(binaryLog, timestamp);
+	appendSwapped(binaryLog, std::uint64_t(300));
+
+	CPPUNIT_ASSERT_EQUAL(std::string(
+			"2017-07-14T02:40:00.123456789Z 4660 -100000 -9223372036854775808 1.5 text\n"
+			"2017-07-14T02:40:00.123456789Z afc::logger: 300 records dropped\n"), decode(binaryLog));
+
+	// An unknown byte order.
+	binaryLog[8] = 'X';
+	CPPUNIT_ASSERT_EQUAL(std::string("<error>"), decode(binaryLog));
+}
+
+void afc::BinaryLoggerTest::testDecode_Malformed()
+{
+	std::FILE * const file = std::tmpfile();
+	CPPUNIT_ASSERT(file != nullptr);
+	{
+		BinaryLogger logger(file);
+		CPPUNIT_ASSERT(logger.log(AFC_FMT("first #"), 1));
+		CPPUNIT_ASSERT(logger.log(AFC_FMT("second #"), 2));
+	}
+	const std::string binaryLog = readAll(file);
+	std::fclose(file);
+
+	CPPUNIT_ASSERT_EQUAL(std::string("first 1\nsecond 2\n"), stripTimestamps(decode(binaryLog)));
+
+	/* Truncated logs. A log cut at a record boundary is a valid shorter log that decodes
+	 * to a prefix of the full text; any other cut is reported as an error.
+	 */
+	for (std::size_t n = 1; n < binaryLog.size(); ++n) {
+		const std::string text = decode(binaryLog.substr(0, binaryLog.size() - n));
+		if (text.size() >= 7 && text.compare(text.size() - 7, 7, "<error>") == 0) {
+			continue;
+		}
+		const std::string records = stripTimestamps(text);
+		CPPUNIT_ASSERT(records.empty() || records == "first 1\n");
+	}
+
+	// Not a binary log.
+	CPPUNIT_ASSERT_EQUAL(std::string("<error>"), decode("plain text log\n"));
+	// Empty log.
+	CPPUNIT_ASSERT_EQUAL(std::string("<error>"), decode(""));
+	// Only the header.
+	CPPUNIT_ASSERT_EQUAL(std::string(), decode(binaryLog.substr(0, 9)));
+}
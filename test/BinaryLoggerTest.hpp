@@ -0,0 +1,44 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_BINARYLOGGERTEST_HPP_
+#define AFC_BINARYLOGGERTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class BinaryLoggerTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(BinaryLoggerTest);
+		CPPUNIT_TEST(testLogAndDecode);
+		CPPUNIT_TEST(testLogAndDecode_AsyncLogger);
+		CPPUNIT_TEST(testLogAndDecode_AsyncLoggerOverflow);
+		CPPUNIT_TEST(testTimestamp);
+		CPPUNIT_TEST(testDecode_ForeignByteOrder);
+		CPPUNIT_TEST(testDecode_Malformed);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testLogAndDecode();
+		void testLogAndDecode_AsyncLogger();
+		void testLogAndDecode_AsyncLoggerOverflow();
+		void testTimestamp();
+		void testDecode_ForeignByteOrder();
+		void testDecode_Malformed();
+	};
+}
+
+#endif /* AFC_BINARYLOGGERTEST_HPP_ */
@@ -15,9 +15,57 @@ You should have received a copy of the GNU Lesser General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "CrcTest.hpp"
 #include <afc/crc.hpp>
+#include <afc/stream.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
 
 CPPUNIT_TEST_SUITE_REGISTRATION(afc::CrcTest);
 
+namespace
+{
+	class MemoryInputStream : public afc::InputStream
+	{
+	public:
+		MemoryInputStream(const unsigned char * const data, const std::size_t n, const std::size_t maxReadSize)
+			: m_data(data), m_size(n), m_pos(0), m_maxReadSize(maxReadSize) {}
+
+		virtual std::size_t read(unsigned char * const data, const std::size_t n)
+		{
+			const std::size_t count = std::min(std::min(n, m_maxReadSize), m_size - m_pos);
+			std::memcpy(data, m_data + m_pos, count);
+			m_pos += count;
+			return count;
+		}
+
+		virtual void reset() { m_pos = 0; }
+
+		virtual std::size_t skip(const std::size_t n)
+		{
+			const std::size_t count = std::min(n, m_size - m_pos);
+			m_pos += count;
+			return count;
+		}
+
+		virtual void close() {}
+	private:
+		const unsigned char * const m_data;
+		const std::size_t m_size;
+		std::size_t m_pos;
+		const std::size_t m_maxReadSize;
+	};
+
+	std::vector<unsigned char> testData(const std::size_t n)
+	{
+		std::vector<unsigned char> data(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			data[i] = static_cast<unsigned char>(i * 131 + (i >> 11));
+		}
+		return data;
+	}
+}
+
 void afc::CrcTest::testCrc64Reversed()
 {
 	{
@@ -181,3 +229,119 @@ void afc::CrcTest::testCrc64ReversedUpdate_Aligned8()
 		CPPUNIT_ASSERT_EQUAL(0xdb7ac38f63413c4eu, crc);
 	}
 }
+
+void afc::CrcTest::testCrc64Reversed_LargeData()
+{
+	alignas(8)
+	unsigned char data[1000];
+	for (std::size_t i = 0; i < sizeof(data); ++i) {
+		data[i] = static_cast<unsigned char>(i * 7 + (i >> 5));
+	}
+
+	CPPUNIT_ASSERT_EQUAL(0x7e40a5811c004856u, afc::crc64Reversed(data, sizeof(data)));
+	CPPUNIT_ASSERT_EQUAL(0x7e40a5811c004856u, afc::crc64Reversed_Aligned8(data, sizeof(data)));
+	CPPUNIT_ASSERT_EQUAL(0x7e40a5811c004856u, afc::crc64Reversed(&data[0], &data[0] + sizeof(data)));
+}
+
+void afc::CrcTest::testCrc64ReversedUpdate_LargeData()
+{
+	unsigned char data[1100];
+	for (std::size_t i = 0; i < sizeof(data); ++i) {
+		data[i] = static_cast<unsigned char>(i * 131 + (i >> 3));
+	}
+
+	// All sizes and alignments of the fast paths must agree with the octet-by-octet calculation.
+	for (std::size_t offset = 0; offset < 16; ++offset) {
+		for (std::size_t n = 0; n <= 1050; ++n) {
+			const unsigned char * const begin = data + offset;
+			const std::uint_fast64_t currentCrc = 0xf0e1d2c3b4a59687u * (offset + 1);
+			CPPUNIT_ASSERT_EQUAL(afc::crc64ReversedUpdate(currentCrc, begin, begin + n),
+					afc::crc64ReversedUpdate(currentCrc, begin, n));
+		}
+	}
+
+	// Splitting data into chunks must not change the result.
+	std::uint_fast64_t crc = afc::crc64ReversedUpdate(0, data, 300);
+	crc = afc::crc64ReversedUpdate(crc, data + 300, 77);
+	crc = afc::crc64ReversedUpdate(crc, data + 377, sizeof(data) - 377);
+	CPPUNIT_ASSERT_EQUAL(afc::crc64Reversed(data, sizeof(data)), crc);
+}
+
+void afc::CrcTest::testCrc64ReversedCombine()
+{
+	const unsigned char data[] =
+			{0x99, 0xeb, 0x96, 0xdd, 0x94, 0xc8, 0x8e, 0x97, 0x5b, 0x58, 0x5d, 0x2f, 0x28, 0x78, 0x5e, 0x36};
+
+	for (std::size_t i = 0; i <= sizeof(data); ++i) {
+		const std::uint_fast64_t crcA = afc::crc64Reversed(data, i);
+		const std::uint_fast64_t crcB = afc::crc64Reversed(data + i, sizeof(data) - i);
+		CPPUNIT_ASSERT_EQUAL(0xdb7ac38f63413c4eu, afc::crc64ReversedCombine(crcA, crcB, sizeof(data) - i));
+	}
+
+	// Chunks combined out of order.
+	const std::vector<unsigned char> largeData = testData(100000);
+	const std::uint_fast64_t crc3 = afc::crc64Reversed(largeData.data() + 70000, 30000);
+	const std::uint_fast64_t crc2 = afc::crc64Reversed(largeData.data() + 12345, 70000 - 12345);
+	const std::uint_fast64_t crc1 = afc::crc64Reversed(largeData.data(), 12345);
+	CPPUNIT_ASSERT_EQUAL(afc::crc64Reversed(largeData.data(), largeData.size()),
+			afc::crc64ReversedCombine(afc::crc64ReversedCombine(crc1, crc2, 70000 - 12345), crc3, 30000));
+
+	CPPUNIT_ASSERT_EQUAL(std::uint_fast64_t(0x1234), afc::crc64ReversedCombine(0x1234, 0, 0));
+}
+
+void afc::CrcTest::testCrc64ReversedParallel()
+{
+	const std::vector<unsigned char> data = testData(5 * 1024 * 1024 + 3);
+	const std::uint_fast64_t expected = afc::crc64Reversed(data.data(), data.size());
+
+	for (const unsigned threadCount : {0u, 1u, 2u, 3u, 7u}) {
+		CPPUNIT_ASSERT_EQUAL(expected, afc::crc64ReversedParallel(data.data(), data.size(), threadCount));
+
+		const std::uint_fast64_t crc = afc::crc64ReversedUpdateParallel(0, data.data(), 1000001, threadCount);
+		CPPUNIT_ASSERT_EQUAL(expected, afc::crc64ReversedUpdateParallel(crc, data.data() + 1000001,
+				data.size() - 1000001, threadCount));
+	}
+
+	CPPUNIT_ASSERT_EQUAL(std::uint_fast64_t(0), afc::crc64ReversedParallel(data.data(), 0, 4));
+}
+
+void afc::CrcTest::testCrc64ReversedParallel_InputStream()
+{
+	const std::vector<unsigned char> data = testData(3 * 1024 * 1024 + 777);
+	const std::uint_fast64_t expected = afc::crc64Reversed(data.data(), data.size());
+
+	{
+		MemoryInputStream in(data.data(), data.size(), data.size());
+		CPPUNIT_ASSERT_EQUAL(expected, afc::crc64ReversedParallel(in, 2));
+	}
+
+	{
+		// Short reads and portions that are split between threads.
+		MemoryInputStream in(data.data(), data.size(), 100000);
+		CPPUNIT_ASSERT_EQUAL(expected, afc::crc64ReversedUpdateParallel(0, in, 2, 1024 * 1024));
+	}
+
+	{
+		// The stream size is a multiple of the portion size.
+		MemoryInputStream in(data.data(), 4000, 4000);
+		CPPUNIT_ASSERT_EQUAL(afc::crc64Reversed(data.data(), 4000), afc::crc64ReversedUpdateParallel(0, in, 4, 100));
+	}
+
+	{
+		MemoryInputStream in(data.data(), 0, 1);
+		CPPUNIT_ASSERT_EQUAL(std::uint_fast64_t(0x5678), afc::crc64ReversedUpdateParallel(0x5678, in, 3));
+	}
+
+	{
+		// Portions larger than the memory available are not allocated for short streams.
+		MemoryInputStream in(data.data(), 4000, 4000);
+		CPPUNIT_ASSERT_EQUAL(afc::crc64Reversed(data.data(), 4000),
+				afc::crc64ReversedUpdateParallel(0, in, 64, std::size_t(1) << 40));
+	}
+
+	{
+		// The first chunk is full but the portion is not.
+		MemoryInputStream in(data.data(), data.size(), 100000);
+		CPPUNIT_ASSERT_EQUAL(expected, afc::crc64ReversedUpdateParallel(0, in, 4, 1024 * 1024));
+	}
+}
@@ -30,6 +30,11 @@ namespace afc
 		CPPUNIT_TEST(testCrc64ReversedUpdate_Iterator);
 		CPPUNIT_TEST(testCrc64Reversed_Aligned8);
 		CPPUNIT_TEST(testCrc64ReversedUpdate_Aligned8);
+		CPPUNIT_TEST(testCrc64Reversed_LargeData);
+		CPPUNIT_TEST(testCrc64ReversedUpdate_LargeData);
+		CPPUNIT_TEST(testCrc64ReversedCombine);
+		CPPUNIT_TEST(testCrc64ReversedParallel);
+		CPPUNIT_TEST(testCrc64ReversedParallel_InputStream);
 		CPPUNIT_TEST_SUITE_END();
 	public:
 		void testCrc64Reversed();
@@ -38,6 +43,11 @@ namespace afc
 		void testCrc64ReversedUpdate_Iterator();
 		void testCrc64Reversed_Aligned8();
 		void testCrc64ReversedUpdate_Aligned8();
+		void testCrc64Reversed_LargeData();
+		void testCrc64ReversedUpdate_LargeData();
+		void testCrc64ReversedCombine();
+		void testCrc64ReversedParallel();
+		void testCrc64ReversedParallel_InputStream();
 	};
 }
 
@@ -19,6 +19,8 @@ CPPUNIT_TEST_SUITE_REGISTRATION(afc::DateUtilTest);
 
 #include <afc/dateutil.hpp>
 #include <afc/StringRef.hpp>
+#include <cstdio>
+#include <cstring>
 #include <time.h>
 
 using namespace std;
@@ -26,6 +28,11 @@ using namespace afc;
 
 namespace
 {
+	bool parsePrecise(const char * const str, std::int_fast64_t &seconds, std::uint_fast32_t &nanoseconds, long &gmtOffset)
+	{
+		return parseISODateTime(str, str + std::strlen(str), seconds, nanoseconds, gmtOffset);
+	}
+
 	time_t utcTime(const int year, const int month, const int day, const int hour, const int minute, const int second)
 	{
 		time_t t;
@@ -422,3 +429,292 @@ void afc::DateUtilTest::test_TimestampTZ_CastToTm()
 	CPPUNIT_ASSERT_EQUAL(26, result.tm_sec);
 	CPPUNIT_ASSERT_EQUAL(-150L * 60, result.tm_gmtoff);
 }
+
+void afc::DateUtilTest::testCivilFromDays()
+{
+	// From 1500-01-01 till 2500-01-01.
+	for (std::int_fast64_t days = -171000; days <= 194000; ++days) {
+		const time_t t = time_t(days * 24 * 60 * 60);
+		tm expected;
+		CPPUNIT_ASSERT(gmtime_r(&t, &expected) != nullptr);
+
+		std::int_fast64_t year;
+		unsigned month, day;
+		afc::helper::civilFromDays(days, year, month, day);
+
+		CPPUNIT_ASSERT_EQUAL(std::int_fast64_t(expected.tm_year) + 1900, year);
+		CPPUNIT_ASSERT_EQUAL(unsigned(expected.tm_mon) + 1, month);
+		CPPUNIT_ASSERT_EQUAL(unsigned(expected.tm_mday), day);
+	}
+}
+
+void afc::DateUtilTest::testDaysFromCivil()
+{
+	for (std::int_fast64_t days = -171000; days <= 194000; ++days) {
+		std::int_fast64_t year;
+		unsigned month, day;
+		afc::helper::civilFromDays(days, year, month, day);
+
+		CPPUNIT_ASSERT_EQUAL(days, afc::helper::daysFromCivil(year, month, day));
+	}
+	CPPUNIT_ASSERT_EQUAL(std::int_fast64_t(0), afc::helper::daysFromCivil(1970, 1, 1));
+	CPPUNIT_ASSERT_EQUAL(std::int_fast64_t(-719528), afc::helper::daysFromCivil(0, 1, 1));
+}
+
+void afc::DateUtilTest::testParseISODateTime_Nanoseconds()
+{
+	std::int_fast64_t seconds;
+	std::uint_fast32_t nanoseconds;
+	long gmtOffset;
+
+	CPPUNIT_ASSERT(parsePrecise("2013-10-16T20:02:26.123456789Z", seconds, nanoseconds, gmtOffset));
+	CPPUNIT_ASSERT_EQUAL(std::int_fast64_t(utcTime(2013, 10, 16, 20, 2, 26)), seconds);
+	CPPUNIT_ASSERT_EQUAL(std::uint_fast32_t(123456789), nanoseconds);
+	CPPUNIT_ASSERT_EQUAL(0L, gmtOffset);
+
+	CPPUNIT_ASSERT(parsePrecise("2013-10-16T20:02:26.5+0000", seconds, nanoseconds, gmtOffset));
+	CPPUNIT_ASSERT_EQUAL(std::uint_fast32_t(500000000), nanoseconds);
+
+	CPPUNIT_ASSERT(parsePrecise("2013-10-16T20:02:26,000001Z", seconds, nanoseconds, gmtOffset));
+	CPPUNIT_ASSERT_EQUAL(std::uint_fast32_t(1000), nanoseconds);
+
+	// Digits beyond nanoseconds are ignored.
+	CPPUNIT_ASSERT(parsePrecise("2013-10-16T20:02:26.9999999999Z", seconds, nanoseconds, gmtOffset));
+	CPPUNIT_ASSERT_EQUAL(std::int_fast64_t(utcTime(2013, 10, 16, 20, 2, 26)), seconds);
+	CPPUNIT_ASSERT_EQUAL(std::uint_fast32_t(999999999), nanoseconds);
+
+	CPPUNIT_ASSERT(parsePrecise("1969-12-31T23:59:59.25Z", seconds, nanoseconds, gmtOffset));
+	CPPUNIT_ASSERT_EQUAL(std::int_fast64_t(-1), seconds);
+	CPPUNIT_ASSERT_EQUAL(std::uint_fast32_t(250000000), nanoseconds);
+}
+
+void afc::DateUtilTest::testParseISODateTime_TimeZoneFormats()
+{
+	std::int_fast64_t seconds;
+	std::uint_fast32_t nanoseconds;
+	long gmtOffset;
+	const std::int_fast64_t utc = utcTime(2000, 2, 29, 0, 10, 0);
+
+	CPPUNIT_ASSERT(parsePrecise("2000-02-29T01:40:00+01:30", seconds, nanoseconds, gmtOffset));
+	CPPUNIT_ASSERT_EQUAL(utc, seconds);
+	CPPUNIT_ASSERT_EQUAL(std::uint_fast32_t(0), nanoseconds);
+	CPPUNIT_ASSERT_EQUAL(90L * 60, gmtOffset);
+
+	CPPUNIT_ASSERT(parsePrecise("2000-02-29T01:40:00+0130", seconds, nanoseconds, gmtOffset));
+	CPPUNIT_ASSERT_EQUAL(utc, seconds);
+	CPPUNIT_ASSERT_EQUAL(90L * 60, gmtOffset);
+
+	CPPUNIT_ASSERT(parsePrecise("2000-02-28T22:10:00-02", seconds, nanoseconds, gmtOffset));
+	CPPUNIT_ASSERT_EQUAL(utc, seconds);
+	CPPUNIT_ASSERT_EQUAL(-120L * 60, gmtOffset);
+
+	CPPUNIT_ASSERT(parsePrecise("2000-02-28T21:40:00-02:30", seconds, nanoseconds, gmtOffset));
+	CPPUNIT_ASSERT_EQUAL(utc, seconds);
+	CPPUNIT_ASSERT_EQUAL(-150L * 60, gmtOffset);
+
+	time_t t;
+	CPPUNIT_ASSERT(parseISODateTime("2000-02-29T00:10:00Z", t));
+	CPPUNIT_ASSERT_EQUAL(time_t(utc), t);
+}
+
+void afc::DateUtilTest::testParseISODateTime_TimestampTZ_Fraction()
+{
+	TimestampTZ dest;
+
+	CPPUNIT_ASSERT(parseISODateTime("2013-10-16T20:02:26.123999-02:30", dest));
+	CPPUNIT_ASSERT_EQUAL(Timestamp::time_type(utcTime(2013, 10, 16, 22, 32, 26)) * 1000 + 123, dest.millis());
+	CPPUNIT_ASSERT_EQUAL(-150L * 60, dest.getGmtOffset());
+
+	const ConstStringRef input = "2013-10-16T20:02:26.5Z"_s;
+	CPPUNIT_ASSERT(parseISODateTime(input.begin(), input.end(), dest));
+	CPPUNIT_ASSERT_EQUAL(Timestamp::time_type(utcTime(2013, 10, 16, 20, 2, 26)) * 1000 + 500, dest.millis());
+	CPPUNIT_ASSERT_EQUAL(0L, dest.getGmtOffset());
+}
+
+void afc::DateUtilTest::testParseISODateTime_Invalid()
+{
+	std::int_fast64_t seconds;
+	std::uint_fast32_t nanoseconds;
+	long gmtOffset;
+
+	const char * const invalid[] = {
+		"",
+		"2013-10-16T20:02:26",
+		"2013-10-16T20:02:26.Z",
+		"2013-10-16T20:02:26.123",
+		"2013-10-16T20:02:26+",
+		"2013-10-16T20:02:26+1",
+		"2013-10-16T20:02:26+01:",
+		"2013-10-16T20:02:26+01:3",
+		"2013-10-16T20:02:26+013",
+		"2013-10-16T20:02:26+01300",
+		"2013-10-16T20:02:26+2400",
+		"2013-10-16T20:02:26+0160",
+		"2013-10-16T20:02:26Zx",
+		"2013-10-16 20:02:26Z",
+		"2013/10/16T20:02:26Z",
+		"2013-1-16T20:02:26Z",
+		"2013-00-16T20:02:26Z",
+		"2013-13-16T20:02:26Z",
+		"2013-10-00T20:02:26Z",
+		"2013-10-32T20:02:26Z",
+		"2013-02-29T20:02:26Z",
+		"1900-02-29T20:02:26Z",
+		"2013-10-16T24:02:26Z",
+		"2013-10-16T20:60:26Z",
+		"2013-10-16T20:02:61Z",
+		"2013-10-16T20:02:26X",
+	};
+	for (const char * const s : invalid) {
+		CPPUNIT_ASSERT_MESSAGE(s, !parsePrecise(s, seconds, nanoseconds, gmtOffset));
+	}
+
+	CPPUNIT_ASSERT(parsePrecise("2000-02-29T20:02:26Z", seconds, nanoseconds, gmtOffset));
+	CPPUNIT_ASSERT(parsePrecise("2016-12-31T23:59:60Z", seconds, nanoseconds, gmtOffset));
+}
+
+void afc::DateUtilTest::testFormatISODateTime()
+{
+	char buf[maxISODateTimeSize()];
+	TimestampTZ ts;
+
+	ts.setMillis(946768353999L);
+	ts.setGmtOffset(90L * 60);
+	CPPUNIT_ASSERT_EQUAL(string("2000-01-02T00:42:33+0130"), string(buf, formatISODateTime(ts, buf)));
+
+	ts.setGmtOffset(-150L * 60);
+	CPPUNIT_ASSERT_EQUAL(string("2000-01-01T20:42:33-0230"), string(buf, formatISODateTime(ts, buf)));
+
+	ts.setMillis(951782400000L);
+	ts.setGmtOffset(0);
+	CPPUNIT_ASSERT_EQUAL(string("2000-02-29T00:00:00+0000"), string(buf, formatISODateTime(ts, buf)));
+
+	// Before epoch.
+	ts.setMillis(-1);
+	CPPUNIT_ASSERT_EQUAL(string("1969-12-31T23:59:59+0000"), string(buf, formatISODateTime(ts, buf)));
+}
+
+void afc::DateUtilTest::testFormatISODateTimeMillis()
+{
+	char buf[maxISODateTimeMillisSize()];
+	TimestampTZ ts;
+
+	ts.setMillis(946768353007L);
+	ts.setGmtOffset(90L * 60);
+	CPPUNIT_ASSERT_EQUAL(string("2000-01-02T00:42:33.007+0130"), string(buf, formatISODateTimeMillis(ts, buf)));
+
+	ts.setMillis(-1);
+	ts.setGmtOffset(-60L * 60);
+	CPPUNIT_ASSERT_EQUAL(string("1969-12-31T22:59:59.999-0100"), string(buf, formatISODateTimeMillis(ts, buf)));
+}
+
+void afc::DateUtilTest::testISODateTimeFormatter()
+{
+	char buf[maxISODateTimeMillisSize()];
+	ISODateTimeFormatter formatter;
+	TimestampTZ ts;
+
+	ts.setMillis(1381953746120L);
+	ts.setGmtOffset(0);
+	CPPUNIT_ASSERT_EQUAL(string("2013-10-16T20:02:26.120+0000"), string(buf, formatter.formatMillis(ts, buf)));
+	// The same second.
+	ts.setMillis(1381953746999L);
+	CPPUNIT_ASSERT_EQUAL(string("2013-10-16T20:02:26.999+0000"), string(buf, formatter.formatMillis(ts, buf)));
+	CPPUNIT_ASSERT_EQUAL(string("2013-10-16T20:02:26+0000"), string(buf, formatter.format(ts, buf)));
+	// The next second.
+	ts.setMillis(1381953747000L);
+	CPPUNIT_ASSERT_EQUAL(string("2013-10-16T20:02:27.000+0000"), string(buf, formatter.formatMillis(ts, buf)));
+	// The same second in another time zone.
+	ts.setGmtOffset(-150L * 60);
+	CPPUNIT_ASSERT_EQUAL(string("2013-10-16T17:32:27.000-0230"), string(buf, formatter.formatMillis(ts, buf)));
+	CPPUNIT_ASSERT_EQUAL(string("2013-10-16T17:32:27-0230"), string(buf, formatter.format(ts, buf)));
+}
+
+void afc::DateUtilTest::testLogISODateTimeView()
+{
+	const Timestamp time(1381953746120L);
+	TimestampTZ ts;
+	ts = static_cast<std::time_t>(time);
+	char buf[maxISODateTimeSize()];
+	const string expected = "t=" + string(buf, formatISODateTime(ts, buf)) + '\n';
+
+	std::FILE * const file = std::tmpfile();
+	CPPUNIT_ASSERT(file != nullptr);
+	CPPUNIT_ASSERT(afc::logger::logToFile<false>(file, "t=", ISODateTimeView(time)));
+	CPPUNIT_ASSERT(afc::logger::logToFileFmt<false>(file, AFC_FMT("t=#"), ISODateTimeView(time)));
+	std::fflush(file);
+	std::rewind(file);
+	char text[256];
+	const std::size_t n = std::fread(text, 1, sizeof(text), file);
+	std::fclose(file);
+
+	CPPUNIT_ASSERT_EQUAL(expected + expected, string(text, n));
+}
+
+void afc::DateUtilTest::testTimestampNanos()
+{
+	const ::timespec time = {1381953746, 120000001};
+	const TimestampNanos ts(time);
+	CPPUNIT_ASSERT_EQUAL(TimestampNanos::time_type(1381953746120000001LL), ts.nanos());
+	CPPUNIT_ASSERT_EQUAL(Timestamp::time_type(1381953746120L), static_cast<Timestamp>(ts).millis());
+	CPPUNIT_ASSERT_EQUAL(::time_t(1381953746), static_cast< ::time_t >(ts));
+
+	// Before epoch, the time is rounded towards the past.
+	const TimestampNanos beforeEpoch(-1);
+	CPPUNIT_ASSERT_EQUAL(Timestamp::time_type(-1), static_cast<Timestamp>(beforeEpoch).millis());
+	CPPUNIT_ASSERT_EQUAL(::time_t(-1), static_cast< ::time_t >(beforeEpoch));
+	const TimestampNanos wholeSecond(-2000000000);
+	CPPUNIT_ASSERT_EQUAL(Timestamp::time_type(-2000), static_cast<Timestamp>(wholeSecond).millis());
+	CPPUNIT_ASSERT_EQUAL(::time_t(-2), static_cast< ::time_t >(wholeSecond));
+}
+
+void afc::DateUtilTest::testNow()
+{
+	const ::time_t before = ::time(nullptr);
+	const Timestamp millis = now();
+	const TimestampNanos realtime = now(realtimeClock);
+	const TimestampNanos coarse = now(coarseRealtimeClock);
+	const ::time_t after = ::time(nullptr);
+
+	// ::time() and the coarse clock may lag behind the realtime clock by a timer tick.
+	CPPUNIT_ASSERT(before <= millis.millis() / 1000 && millis.millis() / 1000 <= after + 1);
+	CPPUNIT_ASSERT(millis.millis() <= static_cast<Timestamp>(realtime).millis());
+	CPPUNIT_ASSERT(before <= static_cast< ::time_t >(realtime) && static_cast< ::time_t >(realtime) <= after + 1);
+	CPPUNIT_ASSERT(before - 1 <= static_cast< ::time_t >(coarse) && static_cast< ::time_t >(coarse) <= after);
+
+	TimestampNanos last = now(monotonicClock);
+	for (int i = 0; i < 1000; ++i) {
+		const TimestampNanos next = now(monotonicClock);
+		CPPUNIT_ASSERT(next.nanos() >= last.nanos());
+		last = next;
+	}
+}
+
+void afc::DateUtilTest::testNow_TscClock()
+{
+	// The first read calibrates the clock.
+	now(tscClock);
+
+	const TimestampNanos monotonic0 = now(monotonicClock);
+	const TimestampNanos tsc0 = now(tscClock);
+
+	TimestampNanos last = tsc0;
+	for (int i = 0; i < 1000; ++i) {
+		const TimestampNanos next = now(tscClock);
+		CPPUNIT_ASSERT(next.nanos() >= last.nanos());
+		last = next;
+	}
+
+	const ::timespec interval = {0, 50000000};
+	::nanosleep(&interval, nullptr);
+	const TimestampNanos tsc1 = now(tscClock);
+	const TimestampNanos monotonic1 = now(monotonicClock);
+
+	// The clock follows the monotonic clock, both in its origin and in its rate.
+	const std::int_fast64_t tscDelta = tsc1.nanos() - tsc0.nanos();
+	const std::int_fast64_t monotonicDelta = monotonic1.nanos() - monotonic0.nanos();
+	CPPUNIT_ASSERT(tscDelta <= monotonicDelta);
+	CPPUNIT_ASSERT(tscDelta >= monotonicDelta - monotonicDelta / 100 - 1000000);
+	CPPUNIT_ASSERT(tsc0.nanos() >= monotonic0.nanos() - 1000000);
+	CPPUNIT_ASSERT(tsc1.nanos() <= monotonic1.nanos() + 1000000);
+}
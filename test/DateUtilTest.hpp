@@ -49,6 +49,20 @@ namespace afc
 
 		CPPUNIT_TEST(test_TimestampTZ_AssignTimeT);
 		CPPUNIT_TEST(test_TimestampTZ_CastToTm);
+
+		CPPUNIT_TEST(testCivilFromDays);
+		CPPUNIT_TEST(testDaysFromCivil);
+		CPPUNIT_TEST(testParseISODateTime_Nanoseconds);
+		CPPUNIT_TEST(testParseISODateTime_TimeZoneFormats);
+		CPPUNIT_TEST(testParseISODateTime_TimestampTZ_Fraction);
+		CPPUNIT_TEST(testParseISODateTime_Invalid);
+		CPPUNIT_TEST(testFormatISODateTime);
+		CPPUNIT_TEST(testFormatISODateTimeMillis);
+		CPPUNIT_TEST(testISODateTimeFormatter);
+		CPPUNIT_TEST(testLogISODateTimeView);
+		CPPUNIT_TEST(testTimestampNanos);
+		CPPUNIT_TEST(testNow);
+		CPPUNIT_TEST(testNow_TscClock);
 		CPPUNIT_TEST_SUITE_END();
 
 		std::unique_ptr<std::string> m_timeZoneBackup;
@@ -78,6 +92,20 @@ namespace afc
 
 		void test_TimestampTZ_AssignTimeT();
 		void test_TimestampTZ_CastToTm();
+
+		void testCivilFromDays();
+		void testDaysFromCivil();
+		void testParseISODateTime_Nanoseconds();
+		void testParseISODateTime_TimeZoneFormats();
+		void testParseISODateTime_TimestampTZ_Fraction();
+		void testParseISODateTime_Invalid();
+		void testFormatISODateTime();
+		void testFormatISODateTimeMillis();
+		void testISODateTimeFormatter();
+		void testLogISODateTimeView();
+		void testTimestampNanos();
+		void testNow();
+		void testNow_TscClock();
 	};
 }
 
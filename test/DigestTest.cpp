@@ -0,0 +1,207 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "DigestTest.hpp"
+#include <afc/md5.hpp>
+#include <afc/sha.hpp>
+#include <afc/stream.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::DigestTest);
+
+namespace
+{
+	class MemoryInputStream : public afc::InputStream
+	{
+	public:
+		MemoryInputStream(const unsigned char * const data, const std::size_t n, const std::size_t maxReadSize)
+			: m_data(data), m_size(n), m_pos(0), m_maxReadSize(maxReadSize) {}
+
+		virtual std::size_t read(unsigned char * const data, const std::size_t n)
+		{
+			const std::size_t count = std::min(std::min(n, m_maxReadSize), m_size - m_pos);
+			std::memcpy(data, m_data + m_pos, count);
+			m_pos += count;
+			return count;
+		}
+
+		virtual void reset() { m_pos = 0; }
+
+		virtual std::size_t skip(const std::size_t n)
+		{
+			const std::size_t count = std::min(n, m_size - m_pos);
+			m_pos += count;
+			return count;
+		}
+
+		virtual void close() {}
+	private:
+		const unsigned char * const m_data;
+		const std::size_t m_size;
+		std::size_t m_pos;
+		const std::size_t m_maxReadSize;
+	};
+
+	std::vector<unsigned char> testData(const std::size_t n)
+	{
+		std::vector<unsigned char> data(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			data[i] = static_cast<unsigned char>(i * 7 + i / 256);
+		}
+		return data;
+	}
+
+	template<typename Digest>
+	std::string finishHex(Digest &digest)
+	{
+		unsigned char result[Digest::digestSize];
+		digest.finish(result);
+
+		std::string hex;
+		afc::digestToHex(result, Digest::digestSize, std::back_inserter(hex));
+		return hex;
+	}
+
+	template<typename Digest>
+	std::string digestHex(const char * const data, const std::size_t n)
+	{
+		Digest digest;
+		digest.update(data, n);
+		return finishHex(digest);
+	}
+
+	template<typename Digest>
+	std::string digestHex(const char * const data)
+	{
+		return digestHex<Digest>(data, std::strlen(data));
+	}
+
+	// Produces 56 octets of data: the length does not fit into the block with the padding octet.
+	const char * const twoBlockMessage = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+	template<typename Digest>
+	void assertChunkedUpdate(const std::vector<unsigned char> &data, const std::string &expected)
+	{
+		for (const std::size_t chunkSize : {1u, 3u, 55u, 63u, 64u, 65u, 1000u, 4096u}) {
+			Digest digest;
+			for (std::size_t i = 0; i < data.size(); i += chunkSize) {
+				digest.update(data.data() + i, std::min(chunkSize, data.size() - i));
+			}
+			CPPUNIT_ASSERT_EQUAL(expected, finishHex(digest));
+		}
+	}
+
+	template<typename Digest>
+	void assertInputStream(const std::vector<unsigned char> &data, const std::string &expected)
+	{
+		{
+			MemoryInputStream in(data.data(), data.size(), data.size());
+			Digest digest;
+			digest.update(in);
+			CPPUNIT_ASSERT_EQUAL(expected, finishHex(digest));
+		}
+
+		{
+			// Short reads are combined with the data passed in directly.
+			MemoryInputStream in(data.data() + 10, data.size() - 10, 777);
+			Digest digest;
+			digest.update(data.data(), 10);
+			digest.update(in);
+			CPPUNIT_ASSERT_EQUAL(expected, finishHex(digest));
+		}
+	}
+}
+
+void afc::DigestTest::testMd5()
+{
+	CPPUNIT_ASSERT_EQUAL(std::string("d41d8cd98f00b204e9800998ecf8427e"), digestHex<Md5>(""));
+	CPPUNIT_ASSERT_EQUAL(std::string("0cc175b9c0f1b6a831c399e269772661"), digestHex<Md5>("a"));
+	CPPUNIT_ASSERT_EQUAL(std::string("900150983cd24fb0d6963f7d28e17f72"), digestHex<Md5>("abc"));
+	CPPUNIT_ASSERT_EQUAL(std::string("f96b697d7cb7938d525a2f31aaf161d0"), digestHex<Md5>("message digest"));
+	CPPUNIT_ASSERT_EQUAL(std::string("8215ef0796a20bcaaae116d3876c664a"), digestHex<Md5>(twoBlockMessage));
+	CPPUNIT_ASSERT_EQUAL(std::string("57edf4a22be3c955ac49da2e2107b67a"), digestHex<Md5>(
+			"12345678901234567890123456789012345678901234567890123456789012345678901234567890"));
+
+	const std::string million(1000000, 'a');
+	CPPUNIT_ASSERT_EQUAL(std::string("7707d6ae4e027c70eea2a935c2296f21"), digestHex<Md5>(million.data(), million.size()));
+}
+
+void afc::DigestTest::testSha1()
+{
+	CPPUNIT_ASSERT_EQUAL(std::string("da39a3ee5e6b4b0d3255bfef95601890afd80709"), digestHex<Sha1>(""));
+	CPPUNIT_ASSERT_EQUAL(std::string("a9993e364706816aba3e25717850c26c9cd0d89d"), digestHex<Sha1>("abc"));
+	CPPUNIT_ASSERT_EQUAL(std::string("84983e441c3bd26ebaae4aa1f95129e5e54670f1"), digestHex<Sha1>(twoBlockMessage));
+
+	const std::string million(1000000, 'a');
+	CPPUNIT_ASSERT_EQUAL(std::string("34aa973cd4c4daa4f61eeb2bdbad27316534016f"),
+			digestHex<Sha1>(million.data(), million.size()));
+}
+
+void afc::DigestTest::testSha256()
+{
+	CPPUNIT_ASSERT_EQUAL(std::string("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"),
+			digestHex<Sha256>(""));
+	CPPUNIT_ASSERT_EQUAL(std::string("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"),
+			digestHex<Sha256>("abc"));
+	CPPUNIT_ASSERT_EQUAL(std::string("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"),
+			digestHex<Sha256>(twoBlockMessage));
+
+	const std::string million(1000000, 'a');
+	CPPUNIT_ASSERT_EQUAL(std::string("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"),
+			digestHex<Sha256>(million.data(), million.size()));
+}
+
+void afc::DigestTest::testChunkedUpdate()
+{
+	const std::vector<unsigned char> data = testData(100000);
+
+	assertChunkedUpdate<Md5>(data, "2dc29e5babf440db9204914bcbe05fbf");
+	assertChunkedUpdate<Sha1>(data, "557878b8118e7a9bdc75bcfc419f9b082ce073e6");
+	assertChunkedUpdate<Sha256>(data, "55af394c980c7a7fb68aa904c4afdd93d76e5f826487105fc06f92a25bab8cbe");
+}
+
+void afc::DigestTest::testInputStream()
+{
+	const std::vector<unsigned char> data = testData(100000);
+
+	assertInputStream<Md5>(data, "2dc29e5babf440db9204914bcbe05fbf");
+	assertInputStream<Sha1>(data, "557878b8118e7a9bdc75bcfc419f9b082ce073e6");
+	assertInputStream<Sha256>(data, "55af394c980c7a7fb68aa904c4afdd93d76e5f826487105fc06f92a25bab8cbe");
+}
+
+void afc::DigestTest::testReuseAfterFinish()
+{
+	Sha256 digest;
+	digest.update("garbage", 7);
+	unsigned char result[Sha256::digestSize];
+	digest.finish(result);
+
+	digest.update("abc", 3);
+	CPPUNIT_ASSERT_EQUAL(std::string("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"),
+			finishHex(digest));
+}
+
+void afc::DigestTest::testAppendMD5String()
+{
+	std::string result;
+	const unsigned char data[] = {'a', 'b', 'c'};
+	appendMD5String(data, sizeof(data), [&result](const char * const s, const std::size_t n) { result.append(s, n); });
+
+	CPPUNIT_ASSERT_EQUAL(std::string("900150983cd24fb0d6963f7d28e17f72"), result);
+}
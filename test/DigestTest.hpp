@@ -0,0 +1,46 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_DIGESTTEST_HPP_
+#define AFC_DIGESTTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class DigestTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(DigestTest);
+		CPPUNIT_TEST(testMd5);
+		CPPUNIT_TEST(testSha1);
+		CPPUNIT_TEST(testSha256);
+		CPPUNIT_TEST(testChunkedUpdate);
+		CPPUNIT_TEST(testInputStream);
+		CPPUNIT_TEST(testReuseAfterFinish);
+		CPPUNIT_TEST(testAppendMD5String);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testMd5();
+		void testSha1();
+		void testSha256();
+		void testChunkedUpdate();
+		void testInputStream();
+		void testReuseAfterFinish();
+		void testAppendMD5String();
+	};
+}
+
+#endif /* AFC_DIGESTTEST_HPP_ */
@@ -0,0 +1,263 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "HistogramTest.hpp"
+#include <afc/Histogram.hpp>
+#include <afc/logger.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::HistogramTest);
+
+using afc::Histogram;
+using afc::HistogramSnapshot;
+
+namespace
+{
+	std::string format(const HistogramSnapshot &snapshot)
+	{
+		char buf[HistogramSnapshot::maxFormattedSize()];
+		return std::string(buf, snapshot.format(buf));
+	}
+
+	std::string printJSON(const HistogramSnapshot &snapshot)
+	{
+		std::vector<char> buf(snapshot.maxJSONSize());
+		return std::string(buf.data(), snapshot.printJSON(buf.data()));
+	}
+
+	void checkBucket(const std::uint64_t value)
+	{
+		using namespace afc::_impl;
+
+		const std::size_t index = histogramBucketIndex(value);
+		CPPUNIT_ASSERT(index < histogramBucketCount);
+		CPPUNIT_ASSERT(histogramBucketLowerBound(index) <= value);
+		CPPUNIT_ASSERT(value <= histogramBucketUpperBound(index));
+		// The relative error is below 1/32.
+		CPPUNIT_ASSERT((histogramBucketUpperBound(index) - histogramBucketLowerBound(index)) * 32 <=
+				histogramBucketLowerBound(index));
+	}
+}
+
+void afc::HistogramTest::testBuckets()
+{
+	using namespace afc::_impl;
+
+	for (std::uint64_t value = 0; value < 100000; ++value) {
+		checkBucket(value);
+	}
+	for (unsigned shift = 0; shift < 64; ++shift) {
+		const std::uint64_t power = std::uint64_t(1) << shift;
+		checkBucket(power);
+		checkBucket(power - 1);
+		checkBucket(power + 1);
+		checkBucket(power + power / 3);
+	}
+	checkBucket(std::numeric_limits<std::uint64_t>::max());
+
+	// The buckets are contiguous.
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), histogramBucketLowerBound(0));
+	for (std::size_t i = 1; i < histogramBucketCount; ++i) {
+		CPPUNIT_ASSERT_EQUAL(histogramBucketUpperBound(i - 1) + 1, histogramBucketLowerBound(i));
+		CPPUNIT_ASSERT_EQUAL(i, histogramBucketIndex(histogramBucketLowerBound(i)));
+		CPPUNIT_ASSERT_EQUAL(i, histogramBucketIndex(histogramBucketUpperBound(i)));
+	}
+	CPPUNIT_ASSERT_EQUAL(std::numeric_limits<std::uint64_t>::max(), histogramBucketUpperBound(histogramBucketCount - 1));
+}
+
+void afc::HistogramTest::testPercentiles()
+{
+	Histogram histogram(1);
+	for (std::uint64_t value = 1; value <= 10000; ++value) {
+		histogram.record(value);
+	}
+	const HistogramSnapshot snapshot = histogram.snapshot();
+
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(10000), snapshot.count());
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), snapshot.min());
+	CPPUNIT_ASSERT(snapshot.max() >= 10000 && snapshot.max() <= 10000 + 10000 / 32);
+	CPPUNIT_ASSERT(snapshot.mean() >= 5000 && snapshot.mean() <= 5000 + 5000 / 32);
+
+	const double percentiles[] = {0, 1, 25, 50, 90, 99, 99.9, 100};
+	for (const double p : percentiles) {
+		const std::uint64_t exact = std::max(std::uint64_t(p * 100), std::uint64_t(1));
+		const std::uint64_t value = snapshot.valueAtPercentile(p);
+		CPPUNIT_ASSERT(value >= exact && value <= exact + exact / 32);
+	}
+}
+
+void afc::HistogramTest::testPercentiles_SmallCount()
+{
+	Histogram histogram;
+	for (std::uint64_t value = 1; value <= 4; ++value) {
+		histogram.record(value);
+	}
+	HistogramSnapshot snapshot = histogram.snapshot();
+	// At least the percentage given of the values do not exceed the value reported.
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), snapshot.valueAtPercentile(0));
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), snapshot.valueAtPercentile(25));
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(2), snapshot.valueAtPercentile(26));
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(2), snapshot.valueAtPercentile(50));
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(3), snapshot.valueAtPercentile(60));
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(4), snapshot.valueAtPercentile(75.1));
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(4), snapshot.valueAtPercentile(100));
+
+	for (std::uint64_t value = 5; value <= 10; ++value) {
+		histogram.record(value);
+	}
+	snapshot = histogram.snapshot();
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(9), snapshot.valueAtPercentile(90));
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(10), snapshot.valueAtPercentile(94));
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(10), snapshot.valueAtPercentile(90.01));
+}
+
+void afc::HistogramTest::testPercentiles_RoundingError()
+{
+	/* 99.9 * 41000 / 100 evaluates to a little above 40959 in floating point; the rank
+	 * must still be 40959, so that p99.9 is not the largest value.
+	 */
+	Histogram histogram;
+	histogram.record(1, 40959);
+	histogram.record(1000, 41);
+	const HistogramSnapshot snapshot = histogram.snapshot();
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), snapshot.valueAtPercentile(99.9));
+	CPPUNIT_ASSERT(snapshot.valueAtPercentile(99.91) >= 1000);
+}
+
+void afc::HistogramTest::testEmpty()
+{
+	const HistogramSnapshot snapshot = Histogram().snapshot();
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), snapshot.count());
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), snapshot.min());
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), snapshot.max());
+	CPPUNIT_ASSERT_EQUAL(0.0, snapshot.mean());
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), snapshot.valueAtPercentile(99));
+	CPPUNIT_ASSERT_EQUAL(std::string("count=0 min=0 p50=0 p90=0 p99=0 p99.9=0 max=0"), format(snapshot));
+	CPPUNIT_ASSERT_EQUAL(std::string("{\"count\":0,\"min\":0,\"max\":0,\"mean\":0,\"p50\":0,\"p90\":0,\"p99\":0,"
+			"\"p99.9\":0,\"buckets\":[]}"), printJSON(snapshot));
+}
+
+void afc::HistogramTest::testConcurrentRecording()
+{
+	// Fewer shards than threads so that threads share shards.
+	Histogram histogram(2);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2), histogram.shardCount());
+	constexpr int threadCount = 4;
+	constexpr int recordCount = 100000;
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < threadCount; ++i) {
+		threads.emplace_back([&histogram, i]()
+		{
+			for (int j = 0; j < recordCount; ++j) {
+				histogram.record(std::uint64_t(i));
+			}
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	const HistogramSnapshot snapshot = histogram.snapshot();
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(threadCount * recordCount), snapshot.count());
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), snapshot.min());
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(threadCount - 1), snapshot.max());
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), snapshot.valueAtPercentile(50));
+}
+
+void afc::HistogramTest::testMerge()
+{
+	Histogram first(3);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(4), first.shardCount());
+	Histogram second;
+	first.record(1);
+	second.record(5, 3);
+
+	first.merge(second);
+	CPPUNIT_ASSERT_EQUAL(std::string("count=4 min=1 p50=5 p90=5 p99=5 p99.9=5 max=5"), format(first.snapshot()));
+	// The source is intact.
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(3), second.snapshot().count());
+
+	first.merge(second.snapshot());
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(7), first.snapshot().count());
+
+	HistogramSnapshot snapshot = first.snapshot();
+	snapshot.merge(second.snapshot());
+	CPPUNIT_ASSERT_EQUAL(std::string("count=10 min=1 p50=5 p90=5 p99=5 p99.9=5 max=5"), format(snapshot));
+}
+
+void afc::HistogramTest::testReset()
+{
+	Histogram histogram;
+	histogram.record(7);
+	histogram.record(9);
+
+	const HistogramSnapshot snapshot = histogram.snapshotAndReset();
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(2), snapshot.count());
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), histogram.snapshot().count());
+
+	histogram.record(1);
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), histogram.snapshot().count());
+	histogram.reset();
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), histogram.snapshot().count());
+}
+
+void afc::HistogramTest::testFormat()
+{
+	Histogram histogram;
+	for (std::uint64_t value = 1; value <= 10; ++value) {
+		histogram.record(value);
+	}
+	CPPUNIT_ASSERT_EQUAL(std::string("count=10 min=1 p50=5 p90=9 p99=10 p99.9=10 max=10"),
+			format(histogram.snapshot()));
+}
+
+void afc::HistogramTest::testPrintJSON()
+{
+	Histogram histogram;
+	histogram.record(3, 2);
+	// Gets into the bucket [100, 101].
+	histogram.record(100);
+
+	CPPUNIT_ASSERT_EQUAL(std::string("{\"count\":3,\"min\":3,\"max\":101,\"mean\":35.5,\"p50\":3,\"p90\":101,"
+			"\"p99\":101,\"p99.9\":101,\"buckets\":[[3,3,2],[100,101,1]]}"), printJSON(histogram.snapshot()));
+}
+
+void afc::HistogramTest::testLog()
+{
+	Histogram histogram;
+	histogram.record(42);
+	const HistogramSnapshot snapshot = histogram.snapshot();
+
+	std::FILE * const file = std::tmpfile();
+	CPPUNIT_ASSERT(file != nullptr);
+	CPPUNIT_ASSERT(afc::logger::logToFile<false>(file, "latency: ", snapshot));
+	CPPUNIT_ASSERT(afc::logger::logToFileFmt<false>(file, AFC_FMT("latency: #"), snapshot));
+	CPPUNIT_ASSERT(afc::logger::logPrint<const HistogramSnapshot &>(snapshot, file));
+
+	std::fflush(file);
+	std::rewind(file);
+	char buf[4096];
+	const std::size_t n = std::fread(buf, 1, sizeof(buf), file);
+	std::fclose(file);
+
+	const std::string text = "count=1 min=42 p50=42 p90=42 p99=42 p99.9=42 max=42";
+	CPPUNIT_ASSERT_EQUAL("latency: " + text + "\nlatency: " + text + '\n' + text, std::string(buf, n));
+}
@@ -0,0 +1,54 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_HISTOGRAMTEST_HPP_
+#define AFC_HISTOGRAMTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class HistogramTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(HistogramTest);
+		CPPUNIT_TEST(testBuckets);
+		CPPUNIT_TEST(testPercentiles);
+		CPPUNIT_TEST(testPercentiles_SmallCount);
+		CPPUNIT_TEST(testPercentiles_RoundingError);
+		CPPUNIT_TEST(testEmpty);
+		CPPUNIT_TEST(testConcurrentRecording);
+		CPPUNIT_TEST(testMerge);
+		CPPUNIT_TEST(testReset);
+		CPPUNIT_TEST(testFormat);
+		CPPUNIT_TEST(testPrintJSON);
+		CPPUNIT_TEST(testLog);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testBuckets();
+		void testPercentiles();
+		void testPercentiles_SmallCount();
+		void testPercentiles_RoundingError();
+		void testEmpty();
+		void testConcurrentRecording();
+		void testMerge();
+		void testReset();
+		void testFormat();
+		void testPrintJSON();
+		void testLog();
+	};
+}
+
+#endif /* AFC_HISTOGRAMTEST_HPP_ */
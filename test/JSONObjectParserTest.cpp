@@ -16,6 +16,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "JSONObjectParserTest.hpp"
 
 #include <algorithm>
+#include <cstring>
+#include <list>
 #include <string>
 
 #include <afc/json.hpp>
@@ -27,6 +29,11 @@ using std::string;
 
 CPPUNIT_TEST_SUITE_REGISTRATION(afc::JSONObjectParserTest);
 
+namespace
+{
+	constexpr auto personProperties = afc::json::propertyNames(u8"id"_s, u8"name"_s, u8"note"_s, u8"active"_s);
+}
+
 struct ErrorHandler
 {
 	bool m_valid = true;
@@ -48,6 +55,45 @@ struct ErrorHandler
 	}
 };
 
+namespace
+{
+	struct IntParser
+	{
+		int &dest;
+
+		const char *operator()(const char * const begin, const char * const end, ErrorHandler &errorHandler)
+		{
+			return afc::parseNumber<10, afc::ParseMode::scan>(begin, end, dest,
+					[&](const char * const pos) { errorHandler.malformedJson(pos); });
+		}
+	};
+
+	struct StringParser
+	{
+		string &dest;
+
+		const char *operator()(const char * const begin, const char * const end, ErrorHandler &errorHandler)
+		{
+			auto charsParser = [&](const char * const begin, const char * const end, ErrorHandler &errorHandler)
+			{
+				return afc::json::parseCharsToUTF8(begin, end, [&](const char c) { dest.push_back(c); }, errorHandler);
+			};
+			return afc::json::parseString<const char *, decltype(charsParser) &, ErrorHandler, afc::json::noSpaces>(
+					begin, end, charsParser, errorHandler);
+		}
+	};
+
+	struct BooleanParser
+	{
+		bool &dest;
+
+		const char *operator()(const char * const begin, const char * const end, ErrorHandler &errorHandler)
+		{
+			return afc::json::parseBoolean<const char *, ErrorHandler, afc::json::noSpaces>(begin, end, dest, errorHandler);
+		}
+	};
+}
+
 void afc::JSONObjectParserTest::testEmptyObject()
 {
 	bool objectBodyParserCalled = false;
@@ -371,3 +417,214 @@ void afc::JSONObjectParserTest::testObjectWithBooleanProperty_False()
 	CPPUNIT_ASSERT_EQUAL(input.end(), result);
 	CPPUNIT_ASSERT(errorHandler.valid());
 }
+
+void afc::JSONObjectParserTest::testSkipSpaces()
+{
+	const string spaces(u8" \t\n\v\f\r  \t\t\n\n\r\r  ");
+
+	// All lengths cover both the vectorised and the tail processing.
+	for (std::size_t n = 0; n <= 4 * spaces.size(); ++n) {
+		string input;
+		for (std::size_t i = 0; i < n; ++i) {
+			input.push_back(spaces[i % spaces.size()]);
+		}
+		const char * const begin = input.data();
+		const char * const end = input.data() + input.size();
+
+		CPPUNIT_ASSERT_EQUAL(end, afc::json::skipSpaces(begin, end));
+
+		input.append(u8"{ }");
+		const char * const begin2 = input.data();
+		const char * const end2 = input.data() + input.size();
+
+		CPPUNIT_ASSERT_EQUAL(begin2 + n, afc::json::skipSpaces(begin2, end2));
+		CPPUNIT_ASSERT_EQUAL(const_cast<char *>(begin2) + n,
+				afc::json::skipSpaces(const_cast<char *>(begin2), const_cast<char *>(end2)));
+	}
+}
+
+void afc::JSONObjectParserTest::testSkipSpaces_ForwardIterator()
+{
+	const std::list<char> input = {u8" "[0], u8"\t"[0], u8"\n"[0], u8"\r"[0], u8"1"[0], u8" "[0]};
+
+	const std::list<char>::const_iterator result = afc::json::skipSpaces(input.begin(), input.end());
+
+	CPPUNIT_ASSERT(result != input.end());
+	CPPUNIT_ASSERT_EQUAL(u8"1"[0], *result);
+	CPPUNIT_ASSERT(afc::json::skipSpaces(input.end(), input.end()) == input.end());
+}
+
+void afc::JSONObjectParserTest::testFindStructuralChar()
+{
+	const string structuralChars(u8"{}[]:,\"");
+
+	for (const char c : structuralChars) {
+		for (std::size_t n = 0; n <= 70; ++n) {
+			string input(n, u8"a"[0]);
+			input.push_back(c);
+			input.append(u8"bc{");
+			const char * const begin = input.data();
+			const char * const end = input.data() + input.size();
+
+			CPPUNIT_ASSERT_EQUAL(begin + n, afc::json::findStructuralChar(begin, end));
+		}
+	}
+
+	for (std::size_t n = 0; n <= 70; ++n) {
+		const string input(n, u8" "[0]);
+		const char * const begin = input.data();
+		const char * const end = input.data() + input.size();
+
+		CPPUNIT_ASSERT_EQUAL(end, afc::json::findStructuralChar(begin, end));
+	}
+
+	const std::list<char> input = {u8"1"[0], u8"2"[0], u8"]"[0]};
+	const std::list<char>::const_iterator result = afc::json::findStructuralChar(input.begin(), input.end());
+	CPPUNIT_ASSERT(result != input.end());
+	CPPUNIT_ASSERT_EQUAL(u8"]"[0], *result);
+}
+
+void afc::JSONObjectParserTest::testParseProperty()
+{
+	afc::ConstStringRef input = u8" \"name\" : \"Jan\" ,"_s;
+	int id = 0;
+	string name;
+	string note;
+	bool active = false;
+	ErrorHandler errorHandler;
+
+	const char * const result = afc::json::parseProperty(input.begin(), input.end(), personProperties, errorHandler,
+			IntParser{id}, StringParser{name}, StringParser{note}, BooleanParser{active});
+
+	CPPUNIT_ASSERT(errorHandler.valid());
+	CPPUNIT_ASSERT_EQUAL(input.end() - 1, result);
+	CPPUNIT_ASSERT_EQUAL(string("Jan"), name);
+	CPPUNIT_ASSERT_EQUAL(0, id);
+	CPPUNIT_ASSERT_EQUAL(string(), note);
+	CPPUNIT_ASSERT(!active);
+}
+
+void afc::JSONObjectParserTest::testParseProperty_EscapedName()
+{
+	// Property names with escape sequences are rejected, even if they denote a known name.
+	const afc::ConstStringRef inputs[] = {u8"\"a\\\"b\":1"_s, u8"\"na\\u006de\":\"Jan\""_s, u8"\"name\\\\\":\"Jan\""_s};
+
+	for (const afc::ConstStringRef input : inputs) {
+		int id = 0;
+		string name;
+		string note;
+		bool active = false;
+		ErrorHandler errorHandler;
+
+		const char * const result = afc::json::parseProperty(input.begin(), input.end(), personProperties,
+				errorHandler, IntParser{id}, StringParser{name}, StringParser{note}, BooleanParser{active});
+
+		CPPUNIT_ASSERT(!errorHandler.valid());
+		CPPUNIT_ASSERT_EQUAL(input.end(), result);
+		CPPUNIT_ASSERT_EQUAL(string(), name);
+		CPPUNIT_ASSERT_EQUAL(0, id);
+	}
+}
+
+void afc::JSONObjectParserTest::testParseProperties_AnyOrder()
+{
+	afc::ConstStringRef input = u8"{\"active\":true, \"note\": \"n\",\n\t\"id\" :12345 , \"name\":\"Jan\"}"_s;
+	int id = 0;
+	string name;
+	string note;
+	bool active = false;
+	ErrorHandler errorHandler;
+
+	auto objectBodyParser = [&](const char * const begin, const char * const end, ErrorHandler &errorHandler)
+	{
+		return afc::json::parseProperties(begin, end, personProperties, errorHandler,
+				IntParser{id}, StringParser{name}, StringParser{note}, BooleanParser{active});
+	};
+
+	const char * const result = afc::json::parseObject<const char *, decltype(objectBodyParser) &, ErrorHandler>
+			(input.begin(), input.end(), objectBodyParser, errorHandler);
+
+	CPPUNIT_ASSERT(errorHandler.valid());
+	CPPUNIT_ASSERT_EQUAL(input.end(), result);
+	CPPUNIT_ASSERT_EQUAL(12345, id);
+	CPPUNIT_ASSERT_EQUAL(string("Jan"), name);
+	CPPUNIT_ASSERT_EQUAL(string("n"), note);
+	CPPUNIT_ASSERT(active);
+}
+
+void afc::JSONObjectParserTest::testParseProperties_EmptyObject()
+{
+	afc::ConstStringRef input = u8"{ }"_s;
+	int id = 0;
+	string name;
+	string note;
+	bool active = false;
+	ErrorHandler errorHandler;
+
+	auto objectBodyParser = [&](const char * const begin, const char * const end, ErrorHandler &errorHandler)
+	{
+		return afc::json::parseProperties(begin, end, personProperties, errorHandler,
+				IntParser{id}, StringParser{name}, StringParser{note}, BooleanParser{active});
+	};
+
+	const char * const result = afc::json::parseObject<const char *, decltype(objectBodyParser) &, ErrorHandler>
+			(input.begin(), input.end(), objectBodyParser, errorHandler);
+
+	CPPUNIT_ASSERT(errorHandler.valid());
+	CPPUNIT_ASSERT_EQUAL(input.end(), result);
+}
+
+void afc::JSONObjectParserTest::testParseProperties_UnknownProperty()
+{
+	const char * const inputs[] = {
+			u8"{\"id\":1,\"nam\":\"Jan\"}",
+			u8"{\"id\":1,\"names\":\"Jan\"}",
+			u8"{\"id\":1,\"\":\"Jan\"}",
+			u8"{\"ID\":1}"};
+
+	for (const char * const input : inputs) {
+		int id = 0;
+		string name;
+		string note;
+		bool active = false;
+		ErrorHandler errorHandler;
+
+		auto objectBodyParser = [&](const char * const begin, const char * const end, ErrorHandler &errorHandler)
+		{
+			return afc::json::parseProperties(begin, end, personProperties, errorHandler,
+					IntParser{id}, StringParser{name}, StringParser{note}, BooleanParser{active});
+		};
+
+		afc::json::parseObject<const char *, decltype(objectBodyParser) &, ErrorHandler>
+				(input, input + std::strlen(input), objectBodyParser, errorHandler);
+
+		CPPUNIT_ASSERT(!errorHandler.valid());
+	}
+}
+
+void afc::JSONObjectParserTest::testPropertyNames_ManyNames()
+{
+	constexpr auto properties = afc::json::propertyNames(
+			u8"a"_s, u8"b"_s, u8"c"_s, u8"d"_s, u8"e"_s, u8"f"_s, u8"g"_s, u8"h"_s,
+			u8"aa"_s, u8"ab"_s, u8"ba"_s, u8"bb"_s, u8"abc"_s, u8"acb"_s, u8"bac"_s, u8"bca"_s,
+			u8"createdAt"_s, u8"updatedAt"_s, u8"deletedAt"_s, u8"userId"_s, u8"userName"_s, u8"userEmail"_s,
+			u8"x1"_s, u8"x2"_s, u8"x3"_s, u8"x4"_s, u8"x5"_s, u8"x6"_s, u8"x7"_s, u8"x8"_s, u8"x9"_s, u8""_s);
+	const char * const names[] = {
+			u8"a", u8"b", u8"c", u8"d", u8"e", u8"f", u8"g", u8"h",
+			u8"aa", u8"ab", u8"ba", u8"bb", u8"abc", u8"acb", u8"bac", u8"bca",
+			u8"createdAt", u8"updatedAt", u8"deletedAt", u8"userId", u8"userName", u8"userEmail",
+			u8"x1", u8"x2", u8"x3", u8"x4", u8"x5", u8"x6", u8"x7", u8"x8", u8"x9", u8""};
+
+	for (std::size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+		const std::size_t size = std::strlen(names[i]);
+		CPPUNIT_ASSERT_EQUAL(i, properties.find(names[i], size,
+				afc::json::_impl::propertyNameHash(names[i], size, properties.seed)));
+	}
+
+	const char * const unknownNames[] = {u8"i", u8"abd", u8"userId2", u8"x10", u8"X1"};
+	for (const char * const name : unknownNames) {
+		const std::size_t size = std::strlen(name);
+		CPPUNIT_ASSERT_EQUAL(std::size_t(32), properties.find(name, size,
+				afc::json::_impl::propertyNameHash(name, size, properties.seed)));
+	}
+}
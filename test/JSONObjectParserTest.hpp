@@ -31,6 +31,15 @@ namespace afc
 		CPPUNIT_TEST(testObjectWithIntProperty);
 		CPPUNIT_TEST(testObjectWithBooleanProperty_True);
 		CPPUNIT_TEST(testObjectWithBooleanProperty_False);
+		CPPUNIT_TEST(testSkipSpaces);
+		CPPUNIT_TEST(testSkipSpaces_ForwardIterator);
+		CPPUNIT_TEST(testFindStructuralChar);
+		CPPUNIT_TEST(testParseProperty);
+		CPPUNIT_TEST(testParseProperty_EscapedName);
+		CPPUNIT_TEST(testParseProperties_AnyOrder);
+		CPPUNIT_TEST(testParseProperties_EmptyObject);
+		CPPUNIT_TEST(testParseProperties_UnknownProperty);
+		CPPUNIT_TEST(testPropertyNames_ManyNames);
 		CPPUNIT_TEST_SUITE_END();
 	public:
 		void testEmptyObject();
@@ -40,6 +49,15 @@ namespace afc
 		void testObjectWithIntProperty();
 		void testObjectWithBooleanProperty_True();
 		void testObjectWithBooleanProperty_False();
+		void testSkipSpaces();
+		void testSkipSpaces_ForwardIterator();
+		void testFindStructuralChar();
+		void testParseProperty();
+		void testParseProperty_EscapedName();
+		void testParseProperties_AnyOrder();
+		void testParseProperties_EmptyObject();
+		void testParseProperties_UnknownProperty();
+		void testPropertyNames_ManyNames();
 	};
 }
 
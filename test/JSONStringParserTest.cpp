@@ -0,0 +1,357 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2015 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "JSONStringParserTest.hpp"
+
+#include <cstddef>
+#include <list>
+#include <string>
+
+#include <afc/FastStringBuffer.hpp>
+#include <afc/json.hpp>
+#include <afc/StringRef.hpp>
+
+using afc::operator"" _s;
+using std::string;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::JSONStringParserTest);
+
+namespace
+{
+	struct ErrorHandler
+	{
+		bool m_valid = true;
+		bool m_prematureEnd = false;
+
+		void prematureEnd()
+		{
+			m_valid = false;
+			m_prematureEnd = true;
+		}
+
+		template<typename Iterator>
+		void malformedJson(Iterator pos)
+		{
+			m_valid = false;
+		}
+
+		bool valid()
+		{
+			return m_valid;
+		}
+	};
+
+	// Collects runs of characters and counts invocations.
+	struct BulkDestination
+	{
+		string &result;
+		std::size_t &callCount;
+
+		void operator()(const char * const s, const std::size_t n)
+		{
+			result.append(s, n);
+			++callCount;
+		}
+	};
+
+	// Parses the input with both per-char and bulk destinations and checks that the results are equal.
+	bool parseString(const string &input, string &result, ErrorHandler &errorHandler)
+	{
+		string perCharResult;
+		ErrorHandler perCharErrorHandler;
+		afc::json::parseCharsToUTF8(input.data(), input.data() + input.size(),
+				[&](const char c) { perCharResult.push_back(c); }, perCharErrorHandler);
+
+		std::size_t callCount = 0;
+		afc::json::parseCharsToUTF8(input.data(), input.data() + input.size(),
+				BulkDestination{result, callCount}, errorHandler);
+
+		return perCharErrorHandler.m_valid == errorHandler.m_valid &&
+				perCharErrorHandler.m_prematureEnd == errorHandler.m_prematureEnd &&
+				(!errorHandler.m_valid || perCharResult == result);
+	}
+}
+
+void afc::JSONStringParserTest::testEmptyString()
+{
+	afc::ConstStringRef input = u8"\""_s;
+	string result;
+	std::size_t callCount = 0;
+	ErrorHandler errorHandler;
+
+	const char * const end = afc::json::parseCharsToUTF8(input.begin(), input.end(),
+			BulkDestination{result, callCount}, errorHandler);
+
+	CPPUNIT_ASSERT(errorHandler.valid());
+	CPPUNIT_ASSERT_EQUAL(input.begin(), end);
+	CPPUNIT_ASSERT_EQUAL(string(), result);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(0), callCount);
+}
+
+void afc::JSONStringParserTest::testPlainString_PerChar()
+{
+	afc::ConstStringRef input = u8"hello, world\"}"_s;
+	string result;
+	ErrorHandler errorHandler;
+
+	const char * const end = afc::json::parseCharsToUTF8(input.begin(), input.end(),
+			[&](const char c) { result.push_back(c); }, errorHandler);
+
+	CPPUNIT_ASSERT(errorHandler.valid());
+	CPPUNIT_ASSERT_EQUAL(input.begin() + 12, end);
+	CPPUNIT_ASSERT_EQUAL(string("hello, world"), result);
+}
+
+void afc::JSONStringParserTest::testPlainString_Bulk()
+{
+	afc::ConstStringRef input = u8"hello, world\"}"_s;
+	string result;
+	std::size_t callCount = 0;
+	ErrorHandler errorHandler;
+
+	const char * const end = afc::json::parseCharsToUTF8(input.begin(), input.end(),
+			BulkDestination{result, callCount}, errorHandler);
+
+	CPPUNIT_ASSERT(errorHandler.valid());
+	CPPUNIT_ASSERT_EQUAL(input.begin() + 12, end);
+	CPPUNIT_ASSERT_EQUAL(string("hello, world"), result);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(1), callCount);
+}
+
+void afc::JSONStringParserTest::testEscapedChars_PerChar()
+{
+	afc::ConstStringRef input = u8"a\\\"b\\\\c\\/d\\be\\ff\\ng\\rh\\t\""_s;
+	string result;
+	ErrorHandler errorHandler;
+
+	const char * const end = afc::json::parseCharsToUTF8(input.begin(), input.end(),
+			[&](const char c) { result.push_back(c); }, errorHandler);
+
+	CPPUNIT_ASSERT(errorHandler.valid());
+	CPPUNIT_ASSERT_EQUAL(input.end() - 1, end);
+	CPPUNIT_ASSERT_EQUAL(string("a\"b\\c/d\be\ff\ng\rh\t"), result);
+}
+
+void afc::JSONStringParserTest::testEscapedChars_Bulk()
+{
+	afc::ConstStringRef input = u8"a\\\"b\\\\c\\/d\\be\\ff\\ng\\rh\\t\""_s;
+	string result;
+	std::size_t callCount = 0;
+	ErrorHandler errorHandler;
+
+	const char * const end = afc::json::parseCharsToUTF8(input.begin(), input.end(),
+			BulkDestination{result, callCount}, errorHandler);
+
+	CPPUNIT_ASSERT(errorHandler.valid());
+	CPPUNIT_ASSERT_EQUAL(input.end() - 1, end);
+	CPPUNIT_ASSERT_EQUAL(string("a\"b\\c/d\be\ff\ng\rh\t"), result);
+	// Eight runs and eight escape sequences.
+	CPPUNIT_ASSERT_EQUAL(std::size_t(16), callCount);
+}
+
+void afc::JSONStringParserTest::testLongStrings_Bulk()
+{
+	// All lengths cover both the vectorised and the tail processing.
+	for (std::size_t n = 0; n <= 100; ++n) {
+		const string run(n, u8"x"[0]);
+		const string input = run + u8"\\n" + run + u8"\"" + run;
+		string result;
+		std::size_t callCount = 0;
+		ErrorHandler errorHandler;
+
+		const char * const end = afc::json::parseCharsToUTF8(input.data(), input.data() + input.size(),
+				BulkDestination{result, callCount}, errorHandler);
+
+		CPPUNIT_ASSERT(errorHandler.valid());
+		CPPUNIT_ASSERT_EQUAL(input.data() + 2 * n + 2, end);
+		CPPUNIT_ASSERT_EQUAL(run + u8"\n" + run, result);
+		CPPUNIT_ASSERT_EQUAL(n == 0 ? std::size_t(1) : std::size_t(3), callCount);
+	}
+}
+
+void afc::JSONStringParserTest::testBulkDestination_ForwardIterator()
+{
+	const string str(u8"ab\\tc\"");
+	const std::list<char> input(str.begin(), str.end());
+	string result;
+	std::size_t callCount = 0;
+	ErrorHandler errorHandler;
+
+	afc::json::parseCharsToUTF8(input.begin(), input.end(), BulkDestination{result, callCount}, errorHandler);
+
+	CPPUNIT_ASSERT(errorHandler.valid());
+	CPPUNIT_ASSERT_EQUAL(string("ab\tc"), result);
+	// Characters are passed in one by one for non-pointer iterators.
+	CPPUNIT_ASSERT_EQUAL(std::size_t(4), callCount);
+}
+
+void afc::JSONStringParserTest::testFastStringBufferDestination()
+{
+	afc::ConstStringRef input = u8"hello,\\tworld\""_s;
+	afc::FastStringBuffer<char> buf(input.size());
+	ErrorHandler errorHandler;
+
+	afc::json::parseCharsToUTF8(input.begin(), input.end(),
+			[&](const char * const s, const std::size_t n) { buf.append(s, n); }, errorHandler);
+
+	CPPUNIT_ASSERT(errorHandler.valid());
+	CPPUNIT_ASSERT_EQUAL(string("hello,\tworld"), string(buf.c_str()));
+}
+
+void afc::JSONStringParserTest::testInvalidEscape()
+{
+	afc::ConstStringRef input = u8"abc\\qdef\""_s;
+	string result;
+	std::size_t callCount = 0;
+	ErrorHandler errorHandler;
+
+	const char * const end = afc::json::parseCharsToUTF8(input.begin(), input.end(),
+			BulkDestination{result, callCount}, errorHandler);
+
+	CPPUNIT_ASSERT(!errorHandler.valid());
+	CPPUNIT_ASSERT(!errorHandler.m_prematureEnd);
+	CPPUNIT_ASSERT_EQUAL(input.end(), end);
+}
+
+void afc::JSONStringParserTest::testPrematureEnd()
+{
+	{
+		afc::ConstStringRef input = u8"abc\\"_s;
+		string result;
+		std::size_t callCount = 0;
+		ErrorHandler errorHandler;
+
+		const char * const end = afc::json::parseCharsToUTF8(input.begin(), input.end(),
+				BulkDestination{result, callCount}, errorHandler);
+
+		CPPUNIT_ASSERT(!errorHandler.valid());
+		CPPUNIT_ASSERT(errorHandler.m_prematureEnd);
+		CPPUNIT_ASSERT_EQUAL(input.end(), end);
+	}
+	{
+		afc::ConstStringRef input = u8"abc\\"_s;
+		string result;
+		ErrorHandler errorHandler;
+
+		const char * const end = afc::json::parseCharsToUTF8(input.begin(), input.end(),
+				[&](const char c) { result.push_back(c); }, errorHandler);
+
+		CPPUNIT_ASSERT(!errorHandler.valid());
+		CPPUNIT_ASSERT(errorHandler.m_prematureEnd);
+		CPPUNIT_ASSERT_EQUAL(input.end(), end);
+	}
+	{
+		// No closing quotation mark is found, which is detected by the caller.
+		afc::ConstStringRef input = u8"abc"_s;
+		string result;
+		std::size_t callCount = 0;
+		ErrorHandler errorHandler;
+
+		const char * const end = afc::json::parseCharsToUTF8(input.begin(), input.end(),
+				BulkDestination{result, callCount}, errorHandler);
+
+		CPPUNIT_ASSERT(errorHandler.valid());
+		CPPUNIT_ASSERT_EQUAL(input.end(), end);
+		CPPUNIT_ASSERT_EQUAL(string("abc"), result);
+	}
+}
+
+void afc::JSONStringParserTest::testUnicodeEscapes_PerChar()
+{
+	afc::ConstStringRef input = u8"\\u0041\\u00e9\\u00C9\\u20ac!\""_s;
+	string result;
+	ErrorHandler errorHandler;
+
+	const char * const end = afc::json::parseCharsToUTF8(input.begin(), input.end(),
+			[&](const char c) { result.push_back(c); }, errorHandler);
+
+	CPPUNIT_ASSERT(errorHandler.valid());
+	CPPUNIT_ASSERT_EQUAL(input.end() - 1, end);
+	CPPUNIT_ASSERT_EQUAL(string(u8"A\u00e9\u00c9\u20ac!"), result);
+}
+
+void afc::JSONStringParserTest::testUnicodeEscapes_Bulk()
+{
+	{
+		string result;
+		ErrorHandler errorHandler;
+		CPPUNIT_ASSERT(parseString(u8"Dzmitry \\u0141a\\u016d\\u010duk\"", result, errorHandler));
+		CPPUNIT_ASSERT(errorHandler.valid());
+		CPPUNIT_ASSERT_EQUAL(string(u8"Dzmitry \u0141a\u016d\u010duk"), result);
+	}
+	{
+		// The boundaries of UTF-8 sequences of different lengths.
+		string result;
+		ErrorHandler errorHandler;
+		CPPUNIT_ASSERT(parseString(u8"\\u0000\\u007f\\u0080\\u07ff\\u0800\\uffff\"", result, errorHandler));
+		CPPUNIT_ASSERT(errorHandler.valid());
+		CPPUNIT_ASSERT_EQUAL(string("\x00\x7f\xc2\x80\xdf\xbf\xe0\xa0\x80\xef\xbf\xbf", 12), result);
+	}
+}
+
+void afc::JSONStringParserTest::testUnicodeEscapes_SurrogatePair()
+{
+	{
+		string result;
+		ErrorHandler errorHandler;
+		CPPUNIT_ASSERT(parseString(u8"a\\ud83d\\ude00b\"", result, errorHandler));
+		CPPUNIT_ASSERT(errorHandler.valid());
+		CPPUNIT_ASSERT_EQUAL(string(u8"a\U0001f600b"), result);
+	}
+	{
+		string result;
+		ErrorHandler errorHandler;
+		CPPUNIT_ASSERT(parseString(u8"\\uD800\\uDC00\\uDBFF\\uDFFF\"", result, errorHandler));
+		CPPUNIT_ASSERT(errorHandler.valid());
+		CPPUNIT_ASSERT_EQUAL(string(u8"\U00010000\U0010ffff"), result);
+	}
+}
+
+void afc::JSONStringParserTest::testUnicodeEscapes_Malformed()
+{
+	const char * const inputs[] = {
+			u8"\\u00g0\"",
+			u8"\\u-123\"",
+			u8"\\u12 4\"",
+			// A lone low surrogate.
+			u8"\\udc00\"",
+			// A high surrogate not followed by a low one.
+			u8"\\ud800\"",
+			u8"\\ud800a\"",
+			u8"\\ud800\\n\"",
+			u8"\\ud800\\u0041\"",
+			u8"\\ud800\\ud800\""};
+
+	for (const char * const input : inputs) {
+		string result;
+		ErrorHandler errorHandler;
+		CPPUNIT_ASSERT(parseString(input, result, errorHandler));
+		CPPUNIT_ASSERT(!errorHandler.valid());
+		CPPUNIT_ASSERT(!errorHandler.m_prematureEnd);
+	}
+}
+
+void afc::JSONStringParserTest::testUnicodeEscapes_PrematureEnd()
+{
+	const char * const inputs[] = {u8"\\u", u8"\\u1", u8"\\u123", u8"\\ud800", u8"\\ud800\\", u8"\\ud800\\u", u8"\\ud800\\udc0"};
+
+	for (const char * const input : inputs) {
+		string result;
+		ErrorHandler errorHandler;
+		CPPUNIT_ASSERT(parseString(input, result, errorHandler));
+		CPPUNIT_ASSERT(!errorHandler.valid());
+		CPPUNIT_ASSERT(errorHandler.m_prematureEnd);
+	}
+}
@@ -0,0 +1,62 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2015 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_JSONSTRINGPARSERTEST_HPP_
+#define AFC_JSONSTRINGPARSERTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class JSONStringParserTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(JSONStringParserTest);
+		CPPUNIT_TEST(testEmptyString);
+		CPPUNIT_TEST(testPlainString_PerChar);
+		CPPUNIT_TEST(testPlainString_Bulk);
+		CPPUNIT_TEST(testEscapedChars_PerChar);
+		CPPUNIT_TEST(testEscapedChars_Bulk);
+		CPPUNIT_TEST(testLongStrings_Bulk);
+		CPPUNIT_TEST(testBulkDestination_ForwardIterator);
+		CPPUNIT_TEST(testFastStringBufferDestination);
+		CPPUNIT_TEST(testInvalidEscape);
+		CPPUNIT_TEST(testPrematureEnd);
+		CPPUNIT_TEST(testUnicodeEscapes_PerChar);
+		CPPUNIT_TEST(testUnicodeEscapes_Bulk);
+		CPPUNIT_TEST(testUnicodeEscapes_SurrogatePair);
+		CPPUNIT_TEST(testUnicodeEscapes_Malformed);
+		CPPUNIT_TEST(testUnicodeEscapes_PrematureEnd);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testEmptyString();
+		void testPlainString_PerChar();
+		void testPlainString_Bulk();
+		void testEscapedChars_PerChar();
+		void testEscapedChars_Bulk();
+		void testLongStrings_Bulk();
+		void testBulkDestination_ForwardIterator();
+		void testFastStringBufferDestination();
+		void testInvalidEscape();
+		void testPrematureEnd();
+		void testUnicodeEscapes_PerChar();
+		void testUnicodeEscapes_Bulk();
+		void testUnicodeEscapes_SurrogatePair();
+		void testUnicodeEscapes_Malformed();
+		void testUnicodeEscapes_PrematureEnd();
+	};
+}
+
+#endif /* AFC_JSONSTRINGPARSERTEST_HPP_ */
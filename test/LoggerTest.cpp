@@ -0,0 +1,348 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "LoggerTest.hpp"
+#include <afc/logger.hpp>
+#include <afc/StringRef.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+
+// POSIX API.
+#include <unistd.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::LoggerTest);
+
+namespace
+{
+	// A type that is printed only by the FILE * overload of logPrint().
+	struct Point
+	{
+		int x;
+		int y;
+	};
+}
+
+namespace afc
+{
+	namespace logger
+	{
+		template<>
+		inline bool logPrint<const Point &>(const Point &val, std::FILE * const dest)
+		{
+			return std::fprintf(dest, "(%d, %d)", val.x, val.y) > 0;
+		}
+	}
+}
+
+namespace
+{
+	class TempFile
+	{
+	public:
+		TempFile() : m_file(std::tmpfile()) { CPPUNIT_ASSERT(m_file != nullptr); }
+		TempFile(const TempFile &) = delete;
+		TempFile &operator=(const TempFile &) = delete;
+		~TempFile() { std::fclose(m_file); }
+
+		std::FILE *file() const noexcept { return m_file; }
+
+		std::string content() const
+		{
+			std::fflush(m_file);
+			std::rewind(m_file);
+			std::string result;
+			char buf[4096];
+			std::size_t n;
+			while ((n = std::fread(buf, 1, sizeof(buf), m_file)) > 0) {
+				result.append(buf, n);
+			}
+			return result;
+		}
+	private:
+		std::FILE * const m_file;
+	};
+
+	// Redirects a standard stream to a temporary file while alive.
+	class OutputCapture
+	{
+	public:
+		explicit OutputCapture(std::FILE * const stream) : m_stream(stream), m_fd(::fileno(stream)), m_savedFd(::dup(m_fd))
+		{
+			CPPUNIT_ASSERT(m_savedFd >= 0);
+			std::fflush(m_stream);
+			CPPUNIT_ASSERT(::dup2(::fileno(m_file.file()), m_fd) >= 0);
+		}
+		OutputCapture(const OutputCapture &) = delete;
+		OutputCapture &operator=(const OutputCapture &) = delete;
+		~OutputCapture() { restore(); }
+
+		std::string content()
+		{
+			restore();
+			return m_file.content();
+		}
+	private:
+		void restore()
+		{
+			if (m_savedFd >= 0) {
+				std::fflush(m_stream);
+				::dup2(m_savedFd, m_fd);
+				::close(m_savedFd);
+				m_savedFd = -1;
+			}
+		}
+
+		TempFile m_file;
+		std::FILE * const m_stream;
+		const int m_fd;
+		int m_savedFd;
+	};
+
+	int evaluationCount = 0;
+
+	int evaluate(const int value)
+	{
+		++evaluationCount;
+		return value;
+	}
+}
+
+void afc::LoggerTest::testLogToFile()
+{
+	using afc::operator"" _s;
+
+	TempFile f;
+	CPPUNIT_ASSERT(afc::logger::logToFile<false>(f.file(), "a"_s, 1, ' ', -2L, ' ', false, "b"));
+	CPPUNIT_ASSERT(afc::logger::logToFile<true>(f.file()));
+
+	CPPUNIT_ASSERT_EQUAL(std::string("a1 -2 falseb\n\n"), f.content());
+}
+
+void afc::LoggerTest::testLogToFile_Unbuffered()
+{
+	using afc::operator"" _s;
+
+	TempFile f;
+	CPPUNIT_ASSERT_EQUAL(0, std::setvbuf(f.file(), nullptr, _IONBF, 0));
+
+	const unsigned char data[] = {0x01, 0xab, 0xff};
+	CPPUNIT_ASSERT(afc::logger::logToFile<false>(f.file(), "hex: "_s, afc::logger::HexEncodedN<3>(data),
+			' ', 1.5, ' ', std::numeric_limits<long long>::min()));
+
+	CPPUNIT_ASSERT_EQUAL(std::string("hex: 01abff 1.5 -9223372036854775808\n"), f.content());
+}
+
+void afc::LoggerTest::testLogToFile_LargeRecord()
+{
+	TempFile f;
+	const std::string large(100000, 'q');
+
+	// The thread-local buffer grows for the large record and is reused for the small ones.
+	CPPUNIT_ASSERT(afc::logger::logToFile<false>(f.file(), 1, large.c_str(), 2));
+	CPPUNIT_ASSERT(afc::logger::logToFile<false>(f.file(), "small"));
+	CPPUNIT_ASSERT(afc::logger::logToFileFmt<false>(f.file(), AFC_FMT("[#]"), large.c_str()));
+
+	CPPUNIT_ASSERT_EQUAL("1" + large + "2\nsmall\n[" + large + "]\n", f.content());
+}
+
+void afc::LoggerTest::testLogToFile_FileOnlyType()
+{
+	const Point p{1, -2};
+
+	TempFile f;
+	CPPUNIT_ASSERT(afc::logger::logToFile<false>(f.file(), "p=", p, ' ', 3));
+	CPPUNIT_ASSERT(afc::logger::logToFileFmt<false>(f.file(), AFC_FMT("p=#!"), p));
+	CPPUNIT_ASSERT(afc::logger::logToFileFmt<false>(f.file(), "p=#", p));
+
+	CPPUNIT_ASSERT_EQUAL(std::string("p=(1, -2) 3\np=(1, -2)!\np=(1, -2)\n"), f.content());
+}
+
+void afc::LoggerTest::testLogToFileFmt()
+{
+	TempFile f;
+	CPPUNIT_ASSERT(afc::logger::logToFileFmt<false>(f.file(), "#: # \\# #", "x", 12, true));
+	CPPUNIT_ASSERT(!afc::logger::logToFileFmt<false>(f.file(), "# #", 1));
+
+	CPPUNIT_ASSERT_EQUAL(std::string("x: 12 # true\n1 \n"), f.content());
+}
+
+void afc::LoggerTest::testLogToFileFmt_CompileTimeFormat()
+{
+	TempFile f;
+	CPPUNIT_ASSERT(afc::logger::logToFileFmt<false>(f.file(), AFC_FMT("#: # \\# #"), "x", 12, true));
+	CPPUNIT_ASSERT(afc::logger::logToFileFmt<false>(f.file(), AFC_FMT("no placeholders")));
+	CPPUNIT_ASSERT(afc::logger::logToFileFmt<false>(f.file(), AFC_FMT("##"), 'a', 'b'));
+	CPPUNIT_ASSERT(afc::logger::logToFileFmt<true>(f.file(), AFC_FMT("")));
+	CPPUNIT_ASSERT(afc::logger::logToFileFmt<false>(f.file(), AFC_FMT("\\\\#\\a"), 5u));
+
+	CPPUNIT_ASSERT_EQUAL(std::string("x: 12 # true\nno placeholders\nab\n\n\\5a\n"), f.content());
+}
+
+void afc::LoggerTest::testLogModule_Levels()
+{
+	using afc::logger::LogLevel;
+
+	afc::logger::LogModule module("LoggerTest.levels", LogLevel::debug);
+	CPPUNIT_ASSERT_EQUAL(std::string("LoggerTest.levels"), std::string(module.name()));
+	CPPUNIT_ASSERT(module.level() == LogLevel::debug);
+	CPPUNIT_ASSERT(!module.enabled(LogLevel::trace));
+	CPPUNIT_ASSERT(module.enabled(LogLevel::debug));
+	CPPUNIT_ASSERT(module.enabled(LogLevel::error));
+
+	module.setLevel(LogLevel::trace);
+	CPPUNIT_ASSERT(module.enabled(LogLevel::trace));
+
+	module.setLevel(LogLevel::off);
+	CPPUNIT_ASSERT(!module.enabled(LogLevel::trace));
+	CPPUNIT_ASSERT(!module.enabled(LogLevel::debug));
+	CPPUNIT_ASSERT(!module.enabled(LogLevel::error));
+}
+
+void afc::LoggerTest::testSetLogLevel_ByName()
+{
+	using afc::logger::LogLevel;
+	using afc::logger::LogModule;
+	using afc::logger::setLogLevel;
+
+	LogModule module1("LoggerTest.byName", LogLevel::error);
+	LogModule module2("LoggerTest.byName", LogLevel::error);
+	LogModule other("LoggerTest.other", LogLevel::error);
+
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2), setLogLevel("LoggerTest.byName", LogLevel::trace));
+	CPPUNIT_ASSERT(module1.level() == LogLevel::trace);
+	CPPUNIT_ASSERT(module2.level() == LogLevel::trace);
+	CPPUNIT_ASSERT(other.level() == LogLevel::error);
+
+	// The level set by name overrides the initial level of modules created later.
+	CPPUNIT_ASSERT_EQUAL(std::size_t(0), setLogLevel("LoggerTest.later", LogLevel::debug));
+	{
+		LogModule later("LoggerTest.later", LogLevel::off);
+		CPPUNIT_ASSERT(later.level() == LogLevel::debug);
+		CPPUNIT_ASSERT_EQUAL(std::size_t(1), setLogLevel("LoggerTest.later", LogLevel::error));
+		CPPUNIT_ASSERT(later.level() == LogLevel::error);
+	}
+	// Destroyed modules are unregistered.
+	CPPUNIT_ASSERT_EQUAL(std::size_t(0), setLogLevel("LoggerTest.later", LogLevel::error));
+}
+
+void afc::LoggerTest::testModuleLog_LazyArguments()
+{
+	using afc::logger::LogLevel;
+
+	afc::logger::LogModule module("LoggerTest.lazy", LogLevel::error);
+	evaluationCount = 0;
+
+	OutputCapture capture(stdout);
+	CPPUNIT_ASSERT(AFC_MODULE_LOG(module, debug, "disabled ", evaluate(1)));
+	CPPUNIT_ASSERT(AFC_MODULE_LOG(module, trace, AFC_FMT("disabled #"), evaluate(2)));
+	CPPUNIT_ASSERT_EQUAL(0, evaluationCount);
+
+	module.setLevel(LogLevel::debug);
+	CPPUNIT_ASSERT(AFC_MODULE_LOG(module, debug, "enabled ", evaluate(3)));
+	CPPUNIT_ASSERT(AFC_MODULE_LOG(module, debug, AFC_FMT("enabled #"), evaluate(4)));
+	CPPUNIT_ASSERT(AFC_MODULE_LOG(module, trace, "disabled ", evaluate(5)));
+	CPPUNIT_ASSERT_EQUAL(2, evaluationCount);
+
+	CPPUNIT_ASSERT_EQUAL(std::string("enabled 3\nenabled 4\n"), capture.content());
+}
+
+void afc::LoggerTest::testLogErrorEveryN()
+{
+	afc::logger::LogSampler site;
+	OutputCapture capture(stderr);
+	for (int i = 0; i < 7; ++i) {
+		CPPUNIT_ASSERT(afc::logger::logErrorEveryN(site, 3, "record ", i));
+	}
+	CPPUNIT_ASSERT(afc::logger::logErrorEveryN(site, 3, AFC_FMT("record #"), 7));
+
+	CPPUNIT_ASSERT_EQUAL(std::string(
+			"record 0\n"
+			"record 3\nafc::logger: 2 similar records suppressed\n"
+			"record 6\nafc::logger: 2 similar records suppressed\n"), capture.content());
+}
+
+void afc::LoggerTest::testLogErrorEveryN_Macro()
+{
+	evaluationCount = 0;
+
+	OutputCapture capture(stderr);
+	for (int i = 0; i < 5; ++i) {
+		CPPUNIT_ASSERT(AFC_LOG_ERROR_EVERY_N(2, AFC_FMT("record #"), evaluate(i)));
+	}
+	CPPUNIT_ASSERT_EQUAL(3, evaluationCount);
+
+	CPPUNIT_ASSERT_EQUAL(std::string(
+			"record 0\n"
+			"record 2\nafc::logger: 1 similar records suppressed\n"
+			"record 4\nafc::logger: 1 similar records suppressed\n"), capture.content());
+}
+
+void afc::LoggerTest::testLogRateLimiter()
+{
+	constexpr std::uint64_t millisecond = 1000000;
+	const std::uint64_t t = std::uint64_t(1000) * 1000 * millisecond;
+
+	// A token is added every 50 ms; two tokens at most.
+	afc::logger::LogRateLimiter site(20, 2);
+	std::uint64_t suppressed = 99;
+	CPPUNIT_ASSERT(site.acquire(t, suppressed));
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), suppressed);
+	CPPUNIT_ASSERT(site.acquire(t, suppressed));
+	CPPUNIT_ASSERT(!site.acquire(t, suppressed));
+	CPPUNIT_ASSERT(!site.acquire(t + 10 * millisecond, suppressed));
+	CPPUNIT_ASSERT(!site.acquire(t + 49 * millisecond, suppressed));
+
+	CPPUNIT_ASSERT(site.acquire(t + 50 * millisecond, suppressed));
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(3), suppressed);
+	CPPUNIT_ASSERT(!site.acquire(t + 60 * millisecond, suppressed));
+
+	// The bucket does not hold more than two tokens after a long pause.
+	CPPUNIT_ASSERT(site.acquire(t + 10000 * millisecond, suppressed));
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), suppressed);
+	CPPUNIT_ASSERT(site.acquire(t + 10000 * millisecond, suppressed));
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), suppressed);
+	CPPUNIT_ASSERT(!site.acquire(t + 10000 * millisecond, suppressed));
+}
+
+void afc::LoggerTest::testLogErrorRateLimited()
+{
+	/* The limiter reads the real clock here, so only the bounds that hold under any
+	 * scheduling delay are checked; the rate itself is checked by testLogRateLimiter().
+	 */
+	afc::logger::LogRateLimiter site(1, 2);
+	evaluationCount = 0;
+
+	OutputCapture capture(stderr);
+	for (int i = 0; i < 5; ++i) {
+		CPPUNIT_ASSERT(afc::logger::logErrorRateLimited(site, "record ", i));
+	}
+	for (int i = 0; i < 5; ++i) {
+		CPPUNIT_ASSERT(AFC_LOG_ERROR_RATE_LIMITED(1, 1, AFC_FMT("macro #"), evaluate(i)));
+	}
+	const std::string text = capture.content();
+
+	// The bucket is full at first.
+	CPPUNIT_ASSERT_EQUAL(std::string("record 0\nrecord 1\n"), text.substr(0, 18));
+	CPPUNIT_ASSERT(text.find("macro 0\n") != std::string::npos);
+	// The arguments are evaluated for the records logged only.
+	CPPUNIT_ASSERT(evaluationCount >= 1);
+	std::size_t macroRecords = 0;
+	for (std::size_t pos = text.find("macro "); pos != std::string::npos; pos = text.find("macro ", pos + 1)) {
+		++macroRecords;
+	}
+	CPPUNIT_ASSERT_EQUAL(std::size_t(evaluationCount), macroRecords);
+}
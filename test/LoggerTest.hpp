@@ -0,0 +1,58 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_LOGGERTEST_HPP_
+#define AFC_LOGGERTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class LoggerTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(LoggerTest);
+		CPPUNIT_TEST(testLogToFile);
+		CPPUNIT_TEST(testLogToFile_Unbuffered);
+		CPPUNIT_TEST(testLogToFile_LargeRecord);
+		CPPUNIT_TEST(testLogToFile_FileOnlyType);
+		CPPUNIT_TEST(testLogToFileFmt);
+		CPPUNIT_TEST(testLogToFileFmt_CompileTimeFormat);
+		CPPUNIT_TEST(testLogModule_Levels);
+		CPPUNIT_TEST(testSetLogLevel_ByName);
+		CPPUNIT_TEST(testModuleLog_LazyArguments);
+		CPPUNIT_TEST(testLogErrorEveryN);
+		CPPUNIT_TEST(testLogErrorEveryN_Macro);
+		CPPUNIT_TEST(testLogRateLimiter);
+		CPPUNIT_TEST(testLogErrorRateLimited);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testLogToFile();
+		void testLogToFile_Unbuffered();
+		void testLogToFile_LargeRecord();
+		void testLogToFile_FileOnlyType();
+		void testLogToFileFmt();
+		void testLogToFileFmt_CompileTimeFormat();
+		void testLogModule_Levels();
+		void testSetLogLevel_ByName();
+		void testModuleLog_LazyArguments();
+		void testLogErrorEveryN();
+		void testLogErrorEveryN_Macro();
+		void testLogRateLimiter();
+		void testLogErrorRateLimited();
+	};
+}
+
+#endif /* AFC_LOGGERTEST_HPP_ */
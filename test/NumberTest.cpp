@@ -14,7 +14,10 @@ GNU Lesser General Public License for more details.
 You should have received a copy of the GNU Lesser General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "NumberTest.hpp"
+#include <cstring>
+#include <iterator>
 #include <limits>
+#include <list>
 #include <string>
 #include <afc/number.h>
 #include <afc/StringRef.hpp>
@@ -23,6 +26,53 @@ using namespace std;
 
 CPPUNIT_TEST_SUITE_REGISTRATION(afc::NumberTest);
 
+namespace
+{
+	template<typename T>
+	bool parseInt(const string &input, T &result, std::size_t &errorPosition)
+	{
+		bool errorReported = false;
+		errorPosition = input.size() + 1;
+		afc::parseNumber<10>(input.data(), input.data() + input.size(), result,
+				[&](const char * const pos) { errorReported = true; errorPosition = pos - input.data(); });
+		return !errorReported;
+	}
+
+	template<typename T>
+	T parseFloat(const string &input)
+	{
+		T result = 1;
+		const char * const end = afc::parseNumber<10>(input.data(), input.data() + input.size(), result,
+				[&](const char *) { CPPUNIT_FAIL("parse error: " + input); });
+		CPPUNIT_ASSERT_EQUAL(input.data() + input.size(), end);
+		return result;
+	}
+
+	template<typename T>
+	bool sameBits(const T expected, const T actual)
+	{
+		return std::memcmp(&expected, &actual, sizeof(T)) == 0;
+	}
+
+	template<typename T>
+	string printFloat(const T value)
+	{
+		char buf[afc::maxPrintedSize<T, 10>()];
+		char * const end = afc::printNumber<10>(value, buf);
+		return string(buf, end);
+	}
+
+	template<typename T>
+	bool malformedFloat(const string &input)
+	{
+		T result = 1;
+		bool errorReported = false;
+		afc::parseNumber<10>(input.data(), input.data() + input.size(), result,
+				[&](const char *) { errorReported = true; });
+		return errorReported;
+	}
+}
+
 void afc::NumberTest::testAppendNumber_Int()
 {
 	{
@@ -85,6 +135,62 @@ void afc::NumberTest::testAppendNumber_MinSignedLongLong()
 	}
 }
 
+void afc::NumberTest::testPrintNumber_DecimalInts()
+{
+	char buf[afc::maxPrintedSize<long long, 10>() + 1];
+	buf[sizeof(buf) - 1] = 'x';
+
+	// All digit counts, including the values next to powers of ten.
+	unsigned long long power = 1;
+	for (int i = 0; i < 20; ++i) {
+		const unsigned long long values[] = {power - 1, power, power + 1, power * 5};
+		for (const unsigned long long value : values) {
+			char * const end = printNumber<10>(value, buf);
+			CPPUNIT_ASSERT_EQUAL(std::to_string(value), string(buf, end));
+		}
+		power *= 10;
+	}
+
+	char *end = printNumber<10>(std::numeric_limits<unsigned long long>::max(), buf);
+	CPPUNIT_ASSERT_EQUAL(string("18446744073709551615"), string(buf, end));
+	end = printNumber<10>(std::numeric_limits<long long>::min(), buf);
+	CPPUNIT_ASSERT_EQUAL(string("-9223372036854775808"), string(buf, end));
+	end = printNumber<10>(std::numeric_limits<int>::min(), buf);
+	CPPUNIT_ASSERT_EQUAL(std::to_string(std::numeric_limits<int>::min()), string(buf, end));
+	end = printNumber<10>(static_cast<signed char>(-128), buf);
+	CPPUNIT_ASSERT_EQUAL(string("-128"), string(buf, end));
+	end = printNumber<10>(static_cast<unsigned char>(255), buf);
+	CPPUNIT_ASSERT_EQUAL(string("255"), string(buf, end));
+	end = printNumber<10>(0, buf);
+	CPPUNIT_ASSERT_EQUAL(string("0"), string(buf, end));
+	end = printNumber<10>(-7, buf);
+	CPPUNIT_ASSERT_EQUAL(string("-7"), string(buf, end));
+	// Nothing is written beyond the number.
+	CPPUNIT_ASSERT_EQUAL('x', buf[sizeof(buf) - 1]);
+}
+
+void afc::NumberTest::testPrintNumber_DecimalInts_Iterator()
+{
+	const long long values[] = {0, 9, 10, 99, 100, -12345, 1234567890123LL, std::numeric_limits<long long>::max(),
+			std::numeric_limits<long long>::min()};
+	for (const long long value : values) {
+		string result;
+		printNumber<10>(value, std::back_inserter(result));
+		CPPUNIT_ASSERT_EQUAL(std::to_string(value), result);
+	}
+}
+
+void afc::NumberTest::testPrintNumber_HexInts()
+{
+	string result;
+	printNumber<16>(0xfa09, std::back_inserter(result));
+	CPPUNIT_ASSERT_EQUAL(string("fa09"), result);
+
+	char buf[afc::maxPrintedSize<int, 16>()];
+	char * const end = printNumber<16>(-0x7b, buf);
+	CPPUNIT_ASSERT_EQUAL(string("-7b"), string(buf, end));
+}
+
 void afc::NumberTest::testParseNumber_DecimalInts()
 {
 	{
@@ -257,6 +363,99 @@ void afc::NumberTest::testParseNumber_HexUnsignedInts()
 	}
 }
 
+void afc::NumberTest::testParseNumber_LongDecimalInts()
+{
+	std::size_t errorPosition;
+	long long result = 0;
+	int intResult = 0;
+
+	CPPUNIT_ASSERT(parseInt<long long>("1234567890123456789", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(1234567890123456789LL, result);
+	CPPUNIT_ASSERT(parseInt<long long>("-1234567890123", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(-1234567890123LL, result);
+	CPPUNIT_ASSERT(parseInt<long long>("12345678", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(12345678LL, result);
+	CPPUNIT_ASSERT(parseInt<long long>("000000000000000000000000000042", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(42LL, result);
+	CPPUNIT_ASSERT(parseInt<int>("1234567890", intResult, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(1234567890, intResult);
+
+	result = 1;
+	CPPUNIT_ASSERT(!parseInt<long long>("123456789012x", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(12), errorPosition);
+	CPPUNIT_ASSERT_EQUAL(1LL, result);
+	CPPUNIT_ASSERT(!parseInt<long long>("1234567:", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(7), errorPosition);
+	CPPUNIT_ASSERT(!parseInt<long long>("1234/5678", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(4), errorPosition);
+	CPPUNIT_ASSERT(!parseInt<long long>("-x2345678", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(1), errorPosition);
+}
+
+void afc::NumberTest::testParseNumber_DecimalIntLimits()
+{
+	std::size_t errorPosition;
+	long long result;
+	unsigned long long unsignedResult;
+	int intResult;
+
+	CPPUNIT_ASSERT(parseInt<long long>("9223372036854775807", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::numeric_limits<long long>::max(), result);
+	CPPUNIT_ASSERT(parseInt<long long>("-9223372036854775808", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::numeric_limits<long long>::min(), result);
+	CPPUNIT_ASSERT(parseInt<unsigned long long>("18446744073709551615", unsignedResult, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::numeric_limits<unsigned long long>::max(), unsignedResult);
+	CPPUNIT_ASSERT(parseInt<int>("-2147483648", intResult, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::numeric_limits<int>::min(), intResult);
+
+	// Overflow is reported at the digit that causes it.
+	CPPUNIT_ASSERT(!parseInt<long long>("9223372036854775808", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(18), errorPosition);
+	CPPUNIT_ASSERT(!parseInt<long long>("-9223372036854775809", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(19), errorPosition);
+	CPPUNIT_ASSERT(!parseInt<unsigned long long>("18446744073709551616", unsignedResult, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(19), errorPosition);
+	CPPUNIT_ASSERT(!parseInt<int>("2147483648", intResult, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(9), errorPosition);
+	CPPUNIT_ASSERT(!parseInt<int>("12345678901", intResult, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(10), errorPosition);
+}
+
+void afc::NumberTest::testParseNumber_DecimalIntsScanMode()
+{
+	const string input = "1700000000123,42,-98765432109;";
+	const char *p = input.data();
+	const char * const end = input.data() + input.size();
+	long long values[3];
+
+	for (long long &value : values) {
+		p = parseNumber<10, ParseMode::scan>(p, end, value, [](const char *) { CPPUNIT_FAIL("parse error"); });
+		++p;
+	}
+
+	CPPUNIT_ASSERT_EQUAL(1700000000123LL, values[0]);
+	CPPUNIT_ASSERT_EQUAL(42LL, values[1]);
+	CPPUNIT_ASSERT_EQUAL(-98765432109LL, values[2]);
+	CPPUNIT_ASSERT_EQUAL(end, p);
+}
+
+void afc::NumberTest::testParseNumber_SignedCharMalformed()
+{
+	std::size_t errorPosition;
+	signed char result = 1;
+
+	CPPUNIT_ASSERT(parseInt<signed char>("-128", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(static_cast<signed char>(-128), result);
+	CPPUNIT_ASSERT(!parseInt<signed char>("x", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(0), errorPosition);
+	CPPUNIT_ASSERT(!parseInt<signed char>("1x", result, errorPosition));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(1), errorPosition);
+
+	bool errorReported = false;
+	parseNumber<10>("1 ", result, [&](const char *) { errorReported = true; });
+	CPPUNIT_ASSERT(errorReported);
+}
+
 void afc::NumberTest::testParseNumberCString_DecimalInts()
 {
 	{
@@ -425,3 +624,256 @@ void afc::NumberTest::testParseNumberCString_HexUnsignedInts()
 		CPPUNIT_ASSERT_EQUAL(zero.end(), iteratorZero);
 	}
 }
+
+void afc::NumberTest::testPrintNumber_Doubles()
+{
+	CPPUNIT_ASSERT_EQUAL(string("0"), printFloat(0.));
+	CPPUNIT_ASSERT_EQUAL(string("1"), printFloat(1.));
+	CPPUNIT_ASSERT_EQUAL(string("-1"), printFloat(-1.));
+	CPPUNIT_ASSERT_EQUAL(string("0.1"), printFloat(0.1));
+	CPPUNIT_ASSERT_EQUAL(string("0.30000000000000004"), printFloat(0.1 + 0.2));
+	CPPUNIT_ASSERT_EQUAL(string("0.3333333333333333"), printFloat(1. / 3));
+	CPPUNIT_ASSERT_EQUAL(string("123.456"), printFloat(123.456));
+	CPPUNIT_ASSERT_EQUAL(string("-2.5"), printFloat(-2.5));
+	CPPUNIT_ASSERT_EQUAL(string("9007199254740992"), printFloat(9007199254740992.));
+	CPPUNIT_ASSERT_EQUAL(string("1e+23"), printFloat(1e23));
+	CPPUNIT_ASSERT_EQUAL(string("5e-324"), printFloat(numeric_limits<double>::denorm_min()));
+	CPPUNIT_ASSERT_EQUAL(string("2.2250738585072014e-308"), printFloat(numeric_limits<double>::min()));
+	CPPUNIT_ASSERT_EQUAL(string("1.7976931348623157e+308"), printFloat(numeric_limits<double>::max()));
+	CPPUNIT_ASSERT_EQUAL(string("-1.7976931348623157e+308"), printFloat(numeric_limits<double>::lowest()));
+	// Powers of two have the closer lower boundary.
+	CPPUNIT_ASSERT_EQUAL(string("8.98846567431158e+307"), printFloat(8.98846567431158e307));
+	CPPUNIT_ASSERT_EQUAL(string("9.5367431640625e-7"), printFloat(9.5367431640625e-7));
+}
+
+void afc::NumberTest::testPrintNumber_DoubleNotation()
+{
+	CPPUNIT_ASSERT_EQUAL(string("100"), printFloat(100.));
+	CPPUNIT_ASSERT_EQUAL(string("123456789012345680000"), printFloat(123456789012345678901.));
+	CPPUNIT_ASSERT_EQUAL(string("1e+21"), printFloat(1e21));
+	CPPUNIT_ASSERT_EQUAL(string("1.5e+21"), printFloat(1.5e21));
+	CPPUNIT_ASSERT_EQUAL(string("12345.678"), printFloat(12345.678));
+	CPPUNIT_ASSERT_EQUAL(string("0.000001"), printFloat(1e-6));
+	CPPUNIT_ASSERT_EQUAL(string("-0.0000012345"), printFloat(-1.2345e-6));
+	CPPUNIT_ASSERT_EQUAL(string("1e-7"), printFloat(1e-7));
+	CPPUNIT_ASSERT_EQUAL(string("1.2345e-7"), printFloat(1.2345e-7));
+	CPPUNIT_ASSERT_EQUAL(string("-1.5e+300"), printFloat(-1.5e300));
+}
+
+void afc::NumberTest::testPrintNumber_DoubleSpecialValues()
+{
+	CPPUNIT_ASSERT_EQUAL(string("-0"), printFloat(-0.));
+	CPPUNIT_ASSERT_EQUAL(string("NaN"), printFloat(numeric_limits<double>::quiet_NaN()));
+	CPPUNIT_ASSERT_EQUAL(string("Infinity"), printFloat(numeric_limits<double>::infinity()));
+	CPPUNIT_ASSERT_EQUAL(string("-Infinity"), printFloat(-numeric_limits<double>::infinity()));
+	CPPUNIT_ASSERT_EQUAL(string("NaN"), printFloat(numeric_limits<float>::quiet_NaN()));
+	CPPUNIT_ASSERT_EQUAL(string("-Infinity"), printFloat(-numeric_limits<float>::infinity()));
+}
+
+void afc::NumberTest::testPrintNumber_DoubleRoundTrip()
+{
+	// Walking through all binary exponents with a few mantissas.
+	const std::uint64_t mantissas[] = {0, 1, 0x123456789abcd, 0xfffffffffffff};
+	for (std::uint64_t exponent = 0; exponent < 0x7ff; ++exponent) {
+		for (const std::uint64_t mantissa : mantissas) {
+			const std::uint64_t bits = exponent << 52 | mantissa;
+			double value;
+			std::memcpy(&value, &bits, sizeof(double));
+
+			const string printed = printFloat(value);
+			CPPUNIT_ASSERT(printed.size() <= (afc::maxPrintedSize<double, 10>()));
+			CPPUNIT_ASSERT(sameBits(value, parseFloat<double>(printed)));
+		}
+	}
+}
+
+void afc::NumberTest::testPrintNumber_Floats()
+{
+	CPPUNIT_ASSERT_EQUAL(string("0.1"), printFloat(0.1f));
+	CPPUNIT_ASSERT_EQUAL(string("0.3"), printFloat(0.3f));
+	CPPUNIT_ASSERT_EQUAL(string("3.1415927"), printFloat(3.14159265358979f));
+	CPPUNIT_ASSERT_EQUAL(string("16777216"), printFloat(16777216.f));
+	CPPUNIT_ASSERT_EQUAL(string("-1e-7"), printFloat(-1e-7f));
+	CPPUNIT_ASSERT_EQUAL(string("1e-45"), printFloat(numeric_limits<float>::denorm_min()));
+	CPPUNIT_ASSERT_EQUAL(string("1.1754944e-38"), printFloat(numeric_limits<float>::min()));
+	CPPUNIT_ASSERT_EQUAL(string("3.4028235e+38"), printFloat(numeric_limits<float>::max()));
+	CPPUNIT_ASSERT_EQUAL(string("-0"), printFloat(-0.f));
+}
+
+void afc::NumberTest::testParseNumber_Doubles()
+{
+	CPPUNIT_ASSERT_EQUAL(0., parseFloat<double>("0"));
+	CPPUNIT_ASSERT_EQUAL(1., parseFloat<double>("1"));
+	CPPUNIT_ASSERT_EQUAL(-1., parseFloat<double>("-1"));
+	CPPUNIT_ASSERT_EQUAL(123.456, parseFloat<double>("123.456"));
+	CPPUNIT_ASSERT_EQUAL(-0.001, parseFloat<double>("-0.001"));
+	CPPUNIT_ASSERT_EQUAL(1.5e10, parseFloat<double>("1.5e10"));
+	CPPUNIT_ASSERT_EQUAL(1.5e10, parseFloat<double>("1.5E+10"));
+	CPPUNIT_ASSERT_EQUAL(2.5e-7, parseFloat<double>("25e-8"));
+	CPPUNIT_ASSERT_EQUAL(0.5, parseFloat<double>(".5"));
+	CPPUNIT_ASSERT_EQUAL(5., parseFloat<double>("5."));
+	CPPUNIT_ASSERT_EQUAL(1., parseFloat<double>("0001.000"));
+	CPPUNIT_ASSERT_EQUAL(3.141592653589793, parseFloat<double>("3.141592653589793238462643383279"));
+	CPPUNIT_ASSERT_EQUAL(1e23, parseFloat<double>("1e23"));
+	CPPUNIT_ASSERT_EQUAL(8.589973e9, parseFloat<double>("8.589973e9"));
+	CPPUNIT_ASSERT_EQUAL(123456789012345678901234567890., parseFloat<double>("123456789012345678901234567890"));
+	CPPUNIT_ASSERT_EQUAL(1e-300, parseFloat<double>("0.000000000000000000000000000000000001e-264"));
+
+	CPPUNIT_ASSERT(sameBits(-0., parseFloat<double>("-0")));
+	CPPUNIT_ASSERT(sameBits(-0., parseFloat<double>("-0.0e10")));
+	CPPUNIT_ASSERT(sameBits(0., parseFloat<double>("0e-999999999999")));
+
+	const string input = "-12.75e1";
+	const list<char> listInput(input.begin(), input.end());
+	double result = 0;
+	const list<char>::const_iterator end = parseNumber<10>(listInput.begin(), listInput.end(), result,
+			[](list<char>::const_iterator) { CPPUNIT_FAIL("parse error"); });
+	CPPUNIT_ASSERT_EQUAL(-127.5, result);
+	CPPUNIT_ASSERT(end == listInput.end());
+}
+
+void afc::NumberTest::testParseNumber_DoubleRounding()
+{
+	// Halfway between 2^53 and 2^53 + 2: rounded to even.
+	CPPUNIT_ASSERT_EQUAL(9007199254740992., parseFloat<double>("9007199254740993"));
+	// Slightly above halfway due to a digit beyond 19 significant ones.
+	CPPUNIT_ASSERT_EQUAL(9007199254740994., parseFloat<double>("9007199254740993.0000000000000000000000001"));
+	CPPUNIT_ASSERT_EQUAL(9007199254740992., parseFloat<double>("9007199254740993.0000000000000000000000000"));
+	CPPUNIT_ASSERT_EQUAL(9007199254740996., parseFloat<double>("9007199254740995"));
+
+	// Halfway between 1 and the next double followed by many digits.
+	CPPUNIT_ASSERT_EQUAL(1., parseFloat<double>("1.00000000000000011102230246251565404236316680908203125"));
+	CPPUNIT_ASSERT_EQUAL(1.0000000000000002,
+			parseFloat<double>("1.00000000000000011102230246251565404236316680908203125000000000000000001"));
+	CPPUNIT_ASSERT_EQUAL(1., parseFloat<double>("1.00000000000000011102230246251565404236316680908203124999999999999"));
+
+	// The smallest subnormal number and halfway between zero and it.
+	CPPUNIT_ASSERT_EQUAL(4.9406564584124654e-324, parseFloat<double>("4.9406564584124654e-324"));
+	CPPUNIT_ASSERT_EQUAL(0., parseFloat<double>("2.4703282292062327e-324"));
+	CPPUNIT_ASSERT_EQUAL(4.9406564584124654e-324, parseFloat<double>("2.4703282292062328e-324"));
+	// The largest subnormal number and the smallest normal number.
+	CPPUNIT_ASSERT_EQUAL(2.2250738585072009e-308, parseFloat<double>("2.2250738585072009e-308"));
+	CPPUNIT_ASSERT_EQUAL(2.2250738585072009e-308, parseFloat<double>("2.2250738585072011e-308"));
+	CPPUNIT_ASSERT_EQUAL(2.2250738585072014e-308, parseFloat<double>("2.2250738585072012e-308"));
+
+	// More than 768 significant digits: exactly halfway between zero and the smallest subnormal number
+	// up to the last digit.
+	string longInput = "2.4703282292062327208828439643411068618252990130716238221279284125033775363510437593264991818081"
+			"799618989828234772285886546332835517796989819938739800539093906315035659515570226392290858392449105184"
+			"435931802849936536152500319370457678249219365623669863658480757001585769269903706311928279558551332927"
+			"834338409351978015531246597263579574622766465272827220056374006485499977096599470454020828166226237857"
+			"393450736339007967761930577506740176324673600968951340535537458516661134223766678604162159680461914467"
+			"291840300530057530849048765391711386591646239524912623653881879636239373280423891018672348497668235089"
+			"863388587925628302755995657524455507255189313690836254779186948667994968324049705821028513185451396213"
+			"837722826145437693412532098591327667236328125";
+	CPPUNIT_ASSERT_EQUAL(0., parseFloat<double>(longInput + "e-324"));
+	CPPUNIT_ASSERT_EQUAL(4.9406564584124654e-324, parseFloat<double>(longInput + string(100, '0') + "1e-324"));
+}
+
+void afc::NumberTest::testParseNumber_DoubleLimits()
+{
+	CPPUNIT_ASSERT_EQUAL(numeric_limits<double>::max(), parseFloat<double>("1.7976931348623157e308"));
+	CPPUNIT_ASSERT_EQUAL(-numeric_limits<double>::max(), parseFloat<double>("-1.7976931348623158e308"));
+	CPPUNIT_ASSERT_EQUAL(numeric_limits<double>::min(), parseFloat<double>("2.2250738585072014e-308"));
+	CPPUNIT_ASSERT_EQUAL(0., parseFloat<double>("1e-400"));
+
+	// Out of range.
+	CPPUNIT_ASSERT(malformedFloat<double>("1.7976931348623159e308"));
+	CPPUNIT_ASSERT(malformedFloat<double>("-1e309"));
+	CPPUNIT_ASSERT(malformedFloat<double>("1e99999999999999999999"));
+	CPPUNIT_ASSERT(malformedFloat<float>("3.4028236e38"));
+}
+
+void afc::NumberTest::testParseNumber_Floats()
+{
+	CPPUNIT_ASSERT_EQUAL(0.f, parseFloat<float>("0"));
+	CPPUNIT_ASSERT_EQUAL(-1.5f, parseFloat<float>("-1.5"));
+	CPPUNIT_ASSERT_EQUAL(0.1f, parseFloat<float>("0.1"));
+	CPPUNIT_ASSERT_EQUAL(3.14159274f, parseFloat<float>("3.14159265358979323846"));
+	CPPUNIT_ASSERT_EQUAL(7.038531e-26f, parseFloat<float>("7.038531e-26"));
+	CPPUNIT_ASSERT_EQUAL(numeric_limits<float>::max(), parseFloat<float>("3.4028235e38"));
+	CPPUNIT_ASSERT_EQUAL(numeric_limits<float>::denorm_min(), parseFloat<float>("1.4e-45"));
+	// Halfway between zero and the smallest subnormal float (2^-150).
+	const string halfDenormMin = "7.00649232162408535461864791644958065640130970938257885878534141944895541342930300743319094181060791015625";
+	CPPUNIT_ASSERT_EQUAL(0.f, parseFloat<float>(halfDenormMin + "e-46"));
+	CPPUNIT_ASSERT_EQUAL(numeric_limits<float>::denorm_min(), parseFloat<float>(halfDenormMin + "000001e-46"));
+	// Halfway between 1 and the next float: rounded to even.
+	CPPUNIT_ASSERT_EQUAL(1.f, parseFloat<float>("1.000000059604644775390625"));
+	CPPUNIT_ASSERT_EQUAL(1.00000012f, parseFloat<float>("1.00000005960464477550"));
+}
+
+void afc::NumberTest::testParseNumber_MalformedDoubles()
+{
+	CPPUNIT_ASSERT(malformedFloat<double>(""));
+	CPPUNIT_ASSERT(malformedFloat<double>("-"));
+	CPPUNIT_ASSERT(malformedFloat<double>("."));
+	CPPUNIT_ASSERT(malformedFloat<double>("-.e1"));
+	CPPUNIT_ASSERT(malformedFloat<double>("e1"));
+	CPPUNIT_ASSERT(malformedFloat<double>("+1"));
+	CPPUNIT_ASSERT(malformedFloat<double>("1e"));
+	CPPUNIT_ASSERT(malformedFloat<double>("1e+"));
+	CPPUNIT_ASSERT(malformedFloat<double>("1.2.3"));
+	CPPUNIT_ASSERT(malformedFloat<double>("12a"));
+	CPPUNIT_ASSERT(malformedFloat<double>("1 "));
+	CPPUNIT_ASSERT(malformedFloat<double>("inf"));
+	CPPUNIT_ASSERT(malformedFloat<double>("nan"));
+
+	const string input = "12.5x";
+	const char *errorPosition = nullptr;
+	double result = 1;
+	parseNumber<10>(input.data(), input.data() + input.size(), result,
+			[&](const char * const pos) { errorPosition = pos; });
+	CPPUNIT_ASSERT_EQUAL(input.data() + 4, errorPosition);
+}
+
+void afc::NumberTest::testParseNumber_DoublesScanMode()
+{
+	{
+		const string input = "-12.5e+3,";
+		double result = 1;
+		const char * const end = parseNumber<10, ParseMode::scan>(input.data(), input.data() + input.size(), result,
+				[](const char *) { CPPUNIT_FAIL("parse error"); });
+		CPPUNIT_ASSERT_EQUAL(-12500., result);
+		CPPUNIT_ASSERT_EQUAL(input.data() + 8, end);
+	}
+
+	{
+		// An incomplete exponent is not a part of the number.
+		const string input = "7.25e+x";
+		double result = 1;
+		const char * const end = parseNumber<10, ParseMode::scan>(input.data(), input.data() + input.size(), result,
+				[](const char *) { CPPUNIT_FAIL("parse error"); });
+		CPPUNIT_ASSERT_EQUAL(7.25, result);
+		CPPUNIT_ASSERT_EQUAL(input.data() + 4, end);
+	}
+
+	{
+		const string input = "x";
+		double result = 1;
+		bool errorReported = false;
+		parseNumber<10, ParseMode::scan>(input.data(), input.data() + input.size(), result,
+				[&](const char *) { errorReported = true; });
+		CPPUNIT_ASSERT(errorReported);
+	}
+}
+
+void afc::NumberTest::testParseNumberCString_Doubles()
+{
+	{
+		ConstStringRef number = "-6.02214076e23"_s;
+		double result = 1;
+
+		const char * const end = parseNumber<10>(number.begin(), result, [](const char *) { CPPUNIT_FAIL("parse error"); });
+		CPPUNIT_ASSERT_EQUAL(-6.02214076e23, result);
+		CPPUNIT_ASSERT_EQUAL(number.end(), end);
+	}
+
+	{
+		ConstStringRef number = "1.25e-3"_s;
+		float result = 1;
+
+		const char * const end = parseNumber<10>(number.begin(), result, [](const char *) { CPPUNIT_FAIL("parse error"); });
+		CPPUNIT_ASSERT_EQUAL(1.25e-3f, result);
+		CPPUNIT_ASSERT_EQUAL(number.end(), end);
+	}
+}
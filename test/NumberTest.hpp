@@ -28,35 +28,81 @@ namespace afc
 		CPPUNIT_TEST(testAppendNumber_MinSignedChar);
 		CPPUNIT_TEST(testAppendNumber_MinSignedLongLong);
 
+		CPPUNIT_TEST(testPrintNumber_DecimalInts);
+		CPPUNIT_TEST(testPrintNumber_DecimalInts_Iterator);
+		CPPUNIT_TEST(testPrintNumber_HexInts);
+
 		CPPUNIT_TEST(testParseNumber_DecimalInts);
 		CPPUNIT_TEST(testParseNumber_DecimalUnsignedInts);
 
 		CPPUNIT_TEST(testParseNumber_HexInts);
 		CPPUNIT_TEST(testParseNumber_HexUnsignedInts);
 
+		CPPUNIT_TEST(testParseNumber_LongDecimalInts);
+		CPPUNIT_TEST(testParseNumber_DecimalIntLimits);
+		CPPUNIT_TEST(testParseNumber_DecimalIntsScanMode);
+		CPPUNIT_TEST(testParseNumber_SignedCharMalformed);
+
 		CPPUNIT_TEST(testParseNumberCString_DecimalInts);
 		CPPUNIT_TEST(testParseNumberCString_DecimalUnsignedInts);
 
 		CPPUNIT_TEST(testParseNumberCString_HexInts);
 		CPPUNIT_TEST(testParseNumberCString_HexUnsignedInts);
 
+		CPPUNIT_TEST(testPrintNumber_Doubles);
+		CPPUNIT_TEST(testPrintNumber_DoubleNotation);
+		CPPUNIT_TEST(testPrintNumber_DoubleSpecialValues);
+		CPPUNIT_TEST(testPrintNumber_DoubleRoundTrip);
+		CPPUNIT_TEST(testPrintNumber_Floats);
+
+		CPPUNIT_TEST(testParseNumber_Doubles);
+		CPPUNIT_TEST(testParseNumber_DoubleRounding);
+		CPPUNIT_TEST(testParseNumber_DoubleLimits);
+		CPPUNIT_TEST(testParseNumber_Floats);
+		CPPUNIT_TEST(testParseNumber_MalformedDoubles);
+		CPPUNIT_TEST(testParseNumber_DoublesScanMode);
+		CPPUNIT_TEST(testParseNumberCString_Doubles);
+
 		CPPUNIT_TEST_SUITE_END();
 	public:
 		void testAppendNumber_Int();
 		void testAppendNumber_MinSignedChar();
 		void testAppendNumber_MinSignedLongLong();
 
+		void testPrintNumber_DecimalInts();
+		void testPrintNumber_DecimalInts_Iterator();
+		void testPrintNumber_HexInts();
+
 		void testParseNumber_DecimalInts();
 		void testParseNumber_DecimalUnsignedInts();
 
 		void testParseNumber_HexInts();
 		void testParseNumber_HexUnsignedInts();
 
+		void testParseNumber_LongDecimalInts();
+		void testParseNumber_DecimalIntLimits();
+		void testParseNumber_DecimalIntsScanMode();
+		void testParseNumber_SignedCharMalformed();
+
 		void testParseNumberCString_DecimalInts();
 		void testParseNumberCString_DecimalUnsignedInts();
 
 		void testParseNumberCString_HexInts();
 		void testParseNumberCString_HexUnsignedInts();
+
+		void testPrintNumber_Doubles();
+		void testPrintNumber_DoubleNotation();
+		void testPrintNumber_DoubleSpecialValues();
+		void testPrintNumber_DoubleRoundTrip();
+		void testPrintNumber_Floats();
+
+		void testParseNumber_Doubles();
+		void testParseNumber_DoubleRounding();
+		void testParseNumber_DoubleLimits();
+		void testParseNumber_Floats();
+		void testParseNumber_MalformedDoubles();
+		void testParseNumber_DoublesScanMode();
+		void testParseNumberCString_Doubles();
 	};
 }
 
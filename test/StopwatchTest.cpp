@@ -0,0 +1,256 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "StopwatchTest.hpp"
+#include <afc/Stopwatch.h>
+#include <afc/logger.hpp>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <time.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::StopwatchTest);
+
+namespace
+{
+	constexpr std::int_fast64_t millisecond = 1000000;
+
+	// A clock that the tests advance, so that the durations measured are exact.
+	struct ManualClock {};
+	std::int_fast64_t manualTime = 0;
+
+	void advance(const std::int_fast64_t nanos)
+	{
+		manualTime += nanos;
+	}
+}
+
+namespace afc
+{
+	template<>
+	inline TimestampNanos now<ManualClock>(ManualClock) noexcept
+	{
+		return TimestampNanos(manualTime);
+	}
+}
+
+namespace
+{
+	typedef afc::BasicStopwatch<ManualClock> ManualStopwatch;
+
+	void sleepMillis(const long millis)
+	{
+		const ::timespec interval = {0, millis * 1000000};
+		::nanosleep(&interval, nullptr);
+	}
+
+	void burnCpu(const std::int_fast64_t nanos)
+	{
+		const std::int_fast64_t end = afc::now(afc::threadCpuClock).nanos() + nanos;
+		while (afc::now(afc::threadCpuClock).nanos() < end) {}
+	}
+
+	template<typename Stopwatch>
+	std::string format(const Stopwatch &stopwatch)
+	{
+		char buf[Stopwatch::maxFormattedSize()];
+		return std::string(buf, stopwatch.format(buf));
+	}
+}
+
+void afc::StopwatchTest::testStartStopResume()
+{
+	ManualStopwatch stopwatch;
+	CPPUNIT_ASSERT(!stopwatch.running());
+	CPPUNIT_ASSERT_EQUAL(ManualStopwatch::duration_type(0), stopwatch.elapsed());
+
+	stopwatch.start();
+	CPPUNIT_ASSERT(stopwatch.running());
+	advance(20 * millisecond);
+	CPPUNIT_ASSERT_EQUAL(20 * millisecond, stopwatch.elapsed());
+	stopwatch.stop();
+	CPPUNIT_ASSERT(!stopwatch.running());
+
+	// The time while stopped is not counted.
+	advance(20 * millisecond);
+	CPPUNIT_ASSERT_EQUAL(20 * millisecond, stopwatch.elapsed());
+	stopwatch.resume();
+	advance(5 * millisecond);
+	CPPUNIT_ASSERT_EQUAL(25 * millisecond, stopwatch.stop().elapsed());
+
+	// start() discards the time measured.
+	stopwatch.start();
+	CPPUNIT_ASSERT_EQUAL(ManualStopwatch::duration_type(0), stopwatch.elapsed());
+	advance(millisecond);
+	CPPUNIT_ASSERT_EQUAL(millisecond, stopwatch.elapsed());
+
+	stopwatch.reset();
+	CPPUNIT_ASSERT(!stopwatch.running());
+	CPPUNIT_ASSERT_EQUAL(ManualStopwatch::duration_type(0), stopwatch.elapsed());
+
+	// The monotonic clock.
+	Stopwatch wall;
+	wall.start();
+	sleepMillis(20);
+	CPPUNIT_ASSERT(wall.stop().elapsed() >= 20 * millisecond);
+}
+
+void afc::StopwatchTest::testLaps()
+{
+	ManualStopwatch stopwatch;
+	stopwatch.start();
+	advance(10 * millisecond);
+	stopwatch.lap();
+	stopwatch.stop();
+	advance(20 * millisecond);
+	stopwatch.resume();
+	advance(5 * millisecond);
+	stopwatch.lap();
+	advance(millisecond);
+	stopwatch.stop();
+
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2), stopwatch.lapCount());
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2), stopwatch.storedLapCount());
+	const ManualStopwatch::duration_type * const laps = stopwatch.laps();
+	CPPUNIT_ASSERT_EQUAL(10 * millisecond, laps[0]);
+	// The stopped time is not a part of the lap.
+	CPPUNIT_ASSERT_EQUAL(5 * millisecond, laps[1]);
+	// The stopwatch ran a little after the last lap.
+	CPPUNIT_ASSERT_EQUAL(16 * millisecond, stopwatch.elapsed());
+	CPPUNIT_ASSERT_EQUAL(std::string("0.016000000s laps: 0.010000000s 0.005000000s"), format(stopwatch));
+
+	stopwatch.start();
+	CPPUNIT_ASSERT_EQUAL(std::size_t(0), stopwatch.lapCount());
+}
+
+void afc::StopwatchTest::testLaps_Overflow()
+{
+	BasicStopwatch<MonotonicClock, 2> stopwatch;
+	stopwatch.start();
+	for (int i = 0; i < 5; ++i) {
+		stopwatch.lap();
+	}
+	stopwatch.stop();
+
+	CPPUNIT_ASSERT_EQUAL(std::size_t(5), stopwatch.lapCount());
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2), stopwatch.storedLapCount());
+
+	const std::string text = format(stopwatch);
+	CPPUNIT_ASSERT(text.find(" laps: ") != std::string::npos);
+	CPPUNIT_ASSERT_EQUAL(std::string(" (3 more)"), text.substr(text.size() - 9));
+}
+
+void afc::StopwatchTest::testThreadCpuClock()
+{
+	BasicStopwatch<ThreadCpuClock> cpu;
+	BasicStopwatch<ProcessCpuClock> processCpu;
+	Stopwatch wall;
+	cpu.start();
+	processCpu.start();
+	wall.start();
+	sleepMillis(30);
+	burnCpu(10 * millisecond);
+	cpu.stop();
+	processCpu.stop();
+	wall.stop();
+
+	// Sleeping does not consume CPU time.
+	CPPUNIT_ASSERT(cpu.elapsed() >= 10 * millisecond);
+	CPPUNIT_ASSERT(cpu.elapsed() < 30 * millisecond);
+	CPPUNIT_ASSERT(wall.elapsed() >= 40 * millisecond);
+	// The process CPU time includes that of this thread.
+	CPPUNIT_ASSERT(processCpu.elapsed() >= 10 * millisecond);
+}
+
+void afc::StopwatchTest::testTscClock()
+{
+	BasicStopwatch<TscClock> tsc;
+	tsc.start();
+	tsc.stop();
+	Stopwatch wall;
+
+	tsc.start();
+	wall.start();
+	sleepMillis(20);
+	tsc.stop();
+	wall.stop();
+
+	CPPUNIT_ASSERT(tsc.elapsed() >= 19 * millisecond);
+	CPPUNIT_ASSERT(tsc.elapsed() <= wall.elapsed() + millisecond);
+}
+
+void afc::StopwatchTest::testPrintDuration()
+{
+	char buf[helper::maxDurationSize()];
+	CPPUNIT_ASSERT_EQUAL(std::string("0.000000000s"), std::string(buf, helper::printDuration(0, buf)));
+	CPPUNIT_ASSERT_EQUAL(std::string("1.000250000s"), std::string(buf, helper::printDuration(1000250000, buf)));
+	CPPUNIT_ASSERT_EQUAL(std::string("-0.000000001s"), std::string(buf, helper::printDuration(-1, buf)));
+	CPPUNIT_ASSERT_EQUAL(std::string("9223372036.854775807s"),
+			std::string(buf, helper::printDuration(INT64_MAX, buf)));
+	CPPUNIT_ASSERT_EQUAL(std::string("-9223372036.854775808s"),
+			std::string(buf, helper::printDuration(INT64_MIN, buf)));
+
+	Stopwatch stopwatch;
+	CPPUNIT_ASSERT_EQUAL(std::string("0.000000000s"), format(stopwatch));
+}
+
+void afc::StopwatchTest::testPrint()
+{
+	std::ostringstream out;
+	ManualStopwatch stopwatch;
+	stopwatch.print(out);
+	CPPUNIT_ASSERT_EQUAL(std::string("Not started\n"), out.str());
+
+	// The format flags of the stream do not affect the output.
+	out.str("");
+	out.flags(std::ios_base::hex | std::ios_base::scientific);
+	out.width(20);
+	out.precision(2);
+	stopwatch.start();
+	advance(1500 * millisecond);
+	stopwatch.print(out);
+	stopwatch.lap();
+	advance(millisecond);
+	stopwatch.stop().print(out);
+	CPPUNIT_ASSERT_EQUAL(std::string("1.500000000s\n1.501000000s laps: 1.500000000s\n"), out.str());
+
+	out.str("");
+	stopwatch.reset().print(out);
+	CPPUNIT_ASSERT_EQUAL(std::string("Not started\n"), out.str());
+}
+
+void afc::StopwatchTest::testLog()
+{
+	BasicStopwatch<MonotonicClock, 1> stopwatch;
+	stopwatch.start();
+	stopwatch.lap();
+	stopwatch.lap();
+	stopwatch.stop();
+	const std::string expected = format(stopwatch) + '\n';
+
+	std::FILE * const file = std::tmpfile();
+	CPPUNIT_ASSERT(file != nullptr);
+	CPPUNIT_ASSERT(afc::logger::logToFile<false>(file, StopwatchView(stopwatch)));
+	CPPUNIT_ASSERT(afc::logger::logToFileFmt<false>(file, AFC_FMT("#"), StopwatchView(stopwatch)));
+	CPPUNIT_ASSERT(afc::logger::logPrint<const StopwatchView &>(StopwatchView(stopwatch), file));
+	CPPUNIT_ASSERT(afc::logger::logText("\n", 1, file));
+
+	std::fflush(file);
+	std::rewind(file);
+	char buf[4096];
+	const std::size_t n = std::fread(buf, 1, sizeof(buf), file);
+	std::fclose(file);
+	CPPUNIT_ASSERT_EQUAL(expected + expected + expected, std::string(buf, n));
+}
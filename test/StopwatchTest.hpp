@@ -0,0 +1,48 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_STOPWATCHTEST_HPP_
+#define AFC_STOPWATCHTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class StopwatchTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(StopwatchTest);
+		CPPUNIT_TEST(testStartStopResume);
+		CPPUNIT_TEST(testLaps);
+		CPPUNIT_TEST(testLaps_Overflow);
+		CPPUNIT_TEST(testThreadCpuClock);
+		CPPUNIT_TEST(testTscClock);
+		CPPUNIT_TEST(testPrintDuration);
+		CPPUNIT_TEST(testPrint);
+		CPPUNIT_TEST(testLog);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testStartStopResume();
+		void testLaps();
+		void testLaps_Overflow();
+		void testThreadCpuClock();
+		void testTscClock();
+		void testPrintDuration();
+		void testPrint();
+		void testLog();
+	};
+}
+
+#endif /* AFC_STOPWATCHTEST_HPP_ */
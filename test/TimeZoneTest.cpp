@@ -0,0 +1,290 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "TimeZoneTest.hpp"
+#include <afc/dateutil.hpp>
+#include <afc/TimeZone.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+// POSIX API.
+#include <time.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::TimeZoneTest);
+
+using afc::TimeZone;
+using std::int_fast64_t;
+using std::string;
+using std::unique_ptr;
+
+namespace
+{
+	int_fast64_t utcTime(const int year, const int month, const int day, const int hour, const int minute,
+			const int second)
+	{
+		return (afc::helper::daysFromCivil(year, month, day) * 24 + hour) * 3600 + minute * 60 + second;
+	}
+
+	void assertOffset(const TimeZone &timeZone, const int_fast64_t time, const long gmtOffset, const bool dst,
+			const char * const abbreviation)
+	{
+		const TimeZone::Offset &offset = timeZone.offsetAt(time);
+		CPPUNIT_ASSERT_EQUAL(gmtOffset, offset.gmtOffset);
+		CPPUNIT_ASSERT_EQUAL(dst, offset.dst);
+		CPPUNIT_ASSERT_EQUAL(string(abbreviation), string(offset.abbreviation));
+	}
+
+	string readFile(const char * const path)
+	{
+		std::FILE * const file = std::fopen(path, "rb");
+		CPPUNIT_ASSERT_MESSAGE(path, file != nullptr);
+		string result;
+		char buf[4096];
+		std::size_t n;
+		while ((n = std::fread(buf, 1, sizeof(buf), file)) > 0) {
+			result.append(buf, n);
+		}
+		std::fclose(file);
+		return result;
+	}
+
+	void setTimeZone(const char * const tz)
+	{
+		::setenv("TZ", tz, true);
+		::tzset();
+	}
+}
+
+void afc::TimeZoneTest::setUp()
+{
+	const char * const tz = std::getenv("TZ");
+	if (tz != nullptr) {
+		m_timeZoneBackup.reset(new string(tz));
+	}
+}
+
+void afc::TimeZoneTest::tearDown()
+{
+	if (m_timeZoneBackup != nullptr) {
+		::setenv("TZ", m_timeZoneBackup->c_str(), true);
+	} else {
+		::unsetenv("TZ");
+	}
+	refreshLocalTimeZone();
+}
+
+void afc::TimeZoneTest::testFromRule()
+{
+	const unique_ptr<TimeZone> timeZone = TimeZone::fromRule("EST5EDT,M3.2.0,M11.1.0");
+	CPPUNIT_ASSERT(timeZone != nullptr);
+
+	assertOffset(*timeZone, utcTime(2019, 3, 10, 6, 59, 59), -5 * 3600, false, "EST");
+	assertOffset(*timeZone, utcTime(2019, 3, 10, 7, 0, 0), -4 * 3600, true, "EDT");
+	assertOffset(*timeZone, utcTime(2019, 11, 3, 5, 59, 59), -4 * 3600, true, "EDT");
+	assertOffset(*timeZone, utcTime(2019, 11, 3, 6, 0, 0), -5 * 3600, false, "EST");
+	assertOffset(*timeZone, utcTime(1950, 7, 1, 0, 0, 0), -4 * 3600, true, "EDT");
+	assertOffset(*timeZone, utcTime(2150, 1, 1, 0, 0, 0), -5 * 3600, false, "EST");
+
+	const unique_ptr<TimeZone> fixed = TimeZone::fromRule("<+0330>-3:30");
+	CPPUNIT_ASSERT(fixed != nullptr);
+	assertOffset(*fixed, 0, 210 * 60, false, "+0330");
+	assertOffset(*fixed, utcTime(2100, 7, 1, 0, 0, 0), 210 * 60, false, "+0330");
+}
+
+void afc::TimeZoneTest::testFromRule_SouthernHemisphere()
+{
+	// DST from the first Sunday of October 02:00 till the first Sunday of April 03:00.
+	const unique_ptr<TimeZone> timeZone = TimeZone::fromRule("AEST-10AEDT,M10.1.0,M4.1.0/3");
+	CPPUNIT_ASSERT(timeZone != nullptr);
+
+	assertOffset(*timeZone, utcTime(1900, 1, 1, 0, 0, 0), 11 * 3600, true, "AEDT");
+	assertOffset(*timeZone, utcTime(2019, 4, 6, 15, 59, 59), 11 * 3600, true, "AEDT");
+	assertOffset(*timeZone, utcTime(2019, 4, 6, 16, 0, 0), 10 * 3600, false, "AEST");
+	assertOffset(*timeZone, utcTime(2019, 10, 5, 15, 59, 59), 10 * 3600, false, "AEST");
+	assertOffset(*timeZone, utcTime(2019, 10, 5, 16, 0, 0), 11 * 3600, true, "AEDT");
+}
+
+void afc::TimeZoneTest::testFromRule_Malformed()
+{
+	const char * const malformed[] = {
+		"",
+		"E5",
+		"EST",
+		"EST+",
+		"EST5EDT,",
+		"EST5EDT,M3.2.0",
+		"EST5EDT,M13.2.0,M11.1.0",
+		"EST5EDT,M3.6.0,M11.1.0",
+		"EST5EDT,M3.2.7,M11.1.0",
+		"EST5EDT,J0,M11.1.0",
+		"EST5EDT,M3.2.0/,M11.1.0",
+		"EST5EDT,M3.2.0,M11.1.0x",
+		"<ABC-1",
+	};
+	for (const char * const rule : malformed) {
+		CPPUNIT_ASSERT_MESSAGE(rule, TimeZone::fromRule(rule) == nullptr);
+	}
+}
+
+void afc::TimeZoneTest::testFromTZif_Malformed()
+{
+	const string data = readFile("/usr/share/zoneinfo/Europe/Berlin");
+	CPPUNIT_ASSERT(TimeZone::fromTZif(data.data(), data.size()) != nullptr);
+
+	for (std::size_t n = 0; n < data.size(); ++n) {
+		CPPUNIT_ASSERT(TimeZone::fromTZif(data.data(), n) == nullptr);
+	}
+
+	string badMagic = data;
+	badMagic[0] = 'X';
+	CPPUNIT_ASSERT(TimeZone::fromTZif(badMagic.data(), badMagic.size()) == nullptr);
+}
+
+void afc::TimeZoneTest::testToUtc_Transitions()
+{
+	const unique_ptr<TimeZone> timeZone = TimeZone::fromRule("CET-1CEST,M3.5.0,M10.5.0/3");
+	CPPUNIT_ASSERT(timeZone != nullptr);
+
+	std::tm local = {};
+	local.tm_year = 2019 - 1900;
+	local.tm_mon = 9;
+	local.tm_mday = 27;
+	local.tm_hour = 2;
+	local.tm_min = 30;
+
+	// 02:30 occurs twice on 2019-10-27.
+	local.tm_isdst = -1;
+	CPPUNIT_ASSERT_EQUAL(utcTime(2019, 10, 27, 0, 30, 0), timeZone->toUtc(local));
+	local.tm_isdst = 1;
+	CPPUNIT_ASSERT_EQUAL(utcTime(2019, 10, 27, 0, 30, 0), timeZone->toUtc(local));
+	local.tm_isdst = 0;
+	CPPUNIT_ASSERT_EQUAL(utcTime(2019, 10, 27, 1, 30, 0), timeZone->toUtc(local));
+
+	// 02:30 is skipped on 2019-03-31; the offset before the transition is used.
+	local.tm_mon = 2;
+	local.tm_mday = 31;
+	local.tm_isdst = -1;
+	CPPUNIT_ASSERT_EQUAL(utcTime(2019, 3, 31, 1, 30, 0), timeZone->toUtc(local));
+
+	// Out-of-range fields are carried over.
+	local.tm_mon = 12;
+	local.tm_mday = 0;
+	local.tm_hour = 25;
+	local.tm_min = -30;
+	CPPUNIT_ASSERT_EQUAL(utcTime(2019, 12, 31, 23, 30, 0), timeZone->toUtc(local));
+}
+
+void afc::TimeZoneTest::testMatchesLocaltime()
+{
+	// glibc applies POSIX TZ rules to years since 1970 only.
+	const int_fast64_t since1901 = -2145916800;
+	const struct
+	{
+		const char *tz;
+		int_fast64_t since;
+	} zones[] = {
+		{"Europe/Berlin", since1901},
+		{"America/New_York", since1901},
+		{"America/St_Johns", since1901},
+		{"Australia/Sydney", since1901},
+		{"Asia/Kolkata", since1901},
+		{"Europe/Minsk", since1901},
+		{":Pacific/Chatham", since1901},
+		{"", since1901},
+		{"ABC-12:30", since1901},
+		{"EST5EDT,M3.2.0,M11.1.0", 0},
+		{"AEST-10AEDT,M10.1.0,M4.1.0/3", 0},
+	};
+	for (const auto &zone : zones) {
+		setTimeZone(zone.tz);
+		const unique_ptr<TimeZone> timeZone = TimeZone::load(zone.tz);
+		CPPUNIT_ASSERT_MESSAGE(zone.tz, timeZone != nullptr);
+
+		// Till 2150.
+		for (int_fast64_t t = zone.since; t < 5680281600; t += 54321) {
+			const std::time_t time = std::time_t(t);
+			std::tm expected;
+			CPPUNIT_ASSERT(::localtime_r(&time, &expected) != nullptr);
+			std::tm actual;
+			timeZone->toLocal(t, actual);
+
+			const string message = string(zone.tz) + " at " + std::to_string(t);
+			CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_gmtoff, actual.tm_gmtoff);
+			CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_isdst, actual.tm_isdst);
+			CPPUNIT_ASSERT_EQUAL_MESSAGE(message, string(expected.tm_zone), string(actual.tm_zone));
+			CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_year, actual.tm_year);
+			CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_mon, actual.tm_mon);
+			CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_mday, actual.tm_mday);
+			CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_hour, actual.tm_hour);
+			CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_min, actual.tm_min);
+			CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_sec, actual.tm_sec);
+			CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_wday, actual.tm_wday);
+			CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_yday, actual.tm_yday);
+
+			/* A local time repeated by a transition between offsets with the same DST flag
+			 * (e.g. in Berlin in 1947) is ambiguous; any of its interpretations is accepted.
+			 */
+			const int_fast64_t utc = timeZone->toUtc(expected);
+			if (utc != t) {
+				std::tm roundTrip;
+				timeZone->toLocal(utc, roundTrip);
+				CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_isdst, roundTrip.tm_isdst);
+				CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_mday, roundTrip.tm_mday);
+				CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_hour, roundTrip.tm_hour);
+				CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_min, roundTrip.tm_min);
+				CPPUNIT_ASSERT_EQUAL_MESSAGE(message, expected.tm_sec, roundTrip.tm_sec);
+			}
+		}
+	}
+}
+
+void afc::TimeZoneTest::testLocalTimeZone_Refresh()
+{
+	setTimeZone("America/New_York");
+	CPPUNIT_ASSERT(refreshLocalTimeZone());
+	CPPUNIT_ASSERT_EQUAL(string("EST"), string(localTimeZone().offsetAt(utcTime(2019, 1, 1, 0, 0, 0)).abbreviation));
+
+	DateTime dateTime;
+	dateTime = std::time_t(utcTime(2019, 7, 4, 16, 30, 15));
+	CPPUNIT_ASSERT_EQUAL(2019L, dateTime.getYear());
+	CPPUNIT_ASSERT_EQUAL(7u, dateTime.getMonth());
+	CPPUNIT_ASSERT_EQUAL(4u, dateTime.getDay());
+	CPPUNIT_ASSERT_EQUAL(12u, dateTime.getHour());
+	CPPUNIT_ASSERT_EQUAL(30u, dateTime.getMinute());
+	CPPUNIT_ASSERT_EQUAL(15u, dateTime.getSecond());
+	CPPUNIT_ASSERT_EQUAL(-4L * 3600, dateTime.getGmtOffet());
+	CPPUNIT_ASSERT_EQUAL(Timestamp::time_type(utcTime(2019, 7, 4, 16, 30, 15)) * 1000, dateTime.timestamp().millis());
+
+	// The zone replaced stays valid.
+	const TimeZone &newYork = localTimeZone();
+	setTimeZone("Asia/Kolkata");
+	CPPUNIT_ASSERT(refreshLocalTimeZone());
+	CPPUNIT_ASSERT(&localTimeZone() != &newYork);
+	CPPUNIT_ASSERT_EQUAL(-5L * 3600, newYork.offsetAt(utcTime(2019, 1, 1, 0, 0, 0)).gmtOffset);
+
+	dateTime = std::time_t(utcTime(2019, 7, 4, 16, 30, 15));
+	CPPUNIT_ASSERT_EQUAL(22u, dateTime.getHour());
+	CPPUNIT_ASSERT_EQUAL(0u, dateTime.getMinute());
+	CPPUNIT_ASSERT_EQUAL(Timestamp::time_type(utcTime(2019, 7, 4, 16, 30, 15)) * 1000, dateTime.timestamp().millis());
+
+	// Unknown zones are UTC.
+	setTimeZone(":No/Such_Zone");
+	CPPUNIT_ASSERT(!refreshLocalTimeZone());
+	CPPUNIT_ASSERT_EQUAL(0L, localTimeZone().offsetAt(0).gmtOffset);
+}
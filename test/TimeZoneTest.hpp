@@ -0,0 +1,54 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_TIMEZONETEST_HPP_
+#define AFC_TIMEZONETEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <memory>
+#include <string>
+
+namespace afc
+{
+	class TimeZoneTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(TimeZoneTest);
+		CPPUNIT_TEST(testFromRule);
+		CPPUNIT_TEST(testFromRule_SouthernHemisphere);
+		CPPUNIT_TEST(testFromRule_Malformed);
+		CPPUNIT_TEST(testFromTZif_Malformed);
+		CPPUNIT_TEST(testToUtc_Transitions);
+		CPPUNIT_TEST(testMatchesLocaltime);
+		CPPUNIT_TEST(testLocalTimeZone_Refresh);
+		CPPUNIT_TEST_SUITE_END();
+
+		std::unique_ptr<std::string> m_timeZoneBackup;
+	public:
+		void setUp() override;
+		void tearDown() override;
+
+		void testFromRule();
+		void testFromRule_SouthernHemisphere();
+		void testFromRule_Malformed();
+		void testFromTZif_Malformed();
+		void testToUtc_Transitions();
+		void testMatchesLocaltime();
+		void testLocalTimeZone_Refresh();
+	};
+}
+
+#endif /* AFC_TIMEZONETEST_HPP_ */
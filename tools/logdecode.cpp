@@ -0,0 +1,56 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2010-2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+// Renders binary logs written by afc::logger::BinaryLogger as text.
+//
+// Usage: afc-logdecode [file...]
+// The standard input is decoded if no file is specified.
+
+#include <afc/BinaryLogger.hpp>
+#include <afc/Exception.h>
+#include <afc/stream.h>
+#include <cstdio>
+
+namespace
+{
+	bool decodeFile(const char * const path)
+	{
+		try {
+			afc::FileInputStream in(path);
+			if (!afc::logger::decodeBinaryLog(in, stdout)) {
+				std::fprintf(stderr, "%s: malformed or truncated binary log\n", path);
+				return false;
+			}
+			return true;
+		} catch (const afc::Exception &ex) {
+			std::fprintf(stderr, "%s: %s\n", path, ex.what());
+			return false;
+		}
+	}
+}
+
+int main(const int argc, const char * const argv[])
+{
+	if (argc < 2) {
+		return decodeFile("/dev/stdin") ? 0 : 1;
+	}
+
+	bool success = true;
+	for (int i = 1; i < argc; ++i) {
+		success &= decodeFile(argv[i]);
+	}
+	return success ? 0 : 1;
+}